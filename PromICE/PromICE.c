@@ -26,6 +26,7 @@
 //        Global options applicable to all commands
 //          -p port     -> set COM port
 //          -b baud     -> set serial baud rate
+//          -t          -> show serial and timing statistics
 //      
 //        Commands (only one may appear!)
 //          v[erify]    -> verify communication with PromICE
@@ -37,10 +38,13 @@
 //          -f dd       -> fill unused locations with dd
 //          -v          -> verify after downloading
 //          -s size     -> set size of emulated device
+//          -n          -> don't use the cache, download everything
+//          -w          -> split one 16 bit image between two units
 //
 // ENVIRONMENT VARIABLES:
 //        PROMICE_PORT  -> set the default serial port to use
 //        PROMICE_BAUD  -> set the default serial baud rate
+//        PROMICE_CACHE -> set the directory for the download cache
 //
 // NOTES:
 //   Yes, Grammer Engine does have a LOADICE program which already does all
@@ -51,10 +55,28 @@
 // master unit, or the bottom connector on the back panel) and the second file
 // is downloaded to unit 1 (the slave, or upper connector on the back).  This
 // program assumes that both emulated EPROMs are the same size, although I don't
-// think the actual PromICE hardware requires that.
+// think the actual PromICE hardware requires that.  Both units are downloaded
+// at the same time, with the chunks for each interleaved on the serial line.
+//
+//   For a sixteen bit target the -w option takes just one file, twice the size
+// of one EPROM, and splits it - the even bytes go to unit 0 and the odd bytes
+// go to unit 1.
+//
+//   Every image successfully downloaded is saved in a cache file, named for
+// the serial port, the unit and the PromICE serial number.  The next time we
+// download to that unit only the 256 byte chunks that have changed are sent.
+// A few random chunks are uploaded first and compared with the cache, just in
+// case something else has loaded the PromICE since.  The cache file is deleted
+// before the download starts, so an interrupted download never leaves a bad
+// cache behind.
 //
 // REVISION HISTORY:
 // 27-MAR-23  RLA  New file.
+// 14-OCT-26  AGT  .HEX files with extended addresses can load more than 64K.
+// 14-OCT-26  AGT  Stream downloads without waiting for every chunk.
+// 14-OCT-26  AGT  Only download the chunks that changed since last time.
+// 14-OCT-26  AGT  Download both master/slave units at once, and add -w.
+// 14-OCT-26  AGT  Add -t to show serial and timing statistics.
 //--
 //000000001111111111222222222233333333334444444444555555555566666666667777777777
 //234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -67,17 +89,24 @@
 #include <memory.h>             // memset(), et al ...
 #include <string.h>             // strlen(), strcpy(), strcat(), etc...
 #include <ctype.h>              // islower(), toupper(), etc...
+#include <time.h>               // time() (to seed rand()) ...
 #ifdef __linux__
 #include <strings.h>		// strcasecmp(), strncasecmp(), ...
 #include <limits.h>		// PATH_MAX, etc ...
 #include <libgen.h>		// basename(), dirname(), ...
 #include <errno.h>		// errno_t, etc ...
+#include <fcntl.h>		// open(), O_EXCL, O_NOFOLLOW, ...
+#include <unistd.h>		// getuid(), ...
+#include <sys/stat.h>		// mkdir(), fstat(), ...
 #endif
 #include "PromICE.h"            // global declarations for this project
 #include "serial.h"             // host dependent serial port interface
 #include "protocol.h"           // GEI protocol definitions
 #include "hexfile.h"            // Intel .HEX file routines
 
+// Downloads are done in pieces this big, just so we can show the progress ...
+#define DOWNLOAD_BLOCK  8192UL
+
 // Locals to this module ...
 PRIVATE PROMICE_COMMAND m_Command;    // command to execute 
 PRIVATE char    *m_pszSerialPort;     // PromICE serial port
@@ -85,6 +114,9 @@ PRIVATE uint32_t m_lBaudRate;         // PromICE baud rate
 PRIVATE uint32_t m_lEmulationSize;    // size of EPROM to emulate
 PRIVATE uint8_t  m_bFillerByte;       // fill unused locations
 PRIVATE bool     m_fVerifyDownload;   // verify after downloading
+PRIVATE bool     m_fUseCache;         // only download what's changed
+PRIVATE bool     m_fSplitWord;        // split one 16 bit image between units
+PRIVATE bool     m_fStatistics;       // print serial and timing statistics
 PRIVATE char m_szFileName1[_MAX_PATH];// first file name to download
 PRIVATE char m_szFileName2[_MAX_PATH];// second file name to download
 
@@ -252,63 +284,320 @@ PRIVATE uint8_t *LoadFile (char *pszFileName, uint32_t lSize)
   //--
   if (strlen(pszFileName) == 0)
     FatalError("not enough file names");
-  if (lSize > 65536)
-    FatalError("unable to load .HEX file larger than 64K");
   ApplyDefaultExtension(pszFileName, ".hex");
   uint8_t *pabData = malloc(lSize);
   if (pabData == NULL)
-    FatalError("out of memory memory");
+    FatalError("out of memory");
   memset(pabData, m_bFillerByte, lSize);
   uint32_t cbTotal = hexLoad(pszFileName, pabData, 0, lSize);
   fprintf(stderr, "%d bytes loaded from %s\n", cbTotal, pszFileName);
   return pabData;
 }
 
-PRIVATE void DownloadUnit (uint8_t bUnit, uint8_t *pabData, uint32_t lSize, bool fVerify)
+PRIVATE void CacheFileName (char *pszFile, uint8_t bUnit, uint32_t lSerial)
+{
+  //++
+  //   Build the name of the cache file for this unit.  It's named for the
+  // serial port, the unit number and the PromICE serial number, so that a
+  // different PromICE on the same port (or the same one on a different port)
+  // never picks up the wrong image.  Any path separators in the port name
+  // are replaced so that the result is a legal file name ...
+  //
+  //   The cache goes in a directory that belongs to this user - never a
+  // shared one like /tmp, where anybody could plant a fake image or a link
+  // with the same name.  On Linux that's $XDG_CACHE_HOME/promice or else
+  // ~/.cache/promice, created (mode 0700) if it doesn't exist.  On Windows
+  // TEMP is already private to the user ...
+  //--
+  const char *pszDir = getenv(CACHEDIRENV);
+#ifdef _WIN32
+  if (pszDir == NULL)  pszDir = getenv("TEMP");
+  if (pszDir == NULL)  pszDir = ".";
+#else
+  static char szDir[_MAX_PATH];
+  if (pszDir == NULL) {
+    const char *pszBase = getenv("XDG_CACHE_HOME");
+    int cch;
+    if ((pszBase != NULL) && (*pszBase != EOS)) {
+      cch = snprintf(szDir, sizeof(szDir), "%s/promice", pszBase);
+    } else {
+      if ((pszBase = getenv("HOME")) == NULL)
+        FatalError("set HOME or %s for the download cache", CACHEDIRENV);
+      cch = snprintf(szDir, sizeof(szDir), "%s/.cache", pszBase);
+      if ((cch < (int) sizeof(szDir)) && (mkdir(szDir, 0700) != 0) && (errno != EEXIST))
+        Message("unable to create %s", szDir);
+      cch = snprintf(szDir, sizeof(szDir), "%s/.cache/promice", pszBase);
+    }
+    if (cch >= (int) sizeof(szDir))
+      FatalError("cache directory name too long");
+    if ((mkdir(szDir, 0700) != 0) && (errno != EEXIST))
+      Message("unable to create %s", szDir);
+    pszDir = szDir;
+  }
+#endif
+  char szPort[64];  size_t i;
+  for (i = 0;  (m_pszSerialPort[i] != '\0') && (i < sizeof(szPort)-1);  ++i) {
+    char ch = m_pszSerialPort[i];
+    szPort[i] = ((ch == '/') || (ch == '\\') || (ch == ':')) ? '_' : ch;
+  }
+  szPort[i] = '\0';
+  if (snprintf(pszFile, _MAX_PATH, "%s/promice-%s-%d-%08X.img", pszDir, szPort, bUnit, lSerial) >= _MAX_PATH)
+    FatalError("cache directory name too long");
+}
+
+PRIVATE uint8_t *ReadCache (const char *pszFile, uint32_t lSize)
+{
+  //++
+  //   Read the cached image for this unit and return a pointer to it, or NULL
+  // if there's no cache file.  If the file isn't exactly the right size (say
+  // the emulation size was changed with "-s") then it's no good either.  On
+  // Linux it also has to be a plain file (not a link) that belongs to us ...
+  //--
+#ifdef __linux__
+  struct stat st;
+  int fd = open(pszFile, O_RDONLY | O_NOFOLLOW);
+  if (fd == -1)  return NULL;
+  if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_uid != getuid())) {
+    close(fd);  return NULL;
+  }
+  FILE *f = fdopen(fd, "rb");
+  if (f == NULL) {
+    close(fd);  return NULL;
+  }
+#else
+  FILE *f = fopen(pszFile, "rb");
+  if (f == NULL)  return NULL;
+#endif
+  uint8_t *pabCache = malloc(lSize+1);
+  if (pabCache == NULL)
+    FatalError("out of memory");
+  size_t cb = fread(pabCache, 1, lSize+1, f);
+  fclose(f);
+  if (cb != lSize) {
+    free(pabCache);  return NULL;
+  }
+  return pabCache;
+}
+
+PRIVATE void WriteCache (const char *pszFile, uint8_t *pabData, uint32_t lSize)
+{
+  //++
+  //   Save the image we just downloaded in the cache.  If that fails it's not
+  // fatal - the download worked, and next time we'll just send everything.
+  // The old file was deleted before the download, so on Linux we insist on
+  // creating a new one (mode 0600) and won't follow a link somebody else put
+  // there in the meantime ...
+  //--
+#ifdef __linux__
+  int fd = open(pszFile, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+  FILE *f = (fd != -1) ? fdopen(fd, "wb") : NULL;
+  if ((f == NULL) && (fd != -1))  close(fd);
+#else
+  FILE *f = fopen(pszFile, "wb");
+#endif
+  if (f == NULL) {
+    Message("unable to write cache %s", pszFile);  return;
+  }
+  size_t cb = fwrite(pabData, 1, lSize, f);
+  if ((fclose(f) != 0) || (cb != lSize)) {
+    Message("unable to write cache %s", pszFile);  remove(pszFile);
+  }
+}
+
+PRIVATE bool ProbeCache (uint8_t bUnit, uint8_t *pabCache, uint32_t lSize, uint32_t lMask)
+{
+  //++
+  //   Upload a few randomly chosen chunks from the PromICE and compare them to
+  // the cached image.  This isn't a guarantee, of course, but it'll catch the
+  // usual case of somebody (or something) else loading the emulator since our
+  // last download, or the PromICE being power cycled.  Returns true if all
+  // the chunks match ...
+  //--
+  uint8_t abProbe[GEI_MAXDATALEN];  uint32_t nChunks = lSize / GEI_MAXDATALEN;
+  if (nChunks == 0)  return false;
+  for (uint32_t i = 0;  i < CACHE_PROBES;  ++i) {
+    uint32_t lAddress = ((uint32_t) rand() % nChunks) * GEI_MAXDATALEN;
+    geiUpload(bUnit, abProbe, GEI_MAXDATALEN, lAddress | lMask);
+    if (memcmp(abProbe, pabCache+lAddress, GEI_MAXDATALEN) != 0)  return false;
+  }
+  return true;
+}
+
+PRIVATE bool ChunkChanged (uint8_t *pabData, uint8_t *pabCache, uint32_t lAddress, uint32_t lEnd)
+{
+  //++
+  //   Return true if the chunk starting at lAddress is different from the
+  // cached image.  Chunks are GEI_MAXDATALEN bytes, except that the last one
+  // stops at lEnd.  With no cache at all, everything has changed ...
+  //--
+  if (pabCache == NULL)  return true;
+  uint32_t cb = lEnd - lAddress;
+  if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
+  return memcmp(pabData+lAddress, pabCache+lAddress, cb) != 0;
+}
+
+PRIVATE void DownloadUnits (uint8_t nUnits, uint8_t *apabData[], uint32_t lSize, uint8_t *apabCache[], bool fVerify)
 {
   //++
   //   This routine handles the actual downloading, with optional verification,
-  // of an EPROM image to a single PromICE unit.  The maximum chunk that we can
-  // send to the PromICE in one message is only 256 bytes, so most images will
-  // require a number of chunks to be sent.
+  // of the EPROM images to one or two (master/slave) PromICE units, starting
+  // with unit 0.  The maximum chunk that we can send to the PromICE in one
+  // message is only 256 bytes, so most images will require a number of chunks
+  // to be sent.  They're streamed back to back, without waiting for each one
+  // to be acknowledged, and with two units the chunks for both are interleaved
+  // on the serial line (see geiStreamDownloadUnits()).
+  //
+  //   If apabCache[unit] isn't NULL then it's what we believe that unit
+  // already contains, and only the chunks that are different get sent.
+  // Consecutive changed chunks are still streamed together.
   //
   //   If the fVerify parameter is true, then after downloading this routine
   // will try to upload the data from the PromICE and compare it to what we
   // originally sent.  If they're not the same then a fatal error occurs and
-  // we abort.
+  // we abort.  The whole image is always verified, even the chunks that the
+  // cache says didn't change, since that's the only way to catch a cache
+  // that passed the probe but is wrong anyway.
+  //
+  //   With "-t" we also time the download and the verify, and print the
+  // effective rate - the image size over the time taken, however much of it
+  // actually had to be sent.  That's what "make bench" collects.
   //--
   uint32_t lMask = geiAddressMask(lSize);  uint8_t abVerify[GEI_MAXDATALEN];
-  fprintf(stderr, "Unit %d: %dK bytes ...", bUnit, (lSize>>10));
+  uint32_t lChanged = 0;  bool fCached = false;  uint8_t u;
+  uint64_t llStart = serGetTime(), llDownload, llVerify = 0;
+  char szUnits[16];
+  assert((nUnits > 0) && (nUnits <= MAXUNIT));
+  if (nUnits > 1)
+    sprintf(szUnits, "Units 0+%d", nUnits-1);
+  else
+    strcpy(szUnits, "Unit 0");
+  for (u = 0;  u < nUnits;  ++u)  if (apabCache[u] != NULL)  fCached = true;
+  fprintf(stderr, "%s: %dK bytes ...", szUnits, (lSize>>10));
 
   //printf(" Filling 0x%02X ...", m_bFillerByte);
   //geiFillRAM(bUnit, m_bFillerByte);
 
+  //   The data is streamed to the PromICE by geiStreamDownloadUnits(), and we
+  // only break it up into DOWNLOAD_BLOCK pieces to show the progress.  Each
+  // pass through the inner loop finds the next run of changed chunks for every
+  // unit and streams them all together ...
   uint32_t lAddress, lCount;
   for (lAddress = lCount = 0;  lCount < lSize;) {
     uint32_t cb = lSize-lCount;
-    if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
-    if ((lCount & 0x3FF) == 0)
-      fprintf(stderr, "\rUnit %d: %dK bytes ... Downloading %dK ...", bUnit, (lSize >> 10), (lCount >> 10));
-    geiDownload(bUnit, pabData+lCount, cb, lAddress | lMask);
+    if (cb > DOWNLOAD_BLOCK)  cb = DOWNLOAD_BLOCK;
+    fprintf(stderr, "\r%s: %dK bytes ... Downloading %dK ...", szUnits, (lSize >> 10), (lCount >> 10));
+    uint32_t alRun[MAXUNIT], lEnd = lAddress+cb;
+    for (u = 0;  u < nUnits;  ++u)  alRun[u] = lAddress;
+    for (;;) {
+      GEI_STREAM aStreams[MAXUNIT];  uint8_t nStreams = 0;
+      for (u = 0;  u < nUnits;  ++u) {
+        uint32_t lRun = alRun[u];
+        while ((lRun < lEnd) && !ChunkChanged(apabData[u], apabCache[u], lRun, lEnd))
+          lRun += GEI_MAXDATALEN;
+        uint32_t lStart = lRun;
+        while ((lRun < lEnd) && ChunkChanged(apabData[u], apabCache[u], lRun, lEnd))
+          lRun += GEI_MAXDATALEN;
+        if (lRun > lEnd)  lRun = lEnd;
+        alRun[u] = lRun;
+        if (lRun == lStart)  continue;
+        aStreams[nStreams].bUnit = u;
+        aStreams[nStreams].pabData = apabData[u]+lStart;
+        aStreams[nStreams].cbData = lRun-lStart;
+        aStreams[nStreams].lAddress = lStart | lMask;
+        ++nStreams;  lChanged += lRun-lStart;
+      }
+      if (nStreams == 0)  break;
+      geiStreamDownloadUnits(aStreams, nStreams);
+    }
     lCount += cb;  lAddress += cb;
   }
-  fprintf(stderr, "\rUnit %d: %dK bytes ... Downloading %dK ...", bUnit, (lSize >> 10), (lCount >> 10));
+  fprintf(stderr, "\r%s: %dK bytes ... Downloading %dK ...", szUnits, (lSize >> 10), (lCount >> 10));
+  if (fCached)
+    fprintf(stderr, " %dK changed ...", (lChanged+1023) >> 10);
+  llDownload = serGetTime() - llStart;
 
   if (fVerify) {
-    for (lAddress = lCount = 0; lCount < lSize;) {
-      uint32_t cb = lSize - lCount;
-      if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
-      if ((lCount & 0x3FF) == 0)
-        fprintf(stderr, "\rUnit %d: %dK bytes ... Downloading %dK ... Verifying %dK ...", bUnit, (lSize >> 10), (lSize >> 10), (lCount >> 10));
-      geiUpload(bUnit, abVerify, cb, lAddress | lMask);
-      if (memcmp(&abVerify, (pabData+lAddress), cb) != 0)
-        FatalError("verification error at 0x%06x", lAddress);
-      lCount += cb;  lAddress += cb;
+    llStart = serGetTime();
+    uint32_t lVerified = 0;
+    for (u = 0;  u < nUnits;  ++u) {
+      for (lAddress = lCount = 0; lCount < lSize;) {
+        uint32_t cb = lSize - lCount;
+        if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
+        if ((lVerified & 0x3FF) == 0)
+          fprintf(stderr, "\r%s: %dK bytes ... Downloading %dK ... Verifying %dK ...", szUnits, (lSize >> 10), (lSize >> 10), (lVerified >> 10));
+        geiUpload(u, abVerify, cb, lAddress | lMask);
+        if (memcmp(&abVerify, (apabData[u]+lAddress), cb) != 0)
+          FatalError("verification error on unit %d at 0x%06x", u, lAddress);
+        lCount += cb;  lAddress += cb;  lVerified += cb;
+      }
     }
-    fprintf(stderr, "\rUnit %d: %dK bytes ... Downloading %dK ... Verifying %dK ...", bUnit, (lSize >> 10), (lSize >> 10), (lCount >> 10));
+    fprintf(stderr, "\r%s: %dK bytes ... Downloading %dK ... Verifying %dK ...", szUnits, (lSize >> 10), (lSize >> 10), (lVerified >> 10));
+    llVerify = serGetTime() - llStart;
   }
 
   fprintf(stderr, " DONE\n");
+  if (m_fStatistics) {
+    uint32_t lTotal = lSize * nUnits;
+    fprintf(stderr, "Download: %dK sent of %dK in %.3f seconds, %.1f KB/s\n", (lChanged+1023) >> 10,
+      lTotal >> 10, llDownload / 1000000.0, (lTotal / 1024.0) / (llDownload / 1000000.0));
+    if (fVerify)
+      fprintf(stderr, "Verify: %dK in %.3f seconds, %.1f KB/s\n",
+        lTotal >> 10, llVerify / 1000000.0, (lTotal / 1024.0) / (llVerify / 1000000.0));
+  }
+}
+
+PRIVATE void DownloadCached (uint8_t nUnits, uint8_t *apabData[], uint32_t lSize)
+{
+  //++
+  //   Download all the units, using the cache if we're allowed to.  If there's
+  // a cache file for a unit and it passes the probe then only the changes are
+  // sent to that unit, and otherwise its whole image is downloaded.  Either
+  // way, the cache files are deleted first and rewritten only after the
+  // download succeeds, so if we die part way through the next download will
+  // start from scratch.
+  //
+  //   With -n the cache isn't read, but it's still deleted and rewritten -
+  // we're changing what's in the emulator, and the old cache file would be
+  // wrong from now on.
+  //--
+  uint8_t *apabCache[MAXUNIT] = {NULL};  char aszCache[MAXUNIT][_MAX_PATH];
+  uint8_t u;
+  srand((unsigned) time(NULL));
+  for (u = 0;  u < nUnits;  ++u) {
+    CacheFileName(aszCache[u], u, geiGetSerial(u));
+    if (m_fUseCache) {
+      apabCache[u] = ReadCache(aszCache[u], lSize);
+      if ((apabCache[u] != NULL) && !ProbeCache(u, apabCache[u], lSize, geiAddressMask(lSize))) {
+        Message("unit %d has changed since the last download", u);
+        free(apabCache[u]);  apabCache[u] = NULL;
+      }
+    }
+    remove(aszCache[u]);
+  }
+  DownloadUnits(nUnits, apabData, lSize, apabCache, m_fVerifyDownload);
+  for (u = 0;  u < nUnits;  ++u) {
+    WriteCache(aszCache[u], apabData[u], lSize);
+    if (apabCache[u] != NULL)  free(apabCache[u]);
+  }
+}
+
+PRIVATE void SplitFile (char *pszFileName, uint32_t lSize, uint8_t *apabData[])
+{
+  //++
+  //   Load a single image for a sixteen bit wide target, twice the size of
+  // one unit, and split it into two - the even bytes go to unit 0 and the odd
+  // bytes to unit 1.  That saves having to split the image into two files
+  // first (e.g. with rombuild) ...
+  //--
+  uint8_t *pabWord = LoadFile(pszFileName, 2*lSize);
+  for (uint8_t u = 0;  u < 2;  ++u) {
+    apabData[u] = malloc(lSize);
+    if (apabData[u] == NULL)
+      FatalError("out of memory");
+    for (uint32_t i = 0;  i < lSize;  ++i)
+      apabData[u][i] = pabWord[2*i+u];
+  }
+  free(pabWord);
 }
 
 PRIVATE void DownloadFiles()
@@ -316,11 +605,12 @@ PRIVATE void DownloadFiles()
   //++
   //   This routine handles the DOWNLOAD command.  It loads one or two (in
   // the case of a master/slave PromICE) Intel HEX files and downloads them to
-  // the emulator.  If the "-v" (verify) option was specified, then after
-  // downloading we immediately upload the data from the PromICE and compare
-  // it with the original file contents.
+  // the emulator.  With two units, "-w" loads one sixteen bit image instead
+  // and splits it between them.  If the "-v" (verify) option was specified,
+  // then after downloading we immediately upload the data from the PromICE
+  // and compare it with the original file contents.
   //--
-  uint8_t *pabData1 = NULL, *pabData2 = NULL;
+  uint8_t *apabData[MAXUNIT] = {NULL};  uint8_t nLoad = 1;
 
   // Connect, get the PromICE size, and put it in LOAD mode ...
   uint8_t nUnits = geiConnect(m_pszSerialPort, m_lBaudRate);
@@ -328,24 +618,32 @@ PRIVATE void DownloadFiles()
   if (m_lEmulationSize == 0) m_lEmulationSize = lSize;
   geiLoadMode();
 
-  // Load the first file ...
   if (strlen(m_szFileName1) == 0)
     FatalError("specify at least one file name");
-  pabData1 = LoadFile(m_szFileName1, m_lEmulationSize);
-
-  // And load the second file, IFF we have two units!
-  if (nUnits > 1) {
-    if (strlen(m_szFileName2) == 0)
-      Message("unit 1 will not be loaded");
-    else
-      pabData2 = LoadFile(m_szFileName2, m_lEmulationSize);
-  } else if (strlen(m_szFileName2) > 0)
-    Message("file name %s ignored", m_szFileName2);
+  if (m_fSplitWord) {
+    // Load one file and split it between both units ...
+    if (nUnits < 2)
+      FatalError("-w needs a master/slave PromICE");
+    if (strlen(m_szFileName2) > 0)
+      Message("file name %s ignored", m_szFileName2);
+    SplitFile(m_szFileName1, m_lEmulationSize, apabData);  nLoad = 2;
+  } else {
+    // Load the first file ...
+    apabData[0] = LoadFile(m_szFileName1, m_lEmulationSize);
+
+    // And load the second file, IFF we have two units!
+    if (nUnits > 1) {
+      if (strlen(m_szFileName2) == 0)
+        Message("unit 1 will not be loaded");
+      else {
+        apabData[1] = LoadFile(m_szFileName2, m_lEmulationSize);  nLoad = 2;
+      }
+    } else if (strlen(m_szFileName2) > 0)
+      Message("file name %s ignored", m_szFileName2);
+  }
 
   // Download the data ...
-  DownloadUnit(0, pabData1, m_lEmulationSize, m_fVerifyDownload);
-  if (pabData2 != NULL)
-    DownloadUnit(1, pabData2, m_lEmulationSize, m_fVerifyDownload);
+  DownloadCached(nLoad, apabData, m_lEmulationSize);
 
   // And we all done ...
   geiDisconnect();
@@ -367,6 +665,7 @@ PRIVATE void ShowUsage()
   fprintf(stderr, "  Global options applicable to all commands\n");
   fprintf(stderr, "    -p port\t-> set COM port\n");
   fprintf(stderr, "    -b baud\t-> set serial baud rate\n");
+  fprintf(stderr, "    -t\t\t-> show serial and timing statistics\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "  Commands (only one may appear!)\n");
   fprintf(stderr, "    v[erify]\t-> verify communication with PromICE\n");
@@ -378,6 +677,8 @@ PRIVATE void ShowUsage()
   fprintf(stderr, "    -f dd\t-> fill unused locations with dd\n");
   fprintf(stderr, "    -v\t\t-> verify after downloading\n");
   fprintf(stderr, "    -s size\t-> set size of emulated device\n");
+  fprintf(stderr, "    -n\t\t-> don't use the cache, download everything\n");
+  fprintf(stderr, "    -w\t\t-> split one 16 bit image between two units\n");
 }
 
 PRIVATE void SetDefaults()
@@ -388,7 +689,8 @@ PRIVATE void SetDefaults()
   // serial port name and baud rate can be initialized from environment
   // variables ...
   //--
-  m_Command = CMD_NONE;  m_fVerifyDownload = false;
+  m_Command = CMD_NONE;  m_fVerifyDownload = false;  m_fUseCache = true;
+  m_fSplitWord = false;  m_fStatistics = false;
   m_lBaudRate = m_lEmulationSize = 0;  m_bFillerByte = 0;
   memset(&m_szFileName1, 0, sizeof(m_szFileName1));
   memset(&m_szFileName2, 0, sizeof(m_szFileName2));
@@ -464,6 +766,18 @@ PRIVATE int ParseOption (char *pszName, char *pszValue)
     // "-v" - verify after downloading ...
     m_fVerifyDownload = true;  return 1;
 
+  } else if (STREQL(pszName, "-n")) {
+    // "-n" - don't use the download cache ...
+    m_fUseCache = false;  return 1;
+
+  } else if (STREQL(pszName, "-w")) {
+    // "-w" - split one sixteen bit image between both units ...
+    m_fSplitWord = true;  return 1;
+
+  } else if (STREQL(pszName, "-t")) {
+    // "-t" - print the serial and round trip time statistics ...
+    m_fStatistics = true;  return 1;
+
   } else if (STRNEQL(pszName, "-p", 2)) {
     // "-p port" - specify the serial COM port ...
     if (pszValue == NULL)
@@ -557,6 +871,7 @@ int main (int argc, char *argv[])
     default:
       FatalError("specify download, reset, verify, test or help");
   }
+  if (m_fStatistics && (m_Command != CMD_HELP))  geiShowStatistics();
 
   // All done!
   exit(EXIT_SUCCESS);
@@ -17,6 +17,7 @@
 //
 // REVISION HISTORY:
 // 24-MAR-23  RLA   New file.
+// 14-OCT-26  AGT   Add the download cache.
 //--
 #pragma once
 
@@ -26,6 +27,8 @@
 #define MAXUNIT                   2   // maximum number of PromICE units
 #define SERIALPORTENV "PROMICE_PORT"  // environment variable for default port
 #define SERIALBAUDENV "PROMICE_BAUD"  // environment variable for default bau
+#define CACHEDIRENV  "PROMICE_CACHE"  // environment variable for cache directory
+#define CACHE_PROBES              4   // chunks uploaded to check the cache
 #define DEFAULTBAUD           57600   // default baud rate (if nothing else)
 
 // PromICE commands ...
@@ -0,0 +1,621 @@
+//++
+//gesim.c - a software PromICE for testing and benchmarking
+//
+//   COPYRIGHT (C) 2026 BY AGT (agent@local).  ALL RIGHTS RESERVED.
+//   The PromICE protocol handling follows protocol.c, COPYRIGHT (C) 2023 BY
+//   SPARE TIME GIZMOS.
+//
+// LICENSE:
+//    This file is part of the PromICE project.  PromICE is free software; you
+// may redistribute it and/or modify it under the terms of the GNU Affero
+// General Public License as published by the Free Software Foundation, either
+// version 3 of the License, or (at your option) any later version.
+//
+//    PromICE is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+// FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more
+// details.  You should have received a copy of the GNU Affero General Public
+// License along with PromICE.  If not, see http://www.gnu.org/licenses/.
+//
+// DESCRIPTION:
+//   GESIM pretends to be a Grammar Engine PromICE, with one or two units, at
+// the other end of a Linux pseudo terminal.  Point PromICE at the pty (with
+// "-p") and it'll connect, download, verify and so on just as it would with
+// the real thing, which means we can test changes to protocol.c, and time
+// them, without tying up a real PromICE.  It understands the commands in
+// protocol.h and protocol.txt - LOAD POINTER, WRITE DATA, READ DATA, SET MODE,
+// READ VERSION, READ SERIAL, RESTART, RESET TARGET and TEST/FILL RAM.
+//
+//   A pty moves data as fast as the host can copy it, so GESIM models the
+// serial line itself.  Every byte takes ten bit times at the chosen baud rate
+// in each direction, and every command takes "latency" microseconds for the
+// unit to execute once it has all arrived.  The two units of a master/slave
+// pair execute their commands independently, but share the one serial line.
+// A response is written to the pty at the moment its last byte would have
+// finished arriving at the host.
+//
+//   The emulated RAM survives from one connection to the next, as long as
+// GESIM keeps running.  There's no DTR on a pty, but when PromICE closes the
+// port we see a hangup, and that resets the protocol state just as the DTR
+// reset would.
+//
+//   To test the error handling in protocol.c, GESIM can also spoil one WRITE
+// DATA response in every connection (-f).  It can drop it altogether, corrupt
+// the XOR so it doesn't match, or delay it (and everything after it) for long
+// enough that PromICE times out.  Any of these should make a streaming download
+// give up and finish the job one chunk at a time, and the result should still
+// verify.  "n" is which WRITE DATA response to spoil, counting from 1.
+//
+//   GESIM can also write random test images (-x) for the benchmark.  Given
+// the same size and seed it always writes the same image, and the "changes"
+// argument then alters that many randomly chosen bytes.
+//
+// USAGE:
+//      gesim [-u units] [-s size] [-b baud] [-l latency] [-k link] [-f fault]
+//      gesim -x file.hex size [seed [changes]]
+//
+//          -u units    -> number of units, 1 or 2 (default 1)
+//          -s size     -> RAM size of each unit, 2K to 2M (default 32K)
+//          -b baud     -> serial line speed to model (default 57600, 0=none)
+//          -l latency  -> turnaround for each command, in us (default 0)
+//          -k link     -> make a symbolic link to the pty
+//          -f fault    -> drop:n, delay:n or corrupt:n (see above)
+//
+//   Without -k the name of the pty is printed on stdout.  GESIM runs until
+// it's interrupted, and then prints the number of commands it executed.
+//
+// REVISION HISTORY:
+// 14-OCT-26  AGT  New file.
+// 14-OCT-26  AGT  Add -f to spoil a WRITE DATA response.
+//--
+//000000001111111111222222222233333333334444444444555555555566666666667777777777
+//234567890123456789012345678901234567890123456789012345678901234567890123456789
+#define _GNU_SOURCE             // posix_openpt(), ptsname(), etc ...
+#include <stdio.h>              // printf(), FILE, etc ...
+#include <stdlib.h>             // exit(), strtoul(), etc ...
+#include <stdint.h>             // uint8_t, uint32_t, etc ...
+#include <stdbool.h>            // bool, true, false, etc ...
+#include <stdarg.h>             // va_list, va_start(), va_end(), etc...
+#include <string.h>             // memset(), strcmp(), etc ...
+#include <errno.h>              // errno, EINTR, etc ...
+#include <signal.h>             // signal(), SIGINT, ...
+#include <time.h>               // clock_gettime(), ...
+#include <unistd.h>             // read(), write(), usleep(), ...
+#include <fcntl.h>              // O_RDWR, O_NOCTTY, ...
+#include <poll.h>               // poll(), struct pollfd, ...
+#include <termios.h>            // cfmakeraw(), tcsetattr(), ...
+#include <limits.h>             // PATH_MAX, ...
+#include "PromICE.h"            // global declarations for this project
+#include "protocol.h"           // GEI protocol definitions
+#include "intelhex.h"           // hexWrite(), HEX_OPTIONS, ...
+
+// Parameters ...
+#define GESIM             "gesim" // name of this program (for messages)
+#define TXQUEUE             64  // maximum responses waiting to be sent
+#define HANGUP_WAIT      20000  // poll interval (us) while nobody is connected
+#define RESET_TICK        9100  // RESET TARGET time per count (55 is ~500ms)
+#define SIM_SERIAL  0x80000108UL// serial number of unit 0
+#define DELAY_EXTRA    500000UL // extra delay (us) past the timeout for -f delay
+
+// Protocol states ...
+enum _SIM_STATE {
+  SIM_AUTOBAUD,             // echoing AUTOBAUD, waiting for IDENTIFY
+  SIM_IDENTIFY,             // waiting for the second IDENTIFY
+  SIM_COMMAND               // receiving GEI_MESSAGE commands
+};
+typedef enum _SIM_STATE SIM_STATE;
+
+// Faults that -f can inject ...
+enum _SIM_FAULT {
+  FAULT_NONE,               // everything works
+  FAULT_DROP,               // never send the response
+  FAULT_DELAY,              // send it too late
+  FAULT_CORRUPT             // send the wrong XOR
+};
+typedef enum _SIM_FAULT SIM_FAULT;
+
+//   One response waiting to be sent, and the time (in microseconds) when the
+// last byte would have reached the host ...
+struct _SIM_RESPONSE {
+  uint64_t llDue;           // when to write it to the pty
+  size_t   cbData;          // number of bytes in abData
+  uint8_t  abData[GEI_HEADERLEN+GEI_MAXDATALEN];
+};
+typedef struct _SIM_RESPONSE SIM_RESPONSE;
+
+// Local data for this module ...
+PRIVATE uint8_t   m_nUnits = 1;         // number of units emulated
+PRIVATE uint8_t   m_bSizeCode;          // GEI_SIZE_xxx for each unit
+PRIVATE uint32_t  m_lSize = 32768UL;    // RAM size of each unit
+PRIVATE uint32_t  m_lBaud = DEFAULTBAUD;// serial line speed to model
+PRIVATE uint32_t  m_lLatency = 0;       // command turnaround time (us)
+PRIVATE const char *m_pszLink = NULL;   // symbolic link to the pty
+PRIVATE int       m_hMaster;            // pty master file descriptor
+PRIVATE uint8_t  *m_apabRAM[MAXUNIT];   // emulated RAM for each unit
+PRIVATE uint32_t  m_alPointer[MAXUNIT]; // address pointer for each unit
+PRIVATE uint64_t  m_allUnitBusy[MAXUNIT];// when each unit is free again
+PRIVATE uint64_t  m_llRxWire;           // when the host->PromICE line is free
+PRIVATE uint64_t  m_llTxWire;           // when the PromICE->host line is free
+PRIVATE SIM_STATE m_State;              // current protocol state
+PRIVATE GEI_MESSAGE m_Command;          // command being received
+PRIVATE size_t    m_cbCommand;          // bytes of m_Command received so far
+PRIVATE SIM_RESPONSE m_aQueue[TXQUEUE]; // responses waiting to be sent
+PRIVATE size_t    m_iQueueHead, m_nQueue;// first response and count
+PRIVATE uint32_t  m_anCommands[GEI_CM_MASK+1]; // commands executed, by code
+PRIVATE uint32_t  m_nConnections;       // number of times PromICE connected
+PRIVATE SIM_FAULT m_Fault = FAULT_NONE; // fault to inject (-f)
+PRIVATE uint32_t  m_nFaultAt;           // WRITE DATA response to spoil
+PRIVATE uint32_t  m_nWrites;            // WRITE DATAs in this connection
+PRIVATE uint32_t  m_nFaults;            // number of faults injected
+PRIVATE volatile sig_atomic_t m_fStop;  // set by SIGINT or SIGTERM
+
+
+PUBLIC void Message (const char *pszMsg, ...)
+{
+  //++
+  // Print an informational message ...
+  //--
+  va_list ap;  va_start(ap, pszMsg);
+  fprintf(stderr, "%s: ", GESIM);  vfprintf(stderr, pszMsg, ap);
+  fprintf(stderr, "\n");  va_end(ap);
+}
+
+PUBLIC void FatalError (const char *pszMsg, ...)
+{
+  //++
+  // Print an error message and exit ...
+  //--
+  va_list ap;  va_start(ap, pszMsg);
+  fprintf(stderr, "%s: ", GESIM);  vfprintf(stderr, pszMsg, ap);
+  fprintf(stderr, "\n");  va_end(ap);
+  if (m_pszLink != NULL)  unlink(m_pszLink);
+  exit(EXIT_FAILURE);
+}
+
+PRIVATE uint64_t GetTime()
+{
+  //++
+  // Return a free running microsecond timer ...
+  //--
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec*1000000ULL + (uint64_t) ts.tv_nsec/1000ULL;
+}
+
+PRIVATE uint64_t ByteTime (size_t cb)
+{
+  //++
+  // Return the time, in microseconds, to send cb bytes at m_lBaud ...
+  //--
+  return (m_lBaud == 0) ? 0 : ((uint64_t) cb * 10000000ULL) / m_lBaud;
+}
+
+PRIVATE uint64_t StreamTimeout()
+{
+  //++
+  //   Return the time, in microseconds, that geiStreamDownloadUnits() waits
+  // for a WRITE DATA response before it gives up on streaming ...
+  //--
+  return LONG_TIMEOUT*1000ULL
+    + ((GEI_WINDOW * (GEI_HEADERLEN+GEI_MAXDATALEN) * 10000000ULL) / ((m_lBaud == 0) ? DEFAULTBAUD : m_lBaud));
+}
+
+PRIVATE void OnSignal (int nSignal)
+{
+  //++
+  // SIGINT or SIGTERM just ask the main loop to quit ...
+  //--
+  (void) nSignal;  m_fStop = 1;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////   GEI PROTOCOL   ////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+PRIVATE void Reset()
+{
+  //++
+  //   Reset the protocol state, the same as the PromICE does when DTR is
+  // toggled.  Anything half received or waiting to be sent is lost, but
+  // the RAM contents are kept ...
+  //--
+  m_State = SIM_AUTOBAUD;  m_cbCommand = 0;
+  m_iQueueHead = m_nQueue = 0;
+  m_llRxWire = m_llTxWire = 0;  m_nWrites = 0;
+  memset(m_allUnitBusy, 0, sizeof(m_allUnitBusy));
+}
+
+PRIVATE void WriteNow (const uint8_t *pabData, size_t cbData)
+{
+  //++
+  //   Write to the pty master.  If nobody is listening any more then it
+  // doesn't matter, so errors are ignored ...
+  //--
+  while (cbData > 0) {
+    ssize_t cb = write(m_hMaster, pabData, cbData);
+    if (cb < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    pabData += cb;  cbData -= cb;
+  }
+}
+
+PRIVATE void Respond (uint64_t llReady, const uint8_t *pabData, size_t cbData)
+{
+  //++
+  //   Queue a response which is ready to be sent at llReady.  It has to wait
+  // for the line to be free and then for all its bytes to be sent, and only
+  // then is it written to the pty.  If the queue is full then the oldest
+  // response goes out now, which should never happen with a sane host.
+  //--
+  if (m_nQueue == TXQUEUE) {
+    SIM_RESPONSE *p = &m_aQueue[m_iQueueHead];
+    WriteNow(p->abData, p->cbData);
+    m_iQueueHead = (m_iQueueHead+1) % TXQUEUE;  --m_nQueue;
+  }
+  if (llReady < m_llTxWire)  llReady = m_llTxWire;
+  m_llTxWire = llReady + ByteTime(cbData);
+  SIM_RESPONSE *p = &m_aQueue[(m_iQueueHead+m_nQueue) % TXQUEUE];
+  p->llDue = m_llTxWire;  p->cbData = cbData;
+  memcpy(p->abData, pabData, cbData);
+  ++m_nQueue;
+}
+
+PRIVATE void SendDue (uint64_t llNow)
+{
+  //++
+  // Send every queued response whose time has come ...
+  //--
+  while ((m_nQueue > 0) && (m_aQueue[m_iQueueHead].llDue <= llNow)) {
+    SIM_RESPONSE *p = &m_aQueue[m_iQueueHead];
+    WriteNow(p->abData, p->cbData);
+    m_iQueueHead = (m_iQueueHead+1) % TXQUEUE;  --m_nQueue;
+  }
+}
+
+PRIVATE void Execute (uint64_t llArrived)
+{
+  //++
+  //   Execute the command in m_Command, which finished arriving at llArrived,
+  // and queue the response (if there is one).  The unit starts on it when it
+  // has finished with its last command, and it takes m_lLatency microseconds.
+  //
+  //   Notice that the command codes for FILL RAM (0x15) and TEST RAM (0x05)
+  // differ only in bit 4, and SET SIZE (0x84) is SET MODE with bit 7 set, so
+  // we can't just mask the command with GEI_CM_MASK ...
+  //--
+  uint8_t bUnit = m_Command.bUnitID, bCommand = m_Command.bCommand & ~GEI_CM_NORESPONSE;
+  bool fResponse = !ISSET(m_Command.bCommand, GEI_CM_NORESPONSE);
+  size_t cbData = (m_Command.bCount == 0) ? GEI_MAXDATALEN : m_Command.bCount;
+  uint8_t *pabData = m_Command.abData, *pabRAM;
+  GEI_MESSAGE rsp;  uint32_t i;
+
+  //   A command for a unit that doesn't exist would just pass through the
+  // daisy chain and never be answered ...
+  if (bUnit >= m_nUnits) {
+    Message("command 0x%02X for non-existent unit %d", m_Command.bCommand, bUnit);
+    return;
+  }
+  pabRAM = m_apabRAM[bUnit];
+  uint64_t llDone = (llArrived > m_allUnitBusy[bUnit]) ? llArrived : m_allUnitBusy[bUnit];
+  llDone += m_lLatency;
+  ++m_anCommands[bCommand & GEI_CM_MASK];
+
+  // Most responses are just one byte ...
+  rsp.bUnitID = bUnit;  rsp.bCommand = GEI_CM_RESPONSE | (bCommand & 0x1F);
+  rsp.bCount = 1;  rsp.abData[0] = 0;
+  switch (bCommand) {
+    case GEI_LOADPOINTER:
+      m_alPointer[bUnit] = ((pabData[0] << 16) | (pabData[1] << 8) | pabData[2]) & (m_lSize-1);
+      break;
+
+    case GEI_WRITEDATA:
+      for (i = 0;  i < cbData;  ++i) {
+        pabRAM[m_alPointer[bUnit]] = pabData[i];  rsp.abData[0] ^= pabData[i];
+        m_alPointer[bUnit] = (m_alPointer[bUnit]+1) & (m_lSize-1);
+      }
+      break;
+
+    case GEI_READDATA:
+      rsp.bCount = pabData[0];
+      for (i = 0;  i < ((pabData[0] == 0) ? GEI_MAXDATALEN : pabData[0]);  ++i) {
+        rsp.abData[i] = pabRAM[m_alPointer[bUnit]];
+        m_alPointer[bUnit] = (m_alPointer[bUnit]+1) & (m_lSize-1);
+      }
+      break;
+
+    case GEI_SETMODE:
+      //   The SET MODE response is the RAM size.  protocol.txt shows 0x77 from
+      // the master of a 2x128K pair and 0x07 from the slave ...
+      rsp.abData[0] = m_bSizeCode;
+      if ((bUnit == 0) && (m_nUnits > 1))  rsp.abData[0] |= m_bSizeCode << 4;
+      break;
+
+    case GEI_FILLRAM:
+      memset(pabRAM, pabData[0], m_lSize);
+      break;
+
+    case GEI_RESETTARGET:
+      llDone += (uint64_t) pabData[0] * RESET_TICK;
+      break;
+
+    case GEI_READVERSION:
+      rsp.bCount = 4;  memcpy(rsp.abData, "5.3a", 4);
+      break;
+
+    case GEI_READSERIAL: {
+      uint32_t lSerial = SIM_SERIAL + bUnit;
+      rsp.bCount = 4;
+      rsp.abData[0] = (lSerial >> 24) & 0xFF;  rsp.abData[1] = (lSerial >> 16) & 0xFF;
+      rsp.abData[2] = (lSerial >>  8) & 0xFF;  rsp.abData[3] =  lSerial        & 0xFF;
+      break;
+    }
+
+    case GEI_SETSIZE:
+    case GEI_RESTART:
+    case GEI_TESTRAM:
+    case GEI_TESTPROMICE:
+      break;
+
+    default:
+      Message("unknown command 0x%02X for unit %d", m_Command.bCommand, bUnit);
+      return;
+  }
+  //   If this is the WRITE DATA response we've been asked to spoil, then do
+  // that.  A delayed response holds up everything queued behind it, and the
+  // unit too, just as if the PromICE had stalled ...
+  if ((bCommand == GEI_WRITEDATA) && fResponse && (m_Fault != FAULT_NONE)
+   && (++m_nWrites == m_nFaultAt)) {
+    ++m_nFaults;
+    if (m_Fault == FAULT_DROP)
+      fResponse = false;
+    else if (m_Fault == FAULT_CORRUPT)
+      rsp.abData[0] ^= 0xFF;
+    else
+      llDone += StreamTimeout() + DELAY_EXTRA;
+  }
+  m_allUnitBusy[bUnit] = llDone;
+
+  if (fResponse) {
+    size_t cbResponse = GEI_HEADERLEN + ((rsp.bCount == 0) ? GEI_MAXDATALEN : rsp.bCount);
+    Respond(llDone, (uint8_t *) &rsp, cbResponse);
+  }
+}
+
+PRIVATE void Receive (const uint8_t *pabData, size_t cbData, uint64_t llNow)
+{
+  //++
+  //   Handle the bytes just read from the pty.  They can't arrive any faster
+  // than the line allows, so the arrival time of each one is the later of now
+  // and the end of the byte before.
+  //--
+  for (size_t i = 0;  i < cbData;  ++i) {
+    uint8_t b = pabData[i];
+    if (m_llRxWire < llNow)  m_llRxWire = llNow;
+    m_llRxWire += ByteTime(1);
+
+    switch (m_State) {
+      case SIM_AUTOBAUD:
+        //   Echo AUTOBAUD until the host sends IDENTIFY, then echo that
+        // too and wait for the real IDENTIFY ...
+        if ((b == GEI_AUTOBAUD) || (b == GEI_IDENTIFY))
+          Respond(m_llRxWire, &b, 1);
+        if (b == GEI_IDENTIFY)  m_State = SIM_IDENTIFY;
+        break;
+
+      case SIM_IDENTIFY:
+        // The second IDENTIFY returns the number of units ...
+        if (b == GEI_AUTOBAUD) {
+          Respond(m_llRxWire, &b, 1);  break;
+        }
+        Respond(m_llRxWire, &m_nUnits, 1);
+        m_State = SIM_COMMAND;  ++m_nConnections;
+        break;
+
+      case SIM_COMMAND:
+        // Collect a complete message and then execute it ...
+        ((uint8_t *) &m_Command)[m_cbCommand++] = b;
+        if (m_cbCommand < GEI_HEADERLEN)  break;
+        if (m_cbCommand < GEI_HEADERLEN + ((m_Command.bCount == 0) ? GEI_MAXDATALEN : m_Command.bCount))
+          break;
+        Execute(m_llRxWire);  m_cbCommand = 0;
+        break;
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   MAIN LOOP   //////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+PRIVATE void OpenPTY()
+{
+  //++
+  //   Create the pseudo terminal, put it in raw mode, and either print its
+  // name or make the symbolic link to it.  We never open the slave side
+  // ourselves - PromICE does that.
+  //--
+  m_hMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((m_hMaster < 0) || (grantpt(m_hMaster) != 0) || (unlockpt(m_hMaster) != 0))
+    FatalError("error (%s) creating pty", strerror(errno));
+  struct termios ts;
+  if (tcgetattr(m_hMaster, &ts) == 0) {
+    cfmakeraw(&ts);  tcsetattr(m_hMaster, TCSANOW, &ts);
+  }
+  const char *pszSlave = ptsname(m_hMaster);
+  if (m_pszLink != NULL) {
+    unlink(m_pszLink);
+    if (symlink(pszSlave, m_pszLink) != 0)
+      FatalError("error (%s) linking %s to %s", strerror(errno), m_pszLink, pszSlave);
+  } else {
+    printf("%s\n", pszSlave);  fflush(stdout);
+  }
+}
+
+PRIVATE void Run()
+{
+  //++
+  //   The main loop.  Wait for input from the host or the next response to
+  // come due, whichever happens first.  When PromICE closes the port the
+  // master side sees POLLHUP (and read() fails with EIO) until somebody opens
+  // the slave again, and that's our DTR reset ...
+  //--
+  uint8_t abBuffer[4096];
+  Reset();
+  while (!m_fStop) {
+    uint64_t llNow = GetTime();
+    int nWait = -1;
+    if (m_nQueue > 0) {
+      uint64_t llDue = m_aQueue[m_iQueueHead].llDue;
+      nWait = (llDue > llNow) ? (int) ((llDue-llNow+999ULL) / 1000ULL) : 0;
+    }
+    struct pollfd pfd = {m_hMaster, POLLIN, 0};
+    int nReady = poll(&pfd, 1, nWait);
+    if (nReady < 0) {
+      if (errno == EINTR) continue;
+      FatalError("error (%s) waiting for pty", strerror(errno));
+    }
+    llNow = GetTime();
+    if (ISSET(pfd.revents, POLLIN)) {
+      ssize_t cb = read(m_hMaster, abBuffer, sizeof(abBuffer));
+      if (cb > 0)
+        Receive(abBuffer, (size_t) cb, llNow);
+      else if ((cb == 0) || (errno == EIO)) {
+        Reset();  usleep(HANGUP_WAIT);
+      } else if ((errno != EINTR) && (errno != EAGAIN))
+        FatalError("error (%s) reading pty", strerror(errno));
+    } else if (ISSET(pfd.revents, POLLHUP)) {
+      Reset();  usleep(HANGUP_WAIT);
+    }
+    SendDue(GetTime());
+  }
+}
+
+PRIVATE uint32_t ParseSize (const char *pszValue)
+{
+  //++
+  //   Parse a size in bytes, or in K or M if followed by "k" or "m", and
+  // return zero if it isn't valid ...
+  //--
+  char *psz;  uint32_t lSize = (uint32_t) strtoul(pszValue, &psz, 10);
+  if ((*psz == 'k') || (*psz == 'K'))  lSize <<= 10, ++psz;
+  else if ((*psz == 'm') || (*psz == 'M'))  lSize <<= 20, ++psz;
+  return (*psz == '\0') ? lSize : 0;
+}
+
+PRIVATE void ParseFault (const char *pszValue)
+{
+  //++
+  // Parse the argument to -f, which is "drop", "delay" or "corrupt", ":" and n ...
+  //--
+  const char *psz = strchr(pszValue, ':');
+  size_t cb = (psz == NULL) ? 0 : (size_t) (psz - pszValue);
+  if      ((cb == 4) && (strncmp(pszValue, "drop",    cb) == 0))  m_Fault = FAULT_DROP;
+  else if ((cb == 5) && (strncmp(pszValue, "delay",   cb) == 0))  m_Fault = FAULT_DELAY;
+  else if ((cb == 7) && (strncmp(pszValue, "corrupt", cb) == 0))  m_Fault = FAULT_CORRUPT;
+  else FatalError("fault must be drop:n, delay:n or corrupt:n");
+  char *pszEnd;  m_nFaultAt = (uint32_t) strtoul(psz+1, &pszEnd, 10);
+  if ((m_nFaultAt == 0) || (*pszEnd != '\0'))
+    FatalError("bad fault response number \"%s\"", psz+1);
+}
+
+PRIVATE void WriteImage (const char *pszFile, uint32_t lSize, unsigned nSeed, uint32_t nChanges)
+{
+  //++
+  //   Write a random test image, lSize bytes, as an Intel .HEX file.  The
+  // same seed always gives the same image, and then nChanges random bytes
+  // (from a different random sequence) are altered ...
+  //--
+  uint8_t *pabImage = malloc(lSize);
+  if (pabImage == NULL)  FatalError("out of memory");
+  srand(nSeed);
+  for (uint32_t i = 0;  i < lSize;  ++i)  pabImage[i] = rand() & 0xFF;
+  srand(nSeed ^ 0x5A5A5A5AU);
+  for (uint32_t i = 0;  i < nChanges;  ++i)  pabImage[((uint32_t) rand()) % lSize] ^= 0xFF;
+  FILE *f = fopen(pszFile, "wt");
+  if (f == NULL)  FatalError("unable to write %s", pszFile);
+  HEX_OPTIONS opt = {0, false, 0, true};
+  if (!hexWrite(f, pabImage, lSize, 1, 0, &opt) || (fclose(f) != 0))
+    FatalError("error writing %s", pszFile);
+  free(pabImage);
+}
+
+PRIVATE void ShowUsage()
+{
+  //++
+  // Print the help text ...
+  //--
+  fprintf(stderr, "usage:\n");
+  fprintf(stderr, "  gesim [-u units] [-s size] [-b baud] [-l latency] [-k link] [-f fault]\n");
+  fprintf(stderr, "  gesim -x file.hex size [seed [changes]]\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "    -u units\t-> number of units, 1 or 2\n");
+  fprintf(stderr, "    -s size\t-> RAM size of each unit, 2K to 2M\n");
+  fprintf(stderr, "    -b baud\t-> serial line speed to model (0 for none)\n");
+  fprintf(stderr, "    -l latency\t-> turnaround for each command, in microseconds\n");
+  fprintf(stderr, "    -k link\t-> make a symbolic link to the pty\n");
+  fprintf(stderr, "    -f fault\t-> drop:n, delay:n or corrupt:n the n'th WRITE DATA response\n");
+  fprintf(stderr, "    -x\t\t-> write a random test image\n");
+}
+
+int main (int argc, char *argv[])
+{
+  int i;
+  if ((argc >= 2) && STREQL(argv[1], "-x")) {
+    if ((argc < 4) || (argc > 6))  {ShowUsage();  exit(EXIT_FAILURE);}
+    uint32_t lSize = ParseSize(argv[3]);
+    if (lSize == 0)  FatalError("bad image size \"%s\"", argv[3]);
+    WriteImage(argv[2], lSize, (argc > 4) ? (unsigned) strtoul(argv[4], NULL, 10) : 1,
+                               (argc > 5) ? (uint32_t) strtoul(argv[5], NULL, 10) : 0);
+    exit(EXIT_SUCCESS);
+  }
+
+  // Parse the options ...
+  for (i = 1;  i < argc;  ++i) {
+    const char *pszValue = (i+1 < argc) ? argv[i+1] : NULL;
+    if (pszValue == NULL)  {ShowUsage();  exit(EXIT_FAILURE);}
+    if (STREQL(argv[i], "-u")) {
+      m_nUnits = (uint8_t) strtoul(pszValue, NULL, 10);
+      if ((m_nUnits < 1) || (m_nUnits > MAXUNIT))  FatalError("units must be 1 or 2");
+    } else if (STREQL(argv[i], "-s")) {
+      m_lSize = ParseSize(pszValue);
+    } else if (STREQL(argv[i], "-b")) {
+      m_lBaud = (uint32_t) strtoul(pszValue, NULL, 10);
+    } else if (STREQL(argv[i], "-l")) {
+      m_lLatency = (uint32_t) strtoul(pszValue, NULL, 10);
+    } else if (STREQL(argv[i], "-k")) {
+      m_pszLink = pszValue;
+    } else if (STREQL(argv[i], "-f")) {
+      ParseFault(pszValue);
+    } else {
+      ShowUsage();  exit(EXIT_FAILURE);
+    }
+    ++i;
+  }
+
+  // The RAM size must be one the PromICE understands ...
+  for (m_bSizeCode = GEI_SIZE_2K;  m_bSizeCode <= GEI_SIZE_2M;  ++m_bSizeCode)
+    if ((1024UL << m_bSizeCode) == m_lSize)  break;
+  if (m_bSizeCode > GEI_SIZE_2M)
+    FatalError("size must be a power of two from 2K to 2M");
+  for (i = 0;  i < m_nUnits;  ++i) {
+    m_apabRAM[i] = malloc(m_lSize);
+    if (m_apabRAM[i] == NULL)  FatalError("out of memory");
+    memset(m_apabRAM[i], 0xFF, m_lSize);
+  }
+
+  // Create the pty and run until we're told to stop ...
+  signal(SIGINT, OnSignal);  signal(SIGTERM, OnSignal);
+  OpenPTY();  Run();
+
+  // Say what we did and quit ...
+  fprintf(stderr, "%s: %d connection(s), %u WRITE DATA, %u READ DATA, %u LOAD POINTER\n", GESIM,
+    m_nConnections, m_anCommands[GEI_WRITEDATA], m_anCommands[GEI_READDATA], m_anCommands[GEI_LOADPOINTER]);
+  if (m_Fault != FAULT_NONE)  fprintf(stderr, "%s: %u fault(s) injected\n", GESIM, m_nFaults);
+  if (m_pszLink != NULL)  unlink(m_pszLink);
+  close(m_hMaster);
+  return EXIT_SUCCESS;
+}
@@ -17,19 +17,20 @@
 //
 // DESCRIPTION:
 //   This module contains routines to read and write files in the standard
-// Intel HEX format.  Only the 00 (data) and 01 (end of file) record types
-// are recognized.
+// Intel HEX format.  Reading is done by hexRead() in ../romlib, which is
+// shared with the other ROM tools and also understands the 02 (extended
+// segment address) and 04 (extended linear address) records.
 //
 //      hexDump() - write a .HEX file from memory
 //      hexLoad() - load a .HEX file into memory
 //
-// NOTE:
-//   Although PromICE in general supports ROM sizes larger than 64K, this code
-// won't handle HEX files with more than 16 bit addresses.  It can't - I don't
-// know how the Intel standard deals with ROMs larger than 64K!
+//   Writing is done by hexWrite(), also in ../romlib, which writes extended
+// linear address records for images larger than 64K.
 //                                                                      
 // REVISION HISTORY:
 // 04-APR-23    RLA     Stolen from the ROMCKSUM project...
+// 14-OCT-26    AGT     hexLoad() uses the shared reader in ../romlib.
+// 14-OCT-26    AGT     hexDump() uses the shared writer.
 //--
 #include <stdio.h>              // printf(), FILE, etc ...
 #include <stdlib.h>             // exit(), system(), etc ...
@@ -39,9 +40,36 @@
 #include <assert.h>             // assert() (what else??)
 #include <memory.h>             // memset(), et al ...
 #include "PromICE.h"            // global declarations for this project
+#include "intelhex.h"           // shared Intel .HEX file reader and writer
 #include "hexfile.h"            // declarations for this module
 
 
+typedef struct _HEXLOAD {
+  uint8_t    *pabMemory;    // memory image to receive the data
+  uint32_t    cbOffset;     // offset to be applied to addresses
+  uint32_t    cbMemory;     // maximum size of the memory image
+  uint32_t    cbTotal;      // number of bytes loaded from file
+} HEXLOAD;
+
+PRIVATE bool hexLoadData (void *pContext, const HEX_RECORD *pRecord)
+{
+  //++
+  //   This is the hexRead() callback for hexLoad().  It stores one data
+  // record in the memory image, and it's an error if any part of the record
+  // won't fit.  Extended addresses are allowed, so this works for images
+  // bigger than 64K too.
+  //--
+  HEXLOAD *pLoad = (HEXLOAD *) pContext;
+  uint32_t nAddress = pRecord->lAddress + pLoad->cbOffset;
+  if ((nAddress < pLoad->cbOffset) || (nAddress >= pLoad->cbMemory))
+    FatalError("Intel address (0x%04X) out of range in file %s line %d\n", pRecord->lAddress, pRecord->pszFile, pRecord->nLine);
+  if (pRecord->cbData > (pLoad->cbMemory - nAddress))
+    FatalError("Intel address (0x%04X) out of range in file %s line %d\n", pRecord->lAddress + (pLoad->cbMemory - nAddress), pRecord->pszFile, pRecord->nLine);
+  memcpy(&pLoad->pabMemory[nAddress], pRecord->pbData, pRecord->cbData);
+  pLoad->cbTotal += pRecord->cbData;
+  return true;
+}
+
 PUBLIC uint32_t hexLoad (
   const char *pszFile,      // name of the file to read
   uint8_t    *pabMemory,    // memory image to receive the data
@@ -53,55 +81,33 @@ PUBLIC uint32_t hexLoad (
   // It returns the number of bytes actually read from the file (which may not
   // be the same as the ROM size since, unlike a binary file, the bytes don't
   // have to be contiguous).  If any error occurs an error message is printed
-  // and the program exits.
+  // and the program exits.  The file itself is parsed by hexRead() in the
+  // shared ../romlib library.
   //--
-  FILE       *fpHex;        // handle of the file we're reading
-  uint32_t    cbTotal;      // number of bytes loaded from file
-  uint32_t    cbRecord;     // length       of the current .HEX record
-  uint32_t    nRecAddr;     // load address "   "     "      "     "
-  uint32_t    nType = 0;    // type         "   "     "      "     "
-  uint32_t    nChecksum;    // checksum     "   "     "      "     "
-  uint32_t    b;            // temporary for the data byte read...
-  uint32_t    nLine;        // current line number (for error messages)
-  
-  // Open the hex file and, if we can't, then we can go home early...
-  if ((fpHex=fopen(pszFile, "rt")) == NULL)
-    FatalError("unable to read %s", pszFile);
-  
-  for (cbTotal = 0, nLine = 1;  nType != 1;  ++nLine) {
-    // Read the record header - length, load address and record type...
-    if (fscanf(fpHex, ":%2x%4x%2x", &cbRecord, &nRecAddr, &nType) != 3)
-      FatalError("Intel format error (1) in file %s line %d", pszFile, nLine);
+  HEXLOAD     Load = {pabMemory, cbOffset, cbMemory, 0};
+  HEX_RECORD  Record;       // where the error is, if hexRead() fails
 
-    // The only allowed record types (now) are 1 (EOF) and 0 (DATA)...
-    if (nType > 1)
-      FatalError("Intel unknown record type (0x%02X) in file %s line %d", nType, pszFile, nLine);
-    
-    // Begin accumulating the checksum, which includes all these bytes...
-    nChecksum = cbRecord + HIBYTE(nRecAddr) + LOBYTE(nRecAddr) + nType;
-
-    // Read the data part of this record and load it into memory...
-    for (; cbRecord > 0;  --cbRecord, ++nRecAddr, ++cbTotal) {
-      if (fscanf(fpHex, "%2x", &b) != 1)
-        FatalError("Intel format error (2) in file %s line %d\n", pszFile, nLine);
-      if ((nRecAddr+cbOffset < 0) || (nRecAddr+cbOffset >= cbMemory)) 
-        FatalError("Intel address (0x%04X) out of range in file %s line %d\n", nRecAddr, pszFile, nLine);
-      pabMemory[nRecAddr+cbOffset] = b;  nChecksum += b;
-    }
-
-    //   Finally, read the checksum at the end of the record.  That byte,
-    // plus what we've recorded so far, should add up to zero if everything's
-    // kosher.
-    if (fscanf(fpHex, "%2x\n", &b) != 1)
-      FatalError("Intel format error (3) in file %s line %d\n", pszFile, nLine);
-    nChecksum = (nChecksum + b) & 0xFF;
-    if (nChecksum != 0)
-      FatalError("Intel checksum error (0x%02X) in file %s line %d", nChecksum, pszFile, nLine);
+  switch (hexRead(pszFile, hexLoadData, &Load, &Record)) {
+    case HEX_OK:
+      break;
+    case HEX_OPEN_ERROR:
+      FatalError("unable to read %s", pszFile);
+    case HEX_FORMAT_HEADER:
+      FatalError("Intel format error (1) in file %s line %d", pszFile, Record.nLine);
+    case HEX_FORMAT_DATA:
+      FatalError("Intel format error (2) in file %s line %d\n", pszFile, Record.nLine);
+    case HEX_FORMAT_CHECKSUM:
+      FatalError("Intel format error (3) in file %s line %d\n", pszFile, Record.nLine);
+    case HEX_UNKNOWN_TYPE:
+      FatalError("Intel unknown record type (0x%02X) in file %s line %d", Record.nType, pszFile, Record.nLine);
+    case HEX_CHECKSUM_ERROR:
+      FatalError("Intel checksum error (0x%02X) in file %s line %d", Record.bChecksum, pszFile, Record.nLine);
+    case HEX_STOPPED:
+      break;
   }
 
   // Everything was fine...
-  fclose(fpHex);
-  return cbTotal;
+  return Load.cbTotal;
 }
 
 PUBLIC bool hexDump (
@@ -112,48 +118,20 @@ PUBLIC bool hexDump (
 {
   //++
   //   This procedure writes a memory dump in standard Intel HEX file format.
-  // It's the logical inverse of LoadHex() and, like that routine, it's limited
-  // to 64K maximum.  It returns FALSE if there's any kind of error while writing
-  // the file.
+  // It's the logical inverse of hexLoad() and, like that routine, it handles
+  // images bigger than 64K by using extended linear addresses.  It returns
+  // FALSE if there's any kind of error while writing the file.
   //--
+  static const HEX_OPTIONS Options = {0, false, 0, true};
   FILE       *fpHex;        // handle of the file we're reading
-  uint32_t    cbRecord;     // length       of the current .HEX record
-  uint32_t    nRecAddr;     // load address "   "     "      "     "
-  int32_t     nChecksum;    // checksum     "   "     "      "     "
-  uint32_t    nMemAddr;     // current memory address
-  uint32_t    i;            // temporary...
+  bool        fOK;          // true if the file was written successfully
 
   // Open the output file for writing...
   if ((fpHex=fopen(pszFile, "wt")) == NULL)
     FatalError("unable to write %s", pszFile);
 
-  // Dump all of memory...
-  for (nMemAddr = 0;  nMemAddr < cbMemory;  nMemAddr += cbRecord) {
-
-    // Figure out the record size and address for that record.  
-    nRecAddr = (uint32_t) (nMemAddr + cbOffset);
-    cbRecord = 16;
-    if (cbRecord > (cbMemory-nMemAddr))  cbRecord = (cbMemory-nMemAddr);
-
-    // Write the record header (for a type 0 record)...
-    fprintf(fpHex, ":%02X%04X00", cbRecord, nRecAddr); 
-    
-    // Start the checksum calculation...
-    nChecksum = cbRecord + HIBYTE(nRecAddr) + LOBYTE(nRecAddr) + 00 /*nType*/;
-
-    // And dump all the data bytes in this record.
-    for (i = 0;  i < cbRecord;  ++i) {
-      fprintf(fpHex, "%02X", pabMemory[nMemAddr+i]);
-      nChecksum += pabMemory[nMemAddr+i];
-    }
-
-    // Write out the checksum byte and finish off this record.
-    fprintf(fpHex,"%02X\n", (-nChecksum) & 0xFF);
-  }
-
-  //   Don't forget to write an EOF record, which is easy in our case, since it
-  // doesn't contain any variable data.
-  fprintf(fpHex, ":00000001FF\n");
-  fclose(fpHex);
-  return true;
+  // Dump all of memory, and the EOF record too ...
+  fOK = hexWrite(fpHex, pabMemory, cbMemory, 1, cbOffset, &Options);
+  if (fclose(fpHex) != 0) fOK = false;
+  return fOK;
 }
@@ -34,7 +34,10 @@
 //      geiResetTarget()  - toggle PromICE RESET output (reset target)
 //      geiLoadMode()     - put PromICE in LOAD mode
 //      geiDownload()     - download data to the PromICE
+//      geiStreamDownload() - download a lot of data to the PromICE, quickly
+//      geiStreamDownloadUnits() - the same, to several units at once
 //      geiUpload()       - upload data from the PromICE
+//      geiShowStatistics() - print serial and round trip statistics
 // 
 // NOTES:
 //   One subtle "gotcha" of the PromICE is that it expects all unused address
@@ -47,6 +50,9 @@
 //
 // REVISION HISTORY:
 // 24-MAR-23  RLA  New file.
+// 14-OCT-26  AGT  Add geiStreamDownload().
+// 14-OCT-26  AGT  Add geiStreamDownloadUnits() for master/slave units.
+// 14-OCT-26  AGT  Keep round trip time histograms for every command.
 //--
 //000000001111111111222222222233333333334444444444555555555566666666667777777777
 //234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -65,6 +71,24 @@
 PRIVATE GEI_MESSAGE m_geiCommand;   // command to send to the PromICE
 PRIVATE GEI_MESSAGE m_geiResponse;  // response received from the PromICE
 PRIVATE uint8_t     m_geiUnits;     // number of units attached
+PRIVATE uint32_t    m_geiBaud;      // baud rate we're using
+
+//   Round trip statistics for each command code (that's the whole command
+// byte, less GEI_CM_NORESPONSE).  We can't just mask the command with
+// GEI_CM_MASK - FILL RAM (0x15) and TEST RAM (0x05), for example, differ
+// only in bit 4.  The times are in microseconds, and histogram bucket n
+// counts round trips less than 2**n milliseconds, except for the last one
+// which counts everything longer ...
+struct _GEI_LATENCY {
+  uint32_t nCommands;               // number of commands sent
+  uint32_t nResponses;              // number of responses received
+  uint64_t llTotal;                 // sum of all the round trip times
+  uint64_t llMaximum;               // longest round trip
+  uint32_t anHistogram[GEI_LATENCY_BUCKETS];
+};
+typedef struct _GEI_LATENCY GEI_LATENCY;
+PRIVATE GEI_LATENCY m_geiLatency[256];
+#define GEI_LATENCY_INDEX(b)  ((uint8_t) ((b) & ~GEI_CM_NORESPONSE))
 
 
 PUBLIC uint8_t geiConnect (const char *pszName, uint32_t nBaud)
@@ -81,7 +105,7 @@ PUBLIC uint8_t geiConnect (const char *pszName, uint32_t nBaud)
   // we print an error message and abort.
   //--
   uint32_t lTimeout = 0;  uint8_t bData;
-  serOpen(pszName, nBaud);
+  serOpen(pszName, nBaud);  m_geiBaud = (nBaud != 0) ? nBaud : DEFAULTBAUD;
   fprintf(stderr, "Connecting to %s at %d baud ...", pszName, nBaud);
 
   //   Set DTR and the clear it - this causes the PromICE to reset.  Yes, the
@@ -148,6 +172,46 @@ PUBLIC uint8_t geiConnect (const char *pszName, uint32_t nBaud)
   return (m_geiUnits = bData);
 }
 
+PRIVATE const char *geiCommandName (uint8_t bCommand)
+{
+  //++
+  // Return the name of a command code, for geiShowStatistics() ...
+  //--
+  static char szCode[8];
+  switch (bCommand) {
+    case GEI_LOADPOINTER:   return "LOAD POINTER";
+    case GEI_WRITEDATA:     return "WRITE DATA";
+    case GEI_READDATA:      return "READ DATA";
+    case GEI_RESTART:       return "RESTART";
+    case GEI_SETMODE:       return "SET MODE";
+    case GEI_SETSIZE:       return "SET SIZE";
+    case GEI_TESTRAM:       return "TEST RAM";
+    case GEI_FILLRAM:       return "FILL RAM";
+    case GEI_RESETTARGET:   return "RESET TARGET";
+    case GEI_TESTPROMICE:   return "TEST PROMICE";
+    case GEI_EXTENDED:      return "EXTENDED";
+    case GEI_READVERSION:   return "READ VERSION";
+    case GEI_READSERIAL:    return "READ SERIAL";
+    default:
+      snprintf(szCode, sizeof(szCode), "0x%02X", bCommand);
+      return szCode;
+  }
+}
+
+PRIVATE void geiRecordLatency (uint8_t bCommand, uint64_t llStart)
+{
+  //++
+  //   Record the round trip time for the command code bCommand, which was
+  // sent at llStart (in serGetTime() units) and has just been answered.
+  //--
+  GEI_LATENCY *p = &m_geiLatency[GEI_LATENCY_INDEX(bCommand)];
+  uint64_t llTime = serGetTime() - llStart;
+  uint32_t i, lMilliseconds = (uint32_t) (llTime / 1000ULL);
+  for (i = 0;  (i < GEI_LATENCY_BUCKETS-1) && (lMilliseconds >= (1UL << i));  ++i) ;
+  ++p->nResponses;  ++p->anHistogram[i];  p->llTotal += llTime;
+  if (llTime > p->llMaximum)  p->llMaximum = llTime;
+}
+
 PRIVATE void geiDoCommand (uint32_t lTimeout)
 {
   //++
@@ -162,7 +226,9 @@ PRIVATE void geiDoCommand (uint32_t lTimeout)
   //   Remember that a count of 0 means 256 bytes of data!
   size_t cbCommand = GEI_HEADERLEN + m_geiCommand.bCount;
   if (m_geiCommand.bCount == 0) cbCommand += GEI_MAXDATALEN;
+  uint64_t llStart = serGetTime();
   serSend((uint8_t *) &m_geiCommand, cbCommand);
+  ++m_geiLatency[GEI_LATENCY_INDEX(m_geiCommand.bCommand)].nCommands;
 
   // If this command doesn't need/want a response, then quit now!
   memset(&m_geiResponse, 0, sizeof(m_geiResponse));
@@ -187,6 +253,7 @@ PRIVATE void geiDoCommand (uint32_t lTimeout)
   size_t cbReceived = serReceive(&m_geiResponse.abData[0], cbResponse, lResponseTimeout);
   if (cbReceived != cbResponse)
     FatalError("timeout waiting for data for response 0x%02X (received %d expected %d)", m_geiCommand.bCommand, cbReceived, cbResponse);
+  geiRecordLatency(m_geiCommand.bCommand, llStart);
 }
 
 PRIVATE void geiSendCommand (uint32_t lTimeout, uint8_t bUnit, uint8_t bCommand, uint8_t bCount, uint8_t bData, ...)
@@ -423,6 +490,25 @@ PRIVATE void geiLoadPointer (uint8_t bUnit, uint32_t lAddress)
   //  FatalError("unexpected response 0x%02x to LOAD POINTER", m_geiResponse.bCommand);
 }
 
+PRIVATE uint8_t geiBuildWriteData (uint8_t bUnit, uint8_t *pabData, size_t cbData)
+{
+  //++
+  //   Build a WRITE DATA command for cbData (1..256) bytes in m_geiCommand,
+  // and return the XOR of all the data bytes.  That's what the PromICE will
+  // send back in its response...
+  //--
+  memset(&m_geiCommand, 0, sizeof(m_geiCommand));
+  m_geiCommand.bUnitID = bUnit;
+  m_geiCommand.bCommand = GEI_WRITEDATA;
+  m_geiCommand.bCount = cbData & 0xFF;
+  uint8_t bCK = 0;
+  for (uint32_t i = 0; i < cbData; ++i) {
+    m_geiCommand.abData[i] = pabData[i];
+    bCK ^= pabData[i];
+  }
+  return bCK;
+}
+
 PUBLIC void geiDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress)
 {
   //++
@@ -437,20 +523,8 @@ PUBLIC void geiDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_
   // First set the PromICE address pointer ...
   geiLoadPointer(bUnit, lAddress);
 
-  // Build the command packet header ...
-  memset(&m_geiCommand, 0, sizeof(m_geiCommand));
-  m_geiCommand.bUnitID = bUnit;
-  m_geiCommand.bCommand = GEI_WRITEDATA;
-  m_geiCommand.bCount = cbData & 0xFF;
-
-  // Copy in the data bytes ...
-  uint8_t bCK = 0;
-  for (uint32_t i = 0; i < cbData; ++i) {
-    m_geiCommand.abData[i] = pabData[i];
-    bCK ^= pabData[i];
-  }
-
-  // Send it and get the response ...
+  // Build the command packet, send it and get the response ...
+  uint8_t bCK = geiBuildWriteData(bUnit, pabData, cbData);
   geiDoCommand(LONG_TIMEOUT);
   if   ((m_geiResponse.bCount != 1) 
     || ((m_geiResponse.bCommand & GEI_CM_MASK) != GEI_WRITEDATA))
@@ -459,6 +533,119 @@ PUBLIC void geiDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_
     FatalError("XOR mismatch for WRITE DATA 0x%02X != 0x%02X", bCK, m_geiResponse.abData[0]);
 }
 
+PRIVATE bool geiReceiveXOR (uint32_t lTimeout, uint8_t *pbUnit, uint8_t *pbXOR)
+{
+  //++
+  //   Receive the response to one WRITE DATA command.  That's always the three
+  // header bytes plus one data byte, the XOR of all the bytes written.  The
+  // unit that sent it is returned in pbUnit.  Unlike geiDoCommand() this never
+  // gives up - if the response doesn't come or isn't right, it just returns
+  // false and lets the caller decide what to do.
+  //--
+  uint8_t abResponse[GEI_HEADERLEN+1];
+  if (serReceive(abResponse, sizeof(abResponse), lTimeout) != sizeof(abResponse))
+    return false;
+  if (   (abResponse[0] >= m_geiUnits) || !ISSET(abResponse[1], GEI_CM_RESPONSE)
+      || ((abResponse[1] & GEI_CM_MASK) != GEI_WRITEDATA) || (abResponse[2] != 1))
+    return false;
+  *pbUnit = abResponse[0];  *pbXOR = abResponse[3];
+  return true;
+}
+
+PUBLIC void geiStreamDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress)
+{
+  //++
+  //   This routine downloads any amount of data to one PromICE unit, starting
+  // at lAddress.  It gives the same result as calling geiDownload() for every
+  // 256 byte chunk, but it's a lot faster - see geiStreamDownloadUnits().
+  //--
+  GEI_STREAM Stream = {bUnit, pabData, cbData, lAddress};
+  geiStreamDownloadUnits(&Stream, 1);
+}
+
+PUBLIC void geiStreamDownloadUnits (GEI_STREAM *pStreams, uint8_t nStreams)
+{
+  //++
+  //   This routine downloads data to one or more PromICE units at the same
+  // time.  The PromICE advances its address pointer after every WRITE DATA,
+  // so we only need to send LOAD POINTER once for each unit.  And we don't
+  // wait for each response before sending the next chunk.  Up to GEI_WINDOW
+  // chunks can be in flight at once, and the XOR from each response is checked
+  // as it comes back.  That keeps the serial line busy all the time.
+  //
+  //   With a master/slave PromICE the chunks for each unit are sent in turn,
+  // so that one unit is always busy with its data while we're waiting for the
+  // other.  Each unit has its own address pointer, so they don't interfere.
+  // The responses for any one unit come back in order, but the two units may
+  // be mixed up, so we keep a separate list of expected XORs for each unit.
+  //
+  //   If a response doesn't come back, or the XOR is wrong, then we give up
+  // on streaming.  We wait for the PromICE to finish, throw away whatever it
+  // sent, and then send all the unconfirmed chunks again with geiDownload().
+  // That's the same stop-and-wait as always, and any errors there are fatal.
+  //--
+  assert((pStreams != NULL) && (nStreams > 0) && (nStreams <= MAXUNIT));
+  uint8_t abXOR[MAXUNIT][GEI_WINDOW];  uint8_t bUnit, bXOR;
+  uint64_t allSent[MAXUNIT][GEI_WINDOW];
+  size_t anChunks[MAXUNIT], anSent[MAXUNIT], anDone[MAXUNIT];
+  uint8_t anStream[MAXUNIT];  uint8_t i, iNext = 0;
+  size_t nChunks = 0, nSent = 0, nDone = 0;
+
+  //   The oldest response may have to wait while a whole window of commands
+  // is sent, so allow for that (at 10 bits per byte) in the timeout ...
+  uint32_t lTimeout = LONG_TIMEOUT
+    + (uint32_t) ((GEI_WINDOW * (GEI_HEADERLEN+GEI_MAXDATALEN) * 10000UL) / m_geiBaud);
+
+  // Set the address pointer for every unit first ...
+  for (i = 0;  i < MAXUNIT;  ++i)  anStream[i] = 0xFF;
+  for (i = 0;  i < nStreams;  ++i) {
+    assert((pStreams[i].pabData != NULL) && (pStreams[i].bUnit < MAXUNIT));
+    anStream[pStreams[i].bUnit] = i;
+    anChunks[i] = (pStreams[i].cbData + GEI_MAXDATALEN-1) / GEI_MAXDATALEN;
+    anSent[i] = anDone[i] = 0;  nChunks += anChunks[i];
+    if (anChunks[i] > 0)  geiLoadPointer(pStreams[i].bUnit, pStreams[i].lAddress);
+  }
+
+  while (nDone < nChunks) {
+    //   Keep the window full as long as there's something left to send, taking
+    // the units in turn ...
+    if ((nSent < nChunks) && ((nSent - nDone) < GEI_WINDOW)) {
+      while (anSent[iNext] >= anChunks[iNext])  iNext = (iNext+1) % nStreams;
+      GEI_STREAM *p = &pStreams[iNext];
+      size_t cb = p->cbData - anSent[iNext]*GEI_MAXDATALEN;
+      if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
+      abXOR[iNext][anSent[iNext] % GEI_WINDOW] = geiBuildWriteData(p->bUnit, p->pabData + anSent[iNext]*GEI_MAXDATALEN, cb);
+      allSent[iNext][anSent[iNext] % GEI_WINDOW] = serGetTime();
+      serSend((uint8_t *) &m_geiCommand, GEI_HEADERLEN + cb);
+      ++m_geiLatency[GEI_WRITEDATA].nCommands;
+      ++anSent[iNext];  ++nSent;  iNext = (iNext+1) % nStreams;
+      continue;
+    }
+
+    // Otherwise wait for the next response, from whichever unit ...
+    if (   geiReceiveXOR(lTimeout, &bUnit, &bXOR)
+        && ((i = anStream[bUnit]) != 0xFF)
+        && (anDone[i] < anSent[i])
+        && (bXOR == abXOR[i][anDone[i] % GEI_WINDOW])) {
+      geiRecordLatency(GEI_WRITEDATA, allSent[i][anDone[i] % GEI_WINDOW]);
+      ++anDone[i];  ++nDone;  continue;
+    }
+
+    // Something went wrong - finish the hard way ...
+    Message("streaming failed - retrying one chunk at a time");
+    serSleep(LONG_TIMEOUT);  serFlush();
+    for (i = 0;  i < nStreams;  ++i) {
+      GEI_STREAM *p = &pStreams[i];
+      for (;  anDone[i] < anChunks[i];  ++anDone[i]) {
+        size_t cb = p->cbData - anDone[i]*GEI_MAXDATALEN;
+        if (cb > GEI_MAXDATALEN)  cb = GEI_MAXDATALEN;
+        geiDownload(p->bUnit, p->pabData + anDone[i]*GEI_MAXDATALEN, cb, p->lAddress + anDone[i]*GEI_MAXDATALEN);
+      }
+    }
+    return;
+  }
+}
+
 PUBLIC void geiUpload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress)
 {
   //++
@@ -481,3 +668,41 @@ PUBLIC void geiUpload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t
   // Store the result and we're done ...
   memcpy(pabData, &m_geiResponse.abData, cbData);
 }
+
+PUBLIC void geiShowStatistics()
+{
+  //++
+  //   Print the serial port counters and the round trip time histograms for
+  // the last connection.  The line usage is the busier direction as a
+  // percentage of what the baud rate (at ten bits per byte) could carry, and
+  // it's a good hint when picking a baud rate - if it's near 100% then the
+  // serial line is the bottleneck, and otherwise it's the PromICE or the host.
+  //--
+  SER_STATISTICS ss;  serGetStatistics(&ss);
+  double dSeconds = (double) (ss.llCloseTime - ss.llOpenTime) / 1000000.0;
+  uint64_t llBusiest = (ss.llBytesSent > ss.llBytesReceived) ? ss.llBytesSent : ss.llBytesReceived;
+  fprintf(stderr, "\nSerial port statistics:\n");
+  fprintf(stderr, "  %llu bytes sent in %u writes, %llu bytes received in %u reads\n",
+    (unsigned long long) ss.llBytesSent, ss.nWrites, (unsigned long long) ss.llBytesReceived, ss.nReads);
+  fprintf(stderr, "  %u receive timeouts, %.2f seconds connected", ss.nTimeouts, dSeconds);
+  if ((dSeconds > 0) && (m_geiBaud != 0))
+    fprintf(stderr, ", %.0f%% of %u baud used", (llBusiest * 10.0 * 100.0) / (m_geiBaud * dSeconds), m_geiBaud);
+  fprintf(stderr, "\n\nRound trip times (ms):\n");
+  fprintf(stderr, "  command         sent   avg   max");
+  for (uint32_t i = 0;  i < GEI_LATENCY_BUCKETS-1;  ++i) {
+    char szBucket[8];  snprintf(szBucket, sizeof(szBucket), "<%lu", 1UL << i);
+    fprintf(stderr, " %6s", szBucket);
+  }
+  fprintf(stderr, "   more\n");
+  for (uint32_t c = 0;  c < 256;  ++c) {
+    GEI_LATENCY *p = &m_geiLatency[c];
+    if (p->nCommands == 0)  continue;
+    fprintf(stderr, "  %-12s %7u", geiCommandName((uint8_t) c), p->nCommands);
+    if (p->nResponses == 0) {
+      fprintf(stderr, "  (no response)\n");  continue;
+    }
+    fprintf(stderr, " %5.1f %5.1f", (p->llTotal / 1000.0) / p->nResponses, p->llMaximum / 1000.0);
+    for (uint32_t i = 0;  i < GEI_LATENCY_BUCKETS;  ++i)  fprintf(stderr, " %6u", p->anHistogram[i]);
+    fprintf(stderr, "\n");
+  }
+}
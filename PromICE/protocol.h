@@ -17,6 +17,8 @@
 //
 // REVISION HISTORY:
 // 24-MAR-23  RLA   New file.
+// 14-OCT-26  AGT   Add geiStreamDownload().
+// 14-OCT-26  AGT   Add geiShowStatistics().
 //--
 #pragma once
 
@@ -26,6 +28,8 @@
 #define CONNECT_TIMEOUT 20000UL // timeout for connecting (20s)
 #define RAMTEST_TIMEOUT 30000UL // timeout for RAM TEST and FILL (30s)
 #define RESET_LENGTH       55   // approximately 500ms
+#define GEI_WINDOW          4   // WRITE DATA commands in flight when streaming
+#define GEI_LATENCY_BUCKETS 12  // round trip histogram buckets (<1ms .. >1s)
 
 // "Special" PromICE commands - these are sent without the usual preamble ...
 #define GEI_AUTOBAUD      0x03  // what we send to establish the baud rate
@@ -96,6 +100,16 @@ struct _GEI_MESSAGE {
 #pragma pack(pop)
 typedef struct _GEI_MESSAGE GEI_MESSAGE;
 
+//   One of these describes the data to be streamed to each unit by
+// geiStreamDownloadUnits().  Each stream must be for a different unit ...
+struct _GEI_STREAM {
+  uint8_t  bUnit;                 // unit (0 or 1) to download to
+  uint8_t *pabData;               // data to be downloaded
+  size_t   cbData;                // number of bytes to download
+  uint32_t lAddress;              // PromICE address for the first byte
+};
+typedef struct _GEI_STREAM GEI_STREAM;
+
 // Global methods ...
 extern uint8_t geiConnect (const char *pszName, uint32_t nBaud);
 extern void geiDisconnect();
@@ -108,4 +122,7 @@ extern int32_t geiFillRAM (uint8_t bUnit, uint8_t bValue);
 extern void geiResetTarget();
 extern void geiLoadMode ();
 extern void geiDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress);
+extern void geiStreamDownload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress);
+extern void geiStreamDownloadUnits (GEI_STREAM *pStreams, uint8_t nStreams);
 extern void geiUpload (uint8_t bUnit, uint8_t *pabData, size_t cbData, uint32_t lAddress);
+extern void geiShowStatistics();
@@ -30,11 +30,27 @@
 //      serReceiveByte()  - ditto ...
 //      serSetDTR()       - assert or deassert serial DTR
 //      serSleep()        - generic delay/sleep function
+//      serGetTime()      - return a microsecond timer for measurements
+//      serGetStatistics()- return the byte, read and timeout counters
 // 
 // NOTES
 //   Currently any data associated with the serial connection is maintained in
 // static variables local to this module.  Because of that only one active
 // serial connection is supported.  That's plenty for PromICE.
+//
+//   The port timeouts are set up just once, by serOpen(), and never changed.
+// Received data goes into a buffer here, and each read from the OS takes
+// everything that's waiting (up to SERIAL_BUFFER bytes).  serReceive() is
+// satisfied from that buffer and only goes back to the OS when it's empty.
+// The GEI protocol reads a three byte header and then the payload for every
+// response, and with streaming there are several responses waiting at once,
+// so most receives now never make a system call at all.  On Linux we wait
+// for data with poll(), and on Windows ReadFile() returns as soon as anything
+// arrives (see serOpen()).
+//
+//   We also count the bytes sent and received, the number of reads and writes
+// and the number of receives that timed out.  serGetStatistics() returns
+// those, and PromICE can print them with the "-t" option.
 // 
 //   If neither _WIN32 nor the __linux__ is defined, then this module generates
 // code that always returns a failure status!  That means you can build PromICE
@@ -43,6 +59,8 @@
 // REVISION HISTORY:
 // 24-MAR-23  RLA  New file.
 //  6-APR-23  RLA  Add Linux support.
+// 14-OCT-26  AGT  Buffer received data and set the port timeouts just once.
+// 14-OCT-26  AGT  Ignore DTR on a pty, for gesim.
 //--
 //000000001111111111222222222233333333334444444444555555555566666666667777777777
 //234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -61,9 +79,9 @@
 #include <fcntl.h>              // _O_TRUNC, _O_WRONLY, etc...
 #include <termios.h>            // POSIX terminal control functions
 #include <errno.h>              // errno, ENOENT, etc ...
-#include <time.h>		// struct timeval for select()...
+#include <time.h>               // clock_gettime(), ...
 #include <sys/ioctl.h>          // ioctl(), et al ...
-#include <sys/select.h>		// select() (what else?)
+#include <poll.h>               // poll(), struct pollfd, ...
 #endif
 #include "PromICE.h"            // global declarations for this project
 #include "serial.h"             // declarations for this module
@@ -74,6 +92,10 @@ PRIVATE HANDLE m_hSerialPort = NULL;  // Windows device handle for the port
 #elif defined(__linux__)
 PRIVATE int    m_hSerialPort = 0;     // Linux device handle for the port
 #endif
+PRIVATE uint8_t m_abBuffer[SERIAL_BUFFER];// data received but not yet used
+PRIVATE size_t  m_iBufferNext;        // next byte in m_abBuffer to return
+PRIVATE size_t  m_cbBuffer;           // number of bytes in m_abBuffer
+PRIVATE SER_STATISTICS m_Statistics;  // byte counts, timeouts, etc
 
 
 #ifdef __linux__
@@ -142,6 +164,18 @@ PUBLIC void serOpen (const char *pszName, uint32_t nBaud)
   if (!SetCommState (m_hSerialPort, &dcb))
     FatalError("error (%d) setting COM port mode", GetLastError());
 
+  //   Set the timeouts, once and for all.  This particular combination (it's
+  // documented under COMMTIMEOUTS) makes ReadFile() return immediately with
+  // whatever is already buffered or, if there's nothing, as soon as one byte
+  // arrives.  If nothing comes for SERIAL_POLL milliseconds it returns with
+  // no data, and serFillBuffer() decides whether to keep waiting.
+  COMMTIMEOUTS cto;  memset(&cto, 0, sizeof(cto));
+  cto.ReadIntervalTimeout = MAXDWORD;
+  cto.ReadTotalTimeoutMultiplier = MAXDWORD;
+  cto.ReadTotalTimeoutConstant = SERIAL_POLL;
+  if (!SetCommTimeouts(m_hSerialPort, &cto))
+    FatalError("error (%d) setting COM port timeouts", GetLastError());
+
 #elif defined(__linux__)
   // LINUX VERSION ...
 
@@ -162,9 +196,17 @@ PUBLIC void serOpen (const char *pszName, uint32_t nBaud)
   cfmakeraw(&ts);
   ts.c_cflag &= ~(PARENB | CSTOPB | CSIZE);
   ts.c_cflag |=  (CLOCAL | CREAD  | CS8);
+  //   VMIN and VTIME are both zero, so read() returns whatever is available
+  // without waiting.  The waiting is all done by poll() in serFillBuffer().
+  ts.c_cc[VMIN] = 0;  ts.c_cc[VTIME] = 0;
   if (tcsetattr(m_hSerialPort, TCSANOW, &ts) < 0)
     FatalError("error (%s) setting port mode", strerror(errno));
 #endif
+
+  // Start with an empty buffer and the counters all zero ...
+  m_iBufferNext = m_cbBuffer = 0;
+  memset(&m_Statistics, 0, sizeof(m_Statistics));
+  m_Statistics.llOpenTime = serGetTime();
 }
 
 PUBLIC void serClose()
@@ -173,6 +215,7 @@ PUBLIC void serClose()
   // Close the serial port opened by a call to serOpen()...
   //--
   assert(m_hSerialPort);
+  m_Statistics.llCloseTime = serGetTime();
 #if defined(_WIN32)
   CloseHandle(m_hSerialPort);  m_hSerialPort = NULL;
 #elif defined(__linux__)
@@ -185,9 +228,10 @@ PUBLIC void serFlush()
   //++
   //   Flush the serial port buffers (both transmit and receive!).  This is
   // used during startup to flush any garbage characters received during
-  // the initial negotiation.
+  // the initial negotiation.  Anything in our own receive buffer goes too.
   //--
   assert(m_hSerialPort);
+  m_iBufferNext = m_cbBuffer = 0;
 #if defined(_WIN32)
   FlushFileBuffers(m_hSerialPort);
 #elif defined(__linux__)
@@ -220,6 +264,7 @@ PUBLIC void serSend (const uint8_t *pabBuffer, size_t cbBuffer)
   if ((write(m_hSerialPort, pabBuffer, cbBuffer)) != cbBuffer)
     FatalError("error (%s) writing to serial port", strerror(errno));
 #endif
+  m_Statistics.llBytesSent += cbBuffer;  ++m_Statistics.nWrites;
 }
 
 PUBLIC void serSendByte (uint8_t bData)
@@ -230,84 +275,85 @@ PUBLIC void serSendByte (uint8_t bData)
   serSend(&bData, 1);
 }
 
-PUBLIC size_t serReceive (uint8_t *pabBuffer, size_t cbBuffer, uint32_t lTimeout)
+PRIVATE bool serFillBuffer (uint64_t llDeadline)
 {
   //++
-  //   Receive characters from the serial port and store them in the caller's
-  // buffer.  This is a blocking receive (i.e. this program will wait for data
-  // if necessary) BUT with a timeout.  This routine will return whenever either
-  // a) cbBuffer characters have been read, or b) lTimeout milliseconds elapses
-  // without any new data received.  The return value is the number of bytes
-  // actually read, which may be zero if the timeout expires with no input.
+  //   Read everything that's waiting at the serial port, up to SERIAL_BUFFER
+  // bytes, into our buffer.  The buffer must be empty when this is called.
+  // If nothing is waiting then wait for something to arrive, but not past
+  // llDeadline (in serGetTime() units).  Returns false if nothing arrives in
+  // time, and we always try at least once even if the deadline has passed.
   //--
-  assert(m_hSerialPort);
+  assert(m_hSerialPort && (m_iBufferNext == m_cbBuffer));
+  m_iBufferNext = m_cbBuffer = 0;
 #if defined(_WIN32)
   // WINDOWS VERSION ...
-
-  //   Set the serial port timeouts.  Note that the Windows timeouts are a
-  // little more elaborate, with both an inter-character timeout AND a
-  // total receive time timeout.  We're only using the inter-character
-  // timeout here, BUT apparently if you set the ReadIntervalTimeout but
-  // don't set a ReadTotalTimeout, then the first character will never
-  // time out!  We have to set a ReadTotalTimeoutMultiplier, which sets
-  // a timeout for the entire message based on the number of bytes.
-  COMMTIMEOUTS cto;  memset(&cto, 0, sizeof(cto));
-  cto.ReadTotalTimeoutConstant = lTimeout;
-  if (!SetCommTimeouts(m_hSerialPort, &cto))
-    FatalError("error (%d) setting COM port timeouts", GetLastError());
-
-  // And try to read some bytes ... 
   DWORD dwReceived;
-  if (!ReadFile(m_hSerialPort, pabBuffer, cbBuffer, &dwReceived, NULL))
-    FatalError("error (%d) reading COM port", GetLastError());
-  return dwReceived;
+  do {
+    if (!ReadFile(m_hSerialPort, m_abBuffer, sizeof(m_abBuffer), &dwReceived, NULL))
+      FatalError("error (%d) reading COM port", GetLastError());
+    ++m_Statistics.nReads;
+    if (dwReceived > 0) {
+      m_cbBuffer = dwReceived;  m_Statistics.llBytesReceived += dwReceived;
+      return true;
+    }
+  } while (serGetTime() < llDeadline);
+  return false;
 
 #elif defined(__linux__)
   // LINUX VERSION ...
-
-  //   Linux is also messy for setting a serial port timeout (why is this hard?!).
-  // You can set VMIN and VTIME in the termios structure, BUT if both of those
-  // are non-zero then the timeout only applies to the second and subsequent
-  // characters.  THERE IS NO TIMEOUT FOR THE FIRST CHARACTER!  The only way to
-  // get a read with an overall timeout is to use select() in addition to VMIN
-  // and VTIME.
-
-  // Set the intercharacter timeout to 100ms ...
-  struct termios ts;  bzero(&ts, sizeof(ts));
-  if (tcgetattr(m_hSerialPort, &ts) < 0)
-    FatalError("error (%s) getting port settings", strerror(errno));
-  ts.c_cc[VMIN] = 0/*cbBuffer*/;  ts.c_cc[VTIME] = 1UL;
-  if (tcsetattr(m_hSerialPort, TCSANOW, &ts) < 0)
-    FatalError("error (%s) setting port mode", strerror(errno));
-
-  // Set the timeout for the first character to lTimeout ...
-  int maxfd = m_hSerialPort+1;  struct timeval tv;
-  tv.tv_sec = lTimeout/1000UL;  tv.tv_usec = (lTimeout%1000UL)*1000UL;
-  fd_set fs;  FD_ZERO(&fs);  FD_SET(m_hSerialPort, &fs);
-
-  //   Loop unti we either fulfill the entire read request, or the
-  // timeout occurs  Note that select() will update the timeout
-  // structure after each call to reflect the time remaining, so
-  // the total timeout specified by the caller remains in effect.
-  size_t cbReceived = 0;
-  while ((cbReceived < cbBuffer) && (select(maxfd, &fs, NULL, NULL, &tv) > 0)) {
-    assert(FD_ISSET(m_hSerialPort, &fs));
-    ssize_t cb = read(m_hSerialPort, pabBuffer+cbReceived, cbBuffer-cbReceived);
+  for (;;) {
+    uint64_t llNow = serGetTime();
+    int nWait = (llNow < llDeadline) ? (int) ((llDeadline-llNow+999ULL) / 1000ULL) : 0;
+    struct pollfd pfd = {m_hSerialPort, POLLIN, 0};
+    int nReady = poll(&pfd, 1, nWait);
+    if (nReady < 0) {
+      if (errno == EINTR) continue;
+      FatalError("error (%s) waiting for serial port", strerror(errno));
+    }
+    if (nReady == 0)  return false;
+    ssize_t cb = read(m_hSerialPort, m_abBuffer, sizeof(m_abBuffer));
+    ++m_Statistics.nReads;
     if (cb < 0)
-      FatalError("error (%) reading serial port", strerror(errno));
-    cbReceived += cb;
+      FatalError("error (%s) reading serial port", strerror(errno));
+    if (cb > 0) {
+      m_cbBuffer = (size_t) cb;  m_Statistics.llBytesReceived += cb;
+      return true;
+    }
+    if (serGetTime() >= llDeadline)  return false;
   }
 
-  //   select() timed out so there's nothing more OR we've reached
-  // the requested byte count.
-  return cbReceived;
-
 #else
   // Anything else is not implemented!
-  return 0;
+  return false;
 #endif
 }
 
+PUBLIC size_t serReceive (uint8_t *pabBuffer, size_t cbBuffer, uint32_t lTimeout)
+{
+  //++
+  //   Receive characters from the serial port and store them in the caller's
+  // buffer.  This is a blocking receive (i.e. this program will wait for data
+  // if necessary) BUT with a timeout.  This routine will return whenever either
+  // a) cbBuffer characters have been read, or b) lTimeout milliseconds elapses
+  // before they all arrive.  The return value is the number of bytes actually
+  // read, which may be zero if the timeout expires with no input.
+  //--
+  assert(m_hSerialPort);
+  uint64_t llDeadline = serGetTime() + 1000ULL*lTimeout;
+  size_t cbReceived = 0;
+  while (cbReceived < cbBuffer) {
+    if ((m_iBufferNext == m_cbBuffer) && !serFillBuffer(llDeadline)) {
+      ++m_Statistics.nTimeouts;  break;
+    }
+    size_t cb = m_cbBuffer - m_iBufferNext;
+    if (cb > (cbBuffer-cbReceived))  cb = cbBuffer-cbReceived;
+    memcpy(pabBuffer+cbReceived, m_abBuffer+m_iBufferNext, cb);
+    cbReceived += cb;  m_iBufferNext += cb;
+  }
+  return cbReceived;
+}
+
 PUBLIC bool serReceiveByte (uint8_t *pbData, uint32_t lTimeout)
 {
   //++
@@ -330,7 +376,9 @@ PUBLIC void serSetDTR (bool fDTR)
   // LINUX VERSION ...
   int bits = TIOCM_DTR;
   unsigned long func = fDTR ? TIOCMBIS : TIOCMBIC;
-  if (ioctl(m_hSerialPort, func, &bits) != 0)
+  //   A pseudo terminal (e.g. the one gesim uses) has no modem control lines
+  // at all, and that's not an error ...
+  if ((ioctl(m_hSerialPort, func, &bits) != 0) && (errno != ENOTTY))
     FatalError("error (%s) controlling DTR", strerror(errno));
 #endif
 }
@@ -353,3 +401,35 @@ PUBLIC void serSleep (uint32_t lDelay)
 #endif
 }
 
+PUBLIC uint64_t serGetTime()
+{
+  //++
+  //   Return a free running timer in microseconds.  It's only used to measure
+  // intervals, so where it starts doesn't matter.
+  //--
+#if defined(_WIN32)
+  // WINDOWS VERSION ...
+  LARGE_INTEGER liNow, liFrequency;
+  QueryPerformanceCounter(&liNow);  QueryPerformanceFrequency(&liFrequency);
+  return (uint64_t) ((liNow.QuadPart / liFrequency.QuadPart) * 1000000ULL
+    + ((liNow.QuadPart % liFrequency.QuadPart) * 1000000ULL) / liFrequency.QuadPart);
+#elif defined(__linux__)
+  // LINUX VERSION ...
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec*1000000ULL + (uint64_t) ts.tv_nsec/1000ULL;
+#else
+  return 0;
+#endif
+}
+
+PUBLIC void serGetStatistics (SER_STATISTICS *pStatistics)
+{
+  //++
+  //   Return a copy of the counters for the current (or, after serClose(),
+  // the last) connection.  If the port is still open then llCloseTime is
+  // the current time ...
+  //--
+  *pStatistics = m_Statistics;
+  if (m_hSerialPort)  pStatistics->llCloseTime = serGetTime();
+}
@@ -17,9 +17,27 @@
 //
 // REVISION HISTORY:
 // 24-MAR-23  RLA   New file.
+// 14-OCT-26  AGT   Add the receive buffer and statistics.
 //--
 #pragma once
 
+// Parameters ...
+#define SERIAL_BUFFER   4096    // size of the receive buffer
+#define SERIAL_POLL       10UL  // Windows ReadFile() timeout, in milliseconds
+
+//   Counters kept by the serial module for one connection.  The times are in
+// microseconds, as returned by serGetTime() ...
+struct _SER_STATISTICS {
+  uint64_t llBytesSent;         // total bytes written to the port
+  uint64_t llBytesReceived;     // total bytes read from the port
+  uint32_t nWrites;             // number of writes to the port
+  uint32_t nReads;              // number of reads from the port
+  uint32_t nTimeouts;           // number of receives that timed out
+  uint64_t llOpenTime;          // when serOpen() was called
+  uint64_t llCloseTime;         // when serClose() was called
+};
+typedef struct _SER_STATISTICS SER_STATISTICS;
+
 // Global methods ...
 extern void serOpen (const char *pszName, uint32_t nBaud);
 extern void serClose();
@@ -30,3 +48,5 @@ extern size_t serReceive (uint8_t *pabBuffer, size_t cbBuffer, uint32_t lTimeout
 extern bool serReceiveByte (uint8_t *pbData, uint32_t lTimeout);
 extern void serSetDTR (bool fDTR);
 extern void serSleep (uint32_t lDelay);
+extern uint64_t serGetTime();
+extern void serGetStatistics (SER_STATISTICS *pStatistics);
@@ -57,11 +57,34 @@
 // ensures that if there are an odd number of data bytes then the next record
 // always starts on a word address.
 //
+//   Paper tapes usually have lots of small records, often for consecutive
+// addresses, and sometimes later records overwrite parts of earlier ones.
+// So rather than copying the tape one record at a time, abs2asm loads all of
+// it into a 64K byte memory image, just as the absolute loader would, and
+// then writes one record for each contiguous range of loaded bytes, followed by
+// the start (zero length) record.  The -k option keeps the original records
+// instead.
+//
+//   If the output file has a .bin or .hex extension (or with the -b or -x
+// options), then abs2asm writes the memory image itself, from the lowest to
+// the highest loaded address, as a raw binary or Intel .hex file.  That lets
+// an ABS tape go straight into the ROM tools without assembling anything.
+// Unloaded bytes in the middle are zero.  A record that wraps around from
+// 177777 to 000000 would make the image cover the whole 64K, so that's an
+// error here (it's fine for assembly output - it just becomes two records).
+//
+//   Either file name may be "-" for standard input or output.
+//
 // USAGE:
-//      abs2asm [-v] <paper time image file> <assembly output file>
+//      abs2asm [-v] [-k] [-b | -x] <paper tape image file> <output file>
 //
 // REVISION HISTORY
 // 11-Apr-21    RLA             New file.
+// 14-Oct-26    AGT             Read the tape through a 64K buffer, and allow stdin.
+// 14-Oct-26    AGT             Merge tape records into contiguous ranges.
+// 14-Oct-26    AGT             Format .BYTE statements without fprintf().
+// 14-Oct-26    AGT             Add binary and Intel .hex output.
+// 14-Oct-26    AGT             Reject records that wrap past 177777 for .bin/.hex.
 //--
 //000000001111111111222222222233333333334444444444555555555566666666667777777777
 //234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -72,32 +95,57 @@
 #include <assert.h>             // assert() (what else?)
 #include <string.h>		// strlen(), etc ...
 #include <ctype.h>              // isprint(), et al ...
+#include <errno.h>              // errno, EINTR, ...
 #ifdef __linux__
 #include <unistd.h>		// read(), open(), etc ...
 #include <libgen.h>		// basename(), ...
+#include <strings.h>		// strcasecmp(), ...
 #include <sys/io.h>             // _read(), _open(), et al...
 #include <linux/limits.h>	// PATH_MAX, ...
 #define O_BINARY 0
 #else
 #include <io.h>                 // _read(), _open(), et al...
+#define strcasecmp _stricmp
 #endif
 #include <fcntl.h>              // _O_RDONLY, _O_BINARY, etc...
+#include "checksum.h"           // ckSum(), ...
+#include "intelhex.h"           // hexWrite(), ...
 
 // CONSTANTS ...
-#define ABSBUFSIZ	  512	// size of the ABS file chunks we read
+#define ABSBUFSIZ	65536	// size of the ABS file chunks we read
 #define MAXABSBLK       32768   // largest possible single ABS file block
+#define MEMSIZE         65536   // PDP11 address space, in bytes
+#define BYTESPERLINE        8   // data bytes in each .BYTE statement
+#define ASMBUFSIZ       65536   // size of the assembly output buffer
+
+// Output file formats ...
+typedef enum _OUTPUT_FORMAT {
+  OUTPUT_ASM,                   // assembly language .WORD/.BYTE statements
+  OUTPUT_BINARY,                // raw memory image
+  OUTPUT_HEX                    // Intel .hex memory image
+} OUTPUT_FORMAT;
 
 // VARIABLES ...
 // Command line values ...
 char g_szInputFile [PATH_MAX];  // name of the input (PDP-11 BIN) file
 char g_szOutputFile[PATH_MAX];  // name of the high byte output file
 bool      g_fVerbose;           // be extra verbose when proessing
+bool      g_fKeepRecords;       // don't merge the tape records (-k)
+OUTPUT_FORMAT g_nFormat;        // assembly, binary or .hex output
+bool      g_fFormatSet;         // true if -b or -x was given
 // Absolute file data ...
 int       g_hABSfile;           // handle, from _open() of the OBJ file
 FILE     *g_fASMfile;           // assembly language output file
 uint8_t   g_abABSbuf[ABSBUFSIZ];// buffer for data read from the OBJ file
 int       g_cbABSbuf;		// number of bytes in the buffer now
 int       g_nABSbufPos;		// next byte in the buffer to be used
+// The memory image (unless -k is used) ...
+uint8_t   g_abMemory[MEMSIZE];  // the data loaded from the tape
+bool      g_afLoaded[MEMSIZE];  // true for every byte that was loaded
+bool      g_fStart;             // true if the tape has a start record
+uint16_t  g_wStart;             // and its address
+bool      g_fWrapped;           // true if a record wrapped past 177777
+uint16_t  g_wWrapped;           // and the address of the first one
 
 // ERROR MACROS ...
 #define FAIL(msg)		\
@@ -165,21 +213,25 @@ void ParseCommand (int argc, char *argv[])
 
   // First, set all the defaults...
   g_szInputFile[0] = g_szOutputFile[0] = '\0';
-  g_fVerbose = false;
+  g_fVerbose = g_fKeepRecords = g_fFormatSet = false;  g_nFormat = OUTPUT_ASM;
   
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
     fprintf(stderr, "Usage:\n");
-        fprintf(stderr,"\tabs2asm [-v] input-file output-file\n");
+        fprintf(stderr,"\tabs2asm [-v] [-k] [-b | -x] input-file output-file\n");
     fprintf(stderr,"\n");
     fprintf(stderr,"Options:\n");
     fprintf(stderr, "\t-v\t\t- be extra verbose when processing\n");
+    fprintf(stderr, "\t-k\t\t- keep the tape records (don't merge them)\n");
+    fprintf(stderr, "\t-b\t\t- write a binary memory image\n");
+    fprintf(stderr, "\t-x\t\t- write an Intel .hex memory image\n");
+    fprintf(stderr, "\tUse \"-\" for standard input or output\n");
     exit(EXIT_SUCCESS);
   }
 
   for (nArg = 1;  nArg < argc;  ++nArg) {
     // If it doesn't start with a "-" character, then it must be a file name.
-    if (argv[nArg][0] != '-') {
+    if ((argv[nArg][0] != '-') || (argv[nArg][1] == '\0')) {
            if (strlen(g_szInputFile)  == 0) strcpy(g_szInputFile,  argv[nArg]);
       else if (strlen(g_szOutputFile) == 0) strcpy(g_szOutputFile, argv[nArg]);
       else FAIL1("too many files specified: \"%s\"", argv[nArg]);
@@ -191,6 +243,19 @@ void ParseCommand (int argc, char *argv[])
       g_fVerbose = true;  continue;
     }
 
+    // Handle the -k (keep records) option...
+    if (strcmp(argv[nArg], "-k") == 0) {
+      g_fKeepRecords = true;  continue;
+    }
+
+    // And the -b (binary) and -x (Intel .hex) options...
+    if (strcmp(argv[nArg], "-b") == 0) {
+      g_nFormat = OUTPUT_BINARY;  g_fFormatSet = true;  continue;
+    }
+    if (strcmp(argv[nArg], "-x") == 0) {
+      g_nFormat = OUTPUT_HEX;  g_fFormatSet = true;  continue;
+    }
+
     // Otherwise it's an illegal option...
     FAIL1("unknown option - \"%s\"\n", argv[nArg]);
   }
@@ -198,8 +263,19 @@ void ParseCommand (int argc, char *argv[])
   // Make sure all the file names were specified...
   if (strlen(g_szOutputFile) == 0)
     FAIL("required file names missing");
-  SetFileType(g_szInputFile, ".ptp");
-  SetFileType(g_szOutputFile, ".asm");
+  if (strcmp(g_szInputFile, "-") != 0) SetFileType(g_szInputFile, ".ptp");
+  if (strcmp(g_szOutputFile, "-") != 0) {
+    SetFileType(g_szOutputFile, ".asm");
+    //   Unless -b or -x says otherwise, the output format goes by the file
+    // extension.  Anything other than .bin or .hex is assembly language.
+    if (!g_fFormatSet) {
+      char szExt[PATH_MAX];  GetExtension(g_szOutputFile, szExt);
+      if (strcasecmp(szExt, ".bin") == 0) g_nFormat = OUTPUT_BINARY;
+      if (strcasecmp(szExt, ".hex") == 0) g_nFormat = OUTPUT_HEX;
+    }
+  }
+  if (g_fKeepRecords && (g_nFormat != OUTPUT_ASM))
+    FAIL("-k works only for assembly language output");
 }
 
 
@@ -207,24 +283,52 @@ void ParseCommand (int argc, char *argv[])
 //////   P A P E R   T A P E   I M A G E   F I L E   U T I L I T I E S   //////
 ///////////////////////////////////////////////////////////////////////////////
 
-bool ReadABSbyte (uint8_t *pb)
+bool FillABSbuffer (void)
+{
+  //++
+  //   Read the next chunk of the ABS file into the buffer.  A pipe (or a
+  // terminal) can return less than a full buffer, and that's fine - we take
+  // whatever there is.  Returns FALSE at the end of the file.
+  //--
+  int Count;
+  do
+    Count = read(g_hABSfile, g_abABSbuf, sizeof(g_abABSbuf));
+  while ((Count < 0) && (errno == EINTR));
+  if (Count <= 0) return false;
+  g_cbABSbuf = Count;  g_nABSbufPos = 0;
+  return true;
+}
+
+static inline bool ReadABSbyte (uint8_t *pb)
 {
   //++ 
   //   This function reads and returns the next byte from the ABS file.
-  // Bytes are buffered, one block at a time, and if we've finished this
-  // block then we'll attempt to read the next one.  When we reach the end
+  // Bytes are buffered, ABSBUFSIZ at a time, and if we've finished this
+  // buffer then we'll attempt to read the next one.  When we reach the end
   // of the image file, we return FALSE.
   //--
-  int Count;
-  if (g_nABSbufPos >= g_cbABSbuf) {
-    Count = read(g_hABSfile, g_abABSbuf, sizeof(g_abABSbuf));
-    if (Count <= 0) return false;
-    g_cbABSbuf = Count;  g_nABSbufPos = 0;
-  }
+  if ((g_nABSbufPos >= g_cbABSbuf) && !FillABSbuffer()) return false;
   *pb = g_abABSbuf[g_nABSbufPos++];
   return true;
 }
 
+bool ReadABSbytes (uint8_t *pb, uint32_t cb)
+{
+  //++
+  //   Read cb bytes from the ABS file, copying as much of the buffer as we
+  // can at once.  Returns FALSE if we find the end of the file first.
+  //--
+  while (cb > 0) {
+    uint32_t cbCopy;
+    if ((g_nABSbufPos >= g_cbABSbuf) && !FillABSbuffer()) return false;
+    cbCopy = (uint32_t) (g_cbABSbuf - g_nABSbufPos);
+    if (cbCopy > cb) cbCopy = cb;
+    memcpy(pb, g_abABSbuf+g_nABSbufPos, cbCopy);
+    g_nABSbufPos += cbCopy;  pb += cbCopy;  cb -= cbCopy;
+  }
+  return true;
+}
+
 bool ReadABSword (uint16_t *pw)
 {
   //++
@@ -267,11 +371,9 @@ bool ReadABSrecord (uint16_t *pwAddress, uint16_t *pcbData, uint8_t *pbData)
   if (!ReadABSword(&wAddress)) FAIL("failed to find record address in image file");
   bChecksum += LOBYTE(wAddress) + HIBYTE(wAddress);  *pwAddress = wAddress;
 
-  // Now read the actual data, one byte at a time ...
-  for (uint16_t i = 0;  i < cbData-6;  ++i) {
-    if (!ReadABSbyte(&pbData[i])) FAIL("premature EOF while reading image file");
-    bChecksum += pbData[i];
-  }
+  // Now read the actual data, all at once ...
+  if (!ReadABSbytes(pbData, cbData-6)) FAIL("premature EOF while reading image file");
+  bChecksum += (uint8_t) ckSum(pbData, cbData-6);
 
   //   Lastly, read and verify the checksum ...   Note that the checksum of the
   // image file record is just the complement of the sum of all the bytes...
@@ -288,29 +390,120 @@ bool ReadABSrecord (uint16_t *pwAddress, uint16_t *pcbData, uint8_t *pbData)
 /////////////   A S S E M B L Y   L A N G U A G E    O U T P U T   ////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void WriteData (uint16_t wAddress, uint16_t cbData, uint8_t *pbData)
+static inline char *FormatOctal (char *p, uint8_t b)
+{
+  //++
+  // Store a byte as three octal digits and return the next free position...
+  //--
+  *p++ = (char) ('0' + (b >> 6));  *p++ = (char) ('0' + ((b >> 3) & 7));
+  *p++ = (char) ('0' + (b & 7));
+  return p;
+}
+
+void WriteData (uint16_t wAddress, uint16_t cbData, const uint8_t *pbData)
 {
   //++
   //   This routine dumps the image file data record to the output in PDP11
   // assembly language (well, it's just a bunch of .WORD and .BYTE statements,
-  // but they can be assembled!).
+  // but they can be assembled!).  The .BYTE statements are formatted in a
+  // buffer, which is written whenever it gets full, rather than with a
+  // fprintf() for every byte.
   //--
+  static char szBuffer[ASMBUFSIZ];  char *p = szBuffer;
   fprintf(g_fASMfile, "\n");
   if (g_fVerbose) fprintf(g_fASMfile, "; Record length=%d, address=%06o\n", cbData, wAddress);
   fprintf(g_fASMfile, "\t.WORD\t^D%d\n", cbData);
   fprintf(g_fASMfile, "\t.WORD\t%06o\n", wAddress);
   for (uint16_t cb = 0; cb < cbData;) {
-    fprintf(g_fASMfile, "\t.BYTE\t");
-    for (uint16_t i = 0;  i < 8;  ++i) {
-      if (i > 0) fprintf(g_fASMfile, ", ");
-      fprintf(g_fASMfile, "%03o", pbData[cb]);
+    memcpy(p, "\t.BYTE\t", 7);  p += 7;
+    for (uint16_t i = 0;  i < BYTESPERLINE;  ++i) {
+      if (i > 0) {*p++ = ',';  *p++ = ' ';}
+      p = FormatOctal(p, pbData[cb]);
       if (++cb >= cbData) break;
     }
-    fprintf(g_fASMfile, "\n");
+    *p++ = '\n';
+    if ((p - szBuffer) > (ASMBUFSIZ - 80)) {
+      fwrite(szBuffer, 1, p-szBuffer, g_fASMfile);  p = szBuffer;
+    }
   }
+  fwrite(szBuffer, 1, p-szBuffer, g_fASMfile);
   if (ISODD(cbData)) fprintf(g_fASMfile, "\t.EVEN\n");
 }
 
+void LoadData (uint16_t wAddress, uint16_t cbData, const uint8_t *pbData)
+{
+  //++
+  //   Store one tape record in the memory image, the same way the absolute
+  // loader would - later records overwrite earlier ones, and addresses wrap
+  // around at 64K...
+  //--
+  uint32_t cbFirst = MEMSIZE - wAddress;
+  if (cbFirst > cbData) cbFirst = cbData;
+  if ((cbFirst < cbData) && !g_fWrapped) {g_fWrapped = true;  g_wWrapped = wAddress;}
+  memcpy(g_abMemory+wAddress, pbData, cbFirst);
+  memset(g_afLoaded+wAddress, true, cbFirst);
+  memcpy(g_abMemory, pbData+cbFirst, cbData-cbFirst);
+  memset(g_afLoaded, true, cbData-cbFirst);
+}
+
+bool FindRange (uint32_t *plStart, uint32_t *plEnd)
+{
+  //++
+  //   Find the next contiguous range of loaded bytes at or after *plStart.
+  // Returns its first address and the address after its last byte, or FALSE
+  // if there are no more...
+  //--
+  uint32_t lStart = *plStart, lEnd;
+  while ((lStart < MEMSIZE) && !g_afLoaded[lStart]) ++lStart;
+  if (lStart >= MEMSIZE) return false;
+  for (lEnd = lStart;  (lEnd < MEMSIZE) && g_afLoaded[lEnd];  ++lEnd) ;
+  *plStart = lStart;  *plEnd = lEnd;
+  return true;
+}
+
+void WriteRanges (void)
+{
+  //++
+  //   Write one assembly language record for each contiguous range of bytes
+  // in the memory image, and then the start record.  Ranges longer than the
+  // longest possible tape record are split up, so the output is still a
+  // legal tape...
+  //--
+  uint32_t lStart = 0, lEnd, cb;  unsigned nRanges = 0;
+  while (FindRange(&lStart, &lEnd)) {
+    for (;  lStart < lEnd;  lStart += cb, ++nRanges) {
+      cb = lEnd - lStart;
+      if (cb > MAXABSBLK-6) cb = MAXABSBLK-6;
+      WriteData((uint16_t) lStart, (uint16_t) cb, g_abMemory+lStart);
+    }
+  }
+  if (g_fStart) WriteData(g_wStart, 0, NULL);
+  if (g_fVerbose) fprintf(stderr, "abs2asm: wrote %u records\n", nRanges);
+}
+
+bool WriteImage (void)
+{
+  //++
+  //   Write the memory image, from the lowest loaded address to the highest,
+  // as a raw binary or Intel .hex file.  The .hex file has the real PDP11
+  // addresses, but the binary file has no addresses at all, so we tell the
+  // user where it starts.  Returns FALSE if there's an error writing.  A
+  // record that wrapped around past 177777 would make this the whole 64K,
+  // which surely isn't what anybody wants, so that's an error.
+  //--
+  uint32_t lLow = 0, lHigh, lStart, lEnd;
+  if (g_fWrapped) FAIL1("record at %06o wraps past 177777 - can't write an image", g_wWrapped);
+  if (!FindRange(&lLow, &lHigh)) FAIL("nothing loaded from the image file");
+  for (lStart = lHigh;  FindRange(&lStart, &lEnd);  lStart = lEnd)  lHigh = lEnd;
+  fprintf(stderr, "abs2asm: image is %06o to %06o", lLow, lHigh-1);
+  if (g_fStart) fprintf(stderr, ", start address %06o", g_wStart);
+  fprintf(stderr, "\n");
+  if (g_nFormat == OUTPUT_HEX)
+    return hexWrite(g_fASMfile, g_abMemory+lLow, lHigh-lLow, 1, lLow, NULL);
+  fwrite(g_abMemory+lLow, 1, lHigh-lLow, g_fASMfile);
+  return !ferror(g_fASMfile);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /////////////////////////   M A I N   P R O G R A M   /////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -324,22 +517,50 @@ int main(int argc, char* argv[])
   // Parse the command line...
   ParseCommand(argc, argv);
 
-  // Open the PDP-11 absolute loader file ... 
-  g_hABSfile = open(g_szInputFile, O_RDONLY | O_BINARY);
+  // Open the PDP-11 absolute loader file ("-" is standard input) ... 
+  if (strcmp(g_szInputFile, "-") == 0) {
+    g_hABSfile = 0;
+#ifndef __linux__
+    _setmode(g_hABSfile, O_BINARY);
+#endif
+  } else
+    g_hABSfile = open(g_szInputFile, O_RDONLY | O_BINARY);
   if (g_hABSfile == -1) FAIL1("unable to read %s\n", g_szInputFile);
   g_cbABSbuf = g_nABSbufPos = 0;
 
   // Open the output file for writing...
-  if ((g_fASMfile=fopen(g_szOutputFile, "wt")) == NULL)
+  if (strcmp(g_szOutputFile, "-") == 0) {
+    g_fASMfile = stdout;
+#ifndef __linux__
+    if (g_nFormat == OUTPUT_BINARY) _setmode(_fileno(stdout), O_BINARY);
+#endif
+  } else if ((g_fASMfile=fopen(g_szOutputFile, (g_nFormat == OUTPUT_BINARY) ? "wb" : "wt")) == NULL)
     FAIL1("unable to write %s", g_szOutputFile);
+  setvbuf(g_fASMfile, NULL, _IOFBF, ASMBUFSIZ);
 
-  // Read and process the image file ...
+  //   Read the image file.  With -k, each record is written as soon as we
+  // read it, and otherwise it's loaded into the memory image ...
+  memset(g_afLoaded, false, sizeof(g_afLoaded));  g_fStart = g_fWrapped = false;
   while (ReadABSrecord(&wAddress, &cbData, abData)) {
-    WriteData(wAddress, cbData, abData);
-    if (cbData == 0) break;
+    if (g_fKeepRecords)
+      WriteData(wAddress, cbData, abData);
+    else if (cbData > 0)
+      LoadData(wAddress, cbData, abData);
+    if (cbData == 0) {
+      g_fStart = true;  g_wStart = wAddress;  break;
+    }
+  }
+
+  // Write the memory image, if we haven't already ...
+  if (!g_fKeepRecords) {
+    if (g_nFormat == OUTPUT_ASM)
+      WriteRanges();
+    else if (!WriteImage())
+      FAIL1("error writing %s", g_szOutputFile);
   }
 
   // And we're done!
+  if (fclose(g_fASMfile) != 0) FAIL1("error writing %s", g_szOutputFile);
   return EXIT_SUCCESS;
 }
 
@@ -51,17 +51,35 @@
 // emulator programs, like Kermit, allow a prompting character to be specified
 // for plain text downloads.  This will save a lot of time over a fixed delay.
 //
+//   At 9600 baud a whole ID01 partition takes the better part of an hour, and
+// most of the blocks in a typical image are empty.  The -z option leaves out
+// every block (or page) that's all zeros.  BTS6120 never sees those records,
+// so the same blocks on the SBC6120 are left as they were - only use -z when
+// the destination partition or RAM disk is already cleared!
+//
 // EDIT HISTORY
 // ------------
 // 28-Apr-00    RLA     New file.  
 //  4-Mar-10	RLA		Additions to support the SBC6120-RC model...
+// 14-Oct-26    AGT     Use the shared twelve bit word routines in ../romlib.
+// 14-Oct-26    AGT     Format each block in a buffer, not with printf().
+// 14-Oct-26    AGT     Add -z to skip empty blocks, and build on Linux.
 //--
 #include <stdio.h>      // printf(), et al...
 #include <stdlib.h>     // exit(), EXIT_FAILURE, etc...
 #include <string.h>     // strcmp()...
+#include <stdint.h>     // uint8_t, uint16_t, etc...
+#include <stdbool.h>    // bool, true, false...
 #include <fcntl.h>      // _O_BINARY, etc...
+#ifdef __linux__
+#include <unistd.h>     // read(), open(), close(), etc...
+#include <strings.h>    // strcasecmp()...
+#include <sys/stat.h>   // S_IRUSR, ...
+#else
 #include <sys\stat.h>   // _S_IREAD, ...
 #include <io.h>         // _read(), _open(), _close(), etc...
+#endif
+#include "word12.h"     // w12Unpack3for2(), w12Octal(), etc...
 
 
 //   RAM disk "geometry" parameters.  These must agree with both the WinEight
@@ -78,59 +96,69 @@
 #define ID01_PARTITION_SIZE     4096    // size (in OS/8 blocks) of each partition
 #define ID01_SECTOR_SIZE         256    // size (in words) of each IDE sector
 
+//   The download format - eight words per record, each record and each
+// checksum on a line of its own.  LINE_SIZE is the longest line possible.
+#define WORDS_PER_RECORD           8    // data words in each record
+#define LINE_SIZE (9+1+WORDS_PER_RECORD*5+1)
+#define MAX_BLOCK_SIZE           256    // longest block (ID01 sector)
+
 // Other useful definitions...
 typedef unsigned int   UINT;            // 16 bits of data, unsigned
 typedef unsigned char  UCHAR;           //  8  "    "   "      "
 
+#ifdef __linux__
+//   Linux has the same routines as the Microsoft C library, except without
+// the underscores, and there's no such thing as a binary mode...
+#define _open	  open
+#define _read	  read
+#define _close	  close
+#define _O_RDONLY O_RDONLY
+#define _O_BINARY 0
+#define _S_IREAD  S_IRUSR
+#define stricmp	  strcasecmp
+#endif
 
-//   This routine converts a page, 192 bytes, of data into the corresponding
-// twelve bit words and then writes it to standard output in the BTS6120
-// format.  Note that the eight bit to twelve conversion used here is the
-// conventional OS/8 "three for two" method - this must agree with the method
-// used by both the WinEight emulator and the SBC6120 ROM!
-void DumpPage (UINT nPage, UCHAR *pabBuffer)
-{
-  UINT nWord, nByte, nChecksum;
-  
-  for (nWord = nByte = nChecksum = 0;  nWord < VM01_SECTOR_SIZE;  nWord += 2) {
-    UINT w1 = pabBuffer[nByte++];
-    UINT w2 = pabBuffer[nByte++];
-    w1 |= (pabBuffer[nByte] & 0xF) << 8;
-    w2 |= (pabBuffer[nByte++] & 0xF0) << 4;
-    nChecksum = (nChecksum + w1 + w2) & 07777;
-    if ((nWord & 7) == 0) {
-      if (nWord > 0) printf("\n");
-      printf("%04o.%03o/ ", nPage, nWord);
-    }
-    printf("%04o %04o ", w1, w2);
-  }
-  
-  printf("\n%04o\n", nChecksum);
-}      
+// Global options...
+bool fSkipZero = false;                 // TRUE to leave out empty blocks (-z)
 
 
-//   This routine converts 512 bytes of data into the corresponding block of 
-// 256 twelve bit words and then writes it to standard output in the BTS6120
-// format.  The eight to twelve bit conversion used in this instance is simply
-// a matter of discarding the upper four bits of every sixteen bit word - 
-// exactly what's done by the SBC6120 hardware.
-void DumpBlock (UINT nBlock, UINT *pawBuffer, UINT cwBuffer)
+//   This routine takes a block of twelve bit words and writes it to standard
+// output in the BTS6120 format.  The whole block, records and checksum, is
+// formatted in a buffer and written with one fwrite() - with a printf() for
+// every word, the formatting took longer than reading the disk image.
+void DumpBlock (UINT nBlock, const uint16_t *pawBuffer, UINT cwBuffer)
 {
-  UINT nWord, nChecksum;
-  
+  char szBlock[(MAX_BLOCK_SIZE/WORDS_PER_RECORD)*LINE_SIZE + 8];
+  char *pch = szBlock;  UINT nWord, nChecksum;
+
+  if (fSkipZero && w12IsZero(pawBuffer, cwBuffer)) return;
   for (nWord = nChecksum = 0;  nWord < cwBuffer;  nWord++) {
     nChecksum = (nChecksum + pawBuffer[nWord]) & 07777;
-    if ((nWord & 7) == 0) {
-      if (nWord > 0) printf("\n");
-      printf("%04o.%03o/ ", nBlock, nWord);
+    if ((nWord % WORDS_PER_RECORD) == 0) {
+      if (nWord > 0) *pch++ = '\n';
+      pch = w12Octal(pch, (uint16_t) nBlock, 4);  *pch++ = '.';
+      pch = w12Octal(pch, (uint16_t) nWord, 3);  *pch++ = '/';  *pch++ = ' ';
     }
-    printf("%04o ", pawBuffer[nWord]);
+    pch = w12Octal(pch, pawBuffer[nWord], 4);  *pch++ = ' ';
   }
-  
-  printf("\n%04o\n", nChecksum);
+  *pch++ = '\n';  pch = w12Octal(pch, (uint16_t) nChecksum, 4);  *pch++ = '\n';
+  fwrite(szBlock, 1, pch-szBlock, stdout);
 }
 
 
+//   This routine converts a page, 192 bytes, of data into the corresponding
+// twelve bit words and then writes it to standard output in the BTS6120
+// format.  Note that the eight bit to twelve conversion used here is the
+// conventional OS/8 "three for two" method - this must agree with the method
+// used by both the WinEight emulator and the SBC6120 ROM!
+void DumpPage (UINT nPage, UCHAR *pabBuffer)
+{
+  uint16_t awPage[VM01_SECTOR_SIZE];
+  w12Unpack3for2(pabBuffer, awPage, VM01_SECTOR_SIZE);
+  DumpBlock(nPage, awPage, VM01_SECTOR_SIZE);
+}      
+
+
 //   This routine will dump an entire VM01 RAMDISK image...
 int DumpVM01 (int fdInput)
 {
@@ -145,25 +173,32 @@ int DumpVM01 (int fdInput)
 }
   
   
-// This routine will dump an entire ID01 IDE disk image...
+//   This routine will dump an entire ID01 IDE disk image.  The eight to
+// twelve bit conversion used in this instance is simply a matter of
+// discarding the upper four bits of every sixteen bit word - exactly what's
+// done by the SBC6120 hardware.
 int DumpID01 (int fdInput)
 {
-  UINT awSector[ID01_SECTOR_SIZE];  UINT nBlock, nCount;
+  UCHAR abSector[W12_WORD_BYTES(ID01_SECTOR_SIZE)];  UINT nBlock, nCount;
+  uint16_t awSector[ID01_SECTOR_SIZE];
   for (nBlock = 0;  nBlock < ID01_PARTITION_SIZE;  ++nBlock) {
-    nCount = _read(fdInput, awSector, sizeof(awSector));
-    if (nCount != sizeof(awSector)) return 0;
+    nCount = _read(fdInput, abSector, sizeof(abSector));
+    if (nCount != sizeof(abSector)) return 0;
+    w12UnpackWords(abSector, awSector, ID01_SECTOR_SIZE);
     DumpBlock (nBlock, awSector, ID01_SECTOR_SIZE);
   }
   return -1;
 } 
 
-// This routine will dump an SBC6120-RC RAM disk image ...
+// This routine will dump an SBC6120-RC RAM disk image (same format as ID01)...
 int DumpRC (int fdInput)
 {
-  UINT awSector[VM01_SECTOR_SIZE];  UINT nPage, nCount;
+  UCHAR abSector[W12_WORD_BYTES(VM01_SECTOR_SIZE)];  UINT nPage, nCount;
+  uint16_t awSector[VM01_SECTOR_SIZE];
   for (nPage = 0;  nPage < VM01_RC_SIZE;  ++nPage) {
-    nCount = _read(fdInput, awSector, sizeof(awSector));
-    if (nCount != sizeof(awSector)) return 0;
+    nCount = _read(fdInput, abSector, sizeof(abSector));
+    if (nCount != sizeof(abSector)) return 0;
+    w12UnpackWords(abSector, awSector, VM01_SECTOR_SIZE);
     DumpBlock (nPage, awSector, VM01_SECTOR_SIZE);
   }
   return -1;
@@ -172,40 +207,49 @@ int DumpRC (int fdInput)
 
 int main (int argc, char *argv[])
 {
-  int fdInput;  char szType[_MAX_EXT];
+  int fdInput;  char *pszFile, *pszType;
+  static char abOutput[65536];
   
-  // Make sure there's always exactly one argument...
+  // Make sure there's always exactly one file name, and maybe a -z...
+  if ((argc == 3) && (strcmp(argv[1], "-z") == 0)) {
+    fSkipZero = true;  --argc;  ++argv;
+  }
   if (argc != 2) {
-    fprintf(stderr,"usage: mkdltxt <file>\n");
+    fprintf(stderr,"usage: mkdltxt [-z] <file>\n");
+    fprintf(stderr,"\t-z\t- skip blocks that are all zeros\n");
     return EXIT_FAILURE;
   }
+  pszFile = argv[1];
 
   // Try to open the input file...
-  fdInput = _open(argv[1], _O_BINARY | _O_RDONLY, _S_IREAD);
+  fdInput = _open(pszFile, _O_BINARY | _O_RDONLY, _S_IREAD);
   if (fdInput == -1) {
-    fprintf(stderr,"mkdltxt: unable to read %s\n", argv[1]);
+    fprintf(stderr,"mkdltxt: unable to read %s\n", pszFile);
     return EXIT_FAILURE;
   }
+  setvbuf(stdout, abOutput, _IOFBF, sizeof(abOutput));
 
-  // Figure out the type of the input file...
-  _splitpath (argv[1], NULL, NULL, NULL, szType); 
-  if (stricmp(szType, ".vmd") == 0) {
+  //   Figure out the type of the input file.  That's everything after the
+  // last dot, but only if the dot is in the file name and not a directory...
+  pszType = strrchr(pszFile, '.');
+  if ((pszType == NULL) || (strpbrk(pszType, "/\\:") != NULL)) pszType = "";
+  if (stricmp(pszType, ".vmd") == 0) {
     if (!DumpVM01(fdInput)) {
-      fprintf(stderr,"mkdltxt: error reading %s\n", argv[1]);
+      fprintf(stderr,"mkdltxt: error reading %s\n", pszFile);
       return EXIT_FAILURE;
     }
-  } else if (stricmp(szType, ".vmw") == 0) {
+  } else if (stricmp(pszType, ".vmw") == 0) {
     if (!DumpRC(fdInput)) {
-      fprintf(stderr,"mkdltxt: error reading %s\n", argv[1]);
+      fprintf(stderr,"mkdltxt: error reading %s\n", pszFile);
       return EXIT_FAILURE;
     }
-  } else if (stricmp(szType, ".ide") == 0) {
+  } else if (stricmp(pszType, ".ide") == 0) {
     if (!DumpID01(fdInput)) {
-      fprintf(stderr,"mkdltxt: error reading %s\n", argv[1]);
+      fprintf(stderr,"mkdltxt: error reading %s\n", pszFile);
       return EXIT_FAILURE;
     }
   } else {
-    fprintf(stderr,"mkdltxt: unknown file type %s\n", argv[1]);
+    fprintf(stderr,"mkdltxt: unknown file type %s\n", pszFile);
     return EXIT_FAILURE;
   }
   
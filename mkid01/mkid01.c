@@ -24,6 +24,8 @@
 // Usage:
 //      mkid01 -rnnnn -ud <file>
 //      mkid01 -wnnnn -ud <file>
+//      mkid01 -rnnnn -u/dev/sdX [-d] <file>      (Linux)
+//      mkid01 -wnnnn -u/dev/sdX [-d] <file>      (Linux)
 //
 //   The -r option reads ID01 partition nnnn (octal!) from IDE drive d and
 // writes it to the file given.  The -w option writes ID01 partition nnnn
@@ -39,17 +41,42 @@
 // from a floppy or SCSI disk, that you might want to use "-u0" to select
 // unit zero, but use care!
 //
+//   On Linux the drive is given by the name of its block device instead, for
+// example "-u/dev/sdc" for a CompactFlash card in a USB reader (a plain file
+// works too).  The -d option opens it with O_DIRECT, so that the data goes
+// straight to or from the card and not through the page cache.
+//
+//   Blocks are transferred ID01_BATCH at a time, both to the drive and to the
+// image file, rather than one sector per call.  That's 64K per transfer,
+// which matters a lot for CompactFlash cards where every request has a fixed
+// overhead.  (MSDOS is limited to one 64K segment, so it uses less.)
+//
 // REVISION HISTORY
 // 16-Sep-01    RLA     New file.
+// 14-Oct-26    AGT     Transfer ID01_BATCH blocks at a time.
+// 14-Oct-26    AGT     Add Linux block device support.
+// 14-Oct-26    AGT     Use the shared twelve bit word routines in ../romlib.
 //--
 
 // Include files...
 #include <stdio.h>      // NULL, printf(), scanf(), et al
 #include <string.h>     // strlen(), strcpy(), strcat(), etc...
 #include <stdlib.h>     // malloc(), exit(), etc...
+#include <ctype.h>      // isalpha(), toupper(), etc...
+#ifdef __linux__
+#include <unistd.h>     // open(), read(), pread(), etc...
+#include <errno.h>      // errno, strerror(), ...
+#include <sys/stat.h>   // S_IWUSR, S_IRUSR, fstat(), et al...
+#include <sys/ioctl.h>  // ioctl() ...
+#include <linux/fs.h>   // BLKGETSIZE64, BLKSSZGET, ...
+#else
 #include <io.h>         // open(), read(), write(), etc...
-#include <fcntl.h>      // O_RDWR, O_CREAT, O_BINARY, etc...
 #include <sys\stat.h>   // S_IWRITE, S_IREAD, et al...
+#endif
+#include <fcntl.h>      // O_RDWR, O_CREAT, O_BINARY, etc...
+#include <stdint.h>     // uint16_t, uint32_t, etc...
+#include <stdbool.h>    // bool, true, false (for word12.h)...
+#include "word12.h"     // w12Mask(), etc...
 #ifdef MSDOS
 #include <dos.h>        // _int86(), _int86x(), _REGS, etc...
 #endif
@@ -64,6 +91,13 @@
 
 #define OS8_BLOCK_SIZE	  256
 #define ID01_SECTOR_SIZE  512
+#define ID01_PART_SIZE	  4096	// blocks in one ID01 partition
+#ifdef MSDOS
+#define ID01_BATCH	  16	// blocks per transfer (must fit in a segment)
+#else
+#define ID01_BATCH	  128	// blocks per transfer (64K bytes)
+#endif
+#define ID01_ALIGN	  4096	// buffer alignment for O_DIRECT
 typedef unsigned	  UINT;
 typedef unsigned short	  UWORD;
 typedef unsigned char	  UBYTE;
@@ -107,6 +141,27 @@ struct _DISK_ADDRESS_PACKET {
 #define WARN(msg)                   \
   fprintf(stderr,  "mkid01: " msg "\n");
 
+#ifdef __linux__
+//   Linux has the same routines as the Microsoft C library, except without
+// the underscores, and there's no such thing as a binary mode...
+#define _open	open
+#define _read	read
+#define _write	write
+#define _lseek	lseek
+#define _close	close
+#define _O_RDONLY O_RDONLY
+#define _O_WRONLY O_WRONLY
+#define _O_CREAT  O_CREAT
+#define _O_BINARY 0
+#define _S_IREAD  S_IRUSR
+#define _S_IWRITE S_IWUSR
+
+int   driveHandle = -1;		/* file descriptor for the drive */
+char *driveName = NULL;		/* block device (from -u/dev/xxx) */
+BOOL  fDirectIO = FALSE;	/* TRUE to use O_DIRECT (-d) */
+#endif
+UINT  nMaxPartition = 0;	/* number of partitions (0 if unknown) */
+
 
 #if defined(__WIN32__) || defined(_WIN32)
 HANDLE driveHandle;		/* handle to drive device */
@@ -145,77 +200,98 @@ char* Win32Error(void)
 //   Note that FLX8 supports ID01 partitions only for physical disks -
 // virtual ID01 images are always exactly one partition.
 
-// ReadID01Block - read one OS/8 block from the selected ID01 partition
-BOOL ReadID01Block (UINT nDrive, UINT nPart, UINT nBlock, UWORD *pwData)
+// ReadID01Blocks - read nCount OS/8 blocks from the selected ID01 partition
+BOOL ReadID01Blocks (UINT nDrive, UINT nPart, UINT nBlock, UINT nCount, UWORD *pwData)
 {
-  UINT i;
   long lLBA = (((long) nPart) <<12) + (long) nBlock;
+  assert((nCount > 0) && (nCount <= ID01_BATCH));
 
 #ifdef MSDOS
-  // Read a physical sector from an IDE drive attached to this PC!
+  // Read physical sectors from an IDE drive attached to this PC!
   union _REGS inregs, outregs;  struct _SREGS segregs;
   struct _DISK_ADDRESS_PACKET DiskAddress;
   void __far *lpDAP = &DiskAddress;
   memset(&DiskAddress, 0, sizeof(DiskAddress));
   DiskAddress.bPacketSize = sizeof(DiskAddress);
-  DiskAddress.nTransferCount = 1;  DiskAddress.lpBuffer = pwData;
+  DiskAddress.nTransferCount = nCount;  DiskAddress.lpBuffer = pwData;
   DiskAddress.lLBA[1] = 0;  DiskAddress.lLBA[0] = lLBA;
   inregs.h.ah = 0x42;  inregs.h.dl = nDrive | 0x80;
   inregs.x.si = _FP_OFF(lpDAP);  segregs.ds  = _FP_SEG(lpDAP);
   _int86x (0x13, &inregs, &outregs, &segregs);
   if (outregs.x.cflag != 0) return FALSE;
 #elif defined(__WIN32__) || defined(_WIN32)
-    /* Read a physical sector from a raw drive attached to this PC */
+    /* Read physical sectors from a raw drive attached to this PC */
     LARGE_INTEGER qLBA;		/* use 64-bit math to compute offset */
-    DWORD read;
+    DWORD read, size = nCount * ID01_SECTOR_SIZE;
     qLBA.QuadPart = (LONGLONG) lLBA * ID01_SECTOR_SIZE;
-    assert(0xFFFFFFFF != SetFilePointer(driveHandle, qLBA.LowPart, &qLBA.HighPart, FILE_BEGIN));
-    assert(ReadFile(driveHandle, pwData, ID01_SECTOR_SIZE, &read, NULL));
+    if (!SetFilePointerEx(driveHandle, qLBA, NULL, FILE_BEGIN)) return FALSE;
+    if (!ReadFile(driveHandle, pwData, size, &read, NULL) || (read != size)) return FALSE;
+#elif defined(__linux__)
+    /* Read from the block device, in as many pieces as it takes */
+    size_t done = 0, size = (size_t) nCount * ID01_SECTOR_SIZE;
+    off_t offset = (off_t) lLBA * ID01_SECTOR_SIZE;
+    while (done < size) {
+      ssize_t cb = pread(driveHandle, (char *) pwData + done, size - done, offset + done);
+      if (cb < 0 && errno == EINTR) continue;
+      if (cb <= 0) return FALSE;
+      done += cb;
+    }
 #else
     assert(FALSE);  /* physical disk operations not implemented */
 #endif
 
-  //   Mask all the data words in the block to 12 bits.  For a real,
+  //   Mask all the data words in the blocks to 12 bits.  For a real,
   // legitimate drive written by the SBC6120 this shouldn't be needed,
   // but just to be safe we'll do it in case this drive's never been
   // near a SBC6120 before...
-  for (i = 0;  i < OS8_BLOCK_SIZE;  ++i)  pwData[i] &= 07777;
+  w12Mask(pwData, nCount * OS8_BLOCK_SIZE);
   return TRUE;
   
-} //ReadID01Block
+} //ReadID01Blocks
 
 
-// WriteID01Block - write one OS/8 block to the selected ID01 partition
-BOOL WriteID01Block (UINT nDrive, UINT nPart, UINT nBlock, UWORD *pwData)
+// WriteID01Blocks - write nCount OS/8 blocks to the selected ID01 partition
+BOOL WriteID01Blocks (UINT nDrive, UINT nPart, UINT nBlock, UINT nCount, UWORD *pwData)
 {
   long lLBA = (((long) nPart) << 12) + (long) nBlock;
+  assert((nCount > 0) && (nCount <= ID01_BATCH));
 
 #ifdef MSDOS
-  // Write a physical sector to an IDE drive attached to this PC!
+  // Write physical sectors to an IDE drive attached to this PC!
   union _REGS inregs, outregs;  struct _SREGS segregs;
   struct _DISK_ADDRESS_PACKET DiskAddress;
   void __far *lpDAP = &DiskAddress;
   memset(&DiskAddress, 0, sizeof(DiskAddress));
   DiskAddress.bPacketSize = sizeof(DiskAddress);
-  DiskAddress.nTransferCount = 1;  DiskAddress.lpBuffer = pwData;
+  DiskAddress.nTransferCount = nCount;  DiskAddress.lpBuffer = pwData;
   DiskAddress.lLBA[1] = 0;  DiskAddress.lLBA[0] = lLBA;
   inregs.h.ah = 0x43;  inregs.h.al = 0;  inregs.h.dl = nDrive | 0x80;
   inregs.x.si = _FP_OFF(lpDAP);  segregs.ds  = _FP_SEG(lpDAP);
   _int86x (0x13, &inregs, &outregs, &segregs);
   if (outregs.x.cflag != 0) return FALSE;
 #elif defined(__WIN32__) || defined(_WIN32)
-    /* Write a physical sector to a raw drive attached to this PC */
+    /* Write physical sectors to a raw drive attached to this PC */
     LARGE_INTEGER qLBA;		/* use 64-bit math to compute offset */
-    DWORD wrote;
+    DWORD wrote, size = nCount * ID01_SECTOR_SIZE;
     qLBA.QuadPart = (LONGLONG) lLBA * ID01_SECTOR_SIZE;
-    assert(0xFFFFFFFF != SetFilePointer(driveHandle, qLBA.LowPart, &qLBA.HighPart, FILE_BEGIN));
-    assert(WriteFile(driveHandle, pwData, ID01_SECTOR_SIZE, &wrote, NULL));
+    if (!SetFilePointerEx(driveHandle, qLBA, NULL, FILE_BEGIN)) return FALSE;
+    if (!WriteFile(driveHandle, pwData, size, &wrote, NULL) || (wrote != size)) return FALSE;
+#elif defined(__linux__)
+    /* Write to the block device, in as many pieces as it takes */
+    size_t done = 0, size = (size_t) nCount * ID01_SECTOR_SIZE;
+    off_t offset = (off_t) lLBA * ID01_SECTOR_SIZE;
+    while (done < size) {
+      ssize_t cb = pwrite(driveHandle, (char *) pwData + done, size - done, offset + done);
+      if (cb < 0 && errno == EINTR) continue;
+      if (cb <= 0) return FALSE;
+      done += cb;
+    }
 #else
     assert(FALSE);  /* physical disk operations not implemented */
 #endif
 
   return TRUE;
-} //WriteID01Block
+} //WriteID01Blocks
 
 
 // OpenPhysicalID01
@@ -298,6 +374,27 @@ fprintf(stderr," Opening \"%s\"\n", daName);
 	FAIL1("Error opening drive for I/O: %s", Win32Error());
 	return FALSE;
 	}
+#elif defined(__linux__)
+    /* Open the block device (or an image of a whole drive) */
+    struct stat st;  unsigned long long size = 0;  int sector = ID01_SECTOR_SIZE;
+    if (driveName == NULL)
+      FAIL("Use -u/dev/<device> to select the drive");
+    driveHandle = open(driveName, O_RDWR | (fDirectIO ? O_DIRECT : 0));
+    if (driveHandle == -1)
+      FAIL1("Error opening the drive: %s", strerror(errno));
+    if (fstat(driveHandle, &st) != 0)
+      FAIL1("Error opening drive for I/O: %s", strerror(errno));
+    if (S_ISBLK(st.st_mode)) {
+      /* the sector size has to be 512 bytes for the SBC6120 anyway... */
+      if ((ioctl(driveHandle, BLKGETSIZE64, &size) != 0)
+       || (ioctl(driveHandle, BLKSSZGET, &sector) != 0))
+	FAIL1("Error reading the drive size: %s", strerror(errno));
+      if (sector != ID01_SECTOR_SIZE)
+	FAIL1("%s does not have 512 byte sectors", driveName);
+    } else
+      size = (unsigned long long) st.st_size;
+    nMaxPartition = (UINT) ((size / ID01_SECTOR_SIZE) >> 12);
+    return TRUE;
 #else
   /* Non-MSDOS machines don't support ID01 (at least not yet!)... */
   return FALSE;
@@ -314,72 +411,93 @@ void ClosePhysicalID01 ()
   		  NULL, 0, NULL, 0, &ret, NULL);
   CloseHandle(driveHandle);
   driveHandle = INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+  /* make sure everything is really on the card before we quit */
+  if (fsync(driveHandle) != 0)
+    FAIL1("Error flushing the drive: %s", strerror(errno));
+  close(driveHandle);  driveHandle = -1;
 #endif
 }
 
 
 
-// Read an OS/8 disk block from the image file...
-BOOL ReadImageBlock (int fd, UINT nBlock, UWORD *pwData)
+// Read nCount OS/8 disk blocks from the image file...
+BOOL ReadImageBlocks (int fd, UINT nBlock, UINT nCount, UWORD *pwData)
 {
-  UINT nSize = OS8_BLOCK_SIZE * 2;
-  long lOffset = ((long) nBlock) * ((long) nSize);
+  UINT nSize = OS8_BLOCK_SIZE * 2 * nCount;
+  long lOffset = ((long) nBlock) * ((long) OS8_BLOCK_SIZE * 2);
   if (_lseek(fd, lOffset, SEEK_SET) != lOffset) return FALSE;
   if (_read(fd, pwData, nSize) != (int) nSize) return FALSE;
   return TRUE;
 }
 
 
-// Write an OS/8 disk block to the image file...
-BOOL WriteImageBlock (int fd, UINT nBlock, UWORD *pwData)
+// Write nCount OS/8 disk blocks to the image file...
+BOOL WriteImageBlocks (int fd, UINT nBlock, UINT nCount, UWORD *pwData)
 {
-  UINT nSize = OS8_BLOCK_SIZE * 2;
-  long lOffset = ((long) nBlock) * ((long) nSize);
+  UINT nSize = OS8_BLOCK_SIZE * 2 * nCount;
+  long lOffset = ((long) nBlock) * ((long) OS8_BLOCK_SIZE * 2);
   if (_lseek(fd, lOffset, SEEK_SET) != lOffset) return FALSE;
   if (_write(fd, pwData, nSize) != (int) nSize) return FALSE;
   return TRUE;
 }
 
 
+// Allocate the buffer for one batch of blocks...
+UWORD *AllocateBatch (void)
+{
+  //   O_DIRECT needs a buffer that's aligned (to the logical block size, but
+  // page alignment is always enough).  Everybody else is happy with malloc.
+  void *pBuffer = NULL;
+#ifdef __linux__
+  if (posix_memalign(&pBuffer, ID01_ALIGN, ID01_BATCH * ID01_SECTOR_SIZE) != 0) pBuffer = NULL;
+#else
+  pBuffer = malloc(ID01_BATCH * ID01_SECTOR_SIZE);
+#endif
+  if (pBuffer == NULL) FAIL("out of memory");
+  return (UWORD *) pBuffer;
+}
+
+
 
 // Write an entire ID01 image to the IDE drive...
 void WritePartition (int nDrive, int nPartition, char *lpszFile)
 {
-  UWORD awData[OS8_BLOCK_SIZE];  int fd, nBlock;
+  UWORD *pwData = AllocateBatch();  int fd, nBlock;
   fd = _open(lpszFile, _O_RDONLY|_O_BINARY, _S_IREAD|_S_IWRITE);
   if (fd == -1) FAIL1("Unable to read %s", lpszFile);
 
-  for (nBlock = 0;  nBlock < 4096;  ++nBlock) {
+  for (nBlock = 0;  nBlock < ID01_PART_SIZE;  nBlock += ID01_BATCH) {
     if ((nBlock & 0177) == 0)
       fprintf(stderr,"\rWriting block %d ... ", nBlock);
-    if (!ReadImageBlock(fd, nBlock, awData))
+    if (!ReadImageBlocks(fd, nBlock, ID01_BATCH, pwData))
       FAIL1("Error reading file %s", lpszFile);
-    if (!WriteID01Block(nDrive, nPartition, nBlock, awData))
+    if (!WriteID01Blocks(nDrive, nPartition, nBlock, ID01_BATCH, pwData))
       FAIL1("Error writing drive %d", nDrive);
   }
 
   fprintf(stderr,"\rWriting block %d ... Done!\n", nBlock);
-  _close(fd);
+  _close(fd);  free(pwData);
 }
 
 // Read an entire ID01 image from the IDE drive...
 void ReadPartition (char *lpszFile, int nDrive, int nPartition)
 {
-  UWORD awData[OS8_BLOCK_SIZE];  int fd, nBlock;
+  UWORD *pwData = AllocateBatch();  int fd, nBlock;
   fd = _open(lpszFile, _O_CREAT|_O_WRONLY|_O_BINARY, _S_IREAD|_S_IWRITE);
   if (fd == -1) FAIL1("Unable to write %s", lpszFile);
 
-  for (nBlock = 0;  nBlock < 4096;  ++nBlock) {
+  for (nBlock = 0;  nBlock < ID01_PART_SIZE;  nBlock += ID01_BATCH) {
     if ((nBlock & 0177) == 0)
       fprintf(stderr,"\rReading block %d ... ", nBlock);
-    if (!ReadID01Block(nDrive, nPartition, nBlock, awData))
+    if (!ReadID01Blocks(nDrive, nPartition, nBlock, ID01_BATCH, pwData))
       FAIL1("Error reading drive %d", nDrive);
-    if (!WriteImageBlock(fd, nBlock, awData))
+    if (!WriteImageBlocks(fd, nBlock, ID01_BATCH, pwData))
       FAIL1("Error writing file %s", lpszFile);
   }
 
   fprintf(stderr,"\rReading block %d ... Done!\n", nBlock);
-  _close(fd);
+  _close(fd);  free(pwData);
 }
 
 
@@ -390,11 +508,19 @@ void ShowUsage (void)
   fprintf(stderr, "Usage:\n");
   fprintf(stderr, "\tmkid01 -rnnnn -ud <image-file>\n");
   fprintf(stderr, "\tmkid01 -wnnnn -ud <image-file>\n");
+#ifdef __linux__
+  fprintf(stderr, "\tmkid01 -rnnnn -u/dev/sdX [-d] <image-file>\n");
+  fprintf(stderr, "\tmkid01 -wnnnn -u/dev/sdX [-d] <image-file>\n");
+#endif
   fprintf(stderr, "\n");
   fprintf(stderr, "Options:\n");
   fprintf(stderr, "\t-rnnnn\t- read partition nnnn (octal!)\n");
   fprintf(stderr, "\t-wnnnn\t- write partition nnnn (octal!)\n");
   fprintf(stderr, "\t-ud\t- select IDE drive d\n");
+#ifdef __linux__
+  fprintf(stderr, "\t-u/dev/sdX - select block device /dev/sdX\n");
+  fprintf(stderr, "\t-d\t- use direct (O_DIRECT) I/O\n");
+#endif
   exit(EXIT_SUCCESS);
 }
 
@@ -425,6 +551,12 @@ void ParseArguments (int argc, char *argv[], int *pnPartition,
     
     // Handle the -u (unit) option...
     if (strncmp(argv[nArg], "-u", 2) == 0) {
+#ifdef __linux__
+      // On Linux the unit is the name of the block device ...
+      if (argv[nArg][2] == '/') {
+        driveName = argv[nArg]+2;  *pnDrive = 0;  continue;
+      }
+#endif
       *pnDrive = (UINT) strtoul(argv[nArg]+2, &psz, 10);
       if ((*psz != '\0') || (*pnDrive > 1)) {
         if (isalpha(*psz) && (*(psz+1) == '\0'))
@@ -435,6 +567,13 @@ void ParseArguments (int argc, char *argv[], int *pnPartition,
       continue;
     }
     
+#ifdef __linux__
+    // Handle the -d (direct I/O) option...
+    if (strcmp(argv[nArg], "-d") == 0) {
+      fDirectIO = TRUE;  continue;
+    }
+#endif
+
     // Otherwise it's an illegal option...
     FAIL1("unknown option - \"%s\"\n", argv[nArg]);
   }
@@ -451,10 +590,13 @@ int main (int argc, char *argv[])
 
   // All arguments, including -ud and -rnnnn or -wnnnn, are required.  
   // If the they aren't there, then just print the help and exit...
-  if (argc != 4) ShowUsage();
+  if ((argc < 4) || (argc > 5)) ShowUsage();
   ParseArguments(argc, argv, &nPartition, &nDrive, &nDirection, &pszFileName);
+  if ((nPartition < 0) || (nDrive < 0) || (pszFileName == NULL)) ShowUsage();
 
   if (!OpenPhysicalID01(nDrive)) return EXIT_FAILURE;
+  if ((nMaxPartition != 0) && ((UINT) nPartition >= nMaxPartition))
+    FAIL1("the drive has only %d partitions", nMaxPartition);
   if (nDirection == 'r')
     ReadPartition(pszFileName, nDrive, nPartition);
   else if (nDirection == 'w')
@@ -24,8 +24,22 @@
 // is used for T11 eight bit bus systems, and two are needed for sixteen
 // bit DCT11 implementations.
 //
+//   Any number of object modules may be given, and they're all loaded into
+// the same memory image - so firmware that's split over several modules can
+// be converted in one step, without rommerge.  Each module's relocation is
+// done separately, and it's an error for two modules to load the same byte.
+// The program start address comes from the first module with an even one.
+//
+//   Each OBJ file is read into memory all at once, and the records are
+// processed right where they are in that buffer.
+//
 // Usage:
-//      obj2rom [-8] [-d] [-v] [-onnnnnn] [-sdddd] [-cnnnnnn] input-file low-file [high-file]
+//      obj2rom [-8] [-d] [-v] [-u] [-onnnnnn] [-sdddd] [-cnnnnnn] [-rddd] input-file [input-file ...] low-file [high-file]
+//
+//      The last file (with -8 or -a) or the last two files (otherwise) are the
+//      outputs, and everything before them is an input module.  An input file
+//      that ends in .hex, .bin or .asm is an error, since that's almost always
+//      an extra output file given with -8 or -a.
 //
 //      -8 specifies an eight bit bus system.  Only one output file should be
 //      specified in this instance.
@@ -45,6 +59,11 @@
 //       the address specified by nnnnnn (octal).  As a result the sun of all
 //       words in the EPROM, including the checksum word, should be zero.
 //      
+//      -rddd sets the number of data bytes in each .HEX file record, in
+//       decimal.  The default is 16 and the maximum is 255.
+//
+//      -u leaves unused (zero) bytes out of the .HEX files entirely.
+//
 //      -d dump the resulting PDP11 memory image to stdout
 //
 //      -v be extra verbose while processing
@@ -54,6 +73,11 @@
 // 31-Jan-09    RLA		Adapted for the PDP-11
 // 16-Mar-21    RLA             Update for the SBCT11 v2
 // 30-NOV-24	RLA		Fixes to compile on Linux
+// 14-OCT-26	AGT		Use the shared .HEX file writer and add -r and -u
+// 14-OCT-26	AGT		And the shared checksum routines
+// 14-OCT-26	AGT		Read the OBJ file all at once, and allow more
+//				  than one module
+// 14-OCT-26	AGT		Don't take .HEX, .BIN or .ASM files as input modules
 //--
 //000000001111111111222222222233333333334444444444555555555566666666667777777777
 //234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -71,9 +95,13 @@
 #include <sys/io.h>		// _open(), _write(), _close(), etc...
 #include <libgen.h>		// basename() and dirname() ...
 #include <errno.h>		// errno, ENOENT, etc ...
+#include <strings.h>		// strcasecmp(), ...
 #else
 #include <io.h>			// _open(), _write(), _close(), etc...
+#define strcasecmp _stricmp
 #endif
+#include "intelhex.h"		// hexWrite(), HEX_OPTIONS, etc ...
+#include "checksum.h"		// ckSum(), ckSumLE16(), etc ...
 
 
 // Linux has slightly different names for these symbols...
@@ -94,10 +122,12 @@
 #define PROGRAM     "obj2rom"   // name used for messages
 #define PDPMEMSIZE	65536	// PDP11 memory size, in BYTES!
 #define MAXOBJREC	  512	// longest OBJ file record allowed
+#define MAXMODULES	  255	// most OBJ files allowed
 
 // VARIABLES ...
 // Command line values ...
-char g_szInputFile[_MAX_PATH];  // name of the input (PDP-11 BIN) file
+char *g_apszInputFiles[MAXMODULES];// names of the input (OBJ) files
+int   g_nInputFiles;            // number of input files
 char g_szHighFile[_MAX_PATH];   // name of the high byte output file
 char g_szLowFile[_MAX_PATH];    //   "   "   " low   "     "     "
 uint16_t  g_wROMoffset;         // EPROM address offset, if any
@@ -108,15 +138,16 @@ bool      g_fVerbose;           // be extra verbose when proessing
 bool      g_fChecksum;          // TRUE to insert a checksum word
 bool      g_fAssembler;         // TRUE to output assembler instead of hex
 uint16_t  g_wChecksumLocation;  // EPROM location to receive the checksum
+HEX_OPTIONS g_HexOptions;       // .HEX record size, skip unused bytes, etc
 // OBJ file data ...
-int       g_hOBJfile;           // handle, from _open() of the OBJ file
-uint8_t   g_abOBJbuf[MAXOBJREC];// buffer for data read from the OBJ file
-int       g_cbOBJbuf;		// number of bytes in the buffer now
-int       g_nOBJbufPos;		// next byte in the buffer to be used
+uint8_t  *g_pbOBJfile;          // the entire OBJ file, read into memory
+uint32_t  g_cbOBJfile;		// size of the OBJ file, in bytes
+uint32_t  g_nOBJpos;		// next byte in the file to be used
 uint16_t  g_wLastTextAddress;	// address of last data byte loaded
 uint16_t  g_wStartAddress;      // program start (transfer) address
 // PDP11 memory image ...
 uint8_t  *g_pabMemory;		// PDP-11 memory image
+uint8_t  *g_pabModule;		// module (1..n) that loaded each byte, or 0
 
 // ERROR MACROS ...
 #define FAIL(msg)		\
@@ -185,17 +216,18 @@ void ParseCommand (int argc, char *argv[])
   // are any errors in the command line, then it simply prints an error message
   // and exits - there is no error return!
   //--
-  int nArg;  char *psz;
+  int nArg, nFiles = 0, nOutputs, i;  char *psz, *apszFiles[MAXMODULES+2];
 
   // First, set all the defaults...
-  g_szInputFile[0] = g_szHighFile[0] = g_szLowFile[0] = '\0';
+  g_szHighFile[0] = g_szLowFile[0] = '\0';  g_nInputFiles = 0;
   g_wROMoffset = g_wChecksumLocation = g_wStartAddress = 0;  g_lROMsize = 0;
   g_fEightBit = g_fDumpMemory = g_fVerbose = g_fChecksum = g_fAssembler = false;
+  memset(&g_HexOptions, 0, sizeof(g_HexOptions));
   
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
     fprintf(stderr, "Usage:\n");
-        fprintf(stderr,"\t%s [-8] [-d] [-v] [-onnnnnn] [-sddddd] [-cnnnnnn] input-file low-file [high-file]\n", PROGRAM);
+        fprintf(stderr,"\t%s [-8] [-d] [-v] [-u] [-onnnnnn] [-sddddd] [-cnnnnnn] [-rddd] input-file [input-file ...] low-file [high-file]\n", PROGRAM);
     fprintf(stderr,"\n");
     fprintf(stderr,"Options:\n");
     fprintf(stderr, "\t-8\t\t- eight bit bus system\n");
@@ -205,16 +237,17 @@ void ParseCommand (int argc, char *argv[])
     fprintf(stderr, "\t-sddddd\t\t- set EPROM size, in decimal\n");
     fprintf(stderr, "\t-cnnnnnn\t- compute checksum and store in nnnnnn (octal)\n");
     fprintf(stderr, "\t-a\t\t- output assembler file instead of hex\n");
+    fprintf(stderr, "\t-rddd\t\t- write ddd data bytes per hex record\n");
+    fprintf(stderr, "\t-u\t\t- don't write unused (zero) bytes to hex files\n");
     exit(EXIT_SUCCESS);
   }
 
   for (nArg = 1;  nArg < argc;  ++nArg) {
     // If it doesn't start with a "-" character, then it must be a file name.
+    // The output files are the last one or two, so just save them all for now.
     if (argv[nArg][0] != '-') {
-           if (strlen(g_szInputFile) == 0) strcpy(g_szInputFile, argv[nArg]);
-      else if (strlen(g_szLowFile)   == 0) strcpy(g_szLowFile,   argv[nArg]);
-      else if (strlen(g_szHighFile)  == 0) strcpy(g_szHighFile,  argv[nArg]);
-      else FAIL1("too many files specified: \"%s\"", argv[nArg]);
+      if (nFiles >= MAXMODULES+2) FAIL1("too many files specified: \"%s\"", argv[nArg]);
+      apszFiles[nFiles++] = argv[nArg];
       continue;
     }
     
@@ -243,6 +276,20 @@ void ParseCommand (int argc, char *argv[])
       continue;
     }
 
+    // Handle the -r (hex record size) option...
+    if (strncmp(argv[nArg], "-r", 2) == 0) {
+      unsigned long cbRecord = strtoul(argv[nArg]+2, &psz, 10);
+      if ((*psz != '\0')  ||  (cbRecord == 0)  ||  (cbRecord > 255))
+        FAIL1("illegal record size: \"%s\"", argv[nArg]);
+      g_HexOptions.cbRecord = (uint8_t) cbRecord;
+      continue;
+    }
+
+    // Handle the -u (skip unused bytes) option...
+    if (strcmp(argv[nArg], "-u") == 0) {
+      g_HexOptions.fSkipFill = true;  continue;
+    }
+
     // Handle the -8 (eight bit) option...
     if (strcmp(argv[nArg], "-8") == 0) {
       g_fEightBit = true;  continue;
@@ -267,20 +314,36 @@ void ParseCommand (int argc, char *argv[])
     FAIL1("unknown option - \"%s\"\n", argv[nArg]);
   }
 
-  // Make sure all the file names were specified...
+  //   Make sure all the file names were specified.  The last one (for an
+  // eight bit or assembler output) or two are the output files and all the
+  // rest are input files.  An "input" that's obviously an output file is
+  // most likely a high byte file given with -8 or -a ...
+  nOutputs = (g_fEightBit || g_fAssembler) ? 1 : 2;
+  if (nFiles < nOutputs+1)
+    FAIL("required file names missing");
+  if (nFiles > MAXMODULES+nOutputs)
+    FAIL("too many files specified");
+  g_nInputFiles = nFiles - nOutputs;
+  for (i = 0;  i < g_nInputFiles;  ++i) {
+    g_apszInputFiles[i] = malloc(strlen(apszFiles[i]) + 5);
+    if (g_apszInputFiles[i] == NULL) FAIL("unable to allocate memory");
+    strcpy(g_apszInputFiles[i], apszFiles[i]);
+    SetFileType(g_apszInputFiles[i], ".obj");
+    psz = GetFileType(g_apszInputFiles[i]);
+    if (   (strcasecmp(psz, ".hex") == 0) || (strcasecmp(psz, ".bin") == 0)
+        || (strcasecmp(psz, ".asm") == 0)) {
+      if (g_fEightBit || g_fAssembler) FAIL("specify only one output file with -8 or -a");
+      FAIL1("\"%s\" is not an object file", apszFiles[i]);
+    }
+  }
+  strcpy(g_szLowFile, apszFiles[g_nInputFiles]);
   if (g_fEightBit || g_fAssembler) {
-    if (strlen(g_szLowFile) == 0)
-      FAIL("required file names missing");
-    if (strlen(g_szHighFile) != 0)
-      FAIL("specify only one output file"); 
     SetFileType(g_szLowFile, g_fAssembler ? ".asm" : ".hex");
   } else {
-    if (strlen(g_szHighFile) == 0)
-      FAIL("required file names missing");
+    strcpy(g_szHighFile, apszFiles[g_nInputFiles+1]);
     SetFileType(g_szLowFile, ".hex");
     SetFileType(g_szHighFile, ".hex");
   }
-  SetFileType(g_szInputFile, ".obj");
   if (g_lROMsize == 0) FAIL("specify EPROM size with -s option");
 }
 
@@ -308,78 +371,67 @@ void RAD2ASC (uint16_t w1, uint16_t w2, char *pszName)
   pszName[6] = 0;
 }
 
-bool ReadOBJbyte (uint8_t *pb)
-{
-  //++ 
-  //   This function reads and returns the next byte from the OBJ file.
-  // Bytes are buffered, one block at a time, and if we've finished this
-  // block then we'll attempt to read the next one.  When we reach the end
-  // of the object file, we return FALSE.
-  //--
-  int Count;
-  if (g_nOBJbufPos >= g_cbOBJbuf) {
-    Count = _read(g_hOBJfile, g_abOBJbuf, sizeof(g_abOBJbuf));
-    if (Count <= 0) return false;
-    g_cbOBJbuf = Count;  g_nOBJbufPos = 0;
-  }
-  *pb = g_abOBJbuf[g_nOBJbufPos++];
-  return true;
-}
-
-bool ReadOBJword (uint16_t *pw)
+uint8_t *ReadOBJfile (const char *pszFile, uint32_t *pcbFile)
 {
   //++
-  //   Read two bytes from the PDP11 object file and return them as a sixteen
-  // bit word.  REMEMBER that PDP11s are little endian machines!
+  //   Read the entire object file into memory and return a pointer to the
+  // buffer, or NULL if anything goes wrong.  There are MAXOBJREC extra zero
+  // bytes at the end, so that a truncated record can't make any of the
+  // Process...() routines look past the end of the buffer ...
   //--
-  uint8_t b1, b2;
-  if (!ReadOBJbyte(&b1)) return false;
-  if (!ReadOBJbyte(&b2)) return false;
-  *pw = MKWORD(b2, b1);
-  return true;
+  FILE *f;  long cbFile;  uint8_t *pbFile = NULL;
+  if ((f = fopen(pszFile, "rb")) == NULL) return NULL;
+  if ((fseek(f, 0, SEEK_END) == 0) && ((cbFile = ftell(f)) >= 0)
+   && (fseek(f, 0, SEEK_SET) == 0)
+   && ((pbFile = malloc((size_t) cbFile+MAXOBJREC)) != NULL)) {
+    if (fread(pbFile, 1, (size_t) cbFile, f) == (size_t) cbFile) {
+      memset(pbFile+cbFile, 0, MAXOBJREC);  *pcbFile = (uint32_t) cbFile;
+    } else {
+      free(pbFile);  pbFile = NULL;
+    }
+  }
+  fclose(f);
+  return pbFile;
 }
 
-bool ReadOBJrecord (uint16_t *pcwRecord, uint8_t *pbRecord)
+bool ReadOBJrecord (uint16_t *pcwRecord, const uint8_t **ppbRecord)
 {
   //++
-  //   This routine reads one object file record and verifies the checksum.  If
-  // all is well it returns TRUE and the length of the record (plus the actual
-  // data, of course).  If a bad record is found it aborts, and when we reach
-  // the end of the object file it returns FALSE.
+  //   This routine finds the next object file record and verifies the
+  // checksum.  If all is well it returns TRUE, the length of the record and
+  // a pointer to the data - which is still in the file buffer; nothing is
+  // copied.  If a bad record is found it aborts, and when we reach the end
+  // of the object file it returns FALSE.
   //--
-  uint8_t b, bChecksum1, bChecksum2;  uint16_t wLength, i;
+  const uint8_t *pb;  uint32_t cbLeft;  uint16_t wLength;
 
   // Skip over zero bytes, and quit if we find EOF ...
-  do
-    if (!ReadOBJbyte(&b)) return 0;
-  while (b == 0);
+  while ((g_nOBJpos < g_cbOBJfile) && (g_pbOBJfile[g_nOBJpos] == 0)) ++g_nOBJpos;
+  if (g_nOBJpos >= g_cbOBJfile) return false;
+  pb = &g_pbOBJfile[g_nOBJpos];  cbLeft = g_cbOBJfile - g_nOBJpos;
 
   // Valid records start with the bytes 0x01 and 0x00 ...
-  if ((b != 0x01) || !ReadOBJbyte(&b) || (b != 0x00))
+  if ((cbLeft < 2) || (pb[0] != 0x01) || (pb[1] != 0x00))
     FAIL("failed to find 0x0001 record header in object file");
-  bChecksum1 = 0x01;
 
   // Read the record length ...
-  if (!ReadOBJword(&wLength)) FAIL("failed to find record length in object file");
+  if (cbLeft < 4) FAIL("failed to find record length in object file");
+  wLength = MKWORD(pb[3], pb[2]);
   if ((wLength < 4) || (wLength > MAXOBJREC)) FAIL1("object file record length (%d) too long", wLength)
-  bChecksum1 += LOBYTE(wLength);  bChecksum1 += HIBYTE(wLength);
+  if (cbLeft < wLength) FAIL("premature EOF while reading object file");
 
-  // Now read the actual data, one byte at a time ...
-  for (i = 0;  i < wLength-4;  ++i) {
-    if (!ReadOBJbyte(&pbRecord[i])) FAIL("premature EOF while reading object file");
-    bChecksum1 += pbRecord[i];
-  }
-
-  //   Lastly, read and verify the checksum ...   Note that the checksum of the
-  // object file record is just the complement of the sum of all the bytes...
-  if (!ReadOBJbyte(&bChecksum2)) FAIL("failed to find checksum in object file");
-  if (LOBYTE(bChecksum1+bChecksum2) != 0) FAIL("bad checksum found in object file");
+  //   Lastly, verify the checksum ...   Note that the checksum of the object
+  // file record is just the complement of the sum of all the bytes, so the
+  // sum of the whole thing, header and checksum included, is zero...
+  if (cbLeft < (uint32_t) wLength+1) FAIL("failed to find checksum in object file");
+  if (LOBYTE(ckSum(pb, wLength+1)) != 0) FAIL("bad checksum found in object file");
 
   // All's well - return success...
-  *pcwRecord = wLength-4;  return true;
+  *pcwRecord = wLength-4;  *ppbRecord = pb+4;
+  g_nOBJpos += wLength+1;  return true;
 }
 
-void ProcessGSD (uint16_t wLength, uint8_t *pbRecord)
+void ProcessGSD (uint16_t wLength, const uint8_t *pbRecord)
 {
   //++
   //   Process global symbol directory records.  Currently we don't do anything
@@ -395,11 +447,14 @@ void ProcessGSD (uint16_t wLength, uint8_t *pbRecord)
     wValue = MKWORD(pbRecord[i+7], pbRecord[i+6]);
     if (g_fVerbose)
       fprintf(stderr, PROGRAM ": GSD record, SYM=\"%-6s\", type=%-6s, flags=%03o, value=%06o\n", szSymbol, apszTypes[bType], bFlags, wValue);
-    if (bType == 3) g_wStartAddress = wValue;
+    //   The transfer address comes from the first module that has an even
+    // one - an odd address means "no transfer address" ...
+    if ((bType == 3) && ((g_wStartAddress == 0) || ISODD(g_wStartAddress)))
+      g_wStartAddress = wValue;
   }
 }
 
-void ProcessRLD (uint16_t wLength, uint8_t *pbRecord)
+void ProcessRLD (uint16_t wLength, const uint8_t *pbRecord)
 {
   //++
   //   Process relocation directory records - we have to process these at least at
@@ -441,31 +496,44 @@ void ProcessRLD (uint16_t wLength, uint8_t *pbRecord)
   }
 }
 
-void LoadText (uint16_t wAddress, uint16_t cbText, uint8_t *pbText)
+void LoadText (uint16_t wAddress, uint16_t cbText, const uint8_t *pbText, uint8_t nModule)
 {
   //++
-  // Load a text record into the memory image.  This one, at least, is easy...
+  //   Load a text record into the memory image.  This one, at least, is easy,
+  // but it's an error if some other module has already loaded any of it...
   //--
+  uint32_t i;
   if (g_fVerbose) fprintf(stderr, PROGRAM ": TEXT record, loading %d bytes at %0o\n", cbText, wAddress);
+  if ((uint32_t) wAddress+cbText > PDPMEMSIZE)
+    FAIL1("text record at %06o goes past the end of memory", wAddress);
+  for (i = wAddress;  i < (uint32_t) wAddress+cbText;  ++i) {
+    if ((g_pabModule[i] != 0) && (g_pabModule[i] != nModule)) {
+      fprintf(stderr, PROGRAM ": %s overlaps %s at %06o\n", g_apszInputFiles[nModule-1], g_apszInputFiles[g_pabModule[i]-1], i);
+      exit(EXIT_FAILURE);
+    }
+    g_pabModule[i] = nModule;
+  }
   g_wLastTextAddress = wAddress;
   memcpy(&g_pabMemory[wAddress], pbText, cbText);
 }
 
-void ReadObjectFile (void)
+void ReadObjectFile (const char *pszFile, uint8_t nModule)
 {
   //++
-  //   Open the object file; read it and process all the records we find there,
-  // and then close it.  If any errors occur then just abort this program.
+  //   Read the object file into memory, process all the records we find there,
+  // and then free it.  If any errors occur then just abort this program.
+  // nModule is the number (starting from 1) of this object file...
   //--
-  uint8_t bRecord[MAXOBJREC];  uint16_t wLength;
+  const uint8_t *bRecord;  uint16_t wLength;
 
-  // Open the PDP-11 object file ... 
-  g_hOBJfile = _open(g_szInputFile, _O_RDONLY | _O_BINARY);
-  if (g_hOBJfile == -1) FAIL1("unable to read %s\n", g_szInputFile);
-  g_cbOBJbuf = g_nOBJbufPos = 0;  g_wLastTextAddress = 0;
+  // Read the PDP-11 object file ... 
+  if (g_fVerbose) fprintf(stderr, PROGRAM ": reading %s\n", pszFile);
+  g_pbOBJfile = ReadOBJfile(pszFile, &g_cbOBJfile);
+  if (g_pbOBJfile == NULL) FAIL1("unable to read %s\n", pszFile);
+  g_nOBJpos = 0;  g_wLastTextAddress = 0;
 
-  // Read records from the object file and process each one ...
-  while (ReadOBJrecord(&wLength, &bRecord[0])) {
+  // Process each record in the object file ...
+  while (ReadOBJrecord(&wLength, &bRecord)) {
     switch (bRecord[0]) {
 
       // Process global symbol definitions ...
@@ -475,7 +543,7 @@ void ReadObjectFile (void)
       // Load text records into the memory image ...
       case 0x03:
         if (wLength < 5) FAIL1("object file text record length (%d) too short", wLength);
-        LoadText(MKWORD(bRecord[3], bRecord[2]), wLength-4, &bRecord[4]);  break;
+        LoadText(MKWORD(bRecord[3], bRecord[2]), wLength-4, &bRecord[4], nModule);  break;
 
       // Process relocation records ...
       case 0x04:
@@ -504,8 +572,8 @@ void ReadObjectFile (void)
       }
   }
 
-  // Close the object file and we're done...
-  _close(g_hOBJfile);
+  // Free the object file and we're done...
+  free(g_pbOBJfile);  g_pbOBJfile = NULL;
 }
 
 void CalculateChecksum()
@@ -523,10 +591,9 @@ void CalculateChecksum()
   //   Notice that we always compute the checksum for ALL of memory, even it
   // the EPROM only encompasses a part of that.  The PDP11 memory image is
   // initialized to zeros so in theory any unused words shouldn't affect the
-  // result.
+  // result.  The last word of memory isn't included (it never has been!).
   //--
-  int16_t iChecksum1 = 0;
-  for (uint32_t i = 0; i < PDPMEMSIZE-2; i += 2) iChecksum1 += GETWORD(i);
+  int16_t iChecksum1 = (int16_t) ckSumLE16(g_pabMemory, PDPMEMSIZE-2);
   int16_t iChecksum2 = (-iChecksum1) & 0177777;
   if (g_fChecksum) {
     SETWORD(g_wChecksumLocation, iChecksum2);
@@ -546,46 +613,18 @@ bool WriteHex (char *lpszFile, uint8_t *pbMemory, uint32_t cbMemory, uint16_t wI
   //
   //   This procedure writes a memory dump in standard Intel HEX file format.
   // This particular implementation has the ability to write every byte, only
-  // the even bytes, or only the odd bytes.
+  // the even bytes, or only the odd bytes.  The record size and whether the
+  // unused (zero) bytes are written are up to the -r and -u options.
   //--
   FILE     *fpHex;        // handle of the file we're writing
-  uint16_t  cbRecord;     // length of the current .HEX record
-  uint16_t  wChecksum;    // checksum     "   "     "      "     "
-  uint32_t  lMemAddr;     // current memory address
-  uint16_t  i;            // temporary...
 
   // Open the output file for writing...
   if ((fpHex=fopen(lpszFile, "wt")) == NULL)
     FAIL1("unable to write file %s\n", lpszFile);
 
-  // Dump all of memory...
-  for (lMemAddr = 0;  lMemAddr < cbMemory;  lMemAddr += cbRecord*wIncrement) {
-
-    // Figure out the record size and address for that record.  
-    cbRecord = 16;
-    if ((uint32_t) (cbRecord*wIncrement) > (cbMemory-lMemAddr))
-      cbRecord = (uint16_t) (cbMemory-lMemAddr) / wIncrement;
-
-    // Write the record header (for a type 0 record)...
-    uint16_t wRecAddr = lMemAddr / wIncrement;
-    fprintf(fpHex, ":%02X%04X00", cbRecord, wRecAddr);
-    
-    // Start the checksum calculation...
-    wChecksum = cbRecord + HIBYTE(wRecAddr) + LOBYTE(wRecAddr) + 00 /*nType*/;
-
-    // And dump all the data bytes in this record.
-    for (i = 0;  i < cbRecord;  ++i) {
-      uint8_t b = pbMemory[lMemAddr + (i*wIncrement)];
-      fprintf(fpHex, "%02X", b);  wChecksum += b;
-    }
-
-    // Write out the checksum byte and finish off this record.
-    fprintf(fpHex,"%02X\n", (- (short int) wChecksum) & 0xFF);
-  }
-
-  //   Don't forget to write an EOF record, which is easy in our case, since it
-  // doesn't contain any variable data.
-  fprintf(fpHex, ":00000001FF\n");
+  // Dump all of memory, including the EOF record...
+  if (!hexWrite(fpHex, pbMemory, cbMemory/wIncrement, wIncrement, 0, &g_HexOptions))
+    FAIL1("error writing file %s", lpszFile);
   if (g_fVerbose) fprintf(stderr, PROGRAM ": %d bytes written to %s\n", cbMemory/wIncrement, lpszFile);
   fclose(fpHex);
   return true;
@@ -673,12 +712,13 @@ int main(int argc, char* argv[])
   ParseCommand(argc, argv);
 
   // Allocate the PDP-11 memory image ...
-  g_pabMemory = malloc(PDPMEMSIZE);
-  if (g_pabMemory == NULL) FAIL("unable to allocate memory image");
-  memset(g_pabMemory, 0, PDPMEMSIZE);
+  g_pabMemory = calloc(PDPMEMSIZE, 1);
+  g_pabModule = calloc(PDPMEMSIZE, 1);
+  if ((g_pabMemory == NULL) || (g_pabModule == NULL)) FAIL("unable to allocate memory image");
 
-  // Read and process the object file ...
-  ReadObjectFile();
+  // Read and process all the object files ...
+  for (int i = 0;  i < g_nInputFiles;  ++i)
+    ReadObjectFile(g_apszInputFiles[i], (uint8_t) (i+1));
   if (g_fChecksum) CalculateChecksum();
   if (g_fDumpMemory) DumpMemory();
 
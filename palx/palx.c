@@ -196,6 +196,40 @@
 // 23-JUL-23      RLA   - if the string contains exactly 1 character, .SIXBIT
 //                          doesn't list the source line!
 // 27-JUL-23      RLA   - Allow unary "~" as ones complement.
+// 14-OCT-26      AGT   - The symbol table is no longer a fixed size.  It is
+//                          now a power of two hash index (FNV-1a hash) that
+//                          doubles whenever it gets half full or a probe chain
+//                          gets too long, plus a separate list of all symbols
+//                          in the order they were entered.  SortSymbols() sorts
+//                          the list, so LookupSymbol() still works afterwards.
+//                      - Allocate cross reference entries from pools of
+//                          CREFPOOL at a time rather than one malloc() each,
+//                          and don't collect them at all if there's no
+//                          listing (-n).  The cross reference now marks
+//                          references to a label from another field with "F".
+//                      - Read the whole source file into memory once, with the
+//                          CRLF and form feed fixups done as it's loaded, and
+//                          have both passes step through an index of its lines
+//                          (pszSourceText) instead of reading it twice with
+//                          fgets().
+//                      - ReadBlock() now scans text blocks a line at a time,
+//                          looking only for the next "<" or ">", and copies
+//                          whole runs of text into a buffer that grows as
+//                          needed.  Macro bodies are no longer limited to
+//                          MAXBODY characters, and skipping a false
+//                          conditional doesn't copy anything at all.
+//                      - Add the -n option to make no listing file at all.  Only
+//                          lines with errors are formatted (for stderr) and the
+//                          memory map, symbol table and TOC are skipped.
+//                      - ListLine() builds each line in a buffer and writes it
+//                          with a single fputs(), and the listing file gets a
+//                          LISTBUFFER byte stdio buffer.
+//                      - Keep a memory image of everything punched and add the
+//                          -el/-eh options to write the SBC6120 high and low
+//                          EPROM images straight from it, using the same code
+//                          (pdp2hex/eprom.c) as PDP2HEX.  The -eo, -es, -ec,
+//                          -er and -ep options are PDP2HEX's -o, -s, -c, -r
+//                          and -p.
 //
 // BUGS
 //
@@ -234,6 +268,7 @@
 #else
 #include <io.h>         // _open(), _write(), _close(), etc...
 #endif
+#include "pdp2hex.h"    // EPROM_OPTIONS, WriteEPROMs(), etc...
 #endif
 
 // Linux and VMS/DECC has slightly different names for these symbols...
@@ -264,12 +299,15 @@
 #define TITLE   "IM6100/HD6120 Cross Assembler"
 #define PALX            "PALX"  // our name for messages
 #define VERSION            423  // our version number
-#define HASHSIZE          3079  // maximum entries in the symbol table
+#define HASHSIZE          4096  // initial symbol hash size (power of two!)
+#define MAXPROBE            16  // longest probe before growing the hash
+#define CREFPOOL          4096  // cross reference entries allocated at once
 #define MAXSTRING          256  // longest string (e.g. source line) allowed!
 #define IDLEN               12  // longest identifier allowed!
 #define MAXARG              10  // maximum number of macro arguments
-#define MAXBODY           4096  // longest macro body allowed (in characters)
+#define BLOCKSIZE         4096  // initial size of the text block buffer
 #define LINES_PER_PAGE      60  // default number of lines per listing page
+#define LISTBUFFER       65536  // size of the listing file's stdio buffer
 #define COLUMNS_PER_PAGE   120  // default number of columns per listing page
 #define LIST_TYPE       ".lst"  // default type for listing files
 #define BINARY_TYPE     ".bin"  //    "      "   "  binary    "
@@ -341,10 +379,18 @@ enum _SYMBOL_TYPES {    // Types of symbols in the symbol table:
 };
 typedef enum _SYMBOL_TYPES SYMBOL_TYPE;
 
+// Source file lines ...
+struct _SRCLINE {             // One line of the source file...
+  char         *pszText;      //   text of the line (in pSourceBuffer)
+  bool          fFormFeed;    //   true if the line had a form feed
+};
+typedef struct _SRCLINE SRCLINE;
+
 // Symbol cross reference table entries ...
 struct _CREF {                // Cross reference data for symbols...
   uint16_t      nLine;        //   source line number of this reference
   bool          fDefinition;  //   true if this reference defines the symbol
+  uint8_t       nField;       //   field of the code making the reference
   struct _CREF *pNext;        //   next reference to this symbol
 };
 typedef struct _CREF CREF;
@@ -400,16 +446,23 @@ typedef struct _SYMBOL SYMBOL;
 string_t   szSourceFile;        //   name of the current source file
 FILE      *pSourceFile;         //   file handle of the source
 uint16_t   nSourceLine;         //   count of source lines read
-string_t   szSourceText;        //   text of the current source line
+char      *pszSourceText;       //   text of the current source line
+string_t   szSourceText;        //   buffer for macro expansion lines
+char      *pSourceBuffer;       //   the whole source file, line by line
+SRCLINE   *pSourceLines;        //   index of the lines in pSourceBuffer
+uint32_t   nSourceLines;        //   number of lines in the source file
+uint32_t   nNextSourceLine;     //   index of the next line to assemble
                                 // Listing file variables...
 string_t   szListFile;          //   name of the listing file
 FILE      *pListFile;           //   listing file handle
+bool       fNoListing;          //   true for no listing file at all (-n)
 uint16_t   nLinesPerPage;       //   listing lines per page
 uint16_t   nColumnsPerPage;     //   listing columns per page
 uint16_t   nListPages;          //   count of pages printed
 uint16_t   nLinesThisPage;      //   count of lines on this page
 bool       fNewPage;            //   start a new page in the listing
 bool       fListSymbols;        //   true to list the symbol table 
+bool       fCrossReference;     //   true to collect cross reference data
 bool       fListMap;            //   true to list the memory bitmap
 bool       fListExpansions;     //   true to list macro expansions
 bool       fListText;           //   list code for .TEXT/.ASCIZ/.SIXBIT
@@ -424,11 +477,21 @@ uint16_t   nLastBinaryAddress;  //   address of last word punched
 uint16_t   nBinaryChecksum;     //   running checksum of binary data
 uint8_t    abBinaryData[64];    //   buffer for writing BIN data
 uint16_t   cbBinaryData;        //   number of bytes used in the buffer
+                                // EPROM image variables...
+string_t   szLowEPROM;          //   name of the low EPROM file (-el)
+string_t   szHighEPROM;         //   name of the high EPROM file (-eh)
+EPROM_OPTIONS EPROMOptions;     //   ROM offset, size, checksum, etc...
+uint16_t  *pwMemory;            //   image of all 32K words punched
                                 // Literal pool variables...
 uint16_t   nLiteralBase;        //   first free literal pool address
 uint16_t   anLiteralData[0200]; //   literal pool for this page
                                 // Symbol table variables...
-SYMBOL    *Symbols[HASHSIZE];   //   symbols (all of 'em!)
+SYMBOL   **ppSymbolHash;        //   hash index of the symbols
+uint32_t   nHashSize;           //   size of the hash (a power of two)
+SYMBOL   **ppSymbols;           //   symbols (all of 'em!) in entry order
+uint32_t   nSymbols;            //   number of symbols in the table
+CREF      *pCREFPool;           //   next free cross reference entry
+uint16_t   nCREFFree;           //   number of free entries left in the pool
 TOC       *pFirstTOC;           //   first table of contents entry
 TOC       *pLastTOC;            //   last    "    "    "       "
                                 // Software stack opcodes from .STACK
@@ -437,6 +500,8 @@ uint16_t   nPUSHJ, nPOPJ;       //   opcodes for .PUSHJ and .POPJ
                                 // Macro expansion variables...
 MACEXP    *pCurrentMacro;       //   current macro expansion (NULL if none)
 uint32_t  nGeneratedLabel;      //   current generated label number
+char      *pBlockBuffer;        //   text accumulated by ReadBlock()
+size_t     cbBlockBuffer;       //   allocated size of pBlockBuffer
                                 // Miscellaneous...
 uint16_t   nPass;               //   current assembler pass (1 or 2)
 uint16_t   nPC;                 //   current instruction location
@@ -546,19 +611,43 @@ char *MyStrPad (const char *pszSrc, int nWidth)
 ////////////////////////////////////////////////////////////////////////////////
 
 
-uint16_t HashCode (const char *pszName)
+uint32_t HashCode (const char *pszName)
 {
   //++
-  //   This routine generates the hash code for a given identifier by
-  // forming a RADIX-64 binary equivalent for the ordinal values of the
-  // characters, and then dividing by the table length.  It's crude, but
-  // good enough for now.  Note that the hashing results are markedly
-  // better when the symbol table size (e.g. HASHSIZE) is prime!
+  //   This routine generates the hash code for a given identifier using
+  // the 32 bit FNV-1a hash.  Every character affects all the bits of the
+  // result, so runs of similar names (TTY1, TTY2, ...) spread out nicely
+  // and the caller can simply mask off as many low bits as it needs.
   //--
-  uint32_t Hash = 0;
+  uint32_t Hash = 2166136261UL;
   for (;  *pszName != EOS;  ++pszName)
-    Hash = (Hash * (uint32_t) '_') + (uint32_t) (*pszName - ' ');
-  return (uint16_t) (Hash % (uint32_t) HASHSIZE);
+    Hash = (Hash ^ (uint8_t) *pszName) * 16777619UL;
+  return Hash;
+}
+
+void GrowSymbols (uint32_t nSize)
+{
+  //++
+  //   This routine (re)builds the symbol hash index with nSize entries,
+  // which must be a power of two.  The symbols themselves don't move -
+  // they're simply rehashed from the ppSymbols list into the new index.
+  // The list is grown along with the index, so it always has room for
+  // as many symbols as would half fill the hash...
+  //--
+  uint32_t i, nHash;  SYMBOL **ppNewList;
+
+  free(ppSymbolHash);
+  ppSymbolHash = (SYMBOL **) MyAlloc(nSize * sizeof(SYMBOL *));
+  nHashSize = nSize;
+  for (i = 0;  i < nSymbols;  ++i) {
+    nHash = HashCode(ppSymbols[i]->pszName) & (nHashSize-1);
+    while (ppSymbolHash[nHash] != NULL)  nHash = (nHash+1) & (nHashSize-1);
+    ppSymbolHash[nHash] = ppSymbols[i];
+  }
+
+  ppNewList = (SYMBOL **) MyAlloc((nSize/2) * sizeof(SYMBOL *));
+  if (nSymbols > 0) memcpy(ppNewList, ppSymbols, nSymbols * sizeof(SYMBOL *));
+  free(ppSymbols);  ppSymbols = ppNewList;
 }
 
 SYMBOL *LookupSymbol (const char *pszName, bool fEnter)
@@ -574,24 +663,21 @@ SYMBOL *LookupSymbol (const char *pszName, bool fEnter)
   // name is not in the symbol table and fEnter is false, then NULL is
   // returned and nothing is entered into the table.
   //
-  //   NOTE:  This is a fairly primitive hashed search with linear
-  // probing...
+  //   NOTE:  This is a hashed search with linear probing.  The hash
+  // index is never allowed to get more than half full, and it's doubled
+  // if a new symbol would need more than MAXPROBE probes, so the search
+  // stays short no matter how many symbols there are...
   //--
-  uint16_t nHash, nInitialHash;  SYMBOL *pNew;  char *pszNameCopy;
+  uint32_t nHash, nProbes;  SYMBOL *pNew;  char *pszNameCopy;
 
   //   Compute the hash code of this symbol and use it for the inital
   // stab into the table.  If that entry doesn't match, then search
   // forward from there.  If we find a NULL entry in the table, then we
   // can quit with the knowledge that this symbol isn't defined.
-  nHash = nInitialHash = HashCode(pszName);
-  while (Symbols[nHash] != NULL) {
-    if (STREQL(Symbols[nHash]->pszName, pszName)) return Symbols[nHash];
-    nHash = (nHash + 1) % HASHSIZE;
-    if (nHash == nInitialHash) {
-       //   The symbol table is completely full and this symbol isn't
-       // in there (and, of course, there's no place to add it!).
-       FatalError("symbol table full");
-    }
+  nHash = HashCode(pszName) & (nHashSize-1);  nProbes = 0;
+  while (ppSymbolHash[nHash] != NULL) {
+    if (STREQL(ppSymbolHash[nHash]->pszName, pszName)) return ppSymbolHash[nHash];
+    nHash = (nHash + 1) & (nHashSize-1);  ++nProbes;
   }
 
   //   This symbol isn't defined, but nHash points to where it should
@@ -603,7 +689,19 @@ SYMBOL *LookupSymbol (const char *pszName, bool fEnter)
   pNew = (SYMBOL *) MyAlloc(sizeof(SYMBOL));
   pszNameCopy = MyStrDup(pszName);
   pNew->pszName = pszNameCopy;  pNew->nType = SF_UDF;
-  return Symbols[nHash] = pNew;
+
+  //   If adding this symbol would make the hash more than half full, or
+  // the probe chain was too long, then grow the hash first and find the
+  // new symbol's place in that.  Long chains in a mostly empty hash mean
+  // the names really do collide, and growing won't help with that...
+  if ((nSymbols+1 > nHashSize/2)
+   || ((nProbes > MAXPROBE) && (nSymbols > nHashSize/8))) {
+    GrowSymbols(nHashSize*2);
+    nHash = HashCode(pszName) & (nHashSize-1);
+    while (ppSymbolHash[nHash] != NULL)  nHash = (nHash+1) & (nHashSize-1);
+  }
+  ppSymbols[nSymbols++] = pNew;
+  return ppSymbolHash[nHash] = pNew;
 }
 
 void AddReference (SYMBOL *pSym, bool fDefinition)
@@ -623,15 +721,25 @@ void AddReference (SYMBOL *pSym, bool fDefinition)
   // one on the list, and we don't have to do an expensive search of the
   // entire CREF chain to find it. Finally, we accumulate cross reference
   // data only under pass 2 - otherwise we'd have a whole set of complete
-  // duplicates from each pass!
+  // duplicates from each pass!  And if there's no listing file at all (-n)
+  // then there's no point in collecting any of this.
+  //
+  //   A big program can easily make tens of thousands of references, so
+  // CREF blocks are carved out of pools of CREFPOOL entries rather than
+  // being allocated one at a time.  They're never freed individually -
+  // the cross reference lasts until the program exits anyway...
   //--
   CREF *pNew;
-  if (nPass != 2) return;
+  if ((nPass != 2) || !fCrossReference) return;
   // If we already have a reference to this line, then quit...
   if ((pSym->pLastRef!=NULL) && (pSym->pLastRef->nLine==nSourceLine)) return;
-  // Create a new CREF block...
-  pNew = (CREF *) MyAlloc(sizeof(CREF));
+  // Take a new CREF block from the pool (starting a new pool if need be)...
+  if (nCREFFree == 0) {
+    pCREFPool = (CREF *) MyAlloc(CREFPOOL * sizeof(CREF));  nCREFFree = CREFPOOL;
+  }
+  pNew = pCREFPool++;  --nCREFFree;
   pNew->nLine = nSourceLine;  pNew->fDefinition = fDefinition;
+  pNew->nField = (uint8_t) nField;
   // Add it to the end of the chain...
   if (pSym->pLastRef != NULL) {
     pSym->pLastRef->pNext = pNew;  pSym->pLastRef = pNew;
@@ -655,6 +763,9 @@ void AddTOC (const char *pszTitle)
   //--
   TOC *pTOC;
 
+  // Without a listing there's no table of contents either...
+  if (fNoListing) return;
+
   // Create a new TOC structure and fill out all the fields...
   pTOC = (TOC *) MyAlloc(sizeof(TOC));
   pTOC->pszTitle = MyStrDup(pszTitle);
@@ -698,8 +809,8 @@ void InitializeSymbols (void)
   // pseudo operations.  We'd like these to be compiled into a static
   // table, of course, but with a hash table that's not easily done...
   //--
-  SYMBOL *pSym;  uint16_t i;
-  for (i = 0;  i < HASHSIZE;  ++i)  Symbols[i] = NULL;
+  SYMBOL *pSym;
+  nSymbols = 0;  GrowSymbols(HASHSIZE);
 
   // These macros reduce the amount of typing...
 #define SYM(n,v,t)      \
@@ -835,9 +946,6 @@ int CompareSymbols (const void *p1, const void *p2)
   //--
   const SYMBOL *s1 = *((SYMBOL **) p1);
   const SYMBOL *s2 = *((SYMBOL **) p2);
-  if ((s1 == NULL) && (s2 == NULL)) return  0;
-  if ((s1 == NULL) && (s2 != NULL)) return  1;
-  if ((s1 != NULL) && (s2 == NULL)) return -1;
   return strcmp((s1)->pszName, (s2)->pszName);
 }
 
@@ -845,12 +953,12 @@ void SortSymbols (void)
 {
   //++
   //   This function will sort the symbol table (using the qsort() from
-  // the C RTL).  Since symbol table entries are normally placed based
-  // on hash codes, this routine ruins that and LookupSymbol() will no
-  // longer function after it is used.   SortSymbols() is called only
-  // after assembly is completed and just before listing the symbols.
+  // the C RTL).  Only the ppSymbols list is sorted - the hash index is
+  // left alone, so LookupSymbol() still works afterwards.  SortSymbols()
+  // is called after assembly is completed and just before listing the
+  // symbols.
   //--
-  qsort(&Symbols, HASHSIZE, sizeof(SYMBOL *), &CompareSymbols);
+  qsort(ppSymbols, nSymbols, sizeof(SYMBOL *), &CompareSymbols);
 }
 
 
@@ -965,7 +1073,11 @@ void ListLine (FILE *hList, uint16_t *pField, uint16_t *pAddress, uint16_t *pCod
   // code checks szErrorFlags for a null string to determine whether the
   // current line has any errors, so we can't just change the global value -
   // we've got to make a local copy.
-  string_t szLocalErrors;
+  //
+  //   The whole line is built up in szLine and then written with a single
+  // fputs().  That's a lot cheaper than half a dozen fprintf() calls, and
+  // for stderr (which isn't buffered) it's one write instead of six...
+  string_t szLocalErrors;  char szLine[MAXSTRING+64];  char *p = szLine;
   strcpy(szLocalErrors, szErrorFlags);
   if (pCurrentMacro != NULL) {
     strcat(szLocalErrors, "+");
@@ -981,30 +1093,30 @@ void ListLine (FILE *hList, uint16_t *pField, uint16_t *pAddress, uint16_t *pCod
   //   Print the error characters and, if we will be showing the source
   // text, the source line number as well...
   if (fSource && (pCurrentMacro == NULL))
-    fprintf(hList, "%4d%-4s", nSourceLine, szLocalErrors);
+    p += sprintf(p, "%4d%-4s", nSourceLine, szLocalErrors);
   else
-    fprintf(hList, "    %-4s", szLocalErrors);
+    p += sprintf(p, "    %-4s", szLocalErrors);
 
   // Print the address field (in octal), if needed...
   if ((pField != NULL) && (pAddress != NULL))
-    fprintf(hList, "%01o%04o", *pField, *pAddress);
+    p += sprintf(p, "%01o%04o    ", *pField, *pAddress);
   else
-    fprintf(hList, "     ");
-  fprintf(hList, "    ");
+    {strcpy(p, "         ");  p += 9;}
 
   // And print the generated code (also in octal)....
   if (pCode != NULL)
-    fprintf(hList, "%04o", *pCode);
+    p += sprintf(p, "%04o", *pCode);
   else
-    fprintf(hList, "    ");
+    {strcpy(p, "    ");  p += 4;}
 
   //   And finally print the source text, if it exists.  Note that if
   // do print the source text, we don't print a newline since there's
   // already one at the end of the source line!
   if (fSource) {
-    fprintf(hList, /*"\t"*/ "   ");  fputs(szSourceText, hList);
+    strcpy(p, /*"\t"*/ "   ");  strcpy(p+3, pszSourceText);
   } else
-    fprintf(hList, "\n");
+    strcpy(p, "\n");
+  fputs(szLine, hList);
 }
 
 void List (uint16_t *pField, uint16_t *pAddress, uint16_t *pCode, bool fSource)
@@ -1014,7 +1126,15 @@ void List (uint16_t *pField, uint16_t *pAddress, uint16_t *pCode, bool fSource)
   // one will print the line both to the listing file and, if this line
   // contains any errors, to stderr.  After printing it always clears the
   // error flags...
+  //
+  //   If there's no listing file (-n) then only lines with errors need to
+  // be formatted at all, and there's no paging to worry about...
   //--
+  if (fNoListing) {
+    if (szErrorFlags[0] != EOS)
+      ListLine(stderr, pField, pAddress, pCode, fSource);
+    szErrorFlags[0] = EOS;  return;
+  }
   if ((++nLinesThisPage > nLinesPerPage) || fNewPage)  NewPage();
   ListLine(pListFile, pField, pAddress, pCode, fSource);
   if (strlen(szErrorFlags) > 0)
@@ -1037,22 +1157,23 @@ void ListSummary (void)
   // total error count to both the listing file and to stderr...
   //--
   // See if there's enough room on this page for the summary...
-  nLinesThisPage += 5;
-  if (nLinesThisPage > nLinesPerPage)  NewPage();
-  fprintf(pListFile, "\n\n\n");
-
-  // Print the program break message to the listing and stderr...
-  fprintf(pListFile, "Program break is %05o\n", (nField<<12) + nPC);
-  Message(           "Program break is %05o",   (nField<<12) + nPC);
-
-  // Now summarize the number of errors found...
-  if (nErrorCount > 0) {
-    fprintf(pListFile, "%d error(s) detected\n", nErrorCount);
-    Message(           "%d error(s) detected",   nErrorCount);
-  } else {
-    fprintf(pListFile, "No errors detected\n");
-    Message(           "No errors detected");
+  if (!fNoListing) {
+    nLinesThisPage += 5;
+    if (nLinesThisPage > nLinesPerPage)  NewPage();
+    fprintf(pListFile, "\n\n\n");
+    fprintf(pListFile, "Program break is %05o\n", (nField<<12) + nPC);
+    if (nErrorCount > 0)
+      fprintf(pListFile, "%d error(s) detected\n", nErrorCount);
+    else
+      fprintf(pListFile, "No errors detected\n");
   }
+
+  // Print the program break message and the error count on stderr...
+  Message("Program break is %05o", (nField<<12) + nPC);
+  if (nErrorCount > 0)
+    Message("%d error(s) detected", nErrorCount);
+  else
+    Message("No errors detected");
 }
 
 void ListSymbols (void)
@@ -1068,13 +1189,14 @@ void ListSymbols (void)
   // least once in the source.  Even though the values of these symbols
   // aren't exciting, the cross reference information can be useful. Note
   // that this routine does NOT sort the symbol table - you'll probably
-  // want to do that, by calling SortSymbols(), first.
+  // want to do that, by calling SortSymbols(), first.  References to a
+  // label from code in some other field are marked with an "F".
   //--
-  uint16_t nSymbol, nCREF;  SYMBOL *pSym;  CREF *pCREF;
+  uint32_t nSymbol;  uint16_t nCREF;  SYMBOL *pSym;  CREF *pCREF;
   strcpy(szProgramTitle, "Symbol Table");  NewPage();  AddTOC(szProgramTitle);
 
-  for (nSymbol = 0;  nSymbol < HASHSIZE;  ++nSymbol) {
-    if ((pSym = Symbols[nSymbol]) == NULL) continue;
+  for (nSymbol = 0;  nSymbol < nSymbols;  ++nSymbol) {
+    pSym = ppSymbols[nSymbol];
 
     // Print the symbol's type and value...
     switch (pSym->nType) {
@@ -1118,7 +1240,9 @@ void ListSymbols (void)
         if (++nLinesThisPage > nLinesPerPage)  NewPage();
         fprintf(pListFile, "                    ");
       }
-      fprintf(pListFile, "%6d%c", pCREF->nLine, (pCREF->fDefinition ? '*' : ' '));
+      fprintf(pListFile, "%6d%c", pCREF->nLine, (pCREF->fDefinition ? '*'
+        : ((pSym->nType == SF_TAG) && (pCREF->nField != ((pSym->Value.bin >> 12) & 7))) ? ER_OFF
+        : ' '));
     }
 
     // Finish this line and we're done...
@@ -1312,8 +1436,11 @@ void Punch (uint16_t nAddress, uint16_t nCode)
   //++
   //   This function will write a word to the binary file.  This file is
   // kept in standard PDP-8 BIN loader format, which lets us store 12 bit
-  // words, address, and field information, in 8 bit bytes.
+  // words, address, and field information, in 8 bit bytes.  If we're making
+  // EPROM images then the word goes into the memory image too - the address
+  // is always in the current field.
   //--
+  if (pwMemory != NULL) pwMemory[(nField << 12) | (nAddress & 07777)] = nCode;
   if (nAddress != (nLastBinaryAddress+1)) {
     PutBinary((uint8_t) (((nAddress >> 6) & 077) | 0100));
     PutBinary((uint8_t) (nAddress & 077));
@@ -2706,17 +2833,17 @@ void DotDISABLE (char *pszText) {AssemblyOptions(pszText, false);}
 /////////////////////   MACRO DEFINITION AND EXPANSION   ///////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-void CheckFormFeed (void)
+bool CheckFormFeed (char *pszLine)
 {
   //++
-  //   This function will check the current source line for the presence
-  // of an ASCII form feed character.  If it finds one, then it deletes
-  // the form feed and sets the fNewPage flag which will cause the List()
-  // procedure to force a new page in the listing after we've processed
-  // this line...
+  //   This function will check a source line for the presence of an ASCII
+  // form feed character.  If it finds one, then it deletes the form feed
+  // and returns true. The caller sets the fNewPage flag when the line is
+  // assembled, which will cause the List() procedure to force a new page
+  // in the listing after we've processed this line...
   //--
-  char *p;
-  while ((p=strchr(szSourceText, '\f')) != NULL) {
+  char *p;  bool fFound = false;
+  while ((p=strchr(pszLine, '\f')) != NULL) {
     //  You might be tempted to use strcpy() here, but the offical ANSI
     // standard says of strcpy() "the source and destination must not
     // overlap."  You might think "Nah - they're not serious.  What could
@@ -2726,8 +2853,9 @@ void CheckFormFeed (void)
     // you'll get some really wierd results.  Not kidding... We'll play it
     // safe and copy the characters the hard way...
     while ((*p=*(p+1)) != EOS) ++p;
-    fNewPage = true;
+    fFound = true;
   }
+  return fFound;
 }
 
 MACDEF *NewMacro (SYMBOL *pSym)
@@ -2844,7 +2972,7 @@ bool GetMacroLine()
   // the macro expansion by doubling it (e.g. "$$").
   //--
   uint32_t nPos = 0;  char ch;  identifier_t szName;  const char *pszArg;
-  memset(szSourceText, 0, sizeof(szSourceText));
+  memset(szSourceText, 0, sizeof(szSourceText));  pszSourceText = szSourceText;
   if (*(pCurrentMacro->pszNextLine) == EOS) return false;
 
   while (true) {
@@ -2874,16 +3002,70 @@ bool GetMacroLine()
   return false;
 }
 
+void LoadSource (void)
+{
+  //++
+  //   This routine reads the entire source file into memory, once, before
+  // pass 1.  Each line is stored in pSourceBuffer just the way fgets() used
+  // to return it - up to MAXSTRING-1 characters including the newline, with
+  // "\r\n" (e.g. it's an MSDOS text file) converted to just "\n", form feeds
+  // deleted, and an EOS at the end - and pSourceLines[] indexes them.  Both
+  // passes then simply step through the index and the source file is closed
+  // as soon as it's been read.
+  //--
+  char *pRaw = NULL;  size_t cbRaw = 0, cbAlloc = 0, cbRead, i, nNewlines = 0;
+  char *pDst;  uint32_t nMaxLines;
+
+  // Slurp up the whole file ...
+  do {
+    if (cbRaw == cbAlloc) {
+      cbAlloc = (cbAlloc == 0) ? 65536 : 2*cbAlloc;
+      if ((pRaw = realloc(pRaw, cbAlloc)) == NULL)  FatalError("out of memory");
+    }
+    cbRead = fread(pRaw+cbRaw, 1, cbAlloc-cbRaw, pSourceFile);  cbRaw += cbRead;
+  } while (cbRead > 0);
+  if (ferror(pSourceFile))  FatalError("error reading %s", szSourceFile);
+  fclose(pSourceFile);  pSourceFile = NULL;
+
+  //   Every line needs one more byte for its EOS, and a line that's too long
+  // is split into pieces of MAXSTRING-1 characters (same as fgets() did).
+  // That gives us an upper limit on the size of the buffer and the index...
+  for (i = 0;  i < cbRaw;  ++i)  if (pRaw[i] == EOL) ++nNewlines;
+  nMaxLines = (uint32_t) (nNewlines + cbRaw/(MAXSTRING-2) + 1);
+  pSourceBuffer = (char *) MyAlloc(cbRaw + nMaxLines + 1);
+  pSourceLines = (SRCLINE *) MyAlloc(nMaxLines * sizeof(SRCLINE));
+
+  // Copy the lines into the buffer and fix them up ...
+  nSourceLines = 0;  pDst = pSourceBuffer;  i = 0;
+  while (i < cbRaw) {
+    char *pszLine = pDst;  size_t cbLine = 0;
+    while ((i < cbRaw) && (cbLine < MAXSTRING-1)) {
+      ++cbLine;  if ((*pDst++ = pRaw[i++]) == EOL) break;
+    }
+    *pDst++ = EOS;
+    if (   (cbLine >= 2)
+        && (pszLine[cbLine-2] == '\r')
+        && (pszLine[cbLine-1] == '\n')) {
+      pszLine[cbLine-2] = '\n';  pszLine[cbLine-1] = '\0';
+    }
+    pSourceLines[nSourceLines].pszText = pszLine;
+    pSourceLines[nSourceLines].fFormFeed = CheckFormFeed(pszLine);
+    ++nSourceLines;
+  }
+  free(pRaw);
+}
+
 bool GetSourceLine()
 {
   //++
-  //   This routine will load the next source line into szSourceText.  Usually
-  // it just reads the line from the source file, BUT if a macro expansion is
-  // currently active it will return the next line from the macro body instead.
-  // If we've run out of text in the current expansion it will "pop" the macro
-  // expansion stack and try to return a line from the next outer nested macro.
-  // When we run out of macros it will go back to reading the source file, and
-  // if there are no more lines in the source file it returns false.
+  //   This routine will make pszSourceText point to the next source line.
+  // Usually that's just the next line of the source file (which LoadSource()
+  // has already read into memory), BUT if a macro expansion is currently
+  // active it will return the next line from the macro body instead.  If
+  // we've run out of text in the current expansion it will "pop" the macro
+  // expansion stack and try to return a line from the next outer nested
+  // macro.  When we run out of macros it will go back to the source file,
+  // and if there are no more lines in the source file it returns false.
   //--
   while (pCurrentMacro != NULL) {
     // Return the next line from the current macro expansion ...
@@ -2891,19 +3073,14 @@ bool GetSourceLine()
     // This expansion is done - try to pop the macro expansion "stack" ...
     PopExpansion();
   }
-  // There are no more macros - try to read the source file ...
-  memset(szSourceText, 0, sizeof(szSourceText));
-  if (fgets(szSourceText, sizeof(szSourceText), pSourceFile) == NULL) return false;
-  //  If the line ends with "\r\n" (e.g. it's an MSDOS text file) then convert
-  // that to just "\n" ...
-  size_t cbLine = strlen(szSourceText);
-  if (   (cbLine >= 2)
-      && (szSourceText[cbLine-2] == '\r')
-      && (szSourceText[cbLine-1] == '\n')) {
-    szSourceText[cbLine-2] = '\n';  szSourceText[cbLine-1] = '\0';
+  // There are no more macros - try the next line of the source file ...
+  if (nNextSourceLine >= nSourceLines) {
+    szSourceText[0] = EOS;  pszSourceText = szSourceText;  return false;
   }
+  pszSourceText = pSourceLines[nNextSourceLine].pszText;
+  if (pSourceLines[nNextSourceLine].fFormFeed) fNewPage = true;
   // Count the lines read and we're done ...
-  ++nSourceLine;  CheckFormFeed();  return true;
+  ++nNextSourceLine;  ++nSourceLine;  return true;
 }
 
 char GetSourceChar (char **pszText)
@@ -2920,11 +3097,27 @@ char GetSourceChar (char **pszText)
     if (nPass == 2)  List(NULL, NULL, NULL, true);
     if (!GetSourceLine())
       FatalError("end of file while reading text block");
-    *pszText = szSourceText;
+    *pszText = pszSourceText;
   }
   return ch;
 }
 
+void AppendBlock (size_t *pcbBody, const char *pText, size_t cbText)
+{
+  //++
+  //   Append cbText characters to the text block that ReadBlock() is
+  // accumulating in pBlockBuffer, making the buffer bigger if necessary.
+  // There's always room left for ReadBlock() to add a newline and an EOS.
+  //--
+  if ((*pcbBody + cbText + 2) > cbBlockBuffer) {
+    if (cbBlockBuffer == 0) cbBlockBuffer = BLOCKSIZE;
+    while ((*pcbBody + cbText + 2) > cbBlockBuffer)  cbBlockBuffer *= 2;
+    pBlockBuffer = realloc(pBlockBuffer, cbBlockBuffer);
+    if (pBlockBuffer == NULL)  FatalError("out of memory");
+  }
+  memcpy(pBlockBuffer + *pcbBody, pText, cbText);  *pcbBody += cbText;
+}
+
 void ReadBlock (char **pszText, char **pszBody, bool fAddNewline)
 {
   //++
@@ -2939,9 +3132,14 @@ void ReadBlock (char **pszText, char **pszBody, bool fAddNewline)
   // used for conditionals.  However if pszBody is not NULL then the text
   // accumulated will be copied into a block on the heap and the address of
   // that block returned.  
+  //
+  //   Only the "<" and ">" characters matter inside the block, so rather
+  // than going thru GetSourceChar() one character at a time we search each
+  // line for the next bracket and copy (or skip) everything up to it in
+  // one go.  When we run off the end of a line we list it (on pass 2) and
+  // move on to the next, exactly as GetSourceChar() would...
   //--
-  char ch;  char szBody[MAXBODY];  size_t cbBody = 0;  int32_t nLevel = 0;
-  memset(szBody, 0, sizeof(szBody));
+  char ch;  size_t cbBody = 0, cbRun;  int32_t nLevel = 0;
 
   // Skip everything until we find the next '<' ...
   do {
@@ -2949,28 +3147,39 @@ void ReadBlock (char **pszText, char **pszBody, bool fAddNewline)
     if (ch != '<') Flag(ER_SYN);
   } while (ch != '<');
 
-  // If the next character after the '<' is a newline, then skip it ...
+  //   If the next character after the '<' is a newline, then skip it.
+  // Otherwise back up so that character is the first one scanned below
+  // (GetSourceChar() always leaves *pszText just past what it returned) ...
   ch = GetSourceChar(pszText);
-  if (ch == EOL) ch = GetSourceChar(pszText);
+  if (ch != EOL) --*pszText;
 
   // Store characters in the body until we find the matching '>' ...
-  while ((ch != '>') || (nLevel != 0)) {
-    if (cbBody >= sizeof(szBody)-2) FatalError("macro body too long");
-    if (pszBody != NULL) szBody[cbBody++] = ch;
-    if (ch == '<') ++nLevel;
-    if ((ch == '>') && (nLevel > 0)) --nLevel;
-    ch = GetSourceChar(pszText);
+  while (true) {
+    cbRun = strcspn(*pszText, "<>");
+    if (pszBody != NULL) AppendBlock(&cbBody, *pszText, cbRun);
+    *pszText += cbRun;  ch = **pszText;
+    if (ch == EOS) {
+      // End of this line - list it and go on to the next one ...
+      if (nPass == 2)  List(NULL, NULL, NULL, true);
+      if (!GetSourceLine())
+        FatalError("end of file while reading text block");
+      *pszText = pszSourceText;  continue;
+    }
+    ++*pszText;
+    if ((ch == '>') && (nLevel == 0)) break;
+    if (pszBody != NULL) AppendBlock(&cbBody, &ch, 1);
+    if (ch == '<') ++nLevel;  else --nLevel;
   }
 
   if (pszBody != NULL) {
     // Make sure the definition ended with a newline ...
     if (fAddNewline) {
-      if ((cbBody == 0) || (szBody[cbBody-1] != EOL)) szBody[cbBody++] = EOL;
+      if ((cbBody == 0) || (pBlockBuffer[cbBody-1] != EOL)) AppendBlock(&cbBody, "\n", 1);
     }
-    szBody[cbBody] = EOS;
 
     // Copy the body to the heap and return a pointer to it...
-    *pszBody = MyStrDup(szBody);
+    *pszBody = (char *) MyAlloc(cbBody+1);
+    if (cbBody > 0) memcpy(*pszBody, pBlockBuffer, cbBody);
   }
 }
 
@@ -3509,7 +3718,7 @@ void Pass (uint16_t n)
   char *pszText;
 
   // Initialize all the global variables...
-  nPass = n;  nCPU = 0;  nErrorCount = nSourceLine = 0;
+  nPass = n;  nCPU = 0;  nErrorCount = nSourceLine = 0;  nNextSourceLine = 0;
   nPC = 0200;  nField = 0;  nLiteralBase = nPC + 0200;
   fNewPage = fListExpansions = fPaginate = true;
   fListSymbols = fListMap = fListTOC = fListText = true;
@@ -3520,7 +3729,7 @@ void Pass (uint16_t n)
   Message("%s, pass %d", szSourceFile, n);
 
   while (GetSourceLine()) {
-    pszText = szSourceText;
+    pszText = pszSourceText;
     Assemble(pszText);
   }
 
@@ -3533,6 +3742,26 @@ void Pass (uint16_t n)
 //////////////////////////   COMMAND LINE PARSER   /////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+bool OctalOption (int argc, char *argv[], int *pi, uint32_t nMax, uint16_t *pnValue)
+{
+  //++
+  //   Parse the octal value for one of the -eo, -es or -ec options.  Like
+  // -p and -w, the value can either follow the option directly or be the
+  // next argument.  Returns false if it's missing, not octal or more than
+  // nMax...
+  //--
+  char *pArg, *pEnd;  uint32_t nValue;
+  if (argv[*pi][3] == EOS) {
+    if (++*pi >= argc) return false;
+    pArg = argv[*pi];
+  } else
+    pArg = argv[*pi]+3;
+  nValue = (uint32_t) strtoul(pArg, &pEnd, 8);
+  if ((*pEnd != EOS) || (pEnd == pArg) || (nValue > nMax)) return false;
+  *pnValue = (uint16_t) nValue;
+  return true;
+}
+
 bool ParseOptions (int argc, char *argv[])
 {
   //++
@@ -3544,15 +3773,42 @@ bool ParseOptions (int argc, char *argv[])
   int i;  char *pArg, *pEnd;
   szSourceFile[0] = szListFile[0] = szBinaryFile[0] = EOS;
   nLinesPerPage = LINES_PER_PAGE;  nColumnsPerPage = COLUMNS_PER_PAGE;
-  fOS8SIXBIT = fASCII8BIT = false;
+  fOS8SIXBIT = fASCII8BIT = fNoListing = false;
+  szLowEPROM[0] = szHighEPROM[0] = EOS;
+  EPROMOptions.nROMOffset = 0;  EPROMOptions.nROMSize = PDP_MEM_SIZE;
+  EPROMOptions.nChecksumOffset = -1;
+  EPROMOptions.fReverse = EPROMOptions.fSBC6100 = false;
 
   for (i = 1;  i < argc;  ++i) {
     if (STREQL(argv[i], "-l")) {
-      if ((++i >= argc) || (strlen(szListFile) > 0)) return false;
+      if ((++i >= argc) || (strlen(szListFile) > 0) || fNoListing) return false;
       strcpy(szListFile, argv[i]);
+    } else if (STREQL(argv[i], "-n")) {
+      if (strlen(szListFile) > 0) return false;
+      fNoListing = true;
     } else if (STREQL(argv[i], "-b")) {
       if ((++i >= argc) || (strlen(szBinaryFile) > 0)) return false;
       strcpy(szBinaryFile, argv[i]);
+    } else if (STREQL(argv[i], "-el")) {
+      if ((++i >= argc) || (strlen(szLowEPROM) > 0)) return false;
+      strcpy(szLowEPROM, argv[i]);
+    } else if (STREQL(argv[i], "-eh")) {
+      if ((++i >= argc) || (strlen(szHighEPROM) > 0)) return false;
+      strcpy(szHighEPROM, argv[i]);
+    } else if (STRNEQL(argv[i], "-eo", 3)) {
+      if (!OctalOption(argc, argv, &i, PDP_MEM_SIZE-1, &EPROMOptions.nROMOffset)) return false;
+    } else if (STRNEQL(argv[i], "-es", 3)) {
+      if (!OctalOption(argc, argv, &i, PDP_MEM_SIZE, &EPROMOptions.nROMSize)) return false;
+      if (EPROMOptions.nROMSize == 0) return false;
+    } else if (STRNEQL(argv[i], "-ec", 3)) {
+      uint16_t nOffset;
+      if (!OctalOption(argc, argv, &i, MAX_CKSUM_OFFSET, &nOffset)) return false;
+      if (nOffset == 0) return false;
+      EPROMOptions.nChecksumOffset = (int16_t) nOffset;
+    } else if (STREQL(argv[i], "-er")) {
+      EPROMOptions.fReverse = true;
+    } else if (STREQL(argv[i], "-ep")) {
+      EPROMOptions.fSBC6100 = true;
     } else if (STREQL(argv[i], "-8")) {
       fOS8SIXBIT = true;
     } else if (STREQL(argv[i], "-a")) {
@@ -3580,6 +3836,10 @@ bool ParseOptions (int argc, char *argv[])
       strcpy(szSourceFile, argv[i]);
     }
   }
+  //   The EPROM files always come in pairs, and the ROM has to fit in the
+  // PDP-8 address space...
+  if ((strlen(szLowEPROM) > 0) != (strlen(szHighEPROM) > 0)) return false;
+  if ((uint32_t) EPROMOptions.nROMOffset + EPROMOptions.nROMSize > PDP_MEM_SIZE) return false;
   return strlen(szSourceFile) > 0;
 }
 
@@ -3705,10 +3965,14 @@ void OpenFiles (void)
 #endif
 
   //  The listing file defaults to the same name and path as the source
-  // file with the extension .LST...
-  DefaultFile(szListFile, szSourceFile, LIST_TYPE);
-  pListFile = fopen(szListFile, "w");
-  if (pListFile == NULL) FatalError("unable to write %s", szListFile);
+  // file with the extension .LST.  Listings are big and written a few
+  // characters at a time, so give it a nice big buffer...
+  if (!fNoListing) {
+    DefaultFile(szListFile, szSourceFile, LIST_TYPE);
+    pListFile = fopen(szListFile, "w");
+    if (pListFile == NULL) FatalError("unable to write %s", szListFile);
+    setvbuf(pListFile, NULL, _IOFBF, LISTBUFFER);
+  }
 
   // Ditto for the binary file, except with ".BIN".
   DefaultFile(szBinaryFile, szSourceFile, BINARY_TYPE);
@@ -3716,6 +3980,15 @@ void OpenFiles (void)
     _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
   if (fdBinaryFile == -1) FatalError("unable to write %s", szBinaryFile);
   cbBinaryData = 0;  PunchLeader();
+
+  //   The EPROM files go in the source directory too, but they have no default
+  // extension - WriteEPROMs() adds ".hex" if there isn't one.  The memory
+  // image is needed only if we're making them...
+  if (strlen(szLowEPROM) > 0) {
+    DefaultFile(szLowEPROM, szSourceFile, "");
+    DefaultFile(szHighEPROM, szSourceFile, "");
+    pwMemory = MyAlloc(PDP_MEM_SIZE * sizeof(uint16_t));
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -3730,35 +4003,56 @@ int main (int argc, char *argv[])
 
   // Parse the command line...
   if (!ParseOptions(argc, argv)) {
-    fprintf(stderr, "Usage:\t%s [-w nnn] [-p nnn] [-l file] [-b file] sourcefile\n", PALX);
+    fprintf(stderr, "Usage:\t%s [-w nnn] [-p nnn] [-l file | -n] [-b file] [-el file -eh file] sourcefile\n", PALX);
     fprintf(stderr, "\n");
     fprintf(stderr, "\t-b file - specify binary file name\n");
     fprintf(stderr, "\t-l file - specify listing file name\n");
+    fprintf(stderr, "\t-n      - don't make a listing file\n");
     fprintf(stderr, "\t-w nnn  - listing page width in columns\n");
     fprintf(stderr, "\t-p nn   - listing page length in lines\n");
     fprintf(stderr, "\t-8      - use OS/8 style for .SIXBIT/.SIXBIZ\n");
     fprintf(stderr, "\t-a      - use ASR33 \"always mark\" ASCII\n");
+    fprintf(stderr, "\t-el file - write the low  EPROM image (.hex or .bin)\n");
+    fprintf(stderr, "\t-eh file - write the high EPROM image (.hex or .bin)\n");
+    fprintf(stderr, "\t-eo nnnnn - PDP-8 address of the EPROM, in octal\n");
+    fprintf(stderr, "\t-es nnnnn - size of the EPROM, in PDP-8 words (octal)\n");
+    fprintf(stderr, "\t-ec nnnn - store an EPROM checksum at this address (1..7777)\n");
+    fprintf(stderr, "\t-er      - reverse the EPROM bit order\n");
+    fprintf(stderr, "\t-ep      - SBC6100 EPROM addressing\n");
     exit(EXIT_FAILURE);
   }
 
   // Initialize...
   Message("%s V%d.%02d RLA", TITLE, (VERSION / 100), (VERSION % 100));
   InitializeSymbols();  ClearBitMap();  pFirstTOC = pLastTOC = NULL;
-  OpenFiles();
+  OpenFiles();  LoadSource();
 
-  // Make the first pass and rewind the source file...
+  //   Make the first pass.  Whether the symbol table gets listed depends
+  // on SYM at the end of pass 2, and conditionals can make pass 2 take a
+  // different path through the source than pass 1 did, so collect the
+  // cross reference whenever there's a listing at all...
+  fCrossReference = !fNoListing;
   Pass(1);
-  if (fseek(pSourceFile, 0L, SEEK_SET) != 0)
-    FatalError("error rewinding source file");
 
   // Make the second pass and generate the binary and listing files.
   Pass(2);  PunchChecksum();
   ListSummary();
-  if (fListMap) ListBitMap();
-  if (fListSymbols) {SortSymbols();  ListSymbols();}
-  if (fListTOC) ListTOC();
+
+  //   If we're making EPROM images, checksum them (this doesn't change the
+  // BIN file!) and write them out now...
+  if (pwMemory != NULL) {
+    ChecksumEPROM(PALX, pwMemory, &EPROMOptions);
+    if (!WriteEPROMs(PALX, pwMemory, &EPROMOptions, szLowEPROM, szHighEPROM))
+      FatalError("unable to write the EPROM images");
+  }
+  if (!fNoListing) {
+    if (fListMap) ListBitMap();
+    if (fListSymbols) {SortSymbols();  ListSymbols();}
+    if (fListTOC) ListTOC();
+    fclose(pListFile);
+  }
 
   // Close all the files and we're done... */
-  fclose(pSourceFile);  fclose(pListFile);  _close(fdBinaryFile);
+  _close(fdBinaryFile);
   return EXIT_SUCCESS;
 }
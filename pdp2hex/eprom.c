@@ -0,0 +1,107 @@
+//++
+// eprom.c
+//
+//   Copyright (C) 2000 by Robert Armstrong.  All rights reserved.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   This module splits a PDP-8 memory image into the two EPROM images used
+// by the SBC6120.  The twelve bit PDP-8 words are split in half, with the
+// lower six bits going into one ROM and the upper six bits into the other.
+// It's used by PDP2HEX, which gets the memory image from a BIN file, and
+// by PALX, which writes the EPROM images straight from its own memory image
+// and doesn't need the BIN file at all.
+//
+// REVISION HISTORY:
+// 14-OCT-26    AGT     Split out of pdp2hex.c so that PALX can share it.
+// 14-OCT-26    AGT     Use the shared checksum routines in ../romlib.
+// 14-OCT-26    AGT     And the twelve bit word routines, for the EPROM split.
+//--
+#include <stdio.h>              // printf(), fprintf(), etc...
+#include <stdint.h>             // uint16_t, uint8_t, etc ...
+#include <stdbool.h>            // bool, true, false ...
+#include <stdlib.h>             // malloc(), free(), exit(), ...
+#include "checksum.h"           // ckSumWords(), etc ...
+#include "word12.h"             // w12SplitSixbit(), etc ...
+#include "pdp2hex.h"            // hex tools library declarations
+
+
+//++
+//   This routine will compute the checksum of the ROMs as a two's complement
+// twelve bit value.
+//--
+PUBLIC uint16_t CalculateChecksum (uint16_t *pwMemory, uint16_t nSize)
+{
+  return (uint16_t) ((-ckSumWords(pwMemory, nSize)) & 07777);
+}
+
+
+//++
+//   If the options ask for a checksum, then compute them and store them in
+// the memory image.  "Them", because each field is checksummed separately.
+// The PDP-8 program can then verify the ROM checksum simply by summing all
+// the words in the field and testing that the result is zero.
+//--
+PUBLIC void ChecksumEPROM (char *lpszProgram, uint16_t *pwMemory, EPROM_OPTIONS *pOptions)
+{
+  uint16_t wChecksum, wBase;
+  if (pOptions->nChecksumOffset == -1) return;
+  for (wBase = 0;  wBase < pOptions->nROMSize;  wBase += 4096) {
+    pwMemory[pOptions->nChecksumOffset+wBase] = 0;
+    wChecksum = CalculateChecksum(pwMemory+wBase, 4096);
+    pwMemory[pOptions->nChecksumOffset+wBase] = wChecksum;
+    fprintf(stderr,"%s: field %d checksum = %04o\n", lpszProgram, wBase/4096, wChecksum);
+  }
+}
+
+
+//++
+//   Split the PDP-8 memory image into two 8 bit ROM images and write them to
+// the low and high files (Intel .hex or raw .bin, depending on the extension).
+// At the same time, check to see if there are any words loaded which don't
+// fit into the ROM specified.  This is just a precaution to make sure the
+// user didn't accidentally generate some code that's outside the area
+// occupied by the ROM.  The memory image must be PDP_MEM_SIZE words, and
+// both file name buffers must have room for a ".hex" extension to be added.
+// Returns false if either file can't be written.
+//
+//   The bit reversal (-r) and the SBC6100 model 1 address permutation (-p)
+// are table lookups in w12SplitSixbit() ...
+//--
+PUBLIC bool WriteEPROMs (char *lpszProgram, uint16_t *pwMemory, EPROM_OPTIONS *pOptions, char *lpszLowFile, char *lpszHighFile)
+{
+  uint8_t *pbHigh, *pbLow;  uint16_t n;  bool fOK;
+  uint16_t nROMOffset = pOptions->nROMOffset, nROMSize = pOptions->nROMSize;
+
+  // Allocate memory for the two ROM images...
+  pbHigh = malloc(PDP_MEM_SIZE * sizeof(uint8_t));
+  pbLow  = malloc(PDP_MEM_SIZE * sizeof(uint8_t));
+  if ((pbHigh == NULL) || (pbLow == NULL)) {
+    fprintf(stderr, "%s: out of memory\n", lpszProgram);  exit(EXIT_FAILURE);
+  }
+
+  for (n = 0;  n < PDP_MEM_SIZE;  ++n) {
+    if (((n<nROMOffset) || (n>(nROMOffset+nROMSize-1))) && (pwMemory[n]!=0))
+      fprintf(stderr, "%s: address %05o is used and outside the ROM image\n", lpszProgram, n);
+  }
+  w12SplitSixbit(pwMemory, pbHigh, pbLow, PDP_MEM_SIZE, pOptions->fReverse, pOptions->fSBC6100);
+
+  // Write the output files, release the buffers and we're done!
+  fOK =    DumpHexOrBinary(lpszHighFile, pbHigh+nROMOffset, 0, nROMSize)
+        && DumpHexOrBinary(lpszLowFile,  pbLow +nROMOffset, 0, nROMSize);
+  free(pbHigh);  free(pbLow);
+  return fOK;
+}
@@ -37,9 +37,9 @@
 //
 //      -cnnnn specifies that PDP2HEX should compute a twelve bit checksum for
 //      the ROM image and store its two's complement at the ROM offset specified
-//      by nnnn.  The PDP-8 program can then verify the ROM checksum simply by
-//      summing all ROM words and testing that the result is zero.  If this
-//      option is omitted no checksum is computed.
+//      by nnnn (1 to 7777).  The PDP-8 program can then verify the ROM checksum
+//      simply by summing all ROM words and testing that the result is zero.  If
+//      this option is omitted no checksum is computed.
 //
 //      -r specifies that the bit order should be reversed - DX0 and DX6 become
 //      the LSBs of the two ROMs rather than the MSBs.
@@ -73,6 +73,9 @@
 //
 // REVISION HISTORY
 // 10-Feb-00    RLA             New file.
+// 14-Oct-26    AGT             Move the EPROM splitting and checksum code to
+//                              eprom.c, so PALX can share it.
+// 14-Oct-26    AGT             The -c limit is octal 7777, not decimal.
 //--
 #include <stdio.h>              // printf(), scanf(), etc...
 #include <stdlib.h>             // malloc(), free(), exit(), ...
@@ -90,14 +93,9 @@
 char szInputFile[PATH_MAX];     // name of the input (PDP-8 BIN) file
 char szHighFile [PATH_MAX];     // name of the high byte output file
 char szLowFile  [PATH_MAX];     //   "   "   " low   "     "     "
-uint16_t  nROMOffset;           // ROM address offset, if any
-uint16_t  nROMSize;             // maximum ROM address
-int16_t   nChecksumOffset;      // word to receive the checksum (-1 if none)
-bool      fReverse;             // TRUE to reverse the bit order, FALSE otherwise
-bool      fSBC6100;		// TRUE to prevert the bits for the SBC6100
+EPROM_OPTIONS Options;          // ROM offset, size, checksum and bit order
 bool      fVerilog;		// TRUE to output Verilog .mem files
 uint16_t *pwPDP;                // PDP-8 memory image
-uint8_t  *pbHigh, *pbLow;       // memory buffers for 8 bit ROM images
 
 
 //++
@@ -112,8 +110,8 @@ void ParseCommand (int argc, char *argv[])
 
   // First, set all the defaults...
   szInputFile[0] = szHighFile[0] = szLowFile[0] = '\0';
-  nROMOffset = 0;  nROMSize = PDP_MEM_SIZE;
-  nChecksumOffset = -1;  fReverse = fSBC6100 = fVerilog = false;
+  Options.nROMOffset = 0;  Options.nROMSize = PDP_MEM_SIZE;
+  Options.nChecksumOffset = -1;  Options.fReverse = Options.fSBC6100 = fVerilog = false;
   
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
@@ -143,15 +141,15 @@ void ParseCommand (int argc, char *argv[])
     
     // Handle the -s (size) option...
     if (strncmp(argv[nArg], "-s", 2) == 0) {
-      nROMSize = (uint16_t) strtoul(argv[nArg]+2, &psz, 8);
-      if ((*psz != '\0')  ||  (nROMSize == 0))
+      Options.nROMSize = (uint16_t) strtoul(argv[nArg]+2, &psz, 8);
+      if ((*psz != '\0')  ||  (Options.nROMSize == 0))
         FAIL1("PDP2HEX", "illegal size: \"%s\"", argv[nArg]);
       continue;
     }
     
     // Handle the -o (offset) option...
     if (strncmp(argv[nArg], "-o", 2) == 0) {
-      nROMOffset = (uint16_t) strtoul(argv[nArg]+2, &psz, 8);
+      Options.nROMOffset = (uint16_t) strtoul(argv[nArg]+2, &psz, 8);
       if (*psz != '\0')
         FAIL1("PDP2HEX", "illegal offset: \"%s\"", argv[nArg]);
       continue;
@@ -159,21 +157,21 @@ void ParseCommand (int argc, char *argv[])
     
     // Handle the -c (checksum) option...
     if (strncmp(argv[nArg], "-c", 2) == 0) {
-      nChecksumOffset = (int) strtoul(argv[nArg]+2, &psz, 8);
-      if ((*psz != '\0') || (nChecksumOffset == 0) || (nChecksumOffset > 7777))
+      Options.nChecksumOffset = (int) strtoul(argv[nArg]+2, &psz, 8);
+      if ((*psz != '\0') || (Options.nChecksumOffset == 0) || (Options.nChecksumOffset > MAX_CKSUM_OFFSET))
         FAIL1("PDP2HEX", "illegal offset: \"%s\"", argv[nArg]);
       continue;
     }
     
     // Handle the -r (reverse) option...
     if (strcmp(argv[nArg], "-r") == 0) {
-      fReverse = true;
+      Options.fReverse = true;
       continue;
     }
     
     // Handle the -p (pervert) option...
     if (strcmp(argv[nArg], "-p") == 0) {
-      fSBC6100 = true;
+      Options.fSBC6100 = true;
       continue;
     }
     
@@ -198,69 +196,6 @@ void ParseCommand (int argc, char *argv[])
 }
 
 
-//++
-//   This routine will reverse the order of the bits in a SIXBIT value.  We
-// need it because some unfortunate fool (me!) forgot that the PDP-8 reverses
-// its bit order!
-//--
-uint8_t Reverse (uint8_t x)
-{
-  if (fReverse) {
-    uint8_t b0 = (x   ) & 1;
-    uint8_t b1 = (x>>1) & 1;
-    uint8_t b2 = (x>>2) & 1;
-    uint8_t b3 = (x>>3) & 1;
-    uint8_t b4 = (x>>4) & 1;
-    uint8_t b5 = (x>>5) & 1;
-    return (b0<<5) | (b1<<4) | (b2<<3) | (b3<<2) | (b4<<1) | b5;
-  } else
-    return x;
-}
-
-//++
-//   This routine fixes the address bits for the SBC6100 model 1.  It's
-// here for the same reason we have the Reverse() routine!
-//--
-uint16_t FixSBC6100Address (uint16_t x)
-{
-  if (fSBC6100) {
-    uint16_t b0 = (x   )  & 1;
-    uint16_t b1 = (x>>1)  & 1;
-    uint16_t b2 = (x>>2)  & 1;
-    uint16_t b3 = (x>>3)  & 1;
-    uint16_t b4 = (x>>4)  & 1;
-    uint16_t b5 = (x>>5)  & 1;
-    uint16_t b6 = (x>>6)  & 1;
-    uint16_t b7 = (x>>7)  & 1;
-    uint16_t b8 = (x>>8)  & 1;
-    uint16_t b9 = (x>>9)  & 1;
-    uint16_t b10= (x>>10) & 1;
-    uint16_t b11= (x>>11) & 1;
-    uint16_t b12= (x>>12) & 1;
-    uint16_t b13= (x>>13) & 1;
-    uint16_t b14= (x>>14) & 1;
-    uint16_t w =  (b0 <<14) | (b1 <<13) | (b2 <<12) | (b3 <<11) | (b4 <<10)
-                | (b5 << 9) | (b6 << 8) | (b7 << 7) | (b8 << 6) | (b9 << 5)
-                | (b10<< 4) | (b11<< 3) | (b12<< 2) | (b13<< 1) |  b14;
-    fprintf(stderr,"FixSBC6100Address() x=0x%04X w=0x%04X\n", x, w);
-    return w;
-  } else
-    return x;
-}
-
-
-//++
-//   This routine will compute the checksum of the ROMs as a two's complement
-// twelve bit value.
-//--
-uint16_t CalculateChecksum (uint16_t *pwMemory, uint16_t nSize)
-{
-  int nChecksum = 0;  uint16_t i;
-  for (i = 0;  i < nSize;  ++i)  nChecksum += pwMemory[i];
-  return (uint16_t) ((-nChecksum) & 07777);
-}
-
-
 //++
 //   Write a Verilog .mem file for the entire twelve bit word.  Verilog wants
 // one line for every word of the simulated memory, and one hex value per line.
@@ -316,16 +251,12 @@ void WriteTwoMemFiles (char *lpszLowFile, char *lpszHighFile, uint16_t *pwMemory
 //--
 int main (int argc, char *argv[])
 {
-  uint16_t n;
-  
   // Parse the command line...
   ParseCommand(argc, argv);
   
-  // Allocate memory for the three buffers used...
+  // Allocate memory for the PDP-8 memory image...
   pwPDP  = malloc(PDP_MEM_SIZE * sizeof(uint16_t));
-  pbHigh = malloc(PDP_MEM_SIZE * sizeof(uint8_t));
-  pbLow  = malloc(PDP_MEM_SIZE * sizeof(uint8_t));
-  if ((pwPDP == NULL) || (pbHigh == NULL) || (pbLow == NULL))
+  if (pwPDP == NULL)
     FAIL("PDP2HEX", "out of memory");
 
   // Load the input file...
@@ -334,44 +265,24 @@ int main (int argc, char *argv[])
   
   //   If we want a checksum, then compute them now.  "Them", because each
   // field is checksummed separately.
-  if (nChecksumOffset != -1) {
-    uint16_t wChecksum, wBase;
-    for (wBase = 0;  wBase < nROMSize;  wBase += 4096) {
-      pwPDP[nChecksumOffset+wBase] = 0;
-      wChecksum = CalculateChecksum(pwPDP+wBase, 4096);
-      pwPDP[nChecksumOffset+wBase] = wChecksum;
-      fprintf(stderr,"PDP2HEX: field %d checksum = %04o\n", wBase/4096, wChecksum);
-    }
-  }
+  ChecksumEPROM("PDP2HEX", pwPDP, &Options);
   
   // If the "-m" option was given, write either 1 or 2 Verilog .mem files...
   if (fVerilog) {
     if (strlen(szHighFile) == 0) {
       SetFileType(szLowFile, ".mem");
-      WriteOneMemFile(szLowFile, pwPDP, nROMSize);
+      WriteOneMemFile(szLowFile, pwPDP, Options.nROMSize);
     } else {
       SetFileType(szLowFile, ".mem");
       SetFileType(szHighFile, ".mem");
-      WriteTwoMemFiles(szLowFile, szHighFile, pwPDP, nROMSize);
+      WriteTwoMemFiles(szLowFile, szHighFile, pwPDP, Options.nROMSize);
     }
     return EXIT_SUCCESS;
   }
 
-  //   Split the PDP-8 memory image into two 8 bit ROM images and, at the same
-  // time, check to see if there are any words loaded which don't fit into the
-  // ROM specified.  This is just a precaution to make sure the user didn't
-  // accidentally generate some code in his PDP-8 BIN file that's outside the
-  // area occupied by the ROM.
-  for (n = 0;  n < PDP_MEM_SIZE;  ++n) {
-    if (((n<nROMOffset) || (n>(nROMOffset+nROMSize-1))) && (pwPDP[n]!=0))
-      fprintf(stderr, "PDP2HEX: address %05o is used and outside the ROM image\n", n);
-    pbHigh[FixSBC6100Address(n)] = Reverse((uint8_t) ((pwPDP[n] >> 6) & 077));
-    pbLow[FixSBC6100Address(n)]  = Reverse((uint8_t) (pwPDP[n] & 077));
-   }
-
-  // Write the output files, release the buffers and we're done!  
-  if (!DumpHexOrBinary(szHighFile, pbHigh+nROMOffset, 0, nROMSize)) return EXIT_FAILURE;
-  if (!DumpHexOrBinary(szLowFile,  pbLow +nROMOffset, 0, nROMSize)) return EXIT_FAILURE;
-  free(pwPDP);  free(pbHigh);  free(pbLow);
+  //   Split the PDP-8 memory image into two 8 bit ROM images and write them
+  // out.  Release the buffer and we're done!
+  if (!WriteEPROMs("PDP2HEX", pwPDP, &Options, szLowFile, szHighFile)) return EXIT_FAILURE;
+  free(pwPDP);
   return EXIT_SUCCESS;
 }
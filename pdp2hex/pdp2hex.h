@@ -22,6 +22,7 @@
 
 // Compilation parameters...
 #define PDP_MEM_SIZE 32768      // maximum size of PDP-8 memory, ever!
+#define MAX_CKSUM_OFFSET 07777  // largest legal checksum offset (-c and -ec)
 
 // Handy macros for assembling larger values from small ones...
 #define HIBYTE(x)  ((uint8_t) (((x) >> 8) & 0xFF))
@@ -43,6 +44,15 @@
 #define PRIVATE static
 #define PUBLIC
 
+// How a PDP-8 memory image is split into a pair of EPROMs (see eprom.c)...
+typedef struct _EPROM_OPTIONS {
+  uint16_t nROMOffset;          // PDP-8 address of the first ROM word
+  uint16_t nROMSize;            // size of the ROMs, in words
+  int16_t  nChecksumOffset;     // word to receive the checksum (-1 if none)
+  bool     fReverse;            // true to reverse the bit order
+  bool     fSBC6100;            // true to permute addresses for the SBC6100
+} EPROM_OPTIONS;
+
 // External functions prototypes...
 extern bool LoadPDP (char *lpszFileName, uint16_t *pwMemory, uint16_t cwMemory);
 extern uint32_t LoadBinary (char *lpszFileName, uint8_t *pbMemory, uint32_t lSize);
@@ -52,5 +62,8 @@ extern bool DumpHex (char *lpszFileName, uint8_t *pbMemory, uint32_t lOffset, ui
 extern void SetFileType (char *lpszName, char *lpszType);
 extern uint32_t LoadHexOrBinary (char *lpszName, uint8_t *pbMemory, uint32_t lOffset, uint32_t lSize);
 extern bool DumpHexOrBinary (char *lpszName, uint8_t *pbMemory, uint32_t lOffset, uint32_t lSize);
+extern uint16_t CalculateChecksum (uint16_t *pwMemory, uint16_t nSize);
+extern void ChecksumEPROM (char *lpszProgram, uint16_t *pwMemory, EPROM_OPTIONS *pOptions);
+extern bool WriteEPROMs (char *lpszProgram, uint16_t *pwMemory, EPROM_OPTIONS *pOptions, char *lpszLowFile, char *lpszHighFile);
 
 #endif  // ifndef _PDP2HEX_H_
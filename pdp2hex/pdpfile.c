@@ -25,6 +25,7 @@
 //                                                                      
 // REVISION HISTORY:
 // 02-JAN-00    RLA     Stolen from the Eight project...
+// 14-OCT-26    AGT     The load address wraps around within the current field.
 //--                                                                    
 
 #include <stdio.h>              // printf(), fprintf(), etc...
@@ -152,8 +153,11 @@ PRIVATE int LoadPDPSegment (uint16_t *pwMemory, uint16_t cwMemory)
           fprintf(stderr, "address %06o exceeds memory", nAddress);
           return -1;
         } else {
-          // This is, as they say, the good stuff... 
-          pwMemory[nAddress] = wFrame;  ++nAddress;  ++nCount;
+          //   This is, as they say, the good stuff...  Note that the address
+          // wraps around from 7777 to 0000 in the same field, just like the
+          // real BIN loader.
+          pwMemory[nAddress] = wFrame;  ++nCount;
+          nAddress = (nAddress & 070000) | ((nAddress+1) & 07777);
         }
         wFrame = wNextFrame;
         // Don't read the next frame this time - we already did that! 
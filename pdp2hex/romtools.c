@@ -19,6 +19,8 @@
 //
 // REVISION HISTORY:
 // 02-JAN-00    RLA     Stolen from the ROMCKSUM project...
+// 14-OCT-26    AGT     LoadHex() uses the shared reader in ../romlib.
+// 14-OCT-26    AGT     And DumpHex() uses the shared writer.
 //--
 #include <stdio.h>      	// printf(), fprintf(), etc...
 #include <stdint.h>		// uint16_t, uint8_t, etc ...
@@ -39,6 +41,7 @@
 #else
 #include <io.h>                 // _read(), _open(), et al...
 #endif
+#include "intelhex.h"           // hexRead(), hexWrite(), etc ...
 #include "pdp2hex.h"
 
 
@@ -75,6 +78,36 @@ PUBLIC void SetFileType (char *lpszName, char *lpszType)
 }
 
 
+//++
+//LoadHexData
+//
+//   This is the hexRead() callback for LoadHex().  It stores one data record
+// in the memory image, or prints an error message and returns false if the
+// record doesn't fit.
+//--
+typedef struct _LOADHEX {
+  uint8_t *pbMemory;            // memory image to receive the data
+  uint32_t cbOffset;            // offset to be applied to addresses
+  uint32_t cbMemory;            // maximum size of the memory image
+  uint32_t cbTotal;             // number of bytes loaded from file
+} LOADHEX;
+
+PRIVATE bool LoadHexData (void *pContext, const HEX_RECORD *pRecord)
+{
+  LOADHEX *pLoad = (LOADHEX *) pContext;
+  uint32_t nAddress = pRecord->lAddress + pLoad->cbOffset;
+  uint32_t cbFit = ((nAddress < pLoad->cbOffset) || (nAddress >= pLoad->cbMemory)) ? 0
+                 : MIN(pRecord->cbData, pLoad->cbMemory - nAddress);
+  if (cbFit < pRecord->cbData) {
+    fprintf(stderr, "%s: address (0x%04X) out of range in line %d\n", pRecord->pszFile, pRecord->lAddress+cbFit, pRecord->nLine);
+    return false;
+  }
+  memcpy(pLoad->pbMemory+nAddress, pRecord->pbData, pRecord->cbData);
+  pLoad->cbTotal += pRecord->cbData;
+  return true;
+}
+
+
 //++
 //LoadHex
 //
@@ -82,7 +115,8 @@ PUBLIC void SetFileType (char *lpszName, char *lpszType)
 // It returns the number of bytes actually read from the file (which may not
 // be the same as the ROM size since, unlike a binary file, the bytes don't
 // have to be contiguous), or -1 if any error occurs.  In the latter case,
-// an error message is also printed.
+// an error message is also printed.  The file is parsed by hexRead() in
+// ../romlib, so extended address records are allowed.
 //--
 PUBLIC uint32_t LoadHex (
   char    *lpszFile,            // name of the file to read
@@ -90,68 +124,37 @@ PUBLIC uint32_t LoadHex (
   uint32_t cbOffset,            // offset to be applied to addresses
   uint32_t cbMemory)            // maximum size of the memory image
 {
-  FILE     *fpHex;              // handle of the file we're reading
-  uint32_t  cbTotal;            // number of bytes loaded from file
-  int       cbRecord;           // length       of the current .HEX record
-  int       nRecAddr;           // load address "   "     "      "     "
-  int       nType;              // type         "   "     "      "     "
-  int       nChecksum;    	// checksum     "   "     "      "     "
-  int       b;                  // temporary for the data byte read...
-  uint16_t  nLine;              // current line number (for error messages)
-  
-  // Open the hex file and, if we can't, then we can go home early...
-  if ((fpHex=fopen(lpszFile, "rt")) == NULL) {
-    fprintf(stderr, "%s: unable to read file\n", lpszFile);
-    return -1;
-  }
-  
-  for (cbTotal = 0, nLine = 1;  nType != 1;  ++nLine) {
-    // Read the record header - length, load address and record type...
-    if (fscanf(fpHex, ":%2x%4x%2x", &cbRecord, &nRecAddr, &nType) != 3) {
-      fprintf(stderr, "%s: format error (1) in line %d\n", lpszFile, nLine);
-      fclose(fpHex);  return -1;
-    }
-
-    // The only allowed record types (now) are 1 (EOF) and 0 (DATA)...
-    if (nType > 1) {
-      fprintf(stderr, "%s: unknown record type (0x%02X) in line %d\n", lpszFile, nType, nLine);
-      fclose(fpHex);  return -1;
-    }
-    
-    // Begin accumulating the checksum, which includes all these bytes...
-    nChecksum = cbRecord + HIBYTE(nRecAddr) + LOBYTE(nRecAddr) + nType;
-
-    // Read the data part of this record and load it into memory...
-    for (; cbRecord > 0;  --cbRecord, ++nRecAddr, ++cbTotal) {
-      if (fscanf(fpHex, "%2x", &b) != 1) {
-        fprintf(stderr, "%s: format error (2) in line %d\n", lpszFile, nLine);
-        fclose(fpHex);  return -1;
-      }
-      if ((nRecAddr+cbOffset < 0) || (nRecAddr+cbOffset >= cbMemory)) {
-        fprintf(stderr, "%s: address (0x%04X) out of range in line %d\n", lpszFile, nRecAddr, nLine);
-        fclose(fpHex);  return -1;
-      }
-      pbMemory[nRecAddr+cbOffset] = b;  nChecksum += b;
-    }
-
-    //   Finally, read the checksum at the end of the record.  That byte,
-    // plus what we've recorded so far, should add up to zero if everything's
-    // kosher.
-    if (fscanf(fpHex, "%2x\n", &b) != 1) {
-      fprintf(stderr, "%s: format error (3) in line %d\n", lpszFile, nLine);
-      fclose(fpHex);  return -1;
-    }
-    nChecksum = (nChecksum + b) & 0xFF;
-    if (nChecksum != 0) {
-      fprintf(stderr, "%s: checksum error (0x%02X) in line %d\n",  lpszFile, nChecksum, nLine);
-      fclose(fpHex);  return -1;
-    }
+  LOADHEX    Load = {pbMemory, cbOffset, cbMemory, 0};
+  HEX_RECORD Record;            // where the error is, if there is one
+
+  switch (hexRead(lpszFile, LoadHexData, &Load, &Record)) {
+    case HEX_OK:
+      break;
+    case HEX_OPEN_ERROR:
+      fprintf(stderr, "%s: unable to read file\n", lpszFile);
+      return -1;
+    case HEX_FORMAT_HEADER:
+      fprintf(stderr, "%s: format error (1) in line %d\n", lpszFile, Record.nLine);
+      return -1;
+    case HEX_FORMAT_DATA:
+      fprintf(stderr, "%s: format error (2) in line %d\n", lpszFile, Record.nLine);
+      return -1;
+    case HEX_FORMAT_CHECKSUM:
+      fprintf(stderr, "%s: format error (3) in line %d\n", lpszFile, Record.nLine);
+      return -1;
+    case HEX_UNKNOWN_TYPE:
+      fprintf(stderr, "%s: unknown record type (0x%02X) in line %d\n", lpszFile, Record.nType, Record.nLine);
+      return -1;
+    case HEX_CHECKSUM_ERROR:
+      fprintf(stderr, "%s: checksum error (0x%02X) in line %d\n",  lpszFile, Record.bChecksum, Record.nLine);
+      return -1;
+    case HEX_STOPPED:
+      return -1;
   }
 
   // Everything was fine...
-  fprintf(stderr, "%s: %d bytes loaded\n", lpszFile, cbTotal);
-  fclose(fpHex);
-  return cbTotal;
+  fprintf(stderr, "%s: %d bytes loaded\n", lpszFile, Load.cbTotal);
+  return Load.cbTotal;
 }
 
 
@@ -159,9 +162,9 @@ PUBLIC uint32_t LoadHex (
 //DumpHex
 //
 //   This procedure writes a memory dump in standard Intel HEX file format.
-// It's the logical inverse of LoadHex() and, like that routine, it's limited
-// to 64K maximum.  It returns FALSE if there's any kind of error while writing
-// the file.
+// It's the logical inverse of LoadHex(), and like that routine it uses
+// extended addresses for anything over 64K.  It returns FALSE if there's any
+// kind of error while writing the file.
 //--
 PUBLIC bool DumpHex (
   char    *lpszFile,     // name of the file to read
@@ -169,12 +172,9 @@ PUBLIC bool DumpHex (
   uint32_t cbOffset,     // offset to be applied to addresses
   uint32_t cbMemory)     // maximum size of the memory image
 {
+  static const HEX_OPTIONS Options = {0, false, 0, true};
   FILE    *fpHex;        // handle of the file we're reading
-  int      cbRecord;     // length       of the current .HEX record
-  uint16_t nRecAddr;     // load address "   "     "      "     "
-  int      nChecksum;    // checksum     "   "     "      "     "
-  uint32_t nMemAddr;     // current memory address
-  int      i;            // temporary...
+  bool     fOK;          // true if the file was written successfully
 
   // Open the output file for writing...
   if ((fpHex=fopen(lpszFile, "wt")) == NULL) {
@@ -182,35 +182,14 @@ PUBLIC bool DumpHex (
     return false;
   }
 
-  // Dump all of memory...
-  for (nMemAddr = 0;  nMemAddr < cbMemory;  nMemAddr += cbRecord) {
-
-    // Figure out the record size and address for that record.  
-    nRecAddr = (uint16_t) (nMemAddr + cbOffset);
-    cbRecord = 16;
-    if ((uint32_t) cbRecord > (cbMemory-nMemAddr))  cbRecord = (int) (cbMemory-nMemAddr);
-
-    // Write the record header (for a type 0 record)...
-    fprintf(fpHex, ":%02X%04X00", cbRecord, nRecAddr); 
-    
-    // Start the checksum calculation...
-    nChecksum = cbRecord + HIBYTE(nRecAddr) + LOBYTE(nRecAddr) + 00 /*nType*/;
-
-    // And dump all the data bytes in this record.
-    for (i = 0;  i < cbRecord;  ++i) {
-      fprintf(fpHex, "%02X", pbMemory[nMemAddr+i]);
-      nChecksum += pbMemory[nMemAddr+i];
-    }
-
-    // Write out the checksum byte and finish off this record.
-    fprintf(fpHex,"%02X\n", (-nChecksum) & 0xFF);
+  // Dump all of memory, and the EOF record too ...
+  fOK = hexWrite(fpHex, pbMemory, cbMemory, 1, cbOffset, &Options);
+  if (fclose(fpHex) != 0) fOK = false;
+  if (!fOK) {
+    fprintf(stderr, "%s: unable to write file\n", lpszFile);
+    return false;
   }
-
-  //   Don't forget to write an EOF record, which is easy in our case, since it
-  // doesn't contain any variable data.
-  fprintf(fpHex, ":00000001FF\n");
   fprintf(stderr,"%s: %d bytes written\n", lpszFile, cbMemory);
-  fclose(fpHex);
   return true;
 }
 
@@ -0,0 +1,584 @@
+//++
+//rombuild - build a complete EPROM image from a manifest
+//
+// Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, visit the website of the Free
+// Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   The Elf2000 and SBC1802 EPROMs are built by running romtext on the help
+// text, then rommerge on that and all the TASM outputs, then romcksum on the
+// result.  Each step writes a .HEX file only for the next step to read it
+// back in again.  This program does the whole job in one go, on one memory
+// image, from a manifest file that lists the inputs, the checksums and the
+// output files.  The text, merge and checksum rules are the same ones used
+// by romtext, rommerge and romcksum (and the text reader and the checksum
+// arithmetic are the very same code, in ../romlib).
+//
+//   The manifest is a plain text file with one statement per line.  Blank
+// lines are ignored, and so is anything after a "#".  Numbers may be decimal
+// or, with a leading "0x", hex and either one may end with "k".  File names
+// are relative to the current directory, not the manifest.
+//
+//	size nnnn	  - set the ROM size in bytes (default 64k)
+//	base nnnn	  - set the address of the first ROM byte, like the
+//			    rommerge -o option (default 0)
+//	fill nn		  - set the filler for unused locations (default 0xFF)
+//	hex file [nnnn]	  - load an Intel .HEX file, optionally adding nnnn to
+//			    all the addresses in it
+//	text file nnnn	  - load a help text file at address nnnn, as romtext
+//			    would
+//	order little|big  - set the byte order for checksums (default big)
+//	checksum	  - the traditional romcksum checksum of the whole ROM,
+//			    stored in the last four bytes
+//	checksum type start size offset
+//			  - checksum a region, just like the romcksum -x option
+//			    (type is sum, crc16 or crc32)
+//	records nn	  - write nn data bytes per output record (default 16)
+//	sparse		  - don't write unused (filler) bytes to the outputs
+//	output file [nnnn]- write the whole ROM, starting at address nnnn
+//			    (default 0)
+//	split nnnn file file ...
+//			  - write the ROM in pieces of nnnn bytes, one to each
+//			    file, each starting at address 0
+//	interleave file file ...
+//			  - write every second (third, ...) byte to each file
+//			    for EPROMs on a sixteen (24, ...) bit bus, each
+//			    starting at address 0
+//
+//   All the inputs are loaded first, in the order given, and it's an error
+// for any byte to be loaded twice (even by the same file).  Then all the
+// checksums are done, in order, and finally all the output files are written.
+//
+// USAGE:
+//  rombuild [-v] manifest-file
+//
+//	-v - verbose output
+//
+// REVISION HISTORY
+// 14-Oct-26	AGT	New file...
+//--
+#include <stdio.h>		// printf(), scanf(), et al.
+#include <stdlib.h>		// exit(), ...
+#include <stdint.h>             // uint8_t, uint32_t, etc ...
+#include <string.h>		// strlen(), strtok(), etc ...
+#include <stdbool.h>		// bool, true, false, etc ...
+#include "intelhex.h"		// hexRead(), hexPrintError(), etc ...
+#include "checksum.h"		// ckRegion(), CK_REGION, etc ...
+#include "textfile.h"		// txtRead() ...
+
+// Useful definitions....
+#define MAXROM     (16L*1024L*1024L)// the biggest image we can accomodate (16Mb)
+#define MAXLINE    512		// longest manifest line allowed
+#define MAXINPUT   255		// most hex and text files allowed
+#define MAXREGION  16		// most checksum statements allowed
+#define MAXOUTPUT  16		// most output statements allowed
+#define MAXSPLIT   16		// most files for one split or interleave
+
+// Input files from the hex and text statements ...
+typedef struct {
+  bool      fText;		// true for a text file, false for .HEX
+  char     *pszName;		// name of the file
+  uint32_t  lAddress;		// text address or .HEX file offset
+  uint32_t  lCount;		// number of bytes loaded from the file
+  uint32_t  lBad;		// address outside the ROM, if any
+} ROMINPUT;
+
+// Output files from the output, split and interleave statements ...
+typedef enum {OUT_IMAGE, OUT_SPLIT, OUT_INTERLEAVE} OUTTYPE;
+typedef struct {
+  OUTTYPE   nType;		// kind of output
+  uint32_t  lValue;		// address (OUT_IMAGE) or size (OUT_SPLIT)
+  unsigned  nFiles;		// number of files
+  char     *apszFiles[MAXSPLIT];// and their names
+} ROMOUTPUT;
+
+// Globals...
+uint32_t  lROMSize;		// size of the ROM, in bytes (e.g. 65536)
+uint32_t  lROMBase;		// address of the first byte in the ROM
+uint8_t   bFillByte;		// filler value for unused ROM locations
+bool      fLittleEndian;	// store checksums in little endian format
+bool      fVerbose;		// true for verbose output
+HEX_OPTIONS HexOptions;		// output record size, skip filler, etc
+char     *pszManifest;		// name of the manifest file
+unsigned  nLine;		// current line number in the manifest
+ROMINPUT  aInputs[MAXINPUT];	// hex and text files to be loaded
+unsigned  nInputs;		// number of input files
+CK_REGION aRegions[MAXREGION];	// regions to checksum (from ../romlib)
+unsigned  nRegions;		// number of regions used
+ROMOUTPUT aOutputs[MAXOUTPUT];	// output files to write
+unsigned  nOutputs;		// number of output statements
+uint8_t  *pbData;		// the ROM image
+uint8_t  *pbOwner;		// input (1..n) that loaded each byte, or 0
+
+// Conflicts are collected into ranges before they're reported ...
+unsigned  nConflictFirst;	// input that loaded the range first
+uint32_t  lConflictStart;	// first byte of the range
+uint32_t  lConflictEnd;		// and the last byte
+uint32_t  lConflicts;		// total number of conflicting bytes
+
+
+
+//++
+//   Report an error in the manifest, along with the line number, and quit.
+// pszArg, if it's not NULL, is the thing that was wrong...
+//--
+void ManifestError (const char *pszMessage, const char *pszArg)
+{
+  if (pszArg != NULL)
+    fprintf(stderr,"%s: line %u: %s \"%s\"\n", pszManifest, nLine, pszMessage, pszArg);
+  else
+    fprintf(stderr,"%s: line %u: %s\n", pszManifest, nLine, pszMessage);
+  exit(EXIT_FAILURE);
+}
+
+
+//++
+//   Parse a number - decimal or, with a leading "0x", hex.  Either one may
+// end with "k" for kilobytes.  Unlike the one in romcksum, the whole string
+// must be a number or it's an error in the manifest...
+//--
+uint32_t ParseNumber (const char *pszArg)
+{
+  const char *psz = pszArg;  char *pszEnd;  int nBase = 10;  uint32_t lValue;
+  if (psz == NULL) ManifestError("number missing", NULL);
+  if ((psz[0] == '0') && ((psz[1] == 'x') || (psz[1] == 'X')))  psz += 2, nBase = 16;
+  lValue = (uint32_t) strtoul(psz, &pszEnd, nBase);
+  if (pszEnd == psz) ManifestError("invalid number", pszArg);
+  if ((*pszEnd == 'k') || (*pszEnd == 'K'))  lValue <<= 10, ++pszEnd;
+  if (*pszEnd != '\0') ManifestError("invalid number", pszArg);
+  return lValue;
+}
+
+
+//++
+//   Return the next word on the current manifest line, or NULL if there
+// are no more.  If fRequired is true then it's an error if there isn't one.
+// File names have to be saved, since the line buffer gets reused...
+//--
+char *NextWord (bool fRequired)
+{
+  char *psz = strtok(NULL, " \t\r\n");
+  if ((psz == NULL) && fRequired) ManifestError("missing argument", NULL);
+  return psz;
+}
+
+char *SaveName (char *pszName)
+{
+  char *psz = malloc(strlen(pszName)+1);
+  if (psz == NULL) {
+    fprintf(stderr,"rombuild: failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  return strcpy(psz, pszName);
+}
+
+
+//++
+//   Parse one line of the manifest.  Comments have already been removed, and
+// there's at least one word on the line.  Any errors just print a message and
+// exit - there is no error return from this function!
+//--
+void ParseStatement (char *pszLine)
+{
+  char *pszKey = strtok(pszLine, " \t\r\n");  char *psz;
+  if (pszKey == NULL) return;
+
+  if (strcmp(pszKey, "size") == 0) {
+    lROMSize = ParseNumber(NextWord(true));
+    if ((lROMSize == 0) || (lROMSize > MAXROM)) ManifestError("invalid ROM size", NULL);
+
+  } else if (strcmp(pszKey, "base") == 0) {
+    lROMBase = ParseNumber(NextWord(true));
+
+  } else if (strcmp(pszKey, "fill") == 0) {
+    uint32_t lFill = ParseNumber(NextWord(true));
+    if (lFill > 0xFF) ManifestError("invalid fill byte", NULL);
+    bFillByte = (uint8_t) lFill;
+
+  } else if ((strcmp(pszKey, "hex") == 0) || (strcmp(pszKey, "text") == 0)) {
+    ROMINPUT *pInput = &aInputs[nInputs];
+    if (nInputs >= MAXINPUT) ManifestError("too many input files", NULL);
+    pInput->fText = strcmp(pszKey, "text") == 0;
+    pInput->pszName = SaveName(NextWord(true));
+    psz = NextWord(pInput->fText);
+    pInput->lAddress = (psz != NULL) ? ParseNumber(psz) : 0;
+    ++nInputs;
+
+  } else if (strcmp(pszKey, "order") == 0) {
+    psz = NextWord(true);
+    if (strcmp(psz, "little") == 0)
+      fLittleEndian = true;
+    else if (strcmp(psz, "big") == 0)
+      fLittleEndian = false;
+    else
+      ManifestError("byte order must be little or big -", psz);
+
+  } else if (strcmp(pszKey, "checksum") == 0) {
+    CK_REGION *pRegion = &aRegions[nRegions];
+    if (nRegions >= MAXREGION) ManifestError("too many checksums", NULL);
+    if ((psz = NextWord(false)) == NULL) {
+      // The traditional checksum - filled in later, when we know the size ...
+      pRegion->nType = CK_SUM;  pRegion->lSize = 0;
+    } else {
+      if (!ckTypeFromName(psz, strlen(psz), &pRegion->nType))
+        ManifestError("unknown checksum type", psz);
+      pRegion->lStart  = ParseNumber(NextWord(true));
+      pRegion->lSize   = ParseNumber(NextWord(true));
+      pRegion->lOffset = ParseNumber(NextWord(true));
+      if (pRegion->lSize == 0) ManifestError("checksum region is empty", NULL);
+    }
+    ++nRegions;
+
+  } else if (strcmp(pszKey, "records") == 0) {
+    uint32_t cbRecord = ParseNumber(NextWord(true));
+    if ((cbRecord == 0) || (cbRecord > 255)) ManifestError("invalid record size", NULL);
+    HexOptions.cbRecord = (uint8_t) cbRecord;
+
+  } else if (strcmp(pszKey, "sparse") == 0) {
+    HexOptions.fSkipFill = true;
+
+  } else if (   (strcmp(pszKey, "output") == 0) || (strcmp(pszKey, "split") == 0)
+             || (strcmp(pszKey, "interleave") == 0)) {
+    ROMOUTPUT *pOutput = &aOutputs[nOutputs];
+    if (nOutputs >= MAXOUTPUT) ManifestError("too many outputs", NULL);
+    if (strcmp(pszKey, "output") == 0) {
+      pOutput->nType = OUT_IMAGE;
+      pOutput->apszFiles[pOutput->nFiles++] = SaveName(NextWord(true));
+      psz = NextWord(false);
+      pOutput->lValue = (psz != NULL) ? ParseNumber(psz) : 0;
+    } else {
+      if (strcmp(pszKey, "split") == 0) {
+        pOutput->nType = OUT_SPLIT;
+        pOutput->lValue = ParseNumber(NextWord(true));
+        if (pOutput->lValue == 0) ManifestError("invalid split size", NULL);
+      } else
+        pOutput->nType = OUT_INTERLEAVE;
+      while ((psz = NextWord(pOutput->nFiles == 0)) != NULL) {
+        if (pOutput->nFiles >= MAXSPLIT) ManifestError("too many files", psz);
+        pOutput->apszFiles[pOutput->nFiles++] = SaveName(psz);
+      }
+    }
+    ++nOutputs;
+
+  } else
+    ManifestError("unknown statement", pszKey);
+
+  // There shouldn't be anything left over ...
+  if ((psz = NextWord(false)) != NULL) ManifestError("extra argument", psz);
+}
+
+
+//++
+//   Read the manifest file and parse every statement in it.  When we're
+// done, fill in any defaults that depend on the ROM size and make sure that
+// there's something to do...
+//--
+void ReadManifest (void)
+{
+  FILE *f;  char szLine[MAXLINE], *psz;  unsigned i;
+
+  if ((f = fopen(pszManifest, "r")) == NULL) {
+    fprintf(stderr,"%s: unable to open file\n", pszManifest);
+    exit(EXIT_FAILURE);
+  }
+  for (nLine = 1;  fgets(szLine, MAXLINE, f) != NULL;  ++nLine) {
+    if ((psz = strchr(szLine, '#')) != NULL) *psz = '\0';
+    ParseStatement(szLine);
+  }
+  fclose(f);
+
+  if (nInputs == 0) ManifestError("no input files", NULL);
+  if (nOutputs == 0) ManifestError("no output files", NULL);
+  for (i = 0;  i < nRegions;  ++i) {
+    if (aRegions[i].lSize != 0) continue;
+    aRegions[i].lStart = 0;  aRegions[i].lSize = lROMSize;
+    aRegions[i].lOffset = lROMSize-4;
+  }
+  for (i = 0;  i < nOutputs;  ++i) {
+    ROMOUTPUT *pOutput = &aOutputs[i];
+    if ((pOutput->nType == OUT_SPLIT) && (((uint64_t) pOutput->lValue*pOutput->nFiles) > lROMSize)) {
+      fprintf(stderr,"%s: split of %u bytes doesn't fit in the ROM\n", pOutput->apszFiles[0], pOutput->lValue);
+      exit(EXIT_FAILURE);
+    }
+    if ((pOutput->nType == OUT_INTERLEAVE) && ((lROMSize % pOutput->nFiles) != 0)) {
+      fprintf(stderr,"%s: ROM size isn't a multiple of %u\n", pOutput->apszFiles[0], pOutput->nFiles);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+
+//++
+//   Report the current range of conflicting bytes, if there is one.  These
+// are the same messages rommerge uses...
+//--
+void ReportConflict (unsigned nInput)
+{
+  uint32_t lStart = lConflictStart + lROMBase, lEnd = lConflictEnd + lROMBase;
+  if (nConflictFirst == 0) return;
+  if (lStart == lEnd)
+    fprintf(stderr,"%s: conflict with %s at address 0x%04X\n", aInputs[nInput-1].pszName, aInputs[nConflictFirst-1].pszName, lStart);
+  else
+    fprintf(stderr,"%s: conflict with %s at addresses 0x%04X to 0x%04X\n", aInputs[nInput-1].pszName, aInputs[nConflictFirst-1].pszName, lStart, lEnd);
+  nConflictFirst = 0;
+}
+
+
+//++
+//   Store some bytes from input file nInput (1..n) in the ROM image, starting
+// at lIndex.  Any byte that some input (this one included) has already loaded
+// is a conflict and isn't stored.  Conflicts are collected into ranges and
+// reported by ReportConflict(), along with the file that loaded them first.
+// The caller has already checked that all the bytes fit in the ROM...
+//--
+void StoreData (unsigned nInput, uint32_t lIndex, const uint8_t *pb, uint32_t cb)
+{
+  for (;  cb > 0;  --cb, ++lIndex, ++pb) {
+    unsigned nFirst = pbOwner[lIndex];
+    if (nFirst == 0) {
+      pbOwner[lIndex] = (uint8_t) nInput;  pbData[lIndex] = *pb;
+      continue;
+    }
+    ++lConflicts;
+    if ((nFirst == nConflictFirst) && (lIndex == lConflictEnd+1)) {
+      lConflictEnd = lIndex;  continue;
+    }
+    ReportConflict(nInput);
+    nConflictFirst = nFirst;  lConflictStart = lConflictEnd = lIndex;
+  }
+}
+
+
+//++
+//   This is the hexRead() callback for LoadHex().  Every record must be
+// entirely inside the ROM, after the offset for this file is added and the
+// ROM base address is subtracted.  If it isn't, then stop reading ...
+//--
+bool LoadHexData (void *pContext, const HEX_RECORD *pRecord)
+{
+  unsigned nInput = (unsigned) (uintptr_t) pContext;  ROMINPUT *pInput = &aInputs[nInput-1];
+  uint32_t lIndex = pRecord->lAddress + pInput->lAddress - lROMBase, i;
+  for (i = 0;  i < pRecord->cbData;  ++i) {
+    if ((lIndex+i) >= lROMSize) {
+      pInput->lBad = pRecord->lAddress + pInput->lAddress + i;  return false;
+    }
+  }
+  StoreData(nInput, lIndex, pRecord->pbData, pRecord->cbData);
+  pInput->lCount += pRecord->cbData;
+  return true;
+}
+
+
+//++
+//   Load one .HEX input file into the ROM image and report the results.
+// Returns false if there's any error other than a conflict - those are
+// counted in lConflicts instead...
+//--
+bool LoadHex (unsigned nInput)
+{
+  ROMINPUT *pInput = &aInputs[nInput-1];  char *pszName = pInput->pszName;
+  HEX_RECORD Record;  HEX_STATUS nStatus;
+  nStatus = hexRead(pszName, LoadHexData, (void *) (uintptr_t) nInput, &Record);
+  if (nStatus == HEX_OK) {
+    printf("%s: %ld bytes read\n", pszName, (long) pInput->lCount);
+    return true;
+  } else if (nStatus == HEX_STOPPED)
+    fprintf(stderr,"%s: address %04X outside ROM\n", pszName, pInput->lBad);
+  else
+    hexPrintError(nStatus, &Record);
+  return false;
+}
+
+
+//++
+//   Load one text input file into the ROM image, the same way that romtext
+// does, and report the results.  Returns false if there's any error other
+// than a conflict...
+//--
+bool LoadText (unsigned nInput)
+{
+  ROMINPUT *pInput = &aInputs[nInput-1];  char *pszName = pInput->pszName;
+  uint32_t lIndex = pInput->lAddress - lROMBase, cbText;  uint8_t *pbText;  FILE *f;
+
+  if ((f = fopen(pszName, "r")) == NULL) {
+    fprintf(stderr,"%s: unable to open file\n", pszName);  return false;
+  }
+  if ((pbText = malloc(lROMSize)) == NULL) {
+    fprintf(stderr,"rombuild: failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  cbText = txtRead(f, pbText, lROMSize);
+  fclose(f);
+  if ((lIndex >= lROMSize) || (cbText > (lROMSize - lIndex))) {
+    fprintf(stderr,"%s: %u bytes at 0x%04X don't fit in the ROM\n", pszName, cbText, pInput->lAddress);
+    free(pbText);  return false;
+  }
+  StoreData(nInput, lIndex, pbText, cbText);
+  pInput->lCount = cbText;  free(pbText);
+  printf("%s: %u bytes from 0x%04X to 0x%04X\n",
+    pszName, cbText, pInput->lAddress, pInput->lAddress+cbText-1);
+  return true;
+}
+
+
+//++
+//   Write part of the ROM image to a .HEX file.  cbStride is the distance
+// between bytes in the image, for interleaved outputs, and lAddress is the
+// address of the first byte in the file...
+//--
+void WriteHex (char *pszName, uint8_t *pb, uint32_t cb, uint32_t cbStride, uint32_t lAddress)
+{
+  FILE *f;		// handle of the output file
+  if ((f=fopen(pszName, "wt")) == NULL) {
+    fprintf(stderr,"%s: unable to write file\n", pszName);
+    exit(EXIT_FAILURE);
+  }
+  if (!hexWrite(f, pb, cb, cbStride, lAddress, &HexOptions) || (fclose(f) != 0)) {
+    fprintf(stderr,"%s: unable to write file\n", pszName);
+    exit(EXIT_FAILURE);
+  }
+  printf("%s: %u bytes written\n", pszName, cb);
+}
+
+
+//++
+//   Write all the files for one output statement ...
+//--
+void WriteOutput (ROMOUTPUT *pOutput)
+{
+  unsigned i;
+  switch (pOutput->nType) {
+    case OUT_IMAGE:
+      WriteHex(pOutput->apszFiles[0], pbData, lROMSize, 1, pOutput->lValue);
+      break;
+    case OUT_SPLIT:
+      for (i = 0;  i < pOutput->nFiles;  ++i)
+        WriteHex(pOutput->apszFiles[i], pbData + i*pOutput->lValue, pOutput->lValue, 1, 0);
+      break;
+    case OUT_INTERLEAVE:
+      for (i = 0;  i < pOutput->nFiles;  ++i)
+        WriteHex(pOutput->apszFiles[i], pbData + i, lROMSize/pOutput->nFiles, pOutput->nFiles, 0);
+      break;
+  }
+}
+
+
+//++
+//   This function parses the command line and initializes all the global
+// variables accordingly.  The only thing there is, besides the -v option,
+// is the name of the manifest file...
+//--
+void ParseCommand (int argc, char *argv[])
+{
+  int nArg;
+
+  // First, set all the defaults...
+  lROMSize = 65536;  lROMBase = 0;  bFillByte = 0xFF;
+  fLittleEndian = fVerbose = false;  pszManifest = NULL;
+  memset(&HexOptions, 0, sizeof(HexOptions));
+
+  // If there are no arguments, then just print the help and exit...
+  if (argc == 1) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr,"rombuild [-v] manifest-file\n");
+    fprintf(stderr,"\t-v - verbose output\n");
+    exit(EXIT_SUCCESS);
+  }
+
+  for (nArg = 1;  nArg < argc;  ++nArg) {
+    // If it doesn't start with a "-" character, then it must be a file name.
+    if (argv[nArg][0] != '-') {
+      if (pszManifest != NULL) {
+        fprintf(stderr,"rombuild: too many files specified: \"%s\"\n", argv[nArg]);
+        exit(EXIT_FAILURE);
+      }
+      pszManifest = argv[nArg];
+      continue;
+    }
+
+    // Handle the -v (verbose) option...
+    if (strcmp(argv[nArg], "-v") == 0) {
+      fVerbose = true;
+      continue;
+    }
+
+    // Otherwise it's an illegal option...
+    fprintf(stderr, "rombuild: unknown option - \"%s\"\n", argv[nArg]);
+    exit(EXIT_FAILURE);
+  }
+
+  if (pszManifest == NULL) {
+    fprintf(stderr,"rombuild: specify a manifest file\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+//++
+//main
+//--
+int main (int argc, char *argv[])
+{
+  unsigned i;  bool fOK;  uint32_t lChecksum;
+
+  ParseCommand(argc, argv);
+  ReadManifest();
+  if (fVerbose) {
+    fprintf(stderr,"Manifest        = %s\n", pszManifest);
+    fprintf(stderr,"ROM Size        = %d (0x%05x)\n", lROMSize, lROMSize);
+    fprintf(stderr,"ROM Base        = %d (0x%05x)\n", lROMBase, lROMBase);
+    fprintf(stderr,"Fill Byte       = %u (0x%02x)\n", bFillByte, bFillByte);
+    fprintf(stderr,"Checksum Order  = %s\n", fLittleEndian ? "Little Endian" : "Big Endian");
+    fprintf(stderr,"Inputs          = %u\n", nInputs);
+    fprintf(stderr,"Checksums       = %u\n", nRegions);
+  }
+
+  // Allocate the ROM image and fill it with the filler value ...
+  pbData = malloc(lROMSize);  pbOwner = calloc(lROMSize, 1);
+  if ((pbData == NULL) || (pbOwner == NULL)) {
+    fprintf(stderr,"rombuild: failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(pbData, bFillByte, lROMSize);
+
+  // Load all the input files, in order, and quit if anything went wrong ...
+  for (i = 1, fOK = true, lConflicts = 0;  i <= nInputs;  ++i) {
+    if (aInputs[i-1].fText)
+      fOK = LoadText(i) && fOK;
+    else
+      fOK = LoadHex(i) && fOK;
+    ReportConflict(i);
+  }
+  if (lConflicts != 0)
+    fprintf(stderr,"rombuild: %u bytes loaded more than once\n", lConflicts);
+  if (!fOK || (lConflicts != 0)) exit(EXIT_FAILURE);
+
+  // Do all the checksums, in order ...
+  for (i = 0;  i < nRegions;  ++i) {
+    if (!ckRegion("rombuild", pbData, lROMSize, &aRegions[i], fLittleEndian, &lChecksum))
+      exit(EXIT_FAILURE);
+    printf("%s: %s of 0x%05X..0x%05X = 0x%0*X stored at 0x%05X\n", pszManifest,
+      ckTypeName(aRegions[i].nType), aRegions[i].lStart, aRegions[i].lStart+aRegions[i].lSize-1,
+      (aRegions[i].nType == CK_CRC32) ? 8 : 4, lChecksum, aRegions[i].lOffset);
+  }
+
+  // And write all the output files ...
+  HexOptions.bFill = bFillByte;  HexOptions.fExtended = true;
+  for (i = 0;  i < nOutputs;  ++i)  WriteOutput(&aOutputs[i]);
+
+  free(pbData);  free(pbOwner);
+  return 0;
+}
@@ -54,25 +54,52 @@
 // file.  Normally the filler is 0xFF, but an alternate value may be specified
 // on the command line.
 //
+//   Our newer boot ROMs check themselves with a CRC instead, and the bigger
+// PromICE images have more than one part that needs checking.  The -x option
+// checksums one region of the ROM with any of these algorithms -
+//
+//	sum   - the sixteen bit sum and correction bytes described above.  The
+//		four bytes go at the offset given, which must be in the region.
+//	crc16 - CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF).  The
+//		two byte CRC goes at the offset given, outside the region.
+//	crc32 - the usual CRC-32 (as used by zip, Ethernet, etc).  The four
+//		byte CRC goes at the offset given, outside the region.
+//
+// -x may be used as many times as needed, and the regions are done in the
+// order given - so a CRC over the whole ROM can include the checksums of the
+// smaller regions inside it.  If there's no -x then it's as if the options
+// were "-xsum,0,<ROM size>,<-c offset>".  The sums and CRCs are computed by
+// the shared routines in ../romlib.
+//
 // USAGE:
-//    romcksum input-file [-cnnnn] [-snnnn] [-onnnn] [-fnn] [-e|-b] [-v] output-file
+//    romcksum input-file [-cnnnn] [-snnnn] [-onnnn] [-fnn] [-rnn] [-u] [-e|-b] [-v] [-xtype,start,size,offset ...] output-file
 //      -cnnnn  - set the offset of the checksum to nnnn
 //      -snnnn  - set the ROM size to nnnn bytes
 //      -onnnn  - set the offset applied to input files
 //      -fnn    - fill unused ROM locations with nn
+//      -rnn    - write nn data bytes per output record (default 16)
+//      -u      - don't write unused (filler) bytes to the output file
 //      -e      - store the checksum in little-endian format (default)
 //      -b      - store the checksum in big-endian format
 //      -v      - verbose output
+//      -x...   - checksum a region with sum, crc16 or crc32 (see above).  The
+//                start, size and offset may be decimal, 0x hex, or end in k
 //
 // NOTE:
-//   This program will work for ROMs up to 64K bytes.  In theory it would work
-// for bigger EPROMs, but the HEX file reader/writer can only handle four digit
-// addresses.
+//   This program will work for ROMs up to 16Mb.  For ROMs of 64K or less
+// the input addresses, plus the -o offset, wrap around at 64K just as they
+// always have.  Bigger ROMs wrap at the next power of two instead.
 //
 // REVISION HISTORY
 // 12-May-98	RLA	New file...
 //  3-May-17    RLA     Update to Visual Studio 2013
 // 29-Nov-24    RLA     Change #include <limits.h> to <linux/limits.h>
+// 14-Oct-26    AGT     Use the shared .HEX file reader in ../romlib
+// 14-Oct-26    AGT     And the shared writer, and add -r and -u
+// 14-Oct-26    AGT     Add -x for CRC-16, CRC-32 and multiple regions, and
+//                        allow ROMs bigger than 64K
+// 14-Oct-26    AGT     Move the checksum correction to ../romlib
+// 14-Oct-26    AGT     And the checksum regions and .HEX error messages
 //--
 #include <stdio.h>		// printf(), scanf(), et al.
 #include <stdlib.h>		// exit(), ...
@@ -83,9 +110,12 @@
 #include <linux/limits.h>	// PATH_MAX ...
 #define _MAX_PATH PATH_MAX
 #endif
+#include "intelhex.h"		// hexRead(), hexPrintError(), etc ...
+#include "checksum.h"		// ckRegion(), CK_REGION, etc ...
 
 // Useful definitions....
-#define MAXROM    65536         // the biggest image we can accomodate (64Kb)
+#define MAXROM    (16L*1024L*1024L)// the biggest image we can accomodate (16Mb)
+#define MAXREGION 16            // most -x options allowed
 
 #define HIBYTE(x) 	((uint8_t)  (((x) >> 8) & 0xFF))
 #define LOBYTE(x) 	((uint8_t)  ((x) & 0xFF))
@@ -100,18 +130,52 @@ uint32_t lChecksumOffset;	// position of the checksum bytes
 uint8_t  bFillByte;		// filler value for unused ROM locations
 bool	 fVerbose;		// true for verbose output
 bool     fLittleEndian;		// store checksum in little endian format
+HEX_OPTIONS HexOptions;		// output record size, skip filler, etc
+
+// Checksum regions from the -x options ...
+CK_REGION aRegions[MAXREGION];	// regions to checksum
+unsigned nRegions;		// number of regions used
 char szInputFile[_MAX_PATH];	// input file specification
 char szOutputFile[_MAX_PATH];	// output file specification
 
 
 
+//++
+//ReadHexData
+//
+//   This is the hexRead() callback for ReadHex(), below.  It stores one data
+// record in the ROM image.  For ROMs up to 64K, addresses are only sixteen
+// bits and the offset wraps around at 64K, just as it always has, so anything
+// above 64K is outside the EPROM.  Bigger ROMs work the same way, but wrap at
+// the next power of two instead.
+//--
+typedef struct {
+  uint8_t  *pabData;	// ROM image buffer
+  uint32_t  cbData;	// size of the ROM image
+  uint32_t  lOffset;	// offset applied to HEX file addresses
+  uint32_t  lCount;	// number of bytes loaded from file
+  uint32_t  lMask;	// mask for wrapping addresses
+} READHEX;
+
+bool ReadHexData (void *pContext, const HEX_RECORD *pRecord)
+{
+  READHEX *pRead = (READHEX *) pContext;  uint32_t i, lAddress;
+  for (i = 0;  i < pRecord->cbData;  ++i, ++pRead->lCount) {
+    lAddress = (pRecord->lAddress+i+pRead->lOffset) & pRead->lMask;
+    if ((((pRecord->lAddress+i) & ~pRead->lMask) != 0) || (lAddress >= pRead->cbData))
+      {fprintf(stderr,"%s: address outside EPROM\n", pRecord->pszFile);  return false;}
+    pRead->pabData[lAddress] = pRecord->pbData[i];
+  }
+  return true;
+}
+
+
 //++
 //ReadHex
 //
 //   This function will load a standard Intel format .HEX file into memory.
-// Only the traditional 16-bit address format is supported, which puts an
-// upper limit of 64K on the amount of data which may be loaded.  Only
-// record types 00 (data) and 01 (end of file) are recognized.
+// The file is parsed by hexRead() in ../romlib, which also understands the
+// extended address records.
 //
 //   The number of bytes read will be returned as the function's value,
 // and this will be zero if any error occurs.  Note that all counts, sizes
@@ -120,40 +184,13 @@ char szOutputFile[_MAX_PATH];	// output file specification
 //--
 uint32_t ReadHex (char *pszName, uint8_t *pabData, uint32_t cbData, uint32_t lOffset)
 {
-  FILE	   *f;		// handle of the input file
-  uint32_t  lCount = 0;	// number of bytes loaded from file
-  unsigned  uLength;	// length       of the current .HEX record
-  unsigned  uAddress;	// load address "   "     "      "     "
-  unsigned  uType;	// type         "   "     "      "     "
-  unsigned  uChecksum;	// checksum     "   "     "      "     "
-  unsigned  uByte;	// temporary for the data byte read...
-  if ((f=fopen(pszName, "rt")) == NULL)
-    {fprintf(stderr,"%s: unable to open file\n", pszName);  return 0;}
-
-  while (true) {
-    if (fscanf(f,":%2x%4x%2x", &uLength, &uAddress, &uType) != 3)
-      {fprintf(stderr,"%s: bad .HEX file format (1)\n", pszName);  return 0;}
-    if (uType > 1)
-      {fprintf(stderr,"%s: unknown record type %d\n", pszName, uType);  return 0;}
-    uChecksum = uLength + HIBYTE(uAddress) + LOBYTE(uAddress) + uType;
-    for (;  uLength > 0;  --uLength, ++uAddress, ++lCount) {
-      if (fscanf(f,"%2x",&uByte) != 1)
-        {fprintf(stderr,"%s: bad .HEX file format (2)\n", pszName);  return 0;}
-      if (LOWORD(uAddress+lOffset) >= cbData)
-        {fprintf(stderr,"%s: address outside EPROM\n", pszName);  return 0;}
-      pabData[LOWORD(uAddress+lOffset)] = (uint8_t) uByte;
-      uChecksum += uByte;
-    }
-    if (fscanf(f,"%2x\n",&uByte) != 1)
-      {fprintf(stderr,"%s: bad .HEX file format (3)\n", pszName);  return 0;}
-    uChecksum = LOBYTE(uChecksum+uByte);
-    if (uChecksum != 0)
-      {fprintf(stderr,"%s: checksum error\n", pszName);  return 0;}
-    if (uType == 1) break;
-  }
-  
-  fclose(f);
-  return lCount;
+  READHEX Read = {pabData, cbData, lOffset, 0, 0xFFFF};  HEX_RECORD Record;
+  HEX_STATUS nStatus;
+  while (Read.lMask < cbData-1)  Read.lMask = (Read.lMask << 1) | 1;
+  if ((nStatus = hexRead(pszName, ReadHexData, &Read, &Record)) == HEX_OK)
+    return Read.lCount;
+  hexPrintError(nStatus, &Record);
+  return 0;
 }
 
 
@@ -161,34 +198,64 @@ uint32_t ReadHex (char *pszName, uint8_t *pabData, uint32_t cbData, uint32_t lOf
 //WriteHex
 //
 //   This function will write an array of bytes to a file in standard Intex
-// .HEX file format.  Only the traditional 16 bit format is supported and
-// so the array must be 64K or less.  The only records generated are type 00
-// (data) and 01 (end of file).  This routine always writes everything in
-// the array and doesn't attempt to remove filler bytes...
+// .HEX file format.  The only records generated are type 00 (data) and 01
+// (end of file), plus type 04 (extended linear address) for ROMs bigger than
+// 64K.  The record size and whether filler bytes are
+// written are up to the -r and -u options...
 //--
 void WriteHex (char *pszName, uint8_t *pabData,	uint32_t cbData)
 {
   FILE *f;		// handle of the output file
-  uint16_t uAddress = 0;// address of the current record
-  uint16_t cbRecord;	// size of the current record
-  uint16_t uChecksum;	// checksum "  "     "       "
-  unsigned i;		// temporary...
   if ((f=fopen(pszName, "wt")) == NULL)
     {fprintf(stderr,"%s: unable to write file\n", pszName);  return;}
+  if (!hexWrite(f, pabData, cbData, 1, 0, &HexOptions))
+    fprintf(stderr,"%s: unable to write file\n", pszName);
+  fclose(f);
+}
 
-  while (cbData > 0) {
-   cbRecord = (cbData > 16) ? 16 : (unsigned) cbData;
-    fprintf(f,":%02X%04X00", cbRecord, uAddress);
-    uChecksum = cbRecord + HIBYTE(uAddress) + LOBYTE(uAddress) + 00 /* Type */;
-    for (i = 0; i < cbRecord; ++i) {
-      fprintf(f,"%02X", *(pabData+uAddress+i));
-      uChecksum += *(pabData+uAddress+i);
-    }
-    fprintf(f,"%02X\n", LOBYTE(-uChecksum));
-    cbData -= cbRecord;  uAddress += cbRecord;
+
+//++
+//   Parse a number for the -x option - decimal or, with a leading "0x", hex.
+// Either one may end with "k" for kilobytes.  Returns false if there's no
+// number at all, and otherwise updates the pointer past it...
+//--
+bool ParseNumber (char **ppsz, uint32_t *plValue)
+{
+  char *psz = *ppsz;  int nBase = 10;
+  if ((psz[0] == '0') && ((psz[1] == 'x') || (psz[1] == 'X')))  psz += 2, nBase = 16;
+  *plValue = (uint32_t) strtoul(psz, ppsz, nBase);
+  if (*ppsz == psz) return false;
+  if ((**ppsz == 'k') || (**ppsz == 'K'))  *plValue <<= 10, ++*ppsz;
+  return true;
+}
+
+
+//++
+//   Parse a "-xtype,start,size,offset" option and add it to the list of
+// regions to be checksummed.  Like ParseCommand(), it just prints a message
+// and exits if there's anything wrong...
+//--
+void ParseRegion (char *pszArg)
+{
+  CK_REGION *pRegion = &aRegions[nRegions];  char *psz = pszArg+2;
+  size_t cb = strcspn(psz, ",");  bool fOK;
+
+  if (nRegions >= MAXREGION) {
+    fprintf(stderr,"romcksum: too many -x options\n");
+    exit(EXIT_FAILURE);
   }
-  
-  fprintf(f, ":00000001FF\n");  fclose(f);
+  fOK = (psz[cb] == ',') && ckTypeFromName(psz, cb, &pRegion->nType);
+  if (fOK) {
+    psz += cb+1;
+    fOK =    ParseNumber(&psz, &pRegion->lStart)  && (*psz++ == ',')
+          && ParseNumber(&psz, &pRegion->lSize)   && (*psz++ == ',')
+          && ParseNumber(&psz, &pRegion->lOffset) && (*psz == '\0');
+  }
+  if (!fOK) {
+    fprintf(stderr,"romcksum: invalid checksum region \"%s\"\n", pszArg);
+    exit(EXIT_FAILURE);
+  }
+  ++nRegions;
 }
 
 
@@ -205,19 +272,25 @@ void ParseCommand (int argc, char *argv[])
   // First, set all the defaults...
   szInputFile[0] = szOutputFile[0] = '\0';
   lROMSize = lChecksumOffset = lROMOffset = 0L;  bFillByte = 0xFF;
-  fLittleEndian = fVerbose = false;
+  fLittleEndian = fVerbose = false;  nRegions = 0;
+  memset(&HexOptions, 0, sizeof(HexOptions));
 
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
     fprintf(stderr, "Usage:\n");
-    fprintf(stderr,"  romcksum input-file [-cnnnn] [-snnnn] [-onnnn] [-fnn] [-e] [-v] output-file\n");
+    fprintf(stderr,"  romcksum input-file [-cnnnn] [-snnnn] [-onnnn] [-fnn] [-rnn] [-u] [-e] [-v] [-x...] output-file\n");
     fprintf(stderr,"\t-cnnnn\t- set the offset of the checksum to nnnn\n");
     fprintf(stderr,"\t-snnnn\t- set the ROM size to nnnn bytes\n");
     fprintf(stderr,"\t-onnnn\t- set the offset applied to input files\n");
     fprintf(stderr,"\t-fnn\t- fill unused ROM locations with nn\n");
+    fprintf(stderr,"\t-rnn\t- write nn data bytes per output record (default 16)\n");
+    fprintf(stderr,"\t-u\t- don't write unused (filler) bytes to the output file\n");
     fprintf(stderr,"\t-e\t- store the checksum in little-endian format\n");
     fprintf(stderr,"\t-b\t- store the checksum in big-endian format\n");
     fprintf(stderr,"\t-v\t- verbose output\n");
+    fprintf(stderr,"\t-xtype,start,size,offset\n");
+    fprintf(stderr,"\t\t- checksum a region with type sum, crc16 or crc32 and\n");
+    fprintf(stderr,"\t\t  store it at offset (may be used more than once)\n");
     exit(EXIT_SUCCESS);
   }
 
@@ -236,7 +309,7 @@ void ParseCommand (int argc, char *argv[])
     // Handle the -c (checksum) option...
     if (strncmp(argv[nArg], "-c", 2) == 0) {
       lChecksumOffset = strtoul(argv[nArg]+2, &psz, 10);
-      if ((*psz != '\0') || (lChecksumOffset == 0) || (lChecksumOffset > 0xFFFF)) {
+      if ((*psz != '\0') || (lChecksumOffset == 0)) {
         fprintf(stderr, "romcksum: illegal offset: \"%s\"", argv[nArg]);
 	exit(EXIT_FAILURE);
       }
@@ -246,7 +319,7 @@ void ParseCommand (int argc, char *argv[])
     // Handle the -o (offset) option...
     if (strncmp(argv[nArg], "-o", 2) == 0) {
       lROMOffset = strtoul(argv[nArg]+2, &psz, 10);
-      if ((*psz != '\0') || (lROMOffset > 0xFFFF)) {
+      if ((*psz != '\0') || (lROMOffset >= MAXROM)) {
         fprintf(stderr, "romcksum: illegal offset: \"%s\"", argv[nArg]);
 	exit(EXIT_FAILURE);
       }
@@ -257,7 +330,7 @@ void ParseCommand (int argc, char *argv[])
     if (strncmp(argv[nArg], "-s", 2) == 0) {
       lROMSize = strtoul(argv[nArg]+2, &psz, 10);
       if (*psz == 'k' || *psz == 'K')   lROMSize <<= 10, ++psz;
-      if (*psz != '\0') {
+      if ((*psz != '\0') || (lROMSize > MAXROM)) {
         fprintf(stderr,"romcksum: invalid ROM size \"%s\"\n", argv[nArg]);
         exit(EXIT_FAILURE);
       }
@@ -274,6 +347,23 @@ void ParseCommand (int argc, char *argv[])
       continue;
     }
 
+    // Handle the -r (record size) option...
+    if (strncmp(argv[nArg], "-r", 2) == 0) {
+      unsigned long cbRecord = strtoul(argv[nArg]+2, &psz, 10);
+      if ((*psz != '\0') || (cbRecord == 0) || (cbRecord > 255)) {
+        fprintf(stderr,"romcksum: invalid record size \"%s\"\n", argv[nArg]);
+        exit(EXIT_FAILURE);
+      }
+      HexOptions.cbRecord = (uint8_t) cbRecord;
+      continue;
+    }
+
+    // Handle the -u (skip unused locations) option...
+    if (strcmp(argv[nArg], "-u") == 0) {
+      HexOptions.fSkipFill = true;
+      continue;
+    }
+
     // Handle the -e (little endian) and -b (big endian) options...
     if (strcmp(argv[nArg], "-e") == 0) {
       fLittleEndian = true;
@@ -284,6 +374,12 @@ void ParseCommand (int argc, char *argv[])
       continue;
     }
 
+    // Handle the -x (checksum region) option...
+    if (strncmp(argv[nArg], "-x", 2) == 0) {
+      ParseRegion(argv[nArg]);
+      continue;
+    }
+
     // Handle the -v (verbose) option...
     if (strcmp(argv[nArg], "-v") == 0) {
       fVerbose = true;
@@ -303,57 +399,16 @@ void ParseCommand (int argc, char *argv[])
 }
 
 
-//++
-//   This routine calculates the two checksum bytes for the EPROM and returns
-// them in CheckH (high byte) and CheckL (low byte), AND it calculates two
-// "correction" bytes which are returned in CorrH and CorrL.  The correction
-// bytes are calculated so that when they're added to the sum of all the other
-// EPROM bytes, plus the checksum bytes, the total is the checksum.  Usually
-// this is simple because a byte plus its complement is always 0x0100, but
-// there are special cases when that byte is zero.
-//--
-void CalculateChecksum (uint16_t uSum,
-       uint8_t *pbCheckH, uint8_t *pbCheckL, uint8_t *pbCorrH, uint8_t *pbCorrL)
-{
-  *pbCheckL = LOBYTE(uSum);  *pbCorrL = -*pbCheckL;
-  if (uSum == 0xFE01) {
-    //   This is the case where everything falls apart.  The correct checksum
-    // in this case should be 0x0001, but to get from 0xFE01 to 0x0001 we need
-    // two correction bytes that total 0x0200.  That's not going to happen, and
-    // I don't see any games we could play to make it happen!
-    fprintf(stderr, "UNABLE TO CALCULATE CHECKSUM!!!!!\n");  exit(0);
-    //*pbCheckH = 0x00;  *pbCorrH = 0xFF;  *pbCorrL = 0xFF;
-  } else if ((uSum > 0xFE01) && (uSum < 0xFF01)) {
-    //   If the checksum is in this range, then adding 0x0200 would produce a
-    // high byte of zero.  That's not bad by itself, but the complement of zero
-    // is zero and 0+0 doesn't produce any carry!  The trick is to set the
-    // high order correction byte to 0xFF instead of zero, and then ALSO bump
-    // the low byte by one.  This produces 0xFF+1, which gives another carry.
-    *pbCheckH = 0x00;  *pbCorrH = 0xFF;  ++*pbCorrL;
-  } else {
-    //   This is the easy case - we add 0x0100 to the checksum to account for
-    // the carry from the high byte and, unless the low byte of the checksum
-    // happens to be zero, another 0x0100 for the carry from the low byte.
-    // Remember that adding 1 to the high byte alone is the same as adding
-    // 0x0100 to the entire checksum!
-    *pbCheckH = HIBYTE(uSum) + 1;
-    if (*pbCheckL != 0) ++*pbCheckH;
-    *pbCorrH = -*pbCheckH;
-  }
-}
-
-
 //++
 //main
 //--
 int main (int argc, char *argv[])
 {
-  uint8_t   abData[MAXROM]; // ROM image buffer
+  uint8_t  *abData;	    // ROM image buffer
   uint32_t  cbData;         // count of bytes loaded from the .HEX file
-  uint16_t  uSum;	    // computed sum of all EPROM bytes
+  uint32_t  lChecksum;	    // checksum or CRC of the last region
   unsigned  i;              // temporaries...	
-  uint8_t bCheckH, bCheckL; // two checksum bytes, high and low
-  uint8_t bCorrH, bCorrL;   // two "correction" bytes, high and low
+  bool      fRegions;	    // true if -x was used
  
   ParseCommand(argc, argv);
   if (lROMSize == 0) lROMSize = 32768L;
@@ -369,32 +424,40 @@ int main (int argc, char *argv[])
   }
 
   // Fill the EPROM with the filler and then load the .HEX file over that...
-  for (i = 0; i < lROMSize; ++i)  abData[i] = bFillByte;
+  if ((abData = malloc(lROMSize)) == NULL) {
+    fprintf(stderr, "romcksum: failed to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(abData, bFillByte, lROMSize);
   cbData = ReadHex(szInputFile, abData, lROMSize, lROMOffset);
   if (cbData == 0)  exit(1);
 
-  // Force the bytes occupied by the checksum to always be zeros...
-  abData[lChecksumOffset+0] = abData[lChecksumOffset+1] = 0;
-  abData[lChecksumOffset+2] = abData[lChecksumOffset+3] = 0;
-
-  //   Calculate the sum of the entire EPROM image so far, before we add our
-  // magic four bytes to the total...
-  for (i = 0, uSum = 0;  i < lROMSize;  ++i) uSum += abData[i];
-
-  // Now calculate the magic bytes ...
-  CalculateChecksum(uSum, &bCheckH, &bCheckL, &bCorrH, &bCorrL);
-  
-  // Put the checksum and its complement in the top of the ROM image...
-  if (fLittleEndian) {
-    abData[lChecksumOffset+0] = bCorrL;  abData[lChecksumOffset+1] = bCorrH;
-    abData[lChecksumOffset+2] = bCheckL;  abData[lChecksumOffset+3] = bCheckH;
-  } else {
-    abData[lChecksumOffset+0] = bCorrH;  abData[lChecksumOffset+1] = bCorrL;
-    abData[lChecksumOffset+2] = bCheckH;  abData[lChecksumOffset+3] = bCheckL;
+  //   Without any -x options, we do the traditional checksum of the whole ROM
+  // with the result stored at the -c offset ...
+  fRegions = nRegions != 0;
+  if (!fRegions) {
+    aRegions[0].nType = CK_SUM;  aRegions[0].lStart = 0;
+    aRegions[0].lSize = lROMSize;  aRegions[0].lOffset = lChecksumOffset;
+    nRegions = 1;
+  }
+
+  // Checksum all the regions, in order ...
+  for (i = 0;  i < nRegions;  ++i) {
+    if (!ckRegion("romcksum", abData, lROMSize, &aRegions[i], fLittleEndian, &lChecksum))
+      exit(EXIT_FAILURE);
+    if (fRegions)
+      printf("%s: %s of 0x%05X..0x%05X = 0x%0*X stored at 0x%05X\n", szOutputFile,
+        ckTypeName(aRegions[i].nType), aRegions[i].lStart, aRegions[i].lStart+aRegions[i].lSize-1,
+        (aRegions[i].nType == CK_CRC32) ? 8 : 4, lChecksum, aRegions[i].lOffset);
   }
 
   // Dump out the new ROM image and we're all done...
+  HexOptions.bFill = bFillByte;  HexOptions.fExtended = true;
   WriteHex(szOutputFile, abData, lROMSize);
-  printf("%s: %d bytes loaded, ROMsize=%d, checksum=0x%02X%02X\n", szOutputFile, cbData, lROMSize, bCheckH, bCheckL);
+  if (fRegions)
+    printf("%s: %d bytes loaded, ROMsize=%d\n", szOutputFile, cbData, lROMSize);
+  else
+    printf("%s: %d bytes loaded, ROMsize=%d, checksum=0x%04X\n", szOutputFile, cbData, lROMSize, lChecksum);
+  free(abData);
   return 0;
 }
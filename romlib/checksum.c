@@ -0,0 +1,357 @@
+//++
+// checksum.c - checksum and CRC routines shared by the ROM tools
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//   ckSumCorrection() and ckRegion() are from romcksum, Copyright (C) 2017 by Spare Time
+//   Gizmos.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   This module computes the checksums and CRCs for romcksum, rombuild,
+// obj2rom and pdp2hex.  These used to be simple loops that added up one byte or word at
+// a time, which is fine for a 32K EPROM but slow for the 1 and 2Mb images
+// that PromICE handles.
+//
+//   The additive sums use SSE2 when the compiler has it (always, on x86-64).
+// PSADBW adds up eight bytes at a time into a 64 bit lane, so sixteen bytes
+// go in each instruction and there's no need to worry about overflow.  The
+// sixteen bit word sum widens the words to 32 bits and adds four at a time.
+// Everything else gets a plain C loop.  All the sums are modulo 2^32 - the
+// caller takes as many bits as it needs.
+//
+//   The CRCs use the "slicing-by-8" tables - eight 256 entry tables that let
+// us do eight bytes with one table lookup per byte and no dependency between
+// the lookups, instead of the usual one byte at a time.  The tables are built
+// on the first call.
+//
+//   ckRegion() does a whole romcksum -x region (or rombuild checksum
+// statement) - it checks the region, computes the sum or CRC and stores it
+// in the image.
+//
+// REVISION HISTORY:
+// 14-OCT-26    AGT     New file.
+// 14-OCT-26    AGT     Add ckSumCorrection(), from romcksum, for rombuild.
+// 14-OCT-26    AGT     Add ckRegion() and friends, from romcksum and rombuild.
+//--
+#include <stdio.h>              // fprintf(), NULL, etc ...
+#include <stdint.h>             // uint8_t, uint32_t, etc ...
+#include <string.h>             // memset(), strncmp(), etc ...
+#include <stdbool.h>            // bool, true, false, etc ...
+#if defined(__SSE2__)
+#include <emmintrin.h>          // _mm_sad_epu8(), et al ...
+#endif
+#include "checksum.h"           // declarations for this module
+
+// CRC polynomials ...
+#define CRC16_POLY      0x1021          // CCITT, MSB first
+#define CRC32_POLY      0xEDB88320UL    // IEEE 802.3, reflected
+
+// Slicing-by-8 tables, built by BuildTables() ...
+static uint16_t awCRC16[8][256];
+static uint32_t alCRC32[8][256];
+static bool     fTables = false;
+
+// Checksum region names and the number of bytes each one stores ...
+static const char    *apszTypes[] = {"sum", "crc16", "crc32"};
+static const uint32_t acbTypes[]  = {4, 2, 4};
+#define NTYPES  (sizeof(apszTypes)/sizeof(apszTypes[0]))
+
+
+static void BuildTables (void)
+{
+  //++
+  //   Table [0] is the usual byte at a time CRC table, and table [k] is the
+  // CRC of a byte followed by k zero bytes.  That lets eight bytes be done at
+  // once, by looking up each one in the right table and XORing the results.
+  //--
+  uint32_t i, j, lCRC;  uint16_t wCRC;
+  for (i = 0;  i < 256;  ++i) {
+    for (j = 0, wCRC = (uint16_t) (i << 8);  j < 8;  ++j)
+      wCRC = (wCRC & 0x8000) ? (uint16_t) ((wCRC << 1) ^ CRC16_POLY) : (uint16_t) (wCRC << 1);
+    for (j = 0, lCRC = i;  j < 8;  ++j)
+      lCRC = (lCRC & 1) ? (lCRC >> 1) ^ CRC32_POLY : (lCRC >> 1);
+    awCRC16[0][i] = wCRC;  alCRC32[0][i] = lCRC;
+  }
+  for (i = 0;  i < 256;  ++i) {
+    for (j = 1;  j < 8;  ++j) {
+      wCRC = awCRC16[j-1][i];
+      awCRC16[j][i] = (uint16_t) ((wCRC << 8) ^ awCRC16[0][wCRC >> 8]);
+      lCRC = alCRC32[j-1][i];
+      alCRC32[j][i] = (lCRC >> 8) ^ alCRC32[0][lCRC & 0xFF];
+    }
+  }
+  fTables = true;
+}
+
+
+uint32_t ckSum (const uint8_t *pb, uint32_t cb)
+{
+  //++
+  //   Return the sum of cb bytes, modulo 2^32 ...
+  //--
+  uint32_t lSum = 0;
+#if defined(__SSE2__)
+  __m128i vZero = _mm_setzero_si128(), vSum = _mm_setzero_si128();
+  for (;  cb >= 64;  cb -= 64, pb += 64) {
+    vSum = _mm_add_epi64(vSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (pb   )), vZero));
+    vSum = _mm_add_epi64(vSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (pb+16)), vZero));
+    vSum = _mm_add_epi64(vSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (pb+32)), vZero));
+    vSum = _mm_add_epi64(vSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) (pb+48)), vZero));
+  }
+  for (;  cb >= 16;  cb -= 16, pb += 16)
+    vSum = _mm_add_epi64(vSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *) pb), vZero));
+  lSum = (uint32_t) _mm_cvtsi128_si32(vSum)
+       + (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(vSum, 8));
+#endif
+  while (cb-- > 0)  lSum += *pb++;
+  return lSum;
+}
+
+
+uint32_t ckSumLE16 (const uint8_t *pb, uint32_t cb)
+{
+  //++
+  //   Return the sum of cb bytes taken as little endian (PDP-11 order) sixteen
+  // bit words, modulo 2^32.  If cb is odd, the last byte is a low byte.  The
+  // SSE2 version adds up the even and the odd bytes separately and then puts
+  // them together at the end ...
+  //--
+  uint32_t lEven = 0, lOdd = 0;
+#if defined(__SSE2__)
+  __m128i vZero = _mm_setzero_si128(), vMask = _mm_set1_epi16(0x00FF);
+  __m128i vEven = _mm_setzero_si128(), vOdd = _mm_setzero_si128();
+  for (;  cb >= 16;  cb -= 16, pb += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) pb);
+    vEven = _mm_add_epi64(vEven, _mm_sad_epu8(_mm_and_si128(v, vMask), vZero));
+    vOdd  = _mm_add_epi64(vOdd,  _mm_sad_epu8(_mm_srli_epi16(v, 8), vZero));
+  }
+  lEven = (uint32_t) _mm_cvtsi128_si32(vEven) + (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(vEven, 8));
+  lOdd  = (uint32_t) _mm_cvtsi128_si32(vOdd)  + (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(vOdd, 8));
+#endif
+  for (;  cb >= 2;  cb -= 2, pb += 2)  {lEven += pb[0];  lOdd += pb[1];}
+  if (cb != 0) lEven += pb[0];
+  return lEven + (lOdd << 8);
+}
+
+
+uint32_t ckSumWords (const uint16_t *pw, uint32_t cw)
+{
+  //++
+  //   Return the sum of cw sixteen bit words, modulo 2^32.  The SSE2 version
+  // widens eight words at a time to 32 bits and adds them four at a time.
+  // The 32 bit lanes can overflow, but since we want the result modulo 2^32
+  // anyway that doesn't matter ...
+  //--
+  uint32_t lSum = 0;
+#if defined(__SSE2__)
+  __m128i vZero = _mm_setzero_si128(), vSum = _mm_setzero_si128();
+  for (;  cw >= 8;  cw -= 8, pw += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *) pw);
+    vSum = _mm_add_epi32(vSum, _mm_unpacklo_epi16(v, vZero));
+    vSum = _mm_add_epi32(vSum, _mm_unpackhi_epi16(v, vZero));
+  }
+  vSum = _mm_add_epi32(vSum, _mm_srli_si128(vSum, 8));
+  vSum = _mm_add_epi32(vSum, _mm_srli_si128(vSum, 4));
+  lSum = (uint32_t) _mm_cvtsi128_si32(vSum);
+#endif
+  while (cw-- > 0)  lSum += *pw++;
+  return lSum;
+}
+
+
+uint16_t ckCRC16 (uint16_t wCRC, const uint8_t *pb, uint32_t cb)
+{
+  //++
+  //   Update a CRC-16/CCITT with cb more bytes.  Start with CK_CRC16_INIT.
+  // Since the CRC is only two bytes, only the first two of each group of
+  // eight are XORed with the CRC before we look them up ...
+  //--
+  if (!fTables) BuildTables();
+  for (;  cb >= 8;  cb -= 8, pb += 8) {
+    wCRC ^= (uint16_t) ((pb[0] << 8) | pb[1]);
+    wCRC = awCRC16[7][wCRC >> 8] ^ awCRC16[6][wCRC & 0xFF]
+         ^ awCRC16[5][pb[2]]     ^ awCRC16[4][pb[3]]
+         ^ awCRC16[3][pb[4]]     ^ awCRC16[2][pb[5]]
+         ^ awCRC16[1][pb[6]]     ^ awCRC16[0][pb[7]];
+  }
+  while (cb-- > 0)
+    wCRC = (uint16_t) ((wCRC << 8) ^ awCRC16[0][(wCRC >> 8) ^ *pb++]);
+  return wCRC;
+}
+
+
+uint32_t ckCRC32 (uint32_t lCRC, const uint8_t *pb, uint32_t cb)
+{
+  //++
+  //   Update a CRC-32 with cb more bytes.  Start with CK_CRC32_INIT.  This
+  // one is reflected, so the first four bytes of each group are XORed with
+  // the CRC in little endian order ...
+  //--
+  if (!fTables) BuildTables();
+  lCRC = ~lCRC;
+  for (;  cb >= 8;  cb -= 8, pb += 8) {
+    uint32_t l = lCRC ^ (pb[0] | (pb[1] << 8) | (pb[2] << 16) | ((uint32_t) pb[3] << 24));
+    lCRC = alCRC32[7][l & 0xFF]         ^ alCRC32[6][(l >> 8) & 0xFF]
+         ^ alCRC32[5][(l >> 16) & 0xFF] ^ alCRC32[4][l >> 24]
+         ^ alCRC32[3][pb[4]]            ^ alCRC32[2][pb[5]]
+         ^ alCRC32[1][pb[6]]            ^ alCRC32[0][pb[7]];
+  }
+  while (cb-- > 0)
+    lCRC = (lCRC >> 8) ^ alCRC32[0][(lCRC ^ *pb++) & 0xFF];
+  return ~lCRC;
+}
+
+
+bool ckSumCorrection (uint16_t wSum, uint8_t *pbCheckH, uint8_t *pbCheckL, uint8_t *pbCorrH, uint8_t *pbCorrL)
+{
+  //++
+  //   This is the romcksum EPROM checksum.  Given the sixteen bit sum of all
+  // the bytes in the EPROM (with the four checksum bytes set to zero), it
+  // calculates the two checksum bytes, CheckH (high byte) and CheckL (low
+  // byte), AND two "correction" bytes, CorrH and CorrL.  The correction bytes
+  // are calculated so that when they're added to the sum of all the other
+  // EPROM bytes, plus the checksum bytes, the total is the checksum.  Usually
+  // this is simple because a byte plus its complement is always 0x0100, but
+  // there are special cases when that byte is zero.  Returns false in the one
+  // case where there's no answer at all...
+  //--
+  *pbCheckL = (uint8_t) wSum;  *pbCorrL = -*pbCheckL;
+  if (wSum == 0xFE01) {
+    //   This is the case where everything falls apart.  The correct checksum
+    // in this case should be 0x0001, but to get from 0xFE01 to 0x0001 we need
+    // two correction bytes that total 0x0200.  That's not going to happen, and
+    // I don't see any games we could play to make it happen!
+    return false;
+  } else if ((wSum > 0xFE01) && (wSum < 0xFF01)) {
+    //   If the checksum is in this range, then adding 0x0200 would produce a
+    // high byte of zero.  That's not bad by itself, but the complement of zero
+    // is zero and 0+0 doesn't produce any carry!  The trick is to set the
+    // high order correction byte to 0xFF instead of zero, and then ALSO bump
+    // the low byte by one.  This produces 0xFF+1, which gives another carry.
+    *pbCheckH = 0x00;  *pbCorrH = 0xFF;  ++*pbCorrL;
+  } else {
+    //   This is the easy case - we add 0x0100 to the checksum to account for
+    // the carry from the high byte and, unless the low byte of the checksum
+    // happens to be zero, another 0x0100 for the carry from the low byte.
+    // Remember that adding 1 to the high byte alone is the same as adding
+    // 0x0100 to the entire checksum!
+    *pbCheckH = (uint8_t) ((wSum >> 8) + 1);
+    if (*pbCheckL != 0) ++*pbCheckH;
+    *pbCorrH = -*pbCheckH;
+  }
+  return true;
+}
+
+
+const char *ckTypeName (CK_TYPE nType)
+{
+  //++
+  // Return the name ("sum", "crc16" or "crc32") of a checksum type...
+  //--
+  return ((unsigned) nType < NTYPES) ? apszTypes[nType] : "?";
+}
+
+
+bool ckTypeFromName (const char *psz, size_t cch, CK_TYPE *pnType)
+{
+  //++
+  //   Look up the first cch characters of psz as a checksum type name and
+  // return false if it isn't one...
+  //--
+  unsigned i;
+  for (i = 0;  i < NTYPES;  ++i) {
+    if ((strlen(apszTypes[i]) == cch) && (strncmp(psz, apszTypes[i], cch) == 0)) {
+      *pnType = (CK_TYPE) i;  return true;
+    }
+  }
+  return false;
+}
+
+
+void ckStore (uint8_t *pb, uint32_t lValue, uint32_t cb, bool fLittleEndian)
+{
+  //++
+  //   Store a cb byte checksum or CRC in the ROM image, in either byte
+  // order...
+  //--
+  uint32_t i;
+  for (i = 0;  i < cb;  ++i, lValue >>= 8)
+    pb[fLittleEndian ? i : cb-1-i] = (uint8_t) lValue;
+}
+
+
+bool ckRegion (
+  const char       *pszProgram,   // program name for error messages
+  uint8_t          *pbROM,        // the ROM image
+  uint32_t          cbROM,        // and its size, in bytes
+  const CK_REGION  *pRegion,      // region to checksum
+  bool              fLittleEndian,// byte order for the checksum
+  uint32_t         *plValue)      // returns the checksum or CRC
+{
+  //++
+  //   Compute the checksum or CRC for one region of the ROM and store it in
+  // the image.  It's an error if the region doesn't fit in the ROM, if the
+  // four bytes of a sum aren't inside its own region (that's what makes it
+  // work!) or if a CRC is inside its own region (that wouldn't work at all).
+  // Any error prints a message, prefixed by pszProgram, and returns false...
+  //--
+  uint32_t lStart = pRegion->lStart, lEnd = pRegion->lStart + pRegion->lSize;
+  uint32_t lOffset = pRegion->lOffset, cbCheck = acbTypes[pRegion->nType];
+  uint8_t bCheckH, bCheckL, bCorrH, bCorrL;
+
+  // Make sure the region and its checksum make sense...
+  if (   (pRegion->lSize == 0)
+      || (((uint64_t) lStart + pRegion->lSize) > cbROM)
+      || (((uint64_t) lOffset + cbCheck) > cbROM)) {
+    fprintf(stderr,"%s: %s region at 0x%05X doesn't fit in the ROM\n", pszProgram, apszTypes[pRegion->nType], lStart);
+    return false;
+  }
+  if ((pRegion->nType == CK_SUM) && ((lOffset < lStart) || ((lOffset+cbCheck) > lEnd))) {
+    fprintf(stderr,"%s: checksum at 0x%05X must be inside its region\n", pszProgram, lOffset);
+    return false;
+  }
+  if ((pRegion->nType != CK_SUM) && ((lOffset+cbCheck) > lStart) && (lOffset < lEnd)) {
+    fprintf(stderr,"%s: CRC at 0x%05X can't be inside its region\n", pszProgram, lOffset);
+    return false;
+  }
+
+  switch (pRegion->nType) {
+    case CK_SUM:
+      //   Force the bytes occupied by the checksum to zeros, sum the region
+      // and then calculate the magic bytes ...
+      memset(pbROM+lOffset, 0, cbCheck);
+      if (!ckSumCorrection((uint16_t) ckSum(pbROM+lStart, pRegion->lSize), &bCheckH, &bCheckL, &bCorrH, &bCorrL)) {
+        fprintf(stderr,"%s: unable to calculate checksum for 0x%05X..0x%05X\n", pszProgram, lStart, lEnd-1);
+        return false;
+      }
+      // Put the correction and the checksum in the ROM image...
+      ckStore(pbROM+lOffset,   ((uint32_t) bCorrH  << 8) | bCorrL,  2, fLittleEndian);
+      ckStore(pbROM+lOffset+2, ((uint32_t) bCheckH << 8) | bCheckL, 2, fLittleEndian);
+      *plValue = ((uint32_t) bCheckH << 8) | bCheckL;
+      return true;
+
+    case CK_CRC16:
+      *plValue = ckCRC16(CK_CRC16_INIT, pbROM+lStart, pRegion->lSize);
+      ckStore(pbROM+lOffset, *plValue, cbCheck, fLittleEndian);
+      return true;
+
+    case CK_CRC32:
+      *plValue = ckCRC32(CK_CRC32_INIT, pbROM+lStart, pRegion->lSize);
+      ckStore(pbROM+lOffset, *plValue, cbCheck, fLittleEndian);
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,61 @@
+//++
+// checksum.h -> declarations for the shared checksum and CRC routines
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// REVISION HISTORY:
+// 14-OCT-26  AGT   New file.
+// 14-OCT-26  AGT   Add ckSumCorrection() from romcksum, for rombuild.
+// 14-OCT-26  AGT   Add the checksum regions from romcksum and rombuild.
+//--
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+//   Initial values for ckCRC16() and ckCRC32().  The CRC-16 is the CCITT
+// polynomial (0x1021), MSB first, with no final XOR - the "CCITT-FALSE"
+// flavor.  The CRC-32 is the usual reflected one from Ethernet and zlib (the
+// inversion before and after is done for you).  Either one can be computed in
+// pieces by passing the result from one call as the initial value for the
+// next ...
+#define CK_CRC16_INIT   0xFFFF
+#define CK_CRC32_INIT   0x00000000UL
+
+//   A checksum region, from a romcksum -x option or a rombuild checksum
+// statement.  The checksum or CRC of lSize bytes starting at lStart is stored
+// at lOffset - four bytes for a sum (the correction and the checksum), two
+// for a CRC-16 and four for a CRC-32 ...
+typedef enum _CK_TYPE {CK_SUM, CK_CRC16, CK_CRC32} CK_TYPE;
+typedef struct _CK_REGION {
+  CK_TYPE        nType;     // algorithm to use
+  uint32_t       lStart;    // first byte of the region
+  uint32_t       lSize;     // and the size of the region, in bytes
+  uint32_t       lOffset;   // where the checksum is stored
+} CK_REGION;
+
+// Global methods ...
+extern uint32_t ckSum (const uint8_t *pb, uint32_t cb);
+extern uint32_t ckSumLE16 (const uint8_t *pb, uint32_t cb);
+extern uint32_t ckSumWords (const uint16_t *pw, uint32_t cw);
+extern uint16_t ckCRC16 (uint16_t wCRC, const uint8_t *pb, uint32_t cb);
+extern uint32_t ckCRC32 (uint32_t lCRC, const uint8_t *pb, uint32_t cb);
+extern bool ckSumCorrection (uint16_t wSum, uint8_t *pbCheckH, uint8_t *pbCheckL, uint8_t *pbCorrH, uint8_t *pbCorrL);
+extern const char *ckTypeName (CK_TYPE nType);
+extern bool ckTypeFromName (const char *psz, size_t cch, CK_TYPE *pnType);
+extern void ckStore (uint8_t *pb, uint32_t lValue, uint32_t cb, bool fLittleEndian);
+extern bool ckRegion (const char *pszProgram, uint8_t *pbROM, uint32_t cbROM, const CK_REGION *pRegion, bool fLittleEndian, uint32_t *plValue);
+
+#endif  // ifndef _CHECKSUM_H_
@@ -0,0 +1,333 @@
+//++
+// intelhex.c - Intel .HEX file reader and writer shared by the ROM tools
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//   Based on the .HEX file loaders in romcksum, rommerge, pdp2hex and PromICE,
+//   Copyright (C) 2000-2024 by Robert Armstrong and Spare Time Gizmos.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   This module reads Intel .HEX files for romcksum, rommerge, pdp2hex and
+// PromICE.  They all used to have their own copy of the same loader, which
+// called fscanf() once for every byte and knew only about record types 00
+// (data) and 01 (end of file).  This one reads the whole file into memory
+// with a single fread(), decodes the hex digits with a table lookup, checks
+// the checksum of every record and understands the 02 (extended segment
+// address) and 04 (extended linear address) records, so images bigger than
+// 64K work too.  The 03 and 05 start address records are ignored.
+//
+//   hexRead() doesn't know anything about where the data goes - it calls
+// the caller's routine once for each data record with the full address of
+// the first byte.  That way each tool can keep its own idea of offsets, ROM
+// sizes and conflicts, and its own error messages too!
+//
+//   hexWrite() replaces the tools' WriteHex() routines, which used fprintf()
+// for every byte.  It formats the records into a big buffer and writes that
+// with fwrite().  The record length can be anything up to 255 bytes, runs of
+// the filler byte can be left out entirely (so a sparse ROM makes a small
+// file), and images bigger than 64K get extended linear address records.
+//
+// REVISION HISTORY:
+// 14-OCT-26    AGT     New file.
+// 14-OCT-26    AGT     Add hexWrite().
+// 14-OCT-26    AGT     Only 02 segment offsets wrap at 64K; 04 linear addresses carry.
+// 14-OCT-26    AGT     Add hexPrintError(), from rommerge and romcksum.
+//--
+#include <stdio.h>              // printf(), FILE, etc ...
+#include <stdlib.h>             // malloc(), free(), etc ...
+#include <stdint.h>             // uint8_t, uint32_t, etc ...
+#include <stdbool.h>            // bool, true, false, etc ...
+#include "intelhex.h"           // declarations for this module
+
+#ifndef MIN
+#define MIN(a,b) ( (a) < (b) ? (a) : (b) )
+#endif
+
+//   The value of each hex digit, plus HEX_VALID.  Everything else, including
+// the null at the end of the buffer, is zero...
+#define HEX_VALID   0x10
+static const uint8_t abHexDigit[256] = {
+  ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+  ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+  ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E,
+  ['F'] = 0x1F, ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D,
+  ['e'] = 0x1E, ['f'] = 0x1F
+};
+
+// And the characters fscanf() would skip between records ...
+#define ISSPACE(c)  (((c) == ' ') || (((c) >= '\t') && ((c) <= '\r')))
+
+// hexWrite() parameters ...
+#define HEX_RECORD_SIZE  16     // default data bytes per record
+#define HEX_MAX_RECORD  524     // longest formatted record, in characters
+#define HEX_BUFFER    65536     // size of the output buffer
+#define HEX_MIN_SKIP      8     // shortest run of filler worth leaving out
+
+
+static inline bool DecodeByte (const char *p, uint8_t *pb)
+{
+  //++
+  //   Convert two hex digits to a byte and return false if either one isn't
+  // a hex digit.  This always looks at both characters, so the buffer needs
+  // two nulls at the end...
+  //--
+  uint8_t h = abHexDigit[(uint8_t) p[0]], l = abHexDigit[(uint8_t) p[1]];
+  *pb = (uint8_t) ((h << 4) | (l & 0x0F));
+  return (h & l & HEX_VALID) != 0;
+}
+
+
+static char *ReadFile (const char *pszFile)
+{
+  //++
+  //   Read the entire file into memory, followed by two nulls, and return a
+  // pointer to the buffer (or NULL if anything goes wrong) ...
+  //--
+  FILE *f;  long cbFile;  char *pszText = NULL;
+  if ((f = fopen(pszFile, "rb")) == NULL) return NULL;
+  if ((fseek(f, 0, SEEK_END) == 0) && ((cbFile = ftell(f)) >= 0)
+   && (fseek(f, 0, SEEK_SET) == 0)
+   && ((pszText = malloc((size_t) cbFile+2)) != NULL)) {
+    if (fread(pszText, 1, (size_t) cbFile, f) == (size_t) cbFile) {
+      pszText[cbFile] = pszText[cbFile+1] = '\0';
+    } else {
+      free(pszText);  pszText = NULL;
+    }
+  }
+  fclose(f);
+  return pszText;
+}
+
+
+HEX_STATUS hexRead (
+  const char   *pszFile,    // name of the file to read
+  HEX_CALLBACK  pfnData,    // called for each data record
+  void         *pContext,   // passed to pfnData
+  HEX_RECORD   *pRecord)    // current record (returned when it fails)
+{
+  //++
+  //   Read an Intel .HEX file and call pfnData for every data record in it.
+  // A record that wraps around the end of a 64K segment (with no extended
+  // address or after an 02 record) is passed as two pieces, so the bytes in
+  // each call are always at consecutive addresses.  After an 04 record the
+  // address is a 32 bit linear one and just carries into the next 64K.
+  // Returns HEX_OK if the whole file, up to its EOF record, was read.  If
+  // not then pRecord shows the line and record where the problem is.
+  //--
+  char       *pszText, *p;  // the entire file, and our place in it
+  uint8_t     abData[255];  // data bytes from the current record
+  uint8_t     cbRecord, bHigh, bLow, bChecksum;
+  uint32_t    lBase = 0;    // extended segment or linear address
+  bool        fLinear = false;  // true if lBase came from an 04 record
+  uint32_t    cbFirst, i;
+  HEX_STATUS  nStatus = HEX_OK;
+
+  pRecord->pszFile = pszFile;  pRecord->nLine = 1;  pRecord->nType = 0;
+  pRecord->nRecAddr = 0;  pRecord->lAddress = 0;  pRecord->bChecksum = 0;
+  pRecord->cbData = 0;  pRecord->pbData = abData;
+  if ((pszText = ReadFile(pszFile)) == NULL) return HEX_OPEN_ERROR;
+
+  for (p = pszText;  ;  ) {
+    // Skip any white space (including the end of the last line) ...
+    while (ISSPACE(*p)) { if (*p == '\n') ++pRecord->nLine;  ++p; }
+
+    // Decode the record header - length, load address and record type ...
+    if ((*p != ':') || !DecodeByte(p+1, &cbRecord) || !DecodeByte(p+3, &bHigh)
+     || !DecodeByte(p+5, &bLow) || !DecodeByte(p+7, &pRecord->nType))
+      {nStatus = HEX_FORMAT_HEADER;  break;}
+    p += 9;
+    pRecord->nRecAddr = (uint16_t) ((bHigh << 8) | bLow);
+    pRecord->cbData = cbRecord;  pRecord->pbData = abData;
+    if (pRecord->nType > HEX_START_LINEAR)
+      {nStatus = HEX_UNKNOWN_TYPE;  break;}
+
+    // The data bytes and the checksum, which should make it all add to zero ...
+    bChecksum = cbRecord + bHigh + bLow + pRecord->nType;
+    for (i = 0;  i < cbRecord;  ++i, p += 2) {
+      if (!DecodeByte(p, &abData[i])) break;
+      bChecksum += abData[i];
+    }
+    if (i < cbRecord) {nStatus = HEX_FORMAT_DATA;  break;}
+    if (!DecodeByte(p, &bLow)) {nStatus = HEX_FORMAT_CHECKSUM;  break;}
+    p += 2;  pRecord->bChecksum = bChecksum + bLow;
+    if (pRecord->bChecksum != 0) {nStatus = HEX_CHECKSUM_ERROR;  break;}
+
+    // Now figure out what to do with this record ...
+    if (pRecord->nType == HEX_EOF) break;
+    if ((pRecord->nType == HEX_EXT_SEGMENT) || (pRecord->nType == HEX_EXT_LINEAR)) {
+      if (cbRecord != 2) {nStatus = HEX_FORMAT_DATA;  break;}
+      lBase = (uint32_t) ((abData[0] << 8) | abData[1]);
+      fLinear = (pRecord->nType == HEX_EXT_LINEAR);
+      lBase <<= fLinear ? 16 : 4;
+      continue;
+    }
+    if ((pRecord->nType != HEX_DATA) || (cbRecord == 0)) continue;
+
+    //   The offset within a segment wraps around from FFFF to 0000, so we
+    // might have to split this record in two.  A linear address doesn't ...
+    cbFirst = 0x10000 - pRecord->nRecAddr;
+    if (fLinear || (cbFirst > cbRecord)) cbFirst = cbRecord;
+    pRecord->lAddress = lBase + pRecord->nRecAddr;  pRecord->cbData = cbFirst;
+    if (!(*pfnData)(pContext, pRecord)) {nStatus = HEX_STOPPED;  break;}
+    if (cbFirst < cbRecord) {
+      pRecord->lAddress = lBase;  pRecord->pbData = abData + cbFirst;
+      pRecord->cbData = cbRecord - cbFirst;
+      if (!(*pfnData)(pContext, pRecord)) {nStatus = HEX_STOPPED;  break;}
+    }
+  }
+
+  free(pszText);  pRecord->pbData = NULL;
+  return nStatus;
+}
+
+
+void hexPrintError (
+  HEX_STATUS         nStatus,   // status returned by hexRead()
+  const HEX_RECORD  *pRecord)   // and the record it returned
+{
+  //++
+  //   Print the usual message for a hexRead() error on stderr, prefixed by
+  // the name of the file.  HEX_OK and HEX_STOPPED print nothing - only the
+  // caller knows why its callback stopped...
+  //--
+  const char *pszFile = pRecord->pszFile;
+  switch (nStatus) {
+    case HEX_OPEN_ERROR:
+      fprintf(stderr,"%s: unable to open file\n", pszFile);  break;
+    case HEX_FORMAT_HEADER:
+      fprintf(stderr,"%s: bad .HEX file format (1)\n", pszFile);  break;
+    case HEX_FORMAT_DATA:
+      fprintf(stderr,"%s: bad .HEX file format (2)\n", pszFile);  break;
+    case HEX_FORMAT_CHECKSUM:
+      fprintf(stderr,"%s: bad .HEX file format (3)\n", pszFile);  break;
+    case HEX_UNKNOWN_TYPE:
+      fprintf(stderr,"%s: unknown record type %d\n", pszFile, pRecord->nType);  break;
+    case HEX_CHECKSUM_ERROR:
+      fprintf(stderr,"%s: checksum error\n", pszFile);  break;
+    default:
+      break;
+  }
+}
+
+
+static inline char *FormatByte (char *p, uint8_t b)
+{
+  //++
+  // Store two hex digits in the buffer and return the next free position...
+  //--
+  static const char achHex[] = "0123456789ABCDEF";
+  *p++ = achHex[b >> 4];  *p++ = achHex[b & 0x0F];
+  return p;
+}
+
+
+static char *FormatRecord (
+  char          *p,         // buffer for the formatted record
+  uint8_t        nType,     // record type
+  uint16_t       nRecAddr,  // sixteen bit load address
+  const uint8_t *pbData,    // data bytes
+  uint32_t       cbStride,  // distance between data bytes
+  uint8_t        cbData)    // number of data bytes
+{
+  //++
+  //   Format one Intel .HEX record, checksum and newline included, and return
+  // the next free position in the buffer...
+  //--
+  uint8_t bChecksum = cbData + (nRecAddr >> 8) + (nRecAddr & 0xFF) + nType;
+  uint32_t i;
+  *p++ = ':';  p = FormatByte(p, cbData);
+  p = FormatByte(p, (uint8_t) (nRecAddr >> 8));  p = FormatByte(p, (uint8_t) nRecAddr);
+  p = FormatByte(p, nType);
+  for (i = 0;  i < cbData;  ++i) {
+    p = FormatByte(p, pbData[i*cbStride]);  bChecksum += pbData[i*cbStride];
+  }
+  p = FormatByte(p, (uint8_t) -bChecksum);  *p++ = '\n';
+  return p;
+}
+
+
+bool hexWrite (
+  FILE              *f,         // file to write (already open)
+  const uint8_t     *pbData,    // first byte to write
+  uint32_t           cbData,    // number of bytes to write
+  uint32_t           cbStride,  // distance between bytes (e.g. 2 for every other)
+  uint32_t           lAddress,  // load address of the first byte
+  const HEX_OPTIONS *pOptions)  // record size, filler, etc (NULL for defaults)
+{
+  //++
+  //   Write cbData bytes, taken every cbStride bytes starting at pbData, to
+  // an Intel .HEX file with load addresses starting at lAddress.  The EOF
+  // record is written at the end.  With the default options the file is
+  // exactly what the old WriteHex() routines wrote.  With fSkipFill, filler
+  // bytes at the start or end of a record are left out, and so is any run of
+  // at least HEX_MIN_SKIP of them in the middle - a shorter run costs less
+  // than starting a new record.  With fExtended a record never crosses a 64K
+  // boundary and an extended linear address record is written whenever the
+  // upper sixteen bits change.  Returns false if there's an error writing the
+  // file.
+  //--
+  static const HEX_OPTIONS Defaults = {HEX_RECORD_SIZE, false, 0xFF, false};
+  char      *pszBuffer, *p;     // output buffer and our place in it
+  uint32_t   cbMax, cbRecord;   // longest record, and this record
+  uint32_t   lRecAddr;          // address of this record
+  uint32_t   lUpper = 0;        // upper 16 bits of the address we've written
+  uint32_t   i, j, cbRun;
+  uint8_t    abUpper[2];
+  bool       fOK;
+
+  if (pOptions == NULL) pOptions = &Defaults;
+  cbMax = (pOptions->cbRecord == 0) ? HEX_RECORD_SIZE : pOptions->cbRecord;
+  if ((pszBuffer = malloc(HEX_BUFFER)) == NULL) return false;
+
+  for (i = 0, p = pszBuffer;  i < cbData;  i += cbRecord) {
+    // Never start a record with a filler byte ...
+    cbRecord = 1;
+    if (pOptions->fSkipFill && (pbData[i*cbStride] == pOptions->bFill)) continue;
+
+    //   Figure out the size of this record - the default size unless we run
+    // out of data, cross a 64K boundary or find a run of filler bytes ...
+    lRecAddr = lAddress + i;
+    cbRecord = MIN(cbMax, cbData-i);
+    if (pOptions->fExtended) {
+      cbRecord = MIN(cbRecord, 0x10000 - (lRecAddr & 0xFFFF));
+      if ((lRecAddr >> 16) != lUpper) {
+        lUpper = lRecAddr >> 16;
+        abUpper[0] = (uint8_t) (lUpper >> 8);  abUpper[1] = (uint8_t) lUpper;
+        p = FormatRecord(p, HEX_EXT_LINEAR, 0, abUpper, 1, 2);
+      }
+    }
+    if (pOptions->fSkipFill) {
+      for (j = 0, cbRun = 0;  j < cbRecord;  ++j) {
+        cbRun = (pbData[(i+j)*cbStride] == pOptions->bFill) ? cbRun+1 : 0;
+        if (cbRun == HEX_MIN_SKIP) break;
+      }
+      cbRecord = (j < cbRecord) ? j+1-cbRun : cbRecord-cbRun;
+    }
+
+    // Write the record, and empty the buffer if it's getting full ...
+    p = FormatRecord(p, HEX_DATA, (uint16_t) lRecAddr, pbData+i*cbStride, cbStride, (uint8_t) cbRecord);
+    if ((p - pszBuffer) > (HEX_BUFFER - 2*HEX_MAX_RECORD)) {
+      fwrite(pszBuffer, 1, p - pszBuffer, f);  p = pszBuffer;
+    }
+  }
+
+  // Finish up with an EOF record ...
+  p = FormatRecord(p, HEX_EOF, 0, NULL, 1, 0);
+  fwrite(pszBuffer, 1, p - pszBuffer, f);
+  fOK = !ferror(f);
+  free(pszBuffer);
+  return fOK;
+}
@@ -0,0 +1,83 @@
+//++
+// intelhex.h -> declarations for the shared Intel .HEX file routines
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// REVISION HISTORY:
+// 14-OCT-26  AGT   New file.
+// 14-OCT-26  AGT   Add hexPrintError().
+//--
+#ifndef _INTELHEX_H_
+#define _INTELHEX_H_
+
+// Intel .HEX record types ...
+#define HEX_DATA            0x00  // data record
+#define HEX_EOF             0x01  // end of file
+#define HEX_EXT_SEGMENT     0x02  // extended segment address (bits 4..19)
+#define HEX_START_SEGMENT   0x03  // start segment address (ignored)
+#define HEX_EXT_LINEAR      0x04  // extended linear address (bits 16..31)
+#define HEX_START_LINEAR    0x05  // start linear address (ignored)
+
+//   hexRead() returns one of these.  The three "format" errors are the same
+// ones the old fscanf() loaders reported as "format error (1)", "(2)" and
+// "(3)" - a bad record header, bad data and a missing checksum byte ...
+typedef enum _HEX_STATUS {
+  HEX_OK,                   // file read successfully
+  HEX_OPEN_ERROR,           // unable to open or read the file
+  HEX_FORMAT_HEADER,        // bad record header (or no EOF record)
+  HEX_FORMAT_DATA,          // bad data in the record
+  HEX_FORMAT_CHECKSUM,      // bad or missing checksum byte
+  HEX_UNKNOWN_TYPE,         // unknown record type
+  HEX_CHECKSUM_ERROR,       // record checksum doesn't match
+  HEX_STOPPED               // the callback routine returned false
+} HEX_STATUS;
+
+//   This describes the current record - it's passed to the callback for each
+// data record and, when hexRead() fails, it tells where.  lAddress is the
+// full address of the first data byte, including any extended segment or
+// linear address, and nRecAddr is just the sixteen bit address from the
+// record itself.  pbData is valid only while the callback is running ...
+typedef struct _HEX_RECORD {
+  const char    *pszFile;   // name of the file being read
+  uint32_t       nLine;     // line number in the file
+  uint8_t        nType;     // record type (HEX_DATA, HEX_EOF, etc)
+  uint16_t       nRecAddr;  // load address from the record
+  uint32_t       lAddress;  // full address of the first data byte
+  uint8_t        bChecksum; // checksum (non-zero for a checksum error)
+  uint32_t       cbData;    // number of data bytes
+  const uint8_t *pbData;    // and the data bytes themselves
+} HEX_RECORD;
+
+// Called for each data record, and returns false to stop reading ...
+typedef bool (*HEX_CALLBACK) (void *pContext, const HEX_RECORD *pRecord);
+
+//   Options for hexWrite().  Passing NULL instead gets the traditional format
+// - sixteen byte records, every byte written and sixteen bit addresses that
+// wrap around at 64K ...
+typedef struct _HEX_OPTIONS {
+  uint8_t        cbRecord;  // data bytes per record (1..255, 0 means 16)
+  bool           fSkipFill; // true to leave out runs of the filler byte
+  uint8_t        bFill;     // the filler byte for fSkipFill
+  bool           fExtended; // write extended linear address records
+} HEX_OPTIONS;
+
+// Global methods ...
+extern HEX_STATUS hexRead (const char *pszFile, HEX_CALLBACK pfnData, void *pContext, HEX_RECORD *pRecord);
+extern void hexPrintError (HEX_STATUS nStatus, const HEX_RECORD *pRecord);
+extern bool hexWrite (FILE *f, const uint8_t *pbData, uint32_t cbData, uint32_t cbStride, uint32_t lAddress, const HEX_OPTIONS *pOptions);
+
+#endif  // ifndef _INTELHEX_H_
@@ -0,0 +1,64 @@
+//++
+// textfile.c - read a plain ASCII help text file into a ROM image
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//   txtRead() is ReadText() from romtext, Copyright (C) 2004-2024 by Spare
+//   Time Gizmos.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   This is the ReadText() routine from romtext, moved here so that rombuild
+// can put help text straight into its ROM image.  Lines that start with "#"
+// are comments and are ignored, every line ends with <CR><LF> no matter how
+// it ended in the file, and the whole thing ends with a null byte.
+//
+// REVISION HISTORY:
+// 14-OCT-26    AGT     New file.
+//--
+#include <stdio.h>              // FILE, fgets(), etc ...
+#include <stdint.h>             // uint8_t, uint32_t, etc ...
+#include <string.h>             // strlen(), strcat(), etc ...
+#include "textfile.h"           // declarations for this module
+
+#define MAXLINE 512             // longest line possible
+
+
+uint32_t txtRead (FILE *f, uint8_t *pbData, uint32_t cbMax)
+{
+  //++
+  //   Read the text file and store it in the buffer.  No more than cbMax
+  // bytes are stored, but the return value is the size of all the text
+  // (including the null at the end) so the caller can tell if it didn't fit.
+  //--
+  char szLine[MAXLINE+2];  uint32_t cbText = 0;
+
+  while (fgets(szLine, MAXLINE, f) != NULL) {
+    char *psz;  size_t len = strlen(szLine);
+    // Ignore comments...
+    if ((len > 0) && (szLine[0] == '#')) continue;
+    // Convert the line ending to <CRLF> regardless of what we read...
+    if ((len > 0) && (szLine[len-1] == '\n')) szLine[--len] = 0;
+    if ((len > 0) && (szLine[len-1] == '\r')) szLine[--len] = 0;
+    strcat(szLine, "\r\n");
+    // Append the line to the buffer ...
+    for (psz = szLine;  *psz != 0;  ++psz) {
+      if (cbText++ < cbMax) *pbData++ = *psz;
+    }
+  }
+  // Always end with a null byte!
+  if (cbText++ < cbMax) *pbData++ = 0;
+  return cbText;
+}
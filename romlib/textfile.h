@@ -0,0 +1,29 @@
+//++
+// textfile.h -> declarations for the shared ROM help text reader
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// REVISION HISTORY:
+// 14-OCT-26  AGT   New file.
+//--
+#ifndef _TEXTFILE_H_
+#define _TEXTFILE_H_
+
+// Global methods ...
+extern uint32_t txtRead (FILE *f, uint8_t *pbData, uint32_t cbMax);
+
+#endif  // ifndef _TEXTFILE_H_
@@ -0,0 +1,220 @@
+//++
+// word12.c - PDP-8 twelve bit word routines shared by the SBC6120 tools
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//   Based on the conversion loops in pdp2hex, mkid01 and mkdltxt, Copyright
+//   (C) 2000-2003 by Robert Armstrong.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// DESCRIPTION:
+//   This module has the routines that pdp2hex (and PALX), mkid01 and mkdltxt
+// use to shuffle PDP-8 twelve bit words around.  Each one of them used to
+// have its own loop that did one word, and sometimes one bit, at a time.
+//
+//   The OS/8 "three for two" unpacking uses SSSE3 when the compiler has it
+// (e.g. with -march=native).  PSHUFB moves the twelve bytes for eight words
+// into eight sixteen bit lanes in one go, and then it's just a matter of
+// masking and shifting the odd and even words differently.  The sixteen bit
+// container and mask loops are simple enough that gcc vectorizes them with
+// nothing more than -O3.
+//
+//   The bit reversal for pdp2hex's -r option and the SBC6100 model 1 address
+// permutation are both done with tables, built on the first call, instead of
+// a bit at a time.
+//
+// REVISION HISTORY:
+// 14-OCT-26    AGT     New file.
+//--
+#include <stdio.h>              // NULL, etc ...
+#include <stdint.h>             // uint8_t, uint16_t, etc ...
+#include <stdbool.h>            // bool, true, false, etc ...
+#if defined(__SSSE3__)
+#include <tmmintrin.h>          // _mm_shuffle_epi8(), et al ...
+#endif
+#include "word12.h"             // declarations for this module
+
+// Tables built by BuildTables() ...
+static uint8_t  abReverse8[256];                        // bits 0..7 -> 7..0
+static uint16_t awSBC6100[W12_ADDRESS_SPACE];           // SBC6100 addresses
+static bool     fTables = false;
+
+
+static void BuildTables (void)
+{
+  //++
+  //   The SBC6100 model 1 has its fifteen EPROM address bits wired in the
+  // reverse order, so the permutation is just the fifteen bit reversal of the
+  // address.  That's the reversal of the low byte shifted up seven bits, plus
+  // the reversal of the high seven bits shifted down by one ...
+  //--
+  uint32_t i, j;  uint8_t b;
+  for (i = 0;  i < 256;  ++i) {
+    for (j = 0, b = 0;  j < 8;  ++j)
+      if (i & (1 << j)) b |= (uint8_t) (0x80 >> j);
+    abReverse8[i] = b;
+  }
+  for (i = 0;  i < W12_ADDRESS_SPACE;  ++i)
+    awSBC6100[i] = (uint16_t) ((abReverse8[i & 0xFF] << 7) | (abReverse8[(i >> 8) & 0x7F] >> 1));
+  fTables = true;
+}
+
+
+void w12Unpack3for2 (const uint8_t *pb, uint16_t *pw, uint32_t cw)
+{
+  //++
+  //   Unpack cw twelve bit words (cw must be even) from the OS/8 "three for
+  // two" format.  The first byte is the low eight bits of the first word, the
+  // second byte is the low eight bits of the second, and the low and high
+  // nibbles of the third are the upper four bits of the first and second
+  // words.  This has to agree with both WinEight and the SBC6120 ROM!
+  //
+  //   The SSSE3 version loads sixteen bytes and uses twelve of them, so it
+  // stops while there's still at least four bytes past the end of the group.
+  //--
+#if defined(__SSSE3__)
+  const __m128i vShuffle = _mm_setr_epi8(0,2, 1,2, 3,5, 4,5, 6,8, 7,8, 9,11, 10,11);
+  const __m128i vEven = _mm_set1_epi32(0x0000FFFF), vLow = _mm_set1_epi16(0x00FF);
+  const __m128i vHigh = _mm_set1_epi16(0x0F00), vMask = _mm_set1_epi16(07777);
+  for (;  cw >= 12;  cw -= 8, pb += 12, pw += 8) {
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) pb), vShuffle);
+    __m128i vOdd = _mm_or_si128(_mm_and_si128(v, vLow), _mm_and_si128(_mm_srli_epi16(v, 4), vHigh));
+    v = _mm_or_si128(_mm_and_si128(vEven, _mm_and_si128(v, vMask)), _mm_andnot_si128(vEven, vOdd));
+    _mm_storeu_si128((__m128i *) pw, v);
+  }
+#endif
+  for (;  cw >= 2;  cw -= 2, pb += 3, pw += 2) {
+    pw[0] = (uint16_t) (pb[0] | ((pb[2] & 0x0F) << 8));
+    pw[1] = (uint16_t) (pb[1] | ((pb[2] & 0xF0) << 4));
+  }
+}
+
+
+void w12Pack3for2 (const uint16_t *pw, uint8_t *pb, uint32_t cw)
+{
+  //++
+  // The reverse of w12Unpack3for2(), for cw (even) words ...
+  //--
+  for (;  cw >= 2;  cw -= 2, pb += 3, pw += 2) {
+    pb[0] = (uint8_t) pw[0];  pb[1] = (uint8_t) pw[1];
+    pb[2] = (uint8_t) (((pw[0] >> 8) & 0x0F) | ((pw[1] >> 4) & 0xF0));
+  }
+}
+
+
+void w12UnpackWords (const uint8_t *pb, uint16_t *pw, uint32_t cw)
+{
+  //++
+  //   Unpack cw words from little endian sixteen bit containers, discarding
+  // the upper four bits of each one - exactly what the SBC6120 hardware does.
+  //--
+  uint32_t i;
+  for (i = 0;  i < cw;  ++i)
+    pw[i] = (uint16_t) ((pb[2*i] | (pb[2*i+1] << 8)) & 07777);
+}
+
+
+void w12PackWords (const uint16_t *pw, uint8_t *pb, uint32_t cw)
+{
+  //++
+  // Store cw words in little endian sixteen bit containers ...
+  //--
+  uint32_t i;
+  for (i = 0;  i < cw;  ++i) {
+    pb[2*i] = (uint8_t) pw[i];  pb[2*i+1] = (uint8_t) ((pw[i] >> 8) & 0x0F);
+  }
+}
+
+
+void w12Mask (uint16_t *pw, uint32_t cw)
+{
+  //++
+  // Mask cw words, in place, to twelve bits ...
+  //--
+  uint32_t i;
+  for (i = 0;  i < cw;  ++i)  pw[i] &= 07777;
+}
+
+
+bool w12IsZero (const uint16_t *pw, uint32_t cw)
+{
+  //++
+  //   Return true if all cw words are zero.  There's deliberately no early
+  // exit - this is used on blocks of a hundred or so words, and without one
+  // the loop vectorizes ...
+  //--
+  uint32_t i;  uint16_t w = 0;
+  for (i = 0;  i < cw;  ++i)  w |= pw[i];
+  return (w & 07777) == 0;
+}
+
+
+uint8_t w12Reverse6 (uint8_t b)
+{
+  //++
+  // Reverse the order of the bits in a SIXBIT value ...
+  //--
+  if (!fTables) BuildTables();
+  return (uint8_t) (abReverse8[b & 077] >> 2);
+}
+
+
+uint16_t w12SBC6100Address (uint16_t w)
+{
+  //++
+  // Return the SBC6100 model 1 EPROM address for PDP-8 address w ...
+  //--
+  if (!fTables) BuildTables();
+  return awSBC6100[w & (W12_ADDRESS_SPACE-1)];
+}
+
+
+void w12SplitSixbit (const uint16_t *pw, uint8_t *pbHigh, uint8_t *pbLow, uint32_t cw, bool fReverse, bool fSBC6100)
+{
+  //++
+  //   Split cw twelve bit words into high and low SIXBIT halves, reversing
+  // the bits in each half if fReverse is true.  If fSBC6100 is true then the
+  // halves are stored at the SBC6100 model 1 addresses instead of in order,
+  // and cw can't be more than W12_ADDRESS_SPACE.  The usual case, with both
+  // options false, vectorizes ...
+  //--
+  uint32_t i;  uint8_t abReverse6[64];
+  if (!fReverse && !fSBC6100) {
+    for (i = 0;  i < cw;  ++i) {
+      pbHigh[i] = (uint8_t) ((pw[i] >> 6) & 077);  pbLow[i] = (uint8_t) (pw[i] & 077);
+    }
+    return;
+  }
+  if (!fTables) BuildTables();
+  for (i = 0;  i < 64;  ++i)
+    abReverse6[i] = fReverse ? (uint8_t) (abReverse8[i] >> 2) : (uint8_t) i;
+  for (i = 0;  i < cw;  ++i) {
+    uint32_t a = fSBC6100 ? awSBC6100[i & (W12_ADDRESS_SPACE-1)] : i;
+    pbHigh[a] = abReverse6[(pw[i] >> 6) & 077];  pbLow[a] = abReverse6[pw[i] & 077];
+  }
+}
+
+
+char *w12Octal (char *pch, uint16_t w, uint8_t nDigits)
+{
+  //++
+  //   Store w as exactly nDigits octal digits (like "%0*o", but without the
+  // overhead of printf for each word) and return a pointer to the next free
+  // character.  No null is stored ...
+  //--
+  uint8_t i;
+  for (i = nDigits;  i > 0;  --i, w >>= 3)  pch[i-1] = (char) ('0' + (w & 7));
+  return pch + nDigits;
+}
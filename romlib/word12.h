@@ -0,0 +1,46 @@
+//++
+// word12.h -> declarations for the shared PDP-8 twelve bit word routines
+//
+//   Copyright (C) 2026 by AGT (agent@local).  All rights reserved.
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of the
+//   License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful, but
+//   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+//   ABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+//   Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; if not, visit the website of the Free
+//   Software Foundation, Inc., www.gnu.org.
+//
+// REVISION HISTORY:
+// 14-OCT-26  AGT   New file.
+//--
+#ifndef _WORD12_H_
+#define _WORD12_H_
+
+//   Sizes of the two packed formats.  "Three for two" is the OS/8 way of
+// putting two twelve bit words in three bytes (used by VM01 RAM disk images)
+// and the other one is one word in each little endian sixteen bit container
+// (used by ID01 IDE disk images and the SBC6120 hardware).
+#define W12_3FOR2_BYTES(cw)   (((cw) / 2) * 3)
+#define W12_WORD_BYTES(cw)    ((cw) * 2)
+#define W12_ADDRESS_SPACE     32768     // largest address w12SplitSixbit() permutes
+
+// Global methods ...
+extern void w12Unpack3for2 (const uint8_t *pb, uint16_t *pw, uint32_t cw);
+extern void w12Pack3for2 (const uint16_t *pw, uint8_t *pb, uint32_t cw);
+extern void w12UnpackWords (const uint8_t *pb, uint16_t *pw, uint32_t cw);
+extern void w12PackWords (const uint16_t *pw, uint8_t *pb, uint32_t cw);
+extern void w12Mask (uint16_t *pw, uint32_t cw);
+extern bool w12IsZero (const uint16_t *pw, uint32_t cw);
+extern uint8_t w12Reverse6 (uint8_t b);
+extern uint16_t w12SBC6100Address (uint16_t w);
+extern void w12SplitSixbit (const uint16_t *pw, uint8_t *pbHigh, uint8_t *pbLow, uint32_t cw, bool fReverse, bool fSBC6100);
+extern char *w12Octal (char *pch, uint16_t w, uint8_t nDigits);
+
+#endif  // ifndef _WORD12_H_
@@ -24,20 +24,36 @@
 // to the new HEX file.  Normally the filler is 0x00, but an alternate value
 // may be specified on the command line.
 //
+//   The input files are all read at the same time, each by its own thread
+// and into its own sparse image, and then the images are merged in one pass.
+// Every image keeps a bitmap of the bytes that were actually loaded, so it's
+// an error for two files (or one file twice) to load the same byte, even if
+// the value happens to be equal to the filler.  Conflicts are reported as
+// address ranges, along with the file that loaded them first, and no output
+// file is written.
+//
 // USAGE:
-//  rommerge [-snnnn] [-onnnn] [-fnn] output-file input-file-1 input-file-2 input-file-3 ...
+//  rommerge [-snnnn] [-onnnn] [-fnn] [-rnn] [-u] output-file input-file-1 input-file-2 input-file-3 ...
 //
 //	-snnnn - set the ROM size in bytes (e.g. -s32k or -s32768)
 //      -onnnn - set the offset for the output image
 //	         (e.g. -o32k starts the output image at 0x8000)
 //	-fnn   - set the filler byte to nn decimal (e.g. -f0 or -f255)
+//	-rnn   - write nn data bytes per output record (default 16)
+//	-u     - don't write unused (filler) bytes to the output file
 //
 // NOTE:
-//   This program will work for ROMs up to 64K, which requires that longs
-// be used to sizes and counts...
+//   ROMs bigger than 64K are fine - the input files may use extended segment
+// or linear address records, and the output will use extended linear address
+// records if it needs them.
 //
 // REVISION HISTORY
 // 24-Feb-05	RLA	New file...
+// 14-Oct-26	AGT	Use the shared .HEX file reader in ../romlib
+// 14-Oct-26	AGT	And the shared writer, and add -r and -u
+// 14-Oct-26	AGT	Read all the files in parallel into sparse images, and
+//			  find conflicts exactly.  Allow ROMs bigger than 64K.
+// 14-Oct-26	AGT	Use hexPrintError() for the .HEX file errors
 //--
 #include <stdio.h>		// printf(), scanf(), et al.
 #include <stdlib.h>		// exit(), ...
@@ -45,77 +61,203 @@
 #include <malloc.h>		// malloc(), _fmalloc(), etc...
 #include <memory.h>		// memset(), etc...
 #include <string.h>
+#include <stdbool.h>		// bool, true, false, etc ...
+#include <pthread.h>		// pthread_create(), pthread_join(), etc ...
+#include "intelhex.h"		// hexRead(), HEX_RECORD, etc ...
 
 typedef unsigned char uchar;
 
+// The sparse input images are allocated in pages of this many bytes ...
+#define PAGESIZE  4096
+
 // Globals...
 uint32_t  lROMSize;     // size of the ROM, in bytes (e.g. 65536)
 uint8_t   uFillByte;	// filler value for unused ROM locations
-uint16_t  uROMOffset;	// offset of the EPROM in memory
+uint32_t  uROMOffset;	// offset of the EPROM in memory
 uint8_t  *pbData;	// pointer to the ROM image buffer
 uint32_t lByteCount;	// count of bytes loaded from the .HEX file
 char    *szOutputFile;	// output file name
+HEX_OPTIONS HexOptions;	// output record size, skip filler, etc
+
+//   Each input file is loaded into its own sparse image by its own thread.
+// The image is an array of pages, allocated only when something is loaded
+// into them, and each page has a bitmap of the bytes that were actually
+// loaded.  That's what lets the merge find conflicts exactly - a byte that
+// happens to be equal to the filler is just as loaded as any other...
+typedef struct {
+  uint8_t   abData[PAGESIZE];	// the data bytes for this page
+  uint8_t   abLoaded[PAGESIZE/8];// and a bit for each one that was loaded
+} ROMPAGE;
+
+typedef struct {
+  char      *pszName;	// name of the .HEX file
+  ROMPAGE  **ppPages;	// sparse image of this file
+  uint32_t   lCount;	// number of bytes loaded from file
+  HEX_STATUS nStatus;	// result from hexRead()
+  HEX_RECORD Record;	// and where it failed, if it did
+  uint32_t   lAddress;	// address outside the ROM or loaded twice
+  bool       fTwice;	// true if lAddress was loaded twice by this file
+  pthread_t  hThread;	// thread that reads this file
+  bool       fThread;	// true if hThread was started
+} ROMINPUT;
 
+#define NPAGES        ((lROMSize + PAGESIZE - 1) / PAGESIZE)
+#define ISLOADED(p,n) (((p)->abLoaded[(n) >> 3] & (1 << ((n) & 7))) != 0)
+
+
+
+//++
+//ReadHexData
+//
+//   This is the hexRead() callback for ReadHex(), below.  It stores one data
+// record in the sparse image for this file, allocating pages as needed.  It's
+// an error to load anything outside the ROM, or to load the same byte twice
+// from one file.  Conflicts between files are found later, by MergeImages().
+// This runs in the file's own thread, so it can't print anything - it just
+// stops hexRead() and leaves the bad address for ReadHex() to report.
+//--
+bool ReadHexData (void *pContext, const HEX_RECORD *pRecord)
+{
+  ROMINPUT *pInput = (ROMINPUT *) pContext;
+  uint32_t uAddress = pRecord->lAddress;  uint32_t i, n;  ROMPAGE *pPage;
+  for (i = 0;  i < pRecord->cbData;  ++i, ++uAddress, ++pInput->lCount) {
+    if ((uAddress < uROMOffset) || ((uAddress - uROMOffset) >= lROMSize))
+      {pInput->lAddress = uAddress;  return false;}
+    n = uAddress - uROMOffset;
+    pPage = pInput->ppPages[n / PAGESIZE];
+    if (pPage == NULL) {
+      if ((pPage = calloc(1, sizeof(ROMPAGE))) == NULL)
+        {fprintf(stderr,"rommerge: failed to allocate memory\n");  exit(EXIT_FAILURE);}
+      pInput->ppPages[n / PAGESIZE] = pPage;
+    }
+    n %= PAGESIZE;
+    if (ISLOADED(pPage, n))
+      {pInput->lAddress = uAddress;  pInput->fTwice = true;  return false;}
+    pPage->abLoaded[n >> 3] |= 1 << (n & 7);
+    pPage->abData[n] = pRecord->pbData[i];
+  }
+  return true;
+}
 
 
 //++
 //ReadHex
 //
-//   This function will load a standard Intel format .HEX file into memory.
-// Only the traditional 16-bit address format is supported, which puts an
-// upper limit of 64K on the amount of data which may be loaded.  Only
-// record types 00 (data) and 01 (end of file) are recognized.
+//   This is the thread that loads one input file into its sparse image.  The
+// file is parsed by hexRead() in ../romlib, which also understands the
+// extended address records, so images bigger than 64K are fine.  Nothing is
+// printed here; ReportInput() does that after all the threads are done...
+//--
+void *ReadHex (void *pContext)
+{
+  ROMINPUT *pInput = (ROMINPUT *) pContext;
+  pInput->nStatus = hexRead(pInput->pszName, ReadHexData, pInput, &pInput->Record);
+  return NULL;
+}
+
+
+//++
+//ReportInput
+//
+//   Print the results of loading one input file and return the number of
+// bytes read from it, or zero if there was any error.  Note that all counts,
+// sizes and offsets must be longs on the off chance that exactly 64K bytes
+// will be read!
+//--
+long ReportInput (ROMINPUT *pInput)
+{
+  char *pszName = pInput->pszName;
+  switch (pInput->nStatus) {
+    case HEX_OK:
+      printf("%s: %ld bytes read\n", pszName, (long) pInput->lCount);
+      return pInput->lCount;
+    case HEX_STOPPED:
+      if (pInput->fTwice)
+        fprintf(stderr,"%s: address %04X loaded twice\n", pszName, pInput->lAddress);
+      else
+        fprintf(stderr,"%s: address %04X outside ROM\n", pszName, pInput->lAddress);
+      return 0;
+    default:
+      hexPrintError(pInput->nStatus, &pInput->Record);  return 0;
+  }
+}
+
+
+//++
+//ReportConflict
 //
-//   The number of bytes read will be returned as the function's value,
-// and this will be zero if any error occurs.  Note that all counts, sizes
-// and offsets must be longs on the off chance that exactly 64K bytes will
-// be read!
+//   Report one range of bytes loaded by two different files ...
 //--
-long ReadHex (		// returns count of bytes read, or zero if error
-  char      *pszName,	// name of the .HEX file to be loaded
-  uint8_t   *bData,	// this array receives the data loaded
-  uint32_t   lSize,	// maximum size of the array, in bytes
-  uint16_t   uOffset)	// offset applied to input records
+void ReportConflict (ROMINPUT *pInput, ROMINPUT *pFirst, uint32_t lStart, uint32_t lEnd)
 {
-  FILE	   *f;		// handle of the input file
-  uint32_t  lCount = 0;	// number of bytes loaded from file
-  unsigned  cbLength;	// length       of the current .HEX record
-  unsigned  uAddress;	// load address "   "     "      "     "
-  unsigned  uType;	// type         "   "     "      "     "
-  unsigned  uChecksum;	// checksum     "   "     "      "     "
-  unsigned  uByte;	// temporary for the data byte read...
-  
-  if ((f=fopen(pszName, "rt")) == NULL)
-    {fprintf(stderr,"%s: unable to open file\n", pszName);  return 0;}
-
-  while (1) {
-    if (fscanf(f,":%2x%4x%2x",&cbLength,&uAddress,&uType) != 3)
-      {fprintf(stderr,"%s: bad .HEX file format (1)\n", pszName);  return 0;}
-    if (uType > 1)
-      {fprintf(stderr,"%s: unknown record type\n", pszName);  return 0;}
-    uChecksum = cbLength + (uAddress >> 8) + (uAddress & 0xFF) + uType;
-    for (;  cbLength > 0;  --cbLength, ++uAddress, ++lCount) {
-      if (fscanf(f,"%2x",&uByte) != 1)
-        {fprintf(stderr,"%s: bad .HEX file format (2)\n", pszName);  return 0;}
-      if ((uint32_t)((uAddress - uOffset) & 0xFFFF) >= lSize)
-        {fprintf(stderr,"%s: address %04X outside ROM\n", pszName, uAddress);  return 0;}
-      if (pbData[(uAddress-uOffset) & 0xFFFF] == uFillByte) 
-        pbData[(uAddress-uOffset) & 0xFFFF] = (uchar) uByte;
-      else if (uByte != uFillByte) {
-        printf("%s: conflict at address 0x%04X\n", pszName, uAddress);  return 0;
+  lStart += uROMOffset;  lEnd += uROMOffset;
+  if (lStart == lEnd)
+    fprintf(stderr,"%s: conflict with %s at address 0x%04X\n", pInput->pszName, pFirst->pszName, lStart);
+  else
+    fprintf(stderr,"%s: conflict with %s at addresses 0x%04X to 0x%04X\n", pInput->pszName, pFirst->pszName, lStart, lEnd);
+}
+
+
+//++
+//MergeImages
+//
+//   Combine all the sparse input images into the ROM image, in one pass over
+// the loaded pages of each file.  A bitmap of every byte already merged finds
+// the conflicts, and those are reported by range along with the (first) file
+// that loaded those bytes before.  Returns the number of conflicting bytes.
+//--
+uint32_t MergeImages (ROMINPUT *pInputs, int nInputs)
+{
+  uint8_t *pbMerged;  uint32_t nPage, n, lAddress, lConflicts = 0;
+  uint32_t lStart = 0, lEnd = 0;  ROMINPUT *pFirst, *pLast = NULL;
+  int i, j;
+
+  if ((pbMerged = calloc(NPAGES, PAGESIZE/8)) == NULL)
+    {fprintf(stderr,"rommerge: failed to allocate memory\n");  exit(EXIT_FAILURE);}
+
+  for (i = 0;  i < nInputs;  ++i) {
+    for (nPage = 0;  nPage < NPAGES;  ++nPage) {
+      ROMPAGE *pPage = pInputs[i].ppPages[nPage];
+      uint8_t *pbDone = pbMerged + nPage*(PAGESIZE/8);
+      if (pPage == NULL) continue;
+      for (n = 0;  n < PAGESIZE/8;  ++n) {
+        uint8_t bLoaded = pPage->abLoaded[n];
+        if (bLoaded == 0) continue;
+        if ((bLoaded & pbDone[n]) == 0) {
+          // The usual case - nothing here has been loaded before ...
+          uint32_t k;  lAddress = nPage*PAGESIZE + n*8;
+          for (k = 0;  k < 8;  ++k)
+            if ((bLoaded & (1 << k)) != 0) pbData[lAddress+k] = pPage->abData[n*8+k];
+          pbDone[n] |= bLoaded;
+          continue;
+        }
+        // Otherwise, one byte at a time and look for the earlier file ...
+        for (lAddress = nPage*PAGESIZE + n*8;  bLoaded != 0;  bLoaded >>= 1, ++lAddress) {
+          if ((bLoaded & 1) == 0) continue;
+          if ((pbDone[n] & (1 << (lAddress & 7))) == 0) {
+            pbData[lAddress] = pPage->abData[lAddress % PAGESIZE];
+            pbDone[n] |= 1 << (lAddress & 7);
+            continue;
+          }
+          for (j = 0, pFirst = NULL;  (j < i) && (pFirst == NULL);  ++j) {
+            ROMPAGE *p = pInputs[j].ppPages[nPage];
+            if ((p != NULL) && ISLOADED(p, lAddress % PAGESIZE)) pFirst = &pInputs[j];
+          }
+          ++lConflicts;
+          if ((pLast == pFirst) && (lAddress == lEnd+1)) {
+            lEnd = lAddress;  continue;
+          }
+          if (pLast != NULL) ReportConflict(&pInputs[i], pLast, lStart, lEnd);
+          pLast = pFirst;  lStart = lEnd = lAddress;
+        }
       }
-      uChecksum += uByte;
     }
-    if (fscanf(f,"%2x\n",&uByte) != 1)
-      {fprintf(stderr,"%s: bad .HEX file format (3)\n", pszName);  return 0;}
-    uChecksum = (uChecksum + uByte) & 0xFF;
-    if (uChecksum != 0)
-      {fprintf(stderr,"%s: checksum error\n", pszName);  return 0;}
-    if (uType == 1) break;
+    if (pLast != NULL) ReportConflict(&pInputs[i], pLast, lStart, lEnd);
+    pLast = NULL;
   }
-  
-  fclose(f);
-  return lCount;
+
+  free(pbMerged);
+  return lConflicts;
 }
 
 
@@ -123,41 +265,24 @@ long ReadHex (		// returns count of bytes read, or zero if error
 //WriteHex
 //
 //   This function will write an array of bytes to a file in standard Intex
-// .HEX file format.  Only the traditional 16 bit format is supported and
-// so the array must be 64K or less.  The only records generated are type 00
-// (data) and 01 (end of file).  This routine always writes everything in
-// the array and doesn't attempt to remove filler bytes...
+// .HEX file format.  The only records generated are type 00 (data) and 01
+// (end of file), plus type 04 (extended linear address) if the image goes
+// past 64K.
+// The record size and whether filler bytes are written are up to the -r and
+// -u options...
 //--
 void WriteHex (
   char      *pszName,	// name of the .HEX file to be written
   uint8_t   *pbData,	// array of bytes to be saved
   long       lCount,	// number of bytes to write
-  uint16_t   uOffset)	// offset applied to input records
+  uint32_t   uOffset)	// offset applied to input records
 {
   FILE *f;		// handle of the output file
-  unsigned uAddress = 0;// address of the current record
-  unsigned cbRecord;	// size of the current record
-  unsigned uRecordAddress;
-  int      uChecksum;	// checksum "  "     "       "
-  unsigned i;		// temporary...
-
   if ((f=fopen(pszName, "wt")) == NULL)
     {fprintf(stderr,"%s: unable to write file\n", pszName);  return;}
-
-  while (lCount > 0) {
-    cbRecord = (lCount > 16) ? 16 : (unsigned) lCount;
-    uRecordAddress = (uAddress+uOffset) & 0xFFFF;
-    fprintf(f, ":%02X%04X00", cbRecord, uRecordAddress);
-    uChecksum = cbRecord + (uRecordAddress >> 8) + (uRecordAddress & 0xFF) + 00 /* Type */;
-    for (i = 0; i < cbRecord; ++i) {
-      fprintf(f,"%02X", *(pbData+uAddress+i));
-      uChecksum += *(pbData+uAddress+i);
-    }
-    fprintf(f,"%02X\n", (-uChecksum) & 0xFF);
-    lCount -= cbRecord;  uAddress += cbRecord;
-  }
-  
-  fprintf(f, ":00000001FF\n");  fclose(f);
+  if (!hexWrite(f, pbData, (uint32_t) lCount, 1, uOffset, &HexOptions))
+    fprintf(stderr,"%s: unable to write file\n", pszName);
+  fclose(f);
 }
 
 
@@ -175,14 +300,17 @@ int ParseOptions (int argc, char *argv[])
 
   // First, set all the defaults...
   lROMSize = 65536;  uROMOffset = 0;  uFillByte = 0xFF;
+  memset(&HexOptions, 0, sizeof(HexOptions));
 
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
     fprintf(stderr, "Usage:\n");
-    fprintf(stderr,"rommerge [-snnnn] [-onnnn] [-fnn] output-file input-file-1 input-file-2 ...\n");
+    fprintf(stderr,"rommerge [-snnnn] [-onnnn] [-fnn] [-rnn] [-u] output-file input-file-1 input-file-2 ...\n");
     fprintf(stderr,"\t-snnnn - set the ROM size in bytes (e.g. -s32k or -s32768)\n");
     fprintf(stderr,"\t-onnnn - set the offset for the output image (e.g. -o32768)\n");
     fprintf(stderr,"\t-fnn   - set the filler byte to nn decimal (e.g. -f0 or -f255)\n");
+    fprintf(stderr,"\t-rnn   - write nn data bytes per output record (default 16)\n");
+    fprintf(stderr,"\t-u     - don't write unused (filler) bytes to the output file\n");
     exit(EXIT_SUCCESS);
   }
 
@@ -200,9 +328,9 @@ int ParseOptions (int argc, char *argv[])
 
     // Handle the -o (offset) option...
     if (strncmp(argv[nArg], "-o", 2) == 0) {
-      uROMOffset = (unsigned) strtoul(argv[nArg]+2, &psz, 10);
+      uROMOffset = (uint32_t) strtoul(argv[nArg]+2, &psz, 10);
       if (*psz == 'k' || *psz == 'K')   uROMOffset <<= 10, ++psz;
-      if ((*psz != '\0') || (uROMOffset > 0xFFFF)) {
+      if (*psz != '\0') {
         fprintf(stderr, "rommerge: illegal offset: \"%s\"", argv[nArg]);
         exit(EXIT_FAILURE);
       }
@@ -213,7 +341,7 @@ int ParseOptions (int argc, char *argv[])
     if (strncmp(argv[nArg], "-s", 2) == 0) {
       lROMSize = strtoul(argv[nArg]+2, &psz, 10);
       if (*psz == 'k' || *psz == 'K')   lROMSize <<= 10, ++psz;
-      if (*psz != '\0') {
+      if ((*psz != '\0') || (lROMSize == 0)) {
         fprintf(stderr,"rommerge: invalid ROM size \"%s\"\n", argv[nArg]);
         exit(EXIT_FAILURE);
       }
@@ -230,6 +358,23 @@ int ParseOptions (int argc, char *argv[])
       continue;
     }
 
+    // Handle the -r (record size) option...
+    if (strncmp(argv[nArg], "-r", 2) == 0) {
+      unsigned long cbRecord = strtoul(argv[nArg]+2, &psz, 10);
+      if ((*psz != '\0') || (cbRecord == 0) || (cbRecord > 255)) {
+        fprintf(stderr,"rommerge: invalid record size \"%s\"\n", argv[nArg]);
+        exit(EXIT_FAILURE);
+      }
+      HexOptions.cbRecord = (uint8_t) cbRecord;
+      continue;
+    }
+
+    // Handle the -u (skip unused locations) option...
+    if (strcmp(argv[nArg], "-u") == 0) {
+      HexOptions.fSkipFill = true;
+      continue;
+    }
+
     // Otherwise it's an illegal option...
     fprintf(stderr, "rommerge: unknown option - \"%s\"\n", argv[nArg]);
     exit(EXIT_FAILURE);
@@ -246,7 +391,7 @@ int ParseOptions (int argc, char *argv[])
 //--
 int main (int argc, char *argv[])
 {
-  int nFile;  uint32_t i;
+  int nFile, nInputs, i;  uint32_t lConflicts;  ROMINPUT *pInputs;
  
   nFile = ParseOptions(argc, argv);
   szOutputFile = argv[nFile++];
@@ -257,22 +402,43 @@ int main (int argc, char *argv[])
  
   // Allocate a buffer to hold the ROM image and fill it with the filler value.
   pbData = malloc((size_t) lROMSize);
-  if (pbData == NULL) {
+  nInputs = argc - nFile;
+  pInputs = calloc(nInputs, sizeof(ROMINPUT));
+  if ((pbData == NULL) || (pInputs == NULL)) {
     fprintf(stderr,"rommerge: failed to allocate memory\n");
     exit(1);
   }
-  for (i = 0;  i < lROMSize;  ++i)  pbData[i] = uFillByte;
-
-  // Load all the input files...
-  for (lByteCount = 0; nFile < argc;  ++nFile) {
-    long lBytes;
-    lBytes = ReadHex(argv[nFile], pbData, lROMSize, uROMOffset);
-    printf("%s: %ld bytes read\n", argv[nFile], lBytes);
-    lByteCount += lBytes;
+  memset(pbData, uFillByte, lROMSize);
+
+  //   Load all the input files at once, each one in its own thread and into
+  // its own sparse image.  If we can't start a thread, just read that file
+  // right now instead ...
+  for (i = 0;  i < nInputs;  ++i) {
+    pInputs[i].pszName = argv[nFile+i];
+    pInputs[i].ppPages = calloc(NPAGES, sizeof(ROMPAGE *));
+    if (pInputs[i].ppPages == NULL) {
+      fprintf(stderr,"rommerge: failed to allocate memory\n");
+      exit(1);
+    }
+    pInputs[i].fThread = pthread_create(&pInputs[i].hThread, NULL, ReadHex, &pInputs[i]) == 0;
+    if (!pInputs[i].fThread) ReadHex(&pInputs[i]);
+  }
+  for (i = 0, lByteCount = 0;  i < nInputs;  ++i) {
+    if (pInputs[i].fThread) pthread_join(pInputs[i].hThread, NULL);
+    lByteCount += ReportInput(&pInputs[i]);
   }
   if (lByteCount == 0)  exit(1);
 
-  // Dump out the new ROM image and we're all done...
+  // Combine them all, and quit now if there are any overlaps ...
+  lConflicts = MergeImages(pInputs, nInputs);
+  if (lConflicts != 0) {
+    fprintf(stderr,"rommerge: %u bytes loaded more than once\n", lConflicts);
+    exit(EXIT_FAILURE);
+  }
+
+  //   Dump out the new ROM image and we're all done.  Extended addresses are
+  // used only if the ROM goes past 64K ...
+  HexOptions.bFill = uFillByte;  HexOptions.fExtended = true;
   WriteHex(szOutputFile, pbData, lROMSize, uROMOffset);
   printf("%s: %d bytes written\n", szOutputFile, lByteCount);
 
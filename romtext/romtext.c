@@ -24,14 +24,17 @@
 // ingore comments in the source file.
 //
 // USAGE:
-//  romtext [-annnn] input-file output-file ...
+//  romtext [-annnn] [-rnn] input-file output-file ...
 //
 //	     -annnn - set the address of the output image
+//	     -rnn   - write nn data bytes per output record (default 16)
 //
 // REVISION HISTORY
 // 22-Feb-06	RLA	New file...
 // 21-Mar-23    RLA     When reading DOS text files on Linux, they already
 //                        end with \r\n - don't add another <CR>!
+// 14-Oct-26    AGT     Use the shared .HEX file writer and add -r
+// 14-Oct-26    AGT     ReadText() is now txtRead() in ../romlib
 //--
 #include <stdio.h>		// printf(), scanf(), et al.
 #include <stdlib.h>		// exit(), ...
@@ -39,14 +42,17 @@
 #include <malloc.h>		// malloc(), _fmalloc(), etc...
 #include <memory.h>		// memset(), etc...
 #include <string.h>
+#include <stdbool.h>		// bool, true, false, etc ...
+#include "intelhex.h"		// hexWrite(), HEX_OPTIONS, etc ...
+#include "textfile.h"		// txtRead() ...
 
 #define ROMSIZE	((unsigned) 65535)	// largest file we can convert!
-#define MAXLINE 512			// longest line possible
 
 typedef unsigned char uchar;
 
 // Globals...
 uint16_t uROMAddress;		// offset of the EPROM in memory
+HEX_OPTIONS HexOptions;		// output record size
 
 
 
@@ -56,8 +62,9 @@ uint16_t uROMAddress;		// offset of the EPROM in memory
 //   This function will write an array of bytes to a file in standard Intex
 // .HEX file format.  Only the traditional 16 bit format is supported and
 // so the array must be 64K or less.  The only records generated are type 00
-// (data) and 01 (end of file).  This routine always writes everything in
-// the array and doesn't attempt to remove filler bytes...
+// (data) and 01 (end of file), and record addresses wrap around at 64K.
+// This routine always writes everything in the array and doesn't attempt to
+// remove filler bytes, but the record size is up to the -r option...
 //--
 void WriteHex (
   FILE      *fOutput,	        // handle of the .HEX file to be written
@@ -65,27 +72,8 @@ void WriteHex (
   uint32_t   cbData,		// number of bytes to write
   uint16_t   uOffset)		// offset applied to input records
 {
-  uint16_t   uAddress = 0;	// address of the current record
-  uint16_t   cbRecord;  	// size of the current record
-  uint16_t   uRecordAddress;
-  uint16_t   uChecksum;	        // checksum "  "     "       "
-  uint16_t   i;			// temporary...
-
-
-  while (cbData > 0) {
-    cbRecord = (cbData > 16) ? 16 : (unsigned) cbData;
-    uRecordAddress = (uAddress+uOffset) & 0xFFFF;
-    fprintf(fOutput, ":%02X%04X00", cbRecord, uRecordAddress);
-    uChecksum = cbRecord + (uRecordAddress >> 8) + (uRecordAddress & 0xFF) + 00 /* Type */;
-    for (i = 0; i < cbRecord; ++i) {
-      fprintf(fOutput,"%02X", *(pbData+uAddress+i));
-      uChecksum += *(pbData+uAddress+i);
-    }
-    fprintf(fOutput,"%02X\n", (-uChecksum) & 0xFF);
-    cbData -= cbRecord;  uAddress += cbRecord;
-  }
-  
-  fprintf(fOutput, ":00000001FF\n");
+  if (!hexWrite(fOutput, pbData, cbData, 1, uOffset, &HexOptions))
+    fprintf(stderr,"romtext: error writing output file\n");
 }
 
 
@@ -100,13 +88,14 @@ int ParseOptions (int argc, char *argv[])
   int nArg;  char *psz;
 
   // First, set all the defaults...
-  uROMAddress = 0;
+  uROMAddress = 0;  memset(&HexOptions, 0, sizeof(HexOptions));
 
   // If there are no arguments, then just print the help and exit...
   if (argc == 1) {
     fprintf(stderr, "Usage:\n");
-    fprintf(stderr,"romtext [-annnn] [input-file] [output-file]\n");
+    fprintf(stderr,"romtext [-annnn] [-rnn] [input-file] [output-file]\n");
     fprintf(stderr,"\t-annnn - set the address of the ROM image\n");
+    fprintf(stderr,"\t-rnn   - write nn data bytes per output record (default 16)\n");
     exit(EXIT_SUCCESS);
   }
 
@@ -126,6 +115,17 @@ int ParseOptions (int argc, char *argv[])
       continue;
     }
 
+    // Handle the -r (record size) option...
+    if (strncmp(argv[nArg], "-r", 2) == 0) {
+      unsigned long cbRecord = strtoul(argv[nArg]+2, &psz, 10);
+      if ((*psz != '\0') || (cbRecord == 0) || (cbRecord > 255)) {
+        fprintf(stderr, "romtext: invalid record size: \"%s\"\n", argv[nArg]);
+        exit(EXIT_FAILURE);
+      }
+      HexOptions.cbRecord = (uint8_t) cbRecord;
+      continue;
+    }
+
     // Otherwise it's an illegal option...
     fprintf(stderr, "romtext: unknown option - \"%s\"\n", argv[nArg]);
     exit(EXIT_FAILURE);
@@ -135,32 +135,6 @@ int ParseOptions (int argc, char *argv[])
 }
 
 
-//++
-// ReadText
-//--
-unsigned ReadText (FILE *fInput, uint8_t *pbData, uint16_t uMaxSize)
-{
-  char szLine[MAXLINE];  uint16_t uTextSize = 0;
-  
-  while (fgets(szLine, MAXLINE, fInput) != NULL) {
-    char *psz;  int len = strlen(szLine);
-    // Ignore comments...
-    if ((len > 0) && (szLine[0] == '#')) continue;
-    // Convert the line ending to <CRLF> regardless of what we read...
-    if ((len > 0) && (szLine[len-1] == '\n')) szLine[--len] = 0;
-    if ((len > 0) && (szLine[len-1] == '\r')) szLine[--len] = 0;
-    strcat(szLine, "\r\n");  len += 2;
-    // Append the line to the buffer ...
-    for (psz = szLine;  *psz != 0;  ++psz) {
-      if (uTextSize++ < uMaxSize) *pbData++ = *psz;
-    }
-  } 
-  // Always end with a null byte!
-  if (uTextSize++ < uMaxSize) *pbData++ = 0;
-  return uTextSize;
-}
-
-
 //++
 //main
 //--
@@ -213,7 +187,7 @@ int main (int argc, char *argv[])
 
   // Load the input file...
   //..
-  uTextSize = ReadText(fInput, pbData, ROMSIZE);
+  uTextSize = (uint16_t) txtRead(fInput, pbData, ROMSIZE);
 
   // Dump out the ROM image and we're all done...
   WriteHex(fOutput, pbData, uTextSize, uROMAddress);
@@ -0,0 +1,211 @@
+/****************************************************************************
+ *  File: arena.c
+ *
+ *  Description:
+ *    Arena (region) memory allocator for TASM, the table driven assembler.
+ *
+ *    Most of what TASM allocates lives until a well defined point - the
+ *    end of the assembly, the next read_table(), the end of pass 1 - and
+ *    is then freed all together.  Rather than malloc and free each piece
+ *    individually it is carved out of big blocks belonging to one of a
+ *    few regions (see arena_t), so an allocation is just a pointer bump,
+ *    related items sit next to each other in memory, and freeing a
+ *    region costs one free() per block.
+ *
+ *    arena_reset() keeps the region's blocks for reuse; arena_free()
+ *    gives them back to the heap.  arena_mark() and arena_release() free
+ *    everything allocated in a region since a given point.
+ *
+ */
+
+/* INCLUDES */
+#include "tasm.h"
+
+#ifdef T_MEMCHECK
+#include <memcheck.h>
+#endif
+
+
+#define ARENA_BLOCK     0x10000         /* Normal size of a block (bytes) */
+
+/* Every allocation is rounded to a multiple of this */
+typedef union{
+        long    l;
+        double  d;
+        void    *p;
+}ARALIGN;
+#define ARENA_ALIGN     sizeof(ARALIGN)
+
+/* Header of a block.  The allocations follow it. */
+typedef struct _ARBLOCK{
+        struct _ARBLOCK *next;          /* Next block in the region       */
+        size_t  size;                   /* Bytes available in this block  */
+        size_t  used;                   /* Bytes allocated so far         */
+        ARALIGN align;                  /* (so the data is aligned)       */
+}ARBLOCK;
+
+/* A region.  Its blocks are in a list; cur is the one being allocated
+ * from and any after it are empty (left over from an arena_reset()).
+ */
+typedef struct{
+        ARBLOCK *first;
+        ARBLOCK *cur;
+}ARENA;
+
+/* Static */
+static ASMSTATE ARENA    Arena[NARENA];
+
+
+/******************************************************************/
+/* Function: arena_alloc()
+ * Description:
+ *     Allocate size bytes from a region.
+ */
+void *
+arena_alloc(
+arena_t region,         /* Region to allocate from */
+size_t  size)           /* Number of bytes         */
+{
+        ARENA   *ar;
+        ARBLOCK *blk;
+        size_t  bsize;
+        void    *p;
+
+        ar   = &Arena[region];
+        size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+        blk = ar->cur;
+        if((blk == NULL) || (blk->used + size > blk->size))
+        {
+            /* Move on to the next empty block if it's big enough,
+             * otherwise get a new one and put it next in line.
+             */
+            if((blk != NULL) && (blk->next != NULL) && (blk->next->size >= size))
+            {
+                blk = blk->next;
+            }
+            else
+            {
+                bsize = max(size, ARENA_BLOCK);
+                blk   = (ARBLOCK *)malloc(sizeof(ARBLOCK) + bsize);
+                if(blk == NULL)
+                {
+                    errprt("tasm: Cannot malloc for arena storage\n");
+                    tasmexit(EXIT_MALLOC);
+                }
+                blk->size = bsize;
+                blk->used = 0;
+                if(ar->cur == NULL)
+                {
+                    blk->next = ar->first;
+                    ar->first = blk;
+                }
+                else
+                {
+                    blk->next = ar->cur->next;
+                    ar->cur->next = blk;
+                }
+            }
+            ar->cur = blk;
+        }
+
+        p = (char *)&blk->align + blk->used;
+        blk->used += size;
+        return(p);
+}
+
+/******************************************************************/
+/* Function: arena_strsave()
+ * Description:
+ *     Save a copy of a string in a region.
+ */
+char *
+arena_strsave(
+arena_t region,
+char    *s)
+{
+        return(strcpy((char *)arena_alloc(region, strlen(s) + 1), s));
+}
+
+/******************************************************************/
+/* Function: arena_mark()
+ * Description:
+ *     Return the current extent of a region, for arena_release().
+ */
+ARMARK
+arena_mark(
+arena_t region)
+{
+        ARMARK  mark;
+
+        mark.block = Arena[region].cur;
+        mark.used  = (mark.block != NULL) ? Arena[region].cur->used : 0;
+        return(mark);
+}
+
+/******************************************************************/
+/* Function: arena_release()
+ * Description:
+ *     Free everything allocated from a region since the mark was taken.
+ *     The blocks are kept for reuse.
+ */
+void
+arena_release(
+arena_t region,
+ARMARK  mark)
+{
+        ARENA   *ar;
+        ARBLOCK *blk;
+
+        ar = &Arena[region];
+        if(mark.block == NULL)
+        {
+            arena_reset(region);
+            return;
+        }
+
+        blk = (ARBLOCK *)mark.block;
+        blk->used = mark.used;
+        ar->cur   = blk;
+        for(blk = blk->next; blk != NULL; blk = blk->next) blk->used = 0;
+}
+
+/******************************************************************/
+/* Function: arena_reset()
+ * Description:
+ *     Free everything in a region.  The blocks are kept for reuse.
+ */
+void
+arena_reset(
+arena_t region)
+{
+        ARENA   *ar;
+        ARBLOCK *blk;
+
+        ar = &Arena[region];
+        for(blk = ar->first; blk != NULL; blk = blk->next) blk->used = 0;
+        ar->cur = ar->first;
+}
+
+/******************************************************************/
+/* Function: arena_free()
+ * Description:
+ *     Free everything in a region and return its blocks to the heap.
+ */
+void
+arena_free(
+arena_t region)
+{
+        ARENA   *ar;
+        ARBLOCK *blk;
+
+        ar = &Arena[region];
+        while((blk = ar->first) != NULL)
+        {
+            ar->first = blk->next;
+            free(blk);
+        }
+        ar->cur = NULL;
+}
+
+/* That's all folks. */
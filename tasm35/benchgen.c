@@ -0,0 +1,145 @@
+/****************************************************************************
+ *  File: benchgen.c
+ *
+ *  Description:
+ *    Generate synthetic TASM source files for the "make bench" throughput
+ *    benchmark.
+ *
+ *    benchgen -<table> <lines> [<label_pct> [<macro_pct>]]  >file.asm
+ *
+ *    <label_pct> percent of the lines get a label and about as many
+ *    instructions refer to one (forward or backward); <macro_pct> percent
+ *    of the instructions use one of a set of #define macros in their
+ *    arguments.  The code is restarted at .org 0 every ORGLINES lines so
+ *    all the labels fit in 16 bits.  The same arguments always generate
+ *    the same file, and it assembles without errors.
+ *
+ */
+
+#include        <stdio.h>
+#include        <stdlib.h>
+#include        <string.h>
+
+#define NMACROS         16      /* Number of #define macros            */
+#define ORGLINES        4096    /* Lines between each .org 0           */
+
+/* The instructions used for one table.  A '%d' in a plain instruction
+ * is replaced by a small number (of the given range).
+ */
+typedef struct{
+        char    *table;         /* As in tasm -<table>                 */
+        char    *plain[4];      /* Ordinary instructions               */
+        int     range[4];       /* ... range of their %d               */
+        char    *jump;          /* Refers to a label (%s)              */
+        char    *macro;         /* Uses a macro (%s)                   */
+}BENCHTAB;
+
+static BENCHTAB Benchtab[] = {
+    { "1802", { "GHI %d",      "PHI %d",       "LDI %d",   "SEX %d"    },
+              { 16, 16, 256, 16 },
+              "LBR %s",        "LDI %s" },
+    { "80",   { "LD A,%d",     "ADD A,B",      "INC HL",   "PUSH BC"   },
+              { 256, 1, 1, 1 },
+              "JP %s",         "LD A,%s" },
+    { "51",   { "MOV A,#%d",   "ADD A,R%d",    "INC A",    "INC R%d"   },
+              { 256, 8, 1, 8 },
+              "LJMP %s",       "MOV A,#%s" },
+    { "96",   { "LD 30H,#%d",  "ADD 32H,#%d",  "INC 34H",  "CLR 36H"   },
+              { 65536, 256, 1, 1 },
+              "LD 38H,#%s",    "LD 3AH,#%s" },
+};
+
+#define NBENCHTAB       ((int)(sizeof(Benchtab) / sizeof(Benchtab[0])))
+
+static unsigned long Seed = 1;
+
+/* A repeatable random number from 0 to n-1 */
+static long
+rnd15(void)
+{
+        Seed = (Seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+        return((long)((Seed >> 16) & 0x7fff));
+}
+
+static int
+rnd(long n)
+{
+        return((int)(((rnd15() << 15) | rnd15()) % n));
+}
+
+int
+main(int argc, char *argv[])
+{
+        BENCHTAB *bt;
+        long    lines;
+        long    nlabels;
+        long    labno;
+        long    line;
+        int     label_pct = 10;
+        int     macro_pct = 10;
+        int     i;
+        char    arg[32];
+
+        if((argc < 3) || (argv[1][0] != '-'))
+        {
+            fprintf(stderr,
+                "usage: benchgen -<table> <lines> [<label_pct> [<macro_pct>]]\n");
+            return(1);
+        }
+        for(bt = Benchtab; bt < &Benchtab[NBENCHTAB]; bt++)
+            if(strcmp(bt->table, &argv[1][1]) == 0) break;
+        if(bt == &Benchtab[NBENCHTAB])
+        {
+            fprintf(stderr, "benchgen: no instructions for table %s\n", argv[1]);
+            return(1);
+        }
+
+        lines = atol(argv[2]);
+        if(argc > 3) label_pct = atoi(argv[3]);
+        if(argc > 4) macro_pct = atoi(argv[4]);
+        nlabels = lines * label_pct / 100;
+        if(nlabels < 1) nlabels = 1;
+
+        printf("; benchgen %s %ld lines, %d%% labels, %d%% macros\n",
+               argv[1], lines, label_pct, macro_pct);
+        for(i = 0; i < NMACROS; i++)
+            printf("#define M%d(a) ((a)+%d)\n", i, i);
+
+        labno = 0;
+        for(line = 0; line < lines; line++)
+        {
+            if((line % ORGLINES) == 0) printf("        .org 0\n");
+
+            /* Spread the labels evenly through the file */
+            if((labno < nlabels) && (labno * lines <= line * nlabels))
+                printf("L%06ld:", labno++);
+
+            if(rnd(100) < label_pct)
+            {
+                sprintf(arg, "L%06d", rnd(nlabels));
+                printf("  ");
+                printf(bt->jump, arg);
+            }
+            else if(rnd(100) < macro_pct)
+            {
+                sprintf(arg, "M%d(%d)", rnd(NMACROS), rnd(200));
+                printf("  ");
+                printf(bt->macro, arg);
+            }
+            else
+            {
+                i = rnd(4);
+                printf("  ");
+                printf(bt->plain[i], rnd(bt->range[i]));
+            }
+
+            if(rnd(8) == 0) printf("    ; comment %ld", line);
+            printf("\n");
+        }
+
+        /* Any labels left over */
+        while(labno < nlabels) printf("L%06ld: .byte 0\n", labno++);
+        printf("        .end\n");
+
+        return(0);
+}
@@ -0,0 +1,359 @@
+/****************************************************************************
+ *  File: build.c
+ *
+ *  Description:
+ *    Incremental build support for TASM, the table driven assembler (-u).
+ *
+ *    While a source is assembled every file it depends on is noted: the
+ *    instruction table and each source and include file, along with the
+ *    file that included it and a hash of its contents, taken when the
+ *    assembler first opens it.  After an assembly without errors the build
+ *    state file (the object file name with a .tbs extension) is written.
+ *    It holds a hash of the command line (options, file names and
+ *    TASMTABS), the include graph with the hash of each file's contents,
+ *    and a hash of each output file.  The next time the same command is
+ *    run with -u, the assembly is skipped if all of those still match.
+ *
+ *    The state file ends with an "end" line giving the number of dep and
+ *    out lines before it, and a file without one (or with the wrong
+ *    count, or with no dependencies, or missing the object or listing)
+ *    never counts as up to date.  It's written to a .tbs.tmp file first
+ *    and renamed, so a crash or a full disk can't leave half of one.
+ *
+ *    That's all -u does: if anything changed, even one leaf include, both
+ *    passes are run over the whole source as usual.  The label table is
+ *    not cached and pass 1 is never seeded from a previous build - an edit
+ *    to any include can move every label after it, and only pass 1 can
+ *    tell whether it did.
+ *
+ *    The dependency list lives in the AR_MODULE arena.
+ *
+ */
+
+/* INCLUDES */
+#include "tasm.h"
+
+#ifdef T_MEMCHECK
+#include <memcheck.h>
+#endif
+
+
+#define BUILD_MAGIC     "TASM build state 2"
+
+typedef unsigned long long hash_t;
+
+/* A file the assembly depends on */
+typedef struct _BUILDDEP{
+        struct _BUILDDEP *next;
+        int     parent;         /* Index of the file that included it,
+                                 * or -1 (the table or the source)     */
+        int     hashed;         /* FALSE if it couldn't be read        */
+        hash_t  hash;           /* Contents when it was first opened   */
+        char    *name;
+}BUILDDEP;
+
+/* Static */
+static ASMSTATE BUILDDEP *Deps     = NULL;  /* In the order first seen     */
+static ASMSTATE BUILDDEP *Lastdep  = NULL;
+static ASMSTATE int      Tracking  = FALSE; /* TRUE to hash them (-u)     */
+
+
+/******************************************************************/
+/* Function: build_hash_bytes()
+ * Description:
+ *     FNV-1a hash of a buffer, continuing from h.
+ */
+static hash_t
+build_hash_bytes(
+hash_t  h,
+const void *buf,
+size_t  n)
+{
+        const ubyte *p = (const ubyte *)buf;
+
+        while(n-- > 0)
+        {
+            h ^= *p++;
+            h *= 0x100000001b3ULL;
+        }
+        return(h);
+}
+
+#define HASH_INIT       0xcbf29ce484222325ULL
+
+/******************************************************************/
+/* Function: build_hash_file()
+ * Description:
+ *     Hash the contents of a file.  Returns FALSE if it can't be read.
+ */
+static int
+build_hash_file(
+char    *name,
+hash_t  *hash)
+{
+        FILE    *fp;
+        size_t  n;
+        hash_t  h;
+        char    buf[0x4000];
+
+        if((fp = fopen(name, "rb")) == NULL) return(FALSE);
+
+        h = HASH_INIT;
+        while((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            h = build_hash_bytes(h, buf, n);
+        fclose(fp);
+
+        *hash = h;
+        return(TRUE);
+}
+
+/******************************************************************/
+/* Function: build_hash_cmd()
+ * Description:
+ *     Hash the arguments of the assembly, and where the tables come
+ *     from.
+ */
+static hash_t
+build_hash_cmd(
+int     argc,
+char    *argv[])
+{
+        hash_t  h;
+        char    *p;
+        int     i;
+
+        h = HASH_INIT;
+        for(i = 1; i < argc; i++)
+            h = build_hash_bytes(h, argv[i], strlen(argv[i]) + 1);
+        if((p = getenv("TASMTABS")) != NULL)
+            h = build_hash_bytes(h, p, strlen(p) + 1);
+        return(h);
+}
+
+/******************************************************************/
+/* Function: build_start()
+ * Description:
+ *     Start hashing the files the assembly depends on (for -u).  The
+ *     table may already have been read, depending on the order of the
+ *     options, so hash anything that's been noted so far now.
+ */
+void
+build_start(void)
+{
+        BUILDDEP *dep;
+
+        Tracking = TRUE;
+        for(dep = Deps; dep != NULL; dep = dep->next)
+            if(!dep->hashed) dep->hashed = build_hash_file(dep->name, &dep->hash);
+}
+
+/******************************************************************/
+/* Function: build_dep()
+ * Description:
+ *     Note a file that the assembly depends on and, with -u, hash it
+ *     now, as the assembler opens it.  parent is the name of the file
+ *     that included it, or NULL.
+ */
+void
+build_dep(
+char    *name,
+char    *parent)
+{
+        BUILDDEP *dep;
+        int     i;
+        int     pi = -1;
+
+        for(i = 0, dep = Deps; dep != NULL; i++, dep = dep->next)
+        {
+            if(strcmp(dep->name, name) == SAME) return;
+            if((parent != NULL) && (strcmp(dep->name, parent) == SAME)) pi = i;
+        }
+
+        dep = (BUILDDEP *)arena_alloc(AR_MODULE, sizeof(BUILDDEP));
+        dep->next   = NULL;
+        dep->parent = pi;
+        dep->hashed = Tracking && build_hash_file(name, &dep->hash);
+        dep->name   = arena_strsave(AR_MODULE, name);
+
+        if(Lastdep == NULL) Deps = dep;
+        else                Lastdep->next = dep;
+        Lastdep = dep;
+}
+
+/******************************************************************/
+/* Function: build_state_name()
+ * Description:
+ *     The build state file goes with the object file.
+ */
+static void
+build_state_name(
+char    *obj_file,
+char    *state_file)    /* LINESIZE buffer */
+{
+        char    *p;
+
+        /* Leave room for ".tbs.tmp" */
+        strncpy(state_file, obj_file, LINESIZE-12);
+        state_file[LINESIZE-12] = '\0';
+        p = strrchr(state_file, '.');
+        if((p == NULL) || (strchr(p, '/') != NULL) || (strchr(p, '\\') != NULL))
+            p = state_file + strlen(state_file);
+        strcpy(p, ".tbs");
+}
+
+/******************************************************************/
+/* Function: build_current()
+ * Description:
+ *     Return TRUE if the outputs of the last assembly done with this
+ *     command line are still up to date: the sources it read and the
+ *     outputs it wrote are all unchanged.  required[] are the outputs
+ *     every assembly writes, and the state file must list them all.
+ */
+int
+build_current(
+int     argc,
+char    *argv[],
+char    *obj_file,
+char    *required[],
+int     nrequired)
+{
+        FILE    *fp;
+        hash_t  want;
+        hash_t  have;
+        int     parent;
+        int     n;
+        int     ok;
+        int     nlines  = 0;
+        int     ndeps   = 0;
+        int     nfound  = 0;
+        int     count   = -1;
+        int     i;
+        char    *p;
+        char    state_file[LINESIZE];
+        char    buf[LINESIZE];
+
+        build_state_name(obj_file, state_file);
+        if((fp = fopen(state_file, "r")) == NULL) return(FALSE);
+
+        ok = FALSE;
+        if((fgets(buf, LINESIZE-1, fp) != NULL) &&
+           (strncmp(buf, BUILD_MAGIC, strlen(BUILD_MAGIC)) == SAME) &&
+           (fgets(buf, LINESIZE-1, fp) != NULL) &&
+           (sscanf(buf, "cmd %llx", &want) == 1) &&
+           (want == build_hash_cmd(argc, argv)))
+        {
+            /* Every dependency and output must hash the same, and
+             * nothing may follow the end line.
+             */
+            ok = TRUE;
+            while(ok && (fgets(buf, LINESIZE-1, fp) != NULL))
+            {
+                if((p = strchr(buf, '\n')) != NULL) *p = '\0';
+
+                if(count >= 0) { ok = FALSE; break; }
+                if(sscanf(buf, "end %d", &count) == 1) continue;
+
+                n = 0;
+                if(sscanf(buf, "dep %llx %d %n", &want, &parent, &n) >= 2)
+                    ndeps++;
+                else if(sscanf(buf, "out %llx %n", &want, &n) >= 1)
+                {
+                    for(i = 0; i < nrequired; i++)
+                        if(strcmp(&buf[n], required[i]) == SAME) nfound++;
+                }
+                else
+                    n = 0;
+
+                if((n == 0) || !build_hash_file(&buf[n], &have) || (have != want))
+                    ok = FALSE;
+                nlines++;
+            }
+
+            /* A file cut short anywhere doesn't count */
+            if((count != nlines) || (ndeps == 0) || (nfound != nrequired))
+                ok = FALSE;
+        }
+        fclose(fp);
+
+        return(ok);
+}
+
+/******************************************************************/
+/* Function: build_save()
+ * Description:
+ *     Write the build state file for an assembly that just finished.
+ *     outputs[] are the files it wrote (NULL entries are skipped).
+ *     Any old state file is removed first, so a failed assembly
+ *     never leaves one behind, and the new one is written under a
+ *     temporary name and then renamed.
+ */
+void
+build_save(
+int     argc,
+char    *argv[],
+char    *obj_file,
+char    *outputs[],
+int     noutputs,
+int     success)        /* FALSE if the assembly had errors */
+{
+        FILE    *fp;
+        BUILDDEP *dep;
+        hash_t  h;
+        int     i;
+        int     n = 0;
+        int     ok;
+        char    state_file[LINESIZE];
+        char    tmp_file[LINESIZE];
+        char    errbuf[LINESIZE];
+
+        build_state_name(obj_file, state_file);
+        sprintf(tmp_file, "%s.tmp", state_file);
+        remove(state_file);
+        remove(tmp_file);
+        if(!success) return;
+
+        if((fp = fopen(tmp_file, "w")) == NULL)
+        {
+            sprintf(errbuf, "tasm: build state file open error on %.128s\n", tmp_file);
+            errprt(errbuf);
+            return;
+        }
+
+        fprintf(fp, "%s\n", BUILD_MAGIC);
+        fprintf(fp, "cmd %016llx\n", build_hash_cmd(argc, argv));
+
+        for(dep = Deps; dep != NULL; dep = dep->next, n++)
+        {
+            if(!dep->hashed) break;
+            fprintf(fp, "dep %016llx %d %s\n", dep->hash, dep->parent, dep->name);
+        }
+
+        for(i = 0; (dep == NULL) && (i < noutputs); i++)
+        {
+            if(outputs[i] == NULL) continue;
+            if(!build_hash_file(outputs[i], &h)) break;
+            fprintf(fp, "out %016llx %s\n", h, outputs[i]);
+            n++;
+        }
+        fprintf(fp, "end %d\n", n);
+
+        /* If a file couldn't be read no state is better than a wrong one */
+        ok = !ferror(fp) && (dep == NULL) && (i >= noutputs);
+        if(fclose(fp) != 0) ok = FALSE;
+        if(!ok || (rename(tmp_file, state_file) != 0)) remove(tmp_file);
+}
+
+/******************************************************************/
+/* Function: build_free()
+ * Description:
+ *     Forget the dependencies (they are in the AR_MODULE arena).
+ */
+void
+build_free(void)
+{
+        Deps     = NULL;
+        Lastdep  = NULL;
+        Tracking = FALSE;
+}
+
+/* That's all folks. */
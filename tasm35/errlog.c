@@ -54,11 +54,11 @@ errout_t output_mode)   /* Enable output on Pass1/Pass2         */
     char    *err_format;
     char    *file;
 
-    extern  int         Errcnt;
-    extern  pass_t      Pass;
-    extern  int         Line_number;
-    extern  int         Skip;
-    extern  char        Errorbuf[];
+    extern ASMSTATE  int         Errcnt;
+    extern ASMSTATE  pass_t      Pass;
+    extern ASMSTATE  int         Line_number;
+    extern ASMSTATE  int         Skip;
+    extern ASMSTATE  char        Errorbuf[];
 
     /* Suppress errors if this is the first pass or if we are
      *  just skipping over source code looking for an 'endif'. 
@@ -27,9 +27,9 @@
 
 
 /* Static */
-static char fname_list[MAXFILES][PATHSIZE];
+static ASMSTATE char fname_list[MAXFILES][PATHSIZE];
 
-static int  SourceIncludeDepth = 0;
+static ASMSTATE int  SourceIncludeDepth = 0;
 
 
 /******************************************************************/
@@ -42,6 +42,12 @@ fname_push(
 char    *fname)         /* File name                      */
 
 {
+        extern ASMSTATE  pass_t  Pass;
+
+        /* Pass 1 sees every file, so note the include graph then */
+        if(Pass == FIRST)
+            build_dep(fname, (SourceIncludeDepth > 0) ?
+                             &fname_list[SourceIncludeDepth][0] : NULL);
 
         SourceIncludeDepth++;
 
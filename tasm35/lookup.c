@@ -28,12 +28,125 @@
 #endif
 
 /* EXTERNALS */
-extern  ushort  Debug;
-extern  char    Errorbuf[LINESIZE];
+extern ASMSTATE  ushort  Debug;
+extern ASMSTATE  char    Errorbuf[LINESIZE];
+
+/* Mnemonic index for inst_lookup().  Every variant (argument pattern) of
+ * a mnemonic is copied, in table order, into one contiguous run of
+ * Opindex[], and an open addressed hash on the whole mnemonic points to
+ * the start of each run.  That way a lookup costs one hash probe and then
+ * only looks at the entries that can actually match.  The index is built
+ * the first time it's needed and discarded whenever the instruction table
+ * changes (read_table(), ADDINSTR).
+ */
+typedef struct{
+        char    *instruction;   /* mnemonic (NULL if this slot is free)  */
+        ushort  first;          /* index of its first entry in Opindex[] */
+        ushort  count;          /* number of variants                    */
+}INSTHASH;
+
+static  ASMSTATE OPTAB    *Opindex     = NULL;   /* variants grouped by mnemonic */
+static  ASMSTATE INSTHASH *Insthash    = NULL;   /* mnemonic hash table          */
+static  ASMSTATE ushort   Insthash_size= 0;      /* number of slots (power of 2) */
 
 /************************************************************************/
 /* FUNCTIONS */
 
+/* Function: inst_hash()
+ * Description:
+ *     Return the Insthash[] slot for this mnemonic - either the one
+ *     that already holds it or the free slot where it belongs.
+ */
+static INSTHASH *
+inst_hash(char *inst)
+{
+    ulong       h;
+    char        *p;
+
+    h = 2166136261UL;
+    for(p = inst; *p; p++)
+    {
+        h ^= (ubyte)*p;
+        h *= 16777619UL;
+    }
+
+    for(h &= (Insthash_size-1);; h = (h+1) & (Insthash_size-1))
+    {
+        if((Insthash[h].instruction == NULL) ||
+           (strcmp(Insthash[h].instruction, inst) == SAME))
+            return(&Insthash[h]);
+    }
+}
+
+/* Function: inst_index()
+ * Description:
+ *     Build the mnemonic index from the current instruction table.
+ */
+static void
+inst_index(void)
+{
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  OPTAB   *Optab[];
+
+    ushort      i;
+    ushort      next;
+    INSTHASH    *ih;
+
+    inst_index_free();
+
+    /* At least twice as many slots as instructions keeps probes short */
+    Insthash_size = 16;
+    while(Insthash_size < 2*Num_instr) Insthash_size *= 2;
+
+    Insthash = (INSTHASH *)calloc(Insthash_size, sizeof(INSTHASH));
+    Opindex  = (OPTAB *)malloc((Num_instr+1) * sizeof(OPTAB));
+    if((Insthash == NULL) || (Opindex == NULL))
+    {
+        errprt("tasm: Cannot malloc for instruction index\n");
+        tasmexit(EXIT_MALLOC);
+    }
+
+    /* Count the variants of each mnemonic ... */
+    for(i = 0; i < Num_instr; i++)
+    {
+        ih = inst_hash(Optab[i]->instruction);
+        ih->instruction = Optab[i]->instruction;
+        ih->count++;
+    }
+
+    /* ... assign each one a run in Opindex[] ... */
+    next = 0;
+    for(i = 0; i < Insthash_size; i++)
+    {
+        if(Insthash[i].instruction == NULL) continue;
+        Insthash[i].first = next;
+        next += Insthash[i].count;
+        Insthash[i].count = 0;
+    }
+
+    /* ... and fill in the runs, keeping the table order within each */
+    for(i = 0; i < Num_instr; i++)
+    {
+        ih = inst_hash(Optab[i]->instruction);
+        Opindex[ih->first + ih->count++] = *Optab[i];
+    }
+
+    DEBUG2("inst_index: %d instructions, %d slots\n", Num_instr, Insthash_size);
+}
+
+/* Function: inst_index_free()
+ * Description:
+ *     Discard the mnemonic index.  It will be rebuilt by the next
+ *     inst_lookup().
+ */
+void
+inst_index_free(void)
+{
+    free(Opindex);   Opindex  = NULL;
+    free(Insthash);  Insthash = NULL;
+    Insthash_size = 0;
+}
+
 /* Function: inst_lookup()
  * Description:
  *     Lookup instruction and args string in tables to see if valid.
@@ -53,17 +166,15 @@ ulong   *bor,
 ushort  *argc,
 char    **argv)
 {
-    static  char    expbuf[LINESIZE];
-
-    extern  ushort  Class_mask;
-    extern  ushort  Ihash[];
-    extern  ushort  Num_instr;
-    extern  ushort  Num_reg;
-    extern  OPTAB   *Optab[];
-    extern  REGTAB  *Regtab[];
-    extern  char    Wild_char;
-    extern  char    Reg_char;
-    extern  char    Errorbuf[LINESIZE];
+    static  ASMSTATE char    expbuf[LINESIZE];
+
+    extern ASMSTATE  ushort  Class_mask;
+    extern ASMSTATE  ushort  Num_reg;
+    extern ASMSTATE  REGTAB  *Regtab[];
+    extern ASMSTATE  char    Wild_char;
+    extern ASMSTATE  char    Reg_char;
+    extern ASMSTATE  char    Errorbuf[LINESIZE];
+    extern ASMSTATE  STATS   Stats;
 
     char    argbuf[LINESIZE];
     ushort  j;
@@ -77,8 +188,9 @@ char    **argv)
     char    *p;
     char    *q;
     char    c;
-    ushort  inst_match;
     ulong   regfield;
+    INSTHASH *ih;
+    OPTAB   *op;
 
     /* Just for safety, make sure we do not return a NULL pointer in argv[0]
      * even if no args are found.  If we match an op_code that needs args
@@ -116,36 +228,25 @@ char    **argv)
     }
     *q = '\0';
 
-    /* Get the first element of Optab that we should look at for
-     *   this instruction from the instruction hash table 
-     */
-    jj = Ihash[HASHKEY(inst)];
-    inst_match = FALSE;
+    /* Find the run of variants for this mnemonic */
+    if(Insthash == NULL) inst_index();
+    ih = inst_hash(inst);
+    op = &Opindex[ih->first];
+    Stats.inst_lookups++;
 
-    for(; jj < Num_instr; jj++)
+    for(jj = 0; jj < ih->count; jj++, op++)
     {
-
-        if(Optab[jj]->same_inst == FALSE)
-        {
-            /* New instruction.  Check to see if it matches. */
-            p = inst;
-            q = Optab[jj]->instruction;
-            while((*p == *q) && (*p)){
-                p++;
-                q++;
-            }
-            inst_match = (*p == *q);
-        }
-        
-        if(inst_match && (Optab[jj]->iclass & Class_mask))
+        if(op->iclass & Class_mask)
         {
+            Stats.inst_compares++;
+
             /* Instruction matches, now check args.
              * Set the error flag hoping it will be cleared when
              *   a legal argument is found 
              */
             errflag = ER_BADARG;
 
-            argpattern = Optab[jj]->args; /* fetch expected arg  */
+            argpattern = op->args;      /* fetch expected arg  */
             argu = argbuf;  /* pointer to args (upper case only) */
             argl = args;    /* pointer to args (mixed case)      */
             arge = expbuf;  /* pointer to  extracted expression  */
@@ -255,12 +356,12 @@ char    **argv)
                  */
                 if((*argpattern == '\0')&&(*argu == '\0'))
                 {
-                    *op_code = Optab[jj]->opcode | regfield;
-                    *obytes  = Optab[jj]->obytes;
-                    *abytes  = Optab[jj]->abytes;
-                    *modop   = Optab[jj]->modop;
-                    *shift   = Optab[jj]->shift;
-                    *bor     = Optab[jj]->bor;
+                    *op_code = op->opcode | regfield;
+                    *obytes  = op->obytes;
+                    *abytes  = op->abytes;
+                    *modop   = op->modop;
+                    *shift   = op->shift;
+                    *bor     = op->bor;
                     return(ER_NOERR);
                 }
                 argl++;
@@ -325,6 +426,83 @@ dir_lookup(char *directive)
     }
 }
 
+/* Function: label_hash()
+ * Description:
+ *     Compute the hash (FNV-1a) of a label string.  The whole label
+ *     participates since generated sources tend to have long runs of
+ *     labels that share the same first few characters.
+ */
+
+static ulong
+label_hash(char *plabel)
+{
+    ulong       h;
+
+    h = 2166136261UL;
+    while(*plabel)
+    {
+        h ^= (ubyte)*plabel++;
+        h *= 16777619UL;
+    }
+    return(h & 0xffffffffUL);
+}
+
+/* Function: link_label()
+ * Description:
+ *     Link label table entry i onto the end of its hash chain.  Entries
+ *     are always kept in table order within a chain so that, when
+ *     duplicate labels are permitted, the first definition is the one
+ *     found (which is what the old linear search did).
+ */
+
+static void
+link_label(int i)
+{
+    extern ASMSTATE      LABTAB  **Labtab;
+    extern ASMSTATE      int     *Lhash;
+    extern ASMSTATE      int     Lhash_size;
+
+    int         *pnext;
+
+    GETLABTAB(i)->hnext = FAILURE;
+    pnext = &Lhash[label_hash(GETLABTAB(i)->lab) & (ulong)(Lhash_size-1)];
+    while(*pnext != FAILURE) pnext = &(GETLABTAB(*pnext)->hnext);
+    *pnext = i;
+}
+
+/* Function: hash_labels()
+ * Description:
+ *     (Re)build the label hash index from scratch.  This is called
+ *     whenever the index grows and after the label table is sorted
+ *     (since sorting changes the table index of every label).
+ */
+
+void
+hash_labels(void)
+{
+    extern ASMSTATE      LABTAB  **Labtab;
+    extern ASMSTATE      int     Nlab;
+    extern ASMSTATE      int     *Lhash;
+    extern ASMSTATE      int     Lhash_size;
+
+    int         i;
+    int         bucket;
+
+    /* Keep the number of buckets at least twice the number of labels */
+    if(Lhash_size == 0) Lhash_size = 2*LABINIT;
+    while(Lhash_size < 2*Nlab) Lhash_size *= 2;
+
+    free(Lhash);
+    Lhash = (int *)malloc(Lhash_size * sizeof(int));
+    if(Lhash == NULL){
+        errprt("tasm: Cannot malloc for label hash table\n");
+        tasmexit(EXIT_MALLOC);
+    }
+    for(bucket = 0; bucket < Lhash_size; bucket++) Lhash[bucket] = FAILURE;
+
+    for(i = 0; i < Nlab; i++) link_label(i);
+}
+
 /* Function: save_label()
  * Description:
  *     Save this label in the label table.
@@ -334,17 +512,20 @@ void
 save_label(char *plabel, expr_t labval)
 {
 
-    extern      LABTAB  *Labtab[];
-    extern      ushort  Nlab;
-    extern      int     Seg;
-    extern      int     Err_check;
-    extern      int     Ignore_case;
-    extern      char    Local_char;
-    extern      char    Module_name[];
+    extern ASMSTATE      LABTAB  **Labtab;
+    extern ASMSTATE      int     Labtab_size;
+    extern ASMSTATE      int     Nlab;
+    extern ASMSTATE      int     Lhash_size;
+    extern ASMSTATE      int     Seg;
+    extern ASMSTATE      int     Err_check;
+    extern ASMSTATE      int     Ignore_case;
+    extern ASMSTATE      char    Local_char;
+    extern ASMSTATE      char    Module_name[];
 
     size_t      labsize;
     char        label[LINESIZE];
     int         local_flag;
+    LABTAB      **newtab;
 
     /* If this is a local label then build the full label by 
      * concatenating the current module name with the local label.
@@ -382,20 +563,28 @@ save_label(char *plabel, expr_t labval)
         return;
     }
 
+    /* Grow the label pointer table if it is full */
+    if(Nlab >= Labtab_size){
+        newtab = (LABTAB **)realloc(Labtab,
+                       (Labtab_size ? 2*Labtab_size : LABINIT)*sizeof(LABTAB *));
+        if(newtab == NULL){
+            sprintf(label, "Cannot malloc for label table.  NumLabels=%d\n", Nlab);
+            errprt(label);
+            tasmexit(EXIT_MALLOC);
+        }
+        Labtab      = newtab;
+        Labtab_size = Labtab_size ? 2*Labtab_size : LABINIT;
+    }
+
     /* Compute size of labtab entry.  The 'lab' buffer is declared as
      * 2 chars.  Grow as necessary.  This approach is a little messy,
      * but avoids saving another pointer and incurring the overhead of
-     * another malloc (another 4 bytes).
+     * another allocation (another 4 bytes).
      */
-    GETLABTAB(Nlab) = (LABTAB *)malloc(sizeof(LABTAB) + labsize - 1);
-    if(GETLABTAB(Nlab) == NULL){
-        sprintf(label, "Cannot malloc for label storage.  NumLabels=%d\n", Nlab);
-        errprt(label);
-        tasmexit(EXIT_MALLOC);
-    }
+    GETLABTAB(Nlab) = (LABTAB *)arena_alloc(AR_LABELS, sizeof(LABTAB) + labsize - 1);
     strcpy(GETLABTAB(Nlab)->lab, label);
 
-    DEBUG2("Malloc %lx %s\n",(long)GETLABTAB(Nlab),GETLABTAB(Nlab)->lab);
+    DEBUG2("Alloc %lx %s\n",(long)GETLABTAB(Nlab),GETLABTAB(Nlab)->lab);
 
     GETLABTAB(Nlab)->val    = labval;
     GETLABTAB(Nlab)->flags  = (Seg & F_SEG) | local_flag;
@@ -404,6 +593,12 @@ save_label(char *plabel, expr_t labval)
     if(Ignore_case) stoupper(GETLABTAB(Nlab)->lab);
 
     Nlab++;
+
+    /* Add it to the hash index, rebuilding the index if it's too full */
+    if(Nlab > Lhash_size/2)
+        hash_labels();
+    else
+        link_label(Nlab-1);
     return;
 }
 
@@ -415,17 +610,15 @@ save_label(char *plabel, expr_t labval)
 int
 find_label(char *plabel)
 {
-    extern      LABTAB  *Labtab[];
-    extern      ushort  Lhash[];
-    extern      ushort  Nlab;
-    extern      pass_t  Pass;
-    extern      int     Ignore_case;
-    extern      char    Module_name[];
-    extern      char    Local_char;
-
-    ushort      i;
-    short       j;
-    char        firstc;
+    extern ASMSTATE      LABTAB  **Labtab;
+    extern ASMSTATE      int     *Lhash;
+    extern ASMSTATE      int     Lhash_size;
+    extern ASMSTATE      int     Ignore_case;
+    extern ASMSTATE      char    Module_name[];
+    extern ASMSTATE      char    Local_char;
+    extern ASMSTATE      STATS   Stats;
+
+    int         i;
     char        label[LINESIZE];
 
     /* If we are looking for a local label then prefix with the module
@@ -440,37 +633,22 @@ find_label(char *plabel)
         strcpy(label, plabel);
     }
 
-    i = 0;      /* starting point for search */
     if(Ignore_case == TRUE)
     {
         stoupper(label);
     }
 
-    /* On second pass the label table is sorted, so do simple indexing */
-    if(Pass != FIRST){
-        /* lookup the starting point in the label table to begin
-         * the search
-         */
-        j = *label - 'A';
-        if((j >=0) && (j < MAXLHASH)) i = Lhash[j]; 
+    Stats.label_finds++;
 
-        for(; i < Nlab; i++)
-        {
-            if(strcmp(label, GETLABTAB(i)->lab) == SAME) return(i);
-        }
+    /* Nothing to search if no labels have been defined yet */
+    if(Lhash_size == 0) return(FAILURE);
 
-    }
-    else{
-        firstc = *label;
-        for(; i < Nlab; i++)
-        {
-            /* Check for first char match before calling strcmp
-             * just for a little more speed.
-             */
-            if((firstc == *(GETLABTAB(i)->lab)) && 
-               (strcmp(label, GETLABTAB(i)->lab) == SAME)) 
-                return(i);
-        }
+    /* Walk the hash chain for this label */
+    i = Lhash[label_hash(label) & (ulong)(Lhash_size-1)];
+    for(; i != FAILURE; i = GETLABTAB(i)->hnext)
+    {
+        Stats.label_probes++;
+        if(strcmp(label, GETLABTAB(i)->lab) == SAME) return(i);
     }
 
     return(FAILURE);
@@ -24,6 +24,7 @@
 
 /* INCLUDES */
 #include        "tasm.h"
+#include        <pthread.h>
 
 #ifdef T_MEMCHECK
 #include        <memcheck.h>
@@ -35,33 +36,91 @@
 #define         MAXMACRO        1000   /* Max number of macros           */
 #define         MAXPARMS        10     /* Max number of parms per macro  */
 #define         MAXARGSIZE      16     /* Max length of parm  label      */
+#define         MACHASH         2048   /* Macro label hash slots (a power
+                                        * of 2 at least 2*MAXMACRO)      */
 
 /* Constants to indicate the rules for finding the end of a string for
- * save_string() (malloc).
+ * save_string().
  */
 typedef enum {STR_NULLEND, STR_SPACEEND} strend_t;
 
 
 /* STATIC */
-int     Num_macros             = 0;
-int     Num_macros_predefined  = 0;
+ASMSTATE int     Num_macros             = 0;
+ASMSTATE ulong   Macro_state            = 0;     /* Changes whenever the macro set */
+                                        /*  does (see macro_state_add())  */
+static  ASMSTATE int     Num_macros_predefined  = 0;
+static  ASMSTATE ulong   Macro_state_predefined = 0;
+static  ASMSTATE ARMARK  Macro_mark_predefined;  /* End of the predefined macros   */
 char    Emptystring[] = "";
 
-static  ptok_t  Lasttok;
-static  int     Elevel;
-static  char    Last_inst[10];
+static  ASMSTATE ptok_t  Lasttok;
+static  ASMSTATE int     Elevel;
+static  ASMSTATE char    Last_inst[10];
 
 /* these pointer arrays keep track of where in heap the appropriate
  *  macro definitions are */
-static  char    *macrolabel[MAXMACRO+1];
-static  char    *macrodef[MAXMACRO+1];
+static  ASMSTATE char    *macrolabel[MAXMACRO+1];
+static  ASMSTATE char    *macrodef[MAXMACRO+1];
+
+/* Open addressed hash of the macro labels.  Each slot holds one more
+ * than an index into macrolabel[]/macrodef[], or 0 if it's free.  Entries
+ * are added by macro_save() and the table is rebuilt by macro_free().
+ */
+static  ASMSTATE short   Machash[MACHASH];
 
 /* Make the following static so that they are available to add to macro
  * definitions with the DEFCONT directive.
  */
 
-static  int     Nparms;
-static  char    Parm[MAXPARMS+1][MAXARGSIZE+1];
+static  ASMSTATE int     Nparms;
+static  ASMSTATE char    Parm[MAXPARMS+1][MAXARGSIZE+1];
+
+/* Precompiled instruction table cache.  After a .tab file is parsed the
+ * resulting Optab/Regtab are written next to it as a .tbc file and
+ * later runs load that image with a single read.  All string pointers in
+ * the image are stored as offsets into the string pool at the end of the
+ * file, so the image is position independent; they are relocated once
+ * it's in memory.  The cache is discarded whenever the .tab file's mtime
+ * or size changes, when its contents don't match the hash in the header,
+ * or when it was written by a build with a different OPTAB/REGTAB layout.
+ */
+#define TBC_MAGIC       "TASMTBC"
+#define TBC_VERSION     2
+
+typedef struct{
+        char    magic[8];       /* TBC_MAGIC                            */
+        ulong   version;        /* TBC_VERSION                          */
+        ulong   tab_mtime;      /* mtime of the .tab file               */
+        ulong   tab_size;       /* size of the .tab file                */
+        ushort  optab_size;     /* sizeof(OPTAB) in the writing build   */
+        ushort  regtab_size;    /* sizeof(REGTAB)  "   "     "     "    */
+        ushort  num_instr;      /* number of OPTAB entries              */
+        ushort  num_reg;        /* number of REGTAB entries             */
+        ulong   strpool_size;   /* bytes in the string pool             */
+        ulong   checksum;       /* FNV-1a hash of everything after this */
+        ulong   banner;         /* string pool offset of the Banner     */
+        int     ols_first;      /* table directives (.MSFIRST, etc)     */
+        int     wordsize;
+        int     no_arg_shift;
+        char    wild_char;
+}TBCHEADER;
+
+static  ASMSTATE ulong   Tbc_hash;                 /* running hash of the image   */
+
+/* In a batch (see table_share()) each table image is loaded once and
+ * then used, read only, by every assembly that needs it.  ADDINSTR only
+ * ever adds entries (in the assembly's own arena), so that's safe.
+ */
+typedef struct _SHTABLE{
+        struct _SHTABLE *next;
+        char    *image;                 /* relocated .tbc image         */
+        char    name[LINESIZE];         /* the .tbc file it came from   */
+}SHTABLE;
+
+static  int             Share_tables  = FALSE;
+static  SHTABLE         *Shared_tables = NULL;
+static  pthread_mutex_t Table_lock    = PTHREAD_MUTEX_INITIALIZER;
 
 /* STATIC FUNCTION PROTOTYPES */
 static void      add_reg    (char *s);
@@ -70,20 +129,149 @@ static ptok_t    gettok     (expr_t *tokval);
 static expr_t    nextval    (void);
 static int       next_operator (char *s);
 static tok_t     toktype    (ptok_t token);
-static char     *save_string(char *s, strend_t strtype);
+static char     *save_string(char *s, strend_t strtype, arena_t region);
+static int       load_table_cache(char *cache_filename, struct stat *tab_stat);
+static char     *read_table_cache(char *cache_filename, struct stat *tab_stat,
+                                  int shared);
+static void      install_table_cache(char *image);
+static char     *tbc_discard(char *image, int shared);
+static void      save_table_cache(char *cache_filename, struct stat *tab_stat);
 
 
 /* EXTERNALS */
-extern  ushort  Debug;
-extern  char    Errorbuf[LINESIZE];
+extern ASMSTATE  ushort  Debug;
+extern ASMSTATE  char    Errorbuf[LINESIZE];
 
 /************************************************************************/
 /* FUNCTIONS */
 
+/* Function: macro_hash()
+ * Description:
+ *     Hash (FNV-1a) the first len characters of a macro label.
+ */
+static ulong
+macro_hash(char *s, int len)
+{
+    ulong   h;
+
+    h = 2166136261UL;
+    while(len--)
+    {
+        h ^= (ubyte)*s++;
+        h *= 16777619UL;
+    }
+    return(h & (MACHASH-1));
+}
+
+/* Function: macro_state_add()
+ * Description:
+ *     Fold a macro definition (or continuation) into Macro_state.  Two
+ *     points in the source with the same Macro_state have the same
+ *     macros defined, so a line expanded at one expands the same way at
+ *     the other.  The source line cache (srccache.c) relies on this.
+ */
+static void
+macro_state_add(char *s)
+{
+    do
+    {
+        Macro_state ^= (ubyte)*s;
+        Macro_state *= 16777619UL;
+        Macro_state &= 0xffffffffUL;
+    }while(*s++);
+}
+
+/* Function: macro_lookup()
+ * Description:
+ *     Find the macro whose label is exactly the first len characters
+ *     of s.  Returns the macro index, or -1 if there is none.
+ */
+static int
+macro_lookup(char *s, int len)
+{
+    ulong   h;
+    int     i;
+
+    for(h = macro_hash(s, len); Machash[h] != 0; h = (h+1) & (MACHASH-1))
+    {
+        i = Machash[h] - 1;
+        if((strncmp(macrolabel[i], s, len) == SAME) && (macrolabel[i][len] == '\0'))
+            return(i);
+    }
+    return(-1);
+}
+
+/* Function: macro_hash_add()
+ * Description:
+ *     Add macro i to the label hash.  If the label is already defined
+ *     the earlier definition is kept, since that's the one that has
+ *     always been used for both expansion and IFDEF.
+ */
+static void
+macro_hash_add(int i)
+{
+    ulong   h;
+    int     len;
+
+    len = strlen(macrolabel[i]);
+    for(h = macro_hash(macrolabel[i], len); Machash[h] != 0; h = (h+1) & (MACHASH-1))
+    {
+        if(strcmp(macrolabel[Machash[h]-1], macrolabel[i]) == SAME) return;
+    }
+    Machash[h] = i + 1;
+}
+
+/* Function: macro_match()
+ * Description:
+ *     Find the macro, if any, that is invoked by the identifier at s.
+ *     An identifier is a run of letters, digits, '_' and '.', and a
+ *     macro label matches either the whole run or the part of it before
+ *     one of the '.'s (so "#define equ .equ" still works).  If more than
+ *     one matches, the one defined first wins.  Returns the macro index
+ *     or -1, and the length of the match in *plen.
+ */
+static int
+macro_match(char *s, int *plen)
+{
+    int     end;
+    int     len;
+    int     i;
+    int     best;
+
+    best = -1;
+    for(end = 0; isalnum(s[end]) || (s[end] == '_') || (s[end] == '.'); end++)
+        /* void */;
+
+    for(len = 1; len <= end; len++)
+    {
+        if((len < end) && (s[len] != '.')) continue;
+        if(((i = macro_lookup(s, len)) >= 0) && ((best < 0) || (i < best)))
+        {
+            best  = i;
+            *plen = len;
+        }
+    }
+    return(best);
+}
+
+/* Macro expansion stops after this many substitutions on one line; it
+ * can only be reached by a macro that (indirectly) invokes itself.
+ */
+#define MAXEXPANSIONS   LINESIZE
+
 /* Function: macro_expand()
  * Description:
  *     Scan an input line for an invocation of a macro.
  *     If one is found then expand it.
+ *
+ *     The line is scanned once, right to left.  At the start of each
+ *     identifier the macro label hash is consulted, so the cost doesn't
+ *     depend on the number of macros defined.  Scanning from the right
+ *     means macros used in the arguments of another macro are expanded
+ *     before it is.  After a macro has been expanded scanning resumes at
+ *     the end of the expansion, so that macros-in-macros and multiple
+ *     instances on a line are all expanded.  Nothing inside double
+ *     quotes or a comment is expanded.
  */
 void
 macro_expand(
@@ -98,20 +286,19 @@ char    *target)          /* Put expanded line here       */
     int     nnparms;
     int     c;
     int     comment;
-    int     macro_found;
+    int     nexpand;
+    int     depth;
     char    parm[MAXPARMS+1][MAXARGSIZE+1];
-    char    *s;
+    char    *t;
     char    *ss;
     char    *mm;
     char    *pparm;
-    char    *save_targ;
-    char    sbuf[LINESIZE];
+    char    *tend;
+    char    sbuf[2*LINESIZE];
     char    comment_buf[LINESIZE];
 
-    extern  char    Comment_char1;
-
-    save_targ = target;
-    s         = sbuf;
+    extern ASMSTATE  char    Comment_char1;
+    extern ASMSTATE  STATS   Stats;
 
     strcpy(target,src);
 
@@ -141,80 +328,88 @@ char    *target)          /* Put expanded line here       */
         comment_buf[0] = '\0';
     }
 
-    do{
-      /* Continue to scan for macros until a complete scan results in 
-       * no hits.  This, to ensure that multiple instances on a line
-       * and macros-in-macros get expanded.
-       */
-      macro_found = FALSE;
-
-      for(i=0; i < Num_macros; i++){
-        target =  save_targ;
-        strcpy(s, save_targ);
-
-        /* look for macro label in the input string */
-        if((pos = search(s,macrolabel[i])) >= 0){
-            /* We have found a match.
-             * Abort if it is after the start of comments or in quotes.
-             */
-            if(inquotes(s, pos)) continue;
-
-            macro_found = TRUE;
-
-            /* first extract parameters, if any */
-            nnparms = 0;
-            len = strlen(macrolabel[i]);
-            ss = &s[pos+len];
-            if(*ss == '('){
-                ss++;
-                do{
-                    j = 0;
-                    while((*ss != ',') && (*ss != ')')
-                                       && (*ss != '\0')
-                                       && (j < MAXARGSIZE)){
-                        parm[nnparms][j++] = *ss++;
-                    }
-                    parm[nnparms][j] = '\0';
-                    nnparms++;
-                }while((*ss++ != ')') && (*ss != '\0')&&( nnparms < MAXPARMS));
-            }
+    Stats.macro_scans++;
+    nexpand = 0;
+    for(pos = strlen(target) - 1; pos >= 0; pos--){
 
+        /* Only look for a macro at the start of an identifier */
+        c = target[pos];
+        if(!(isalpha(c) || (c == '.'))) continue;
+        if(pos > 0){
+            c = target[pos-1];
+            if(isalnum(c) || (c == '_') || (c == '.')) continue;
+        }
 
-            /* copy preceeding part to temp buffer directly */
-            for(j=0; j < pos; j++)*target++ = s[j];
-
-            /* now copy the macro expansion and expand args as we go */
-            mm = macrodef[i];
-            while((c = *mm++) != '\0'){
-               if(c == '?'){
-                   macargi = *mm++ - '0';
-                   /* Make sure we saw the appropriate number of macros
-                    * in the source.
-                    */
-                   if (macargi >= nnparms) {
-                       errlog("Macro expects args but none found",   
-                           PASS2_ONLY);
-                   }
-                   else{
-                       pparm = parm[macargi];
-                       while(*pparm)*target++ = *pparm++;
-                   }
-               }else
-                   *target++ = c;
-            }
+        /* Skip this identifier if it isn't a macro or is in quotes */
+        Stats.macro_lookups++;
+        if((i = macro_match(&target[pos], &len)) < 0) continue;
+        if(inquotes(target, pos)) continue;
 
-            /* copy the rest of the line in */
-            while(*ss)*target++ = *ss++;
-            *target = 0;
+        if(++nexpand > MAXEXPANSIONS){
+            errlog("Macro expansion too long         ",   PASS2_ONLY);
+            return;
+        }
 
-            if(target > (save_targ + LINESIZE - 20)){
-                errlog("Macro expansion too long         ",   PASS2_ONLY);
-                return;
-            }
+        /* first extract parameters, if any */
+        nnparms = 0;
+        ss = &target[pos+len];
+        if(*ss == '('){
+            ss++;
+            do{
+                j     = 0;
+                depth = 0;
+                while((depth > 0) || ((*ss != ',') && (*ss != ')'))){
+                    if(*ss == '\0') break;
+                    if(*ss == '(') depth++;
+                    if(*ss == ')') depth--;
+                    if(j < MAXARGSIZE) parm[nnparms][j++] = *ss;
+                    ss++;
+                }
+                parm[nnparms][j] = '\0';
+                nnparms++;
+            }while((*ss++ == ',') && (*ss != '\0')&&( nnparms < MAXPARMS));
+        }
 
+        /* copy preceeding part to temp buffer directly */
+        t    = sbuf;
+        tend = sbuf + LINESIZE - 20;
+        for(j=0; j < pos; j++)*t++ = target[j];
+
+        /* now copy the macro expansion and expand args as we go */
+        mm = macrodef[i];
+        while(((c = *mm++) != '\0') && (t < tend)){
+           if(c == '?'){
+               macargi = *mm++ - '0';
+               /* Make sure we saw the appropriate number of macros
+                * in the source.
+                */
+               if (macargi >= nnparms) {
+                   errlog("Macro expects args but none found",   
+                       PASS2_ONLY);
+               }
+               else{
+                   pparm = parm[macargi];
+                   while(*pparm)*t++ = *pparm++;
+               }
+           }else
+               *t++ = c;
         }
-      } /* end for */
-    }while (macro_found == TRUE);
+
+        /* Everything after the expansion has already been scanned,
+         * so carry on from the end of the expansion.
+         */
+        pos = t - sbuf;
+
+        /* copy the rest of the line in */
+        while(*ss && (t < tend))*t++ = *ss++;
+        *t = 0;
+
+        if(t >= tend){
+            errlog("Macro expansion too long         ",   PASS2_ONLY);
+            return;
+        }
+        strcpy(target, sbuf);
+    }
 
     /* Append the comment that was removed (if any) */
     if(comment > 0) strcat (target, comment_buf);
@@ -231,13 +426,7 @@ int
 macro_get_index(char *s)
 {
 
-        int     i;
-
-        for(i = 0; i < Num_macros; i++){
-            if(strcmp(s,macrolabel[i]) == SAME) return(i);
-        }
-
-        return (-1);
+        return (macro_lookup(s, strlen(s)));
 
 }
 
@@ -251,7 +440,7 @@ void
 macro_save(char *s)
 {
 
-    static char    argtoken[] = {'?', '0','\0'};
+    static ASMSTATE char    argtoken[] = {'?', '0','\0'};
     int     j;
     char    *macp;
     char    buf[LINESIZE];
@@ -267,7 +456,7 @@ macro_save(char *s)
 
     *p++ = '\0';
 
-    macrolabel[Num_macros] = save_string(buf, STR_NULLEND);
+    macrolabel[Num_macros] = save_string(buf, STR_NULLEND, AR_MACROS);
 
     if(*s == '=')s++;       /* gobble '=' in macro defs from the command line */
 
@@ -303,8 +492,11 @@ macro_save(char *s)
         replace(macp,Parm[j],argtoken);
     }
 
-    macrodef[Num_macros] = save_string(buf, STR_NULLEND);
+    macrodef[Num_macros] = save_string(buf, STR_NULLEND, AR_MACROS);
 
+    macro_hash_add(Num_macros);
+    macro_state_add(macrolabel[Num_macros]);
+    macro_state_add(macrodef[Num_macros]);
     Num_macros++;
 
     if(Num_macros >= MAXMACRO){
@@ -323,7 +515,7 @@ void
 macro_append(char *s)
 {
 
-    static char    argtoken[] = {'?', '0','\0'};
+    static ASMSTATE char    argtoken[] = {'?', '0','\0'};
     int     j;
     int     cnt;
     char    *macp;
@@ -337,19 +529,18 @@ macro_append(char *s)
     ss = s;
     while(*ss++)cnt++;
 
-    /* Increase the size of the memory block used to save the macro */
+    /* Make a new copy of the macro big enough for the addition (the
+     * old one is left in the arena until the macros are freed).
+     */
     ss = macrodef[Num_macros-1];
     while(*ss++)cnt++;
-    macp = (char *)realloc(macrodef[Num_macros-1], cnt + 2);
-    if(macp == NULL)
-    {
-        errprt("tasm: Cannot realloc for macro definition\n");
-        tasmexit(EXIT_MALLOC);
-    }
+    macp = (char *)arena_alloc(AR_MACROS, cnt + 2);
+    strcpy(macp, macrodef[Num_macros-1]);
     macrodef[Num_macros-1] = macp;
 
     /* tag additional stuff on the end of the existing macro buffer */
     strcat(macp,s);
+    macro_state_add(s);
 
     /* Substitute the appropriate argument strings in macro definition.
      *  Replace each argument with a two character string of the
@@ -369,6 +560,21 @@ macro_append(char *s)
 }
 
 
+/* Function: macro_predefined()
+ * Description:
+ *     Note that the macros defined so far (on the command line) are
+ *     the predefined ones that macro_free(FALSE) keeps.
+ */
+
+void
+macro_predefined( void )
+{
+    Num_macros_predefined  = Num_macros;
+    Macro_state_predefined = Macro_state;
+    Macro_mark_predefined  = arena_mark(AR_MACROS);
+}
+
+
 /* Function: macro_free()
  * Description:
  *     Free all the macro storage expect those macros defined on the 
@@ -380,17 +586,22 @@ macro_free(int freeAll)
 {
     int macro;
 
-    if ( freeAll )  macro = 0;
-    else            macro = Num_macros_predefined;
-
-    for (; macro < Num_macros; macro++)
+    if (freeAll)
+    {
+        arena_reset(AR_MACROS);
+        Num_macros  = 0;
+        Macro_state = 0;
+    }
+    else
     {
-        if (macrodef[macro] != Emptystring) free ( macrodef   [ macro ] );  
-        free ( macrolabel [ macro ] ); 
+        arena_release(AR_MACROS, Macro_mark_predefined);
+        Num_macros  = Num_macros_predefined;
+        Macro_state = Macro_state_predefined;
     }
 
-    if (freeAll) Num_macros = 0;
-    else         Num_macros = Num_macros_predefined;
+    /* Rebuild the label hash for the macros that are left */
+    for (macro = 0; macro < MACHASH; macro++) Machash[macro] = 0;
+    for (macro = 0; macro < Num_macros; macro++) macro_hash_add(macro);
 
 }
 
@@ -406,10 +617,10 @@ macro_free(int freeAll)
 expr_t
 val(char *expr_buf)
 {
-    extern  char    *Expr;
+    extern ASMSTATE  char    *Expr;
     expr_t  ival;
-    extern  int     Err_check;
-    extern  line_t  Linetype;
+    extern ASMSTATE  int     Err_check;
+    extern ASMSTATE  line_t  Linetype;
 
     /* If expression surrounded by parens then complain if strict 
      * error checking is enabled.  This is to avoid ambiguity with
@@ -592,10 +803,10 @@ eval(void)
 static ptok_t
 gettok(expr_t *tokval)
 {
-    extern  char    *Expr;          /* Pointer to expression buffer */
-    extern  pc_t    Pc;             /* Instruction pointer */
-    extern  LABTAB  *Labtab[];       /* Label data */
-    extern  char    Local_char;     /* First char for local labels */
+    extern ASMSTATE  char    *Expr;          /* Pointer to expression buffer */
+    extern ASMSTATE  pc_t    Pc;             /* Instruction pointer */
+    extern ASMSTATE  LABTAB  **Labtab;        /* Label data */
+    extern ASMSTATE  char    Local_char;     /* First char for local labels */
 
     int     i;
     int     base;
@@ -884,7 +1095,7 @@ nextval(void)
     expr_t              tokval;
     ptok_t              token;
     tok_t               ttype;
-    extern      char    *Expr;          /* Pointer to expression buffer */
+    extern ASMSTATE      char    *Expr;          /* Pointer to expression buffer */
 
     /* Ignore spaces */
     while((token  = gettok(&tokval)) == SPACE) /* void */;
@@ -1006,34 +1217,32 @@ char    *pn)    /* part number */
 {
 
     char    tab_filename[LINESIZE];
+    char    cache_filename[LINESIZE];
+    struct stat tab_stat;
+    int     have_stat;
     char    *tabpath;
     char    buf[LINESIZE];
     FILE    *fp_tab;
     char    errbuf[LINESIZE];
     char    *s;
     char    *p;
-    int     i;
     int     nextc;
 
-    extern  char    Banner[];
-    extern  ushort  Num_instr;
-    extern  ushort  Num_reg;
-    extern  ushort  Ihash[];
-    extern  int     Ols_first;
-    extern  char    Wild_char;
-    extern  int     Wordsize;
-    extern  int     No_arg_shift;
+    extern ASMSTATE  char    Banner[];
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  ushort  Num_reg;
+    extern ASMSTATE  int     Ols_first;
+    extern ASMSTATE  char    Wild_char;
+    extern ASMSTATE  int     Wordsize;
+    extern ASMSTATE  int     No_arg_shift;
+
+    /* Discard any table that was read before */
+    free_table();
 
     Num_instr = 0;
     Num_reg   = 0;
     Last_inst[0] = '\0';
 
-    /* Initialize the hash table.  Set each element to a large
-     *    value which will be reduced as the instruction table
-     *    is read in. 
-     */
-    for(i = 0; i < MAXIHASH; i++)Ihash[i] = MAXINSTR;
-
     tabpath = getenv("TASMTABS");
     if(tabpath == NULL)
     {
@@ -1044,6 +1253,12 @@ char    *pn)    /* part number */
         sprintf(tab_filename,"%s/tasm%s.tab",tabpath,pn);
     }
 
+    /* Use the precompiled image of this table if it's up to date */
+    sprintf(cache_filename,"%.*s.tbc",(int)strlen(tab_filename)-4,tab_filename);
+    have_stat = (stat(tab_filename, &tab_stat) == 0);
+    build_dep(tab_filename, NULL);
+    if(have_stat && load_table_cache(cache_filename, &tab_stat)) return;
+
     fp_tab = fopen( tab_filename, "r");
     if(fp_tab == NULL)
     {
@@ -1087,14 +1302,390 @@ char    *pn)    /* part number */
         }
     }
 
-    /* set all unused elements in the hash table to point to
-     *  the beginning of the Optab. */
-    for(i = 0; i < MAXIHASH; i++)
-        if(Ihash[i] > Num_instr)Ihash[i] = 0; 
-    
     /* Close the Table file */
     fclose(fp_tab);
 
+    /* and save the parsed table for next time */
+    if(have_stat)
+    {
+        if(Share_tables) pthread_mutex_lock(&Table_lock);
+        save_table_cache(cache_filename, &tab_stat);
+        if(Share_tables) pthread_mutex_unlock(&Table_lock);
+    }
+
+}
+
+/* Function: tbc_hash()
+ * Description:
+ *     Accumulate part of a table cache image into the running FNV-1a
+ *     hash in Tbc_hash.
+ */
+static void
+tbc_hash(const void *data, size_t size)
+{
+    const ubyte *p = (const ubyte *)data;
+
+    while(size--){
+        Tbc_hash ^= *p++;
+        Tbc_hash *= 16777619UL;
+    }
+    Tbc_hash &= 0xffffffffUL;
+}
+
+/* Function: load_table_cache()
+ * Description:
+ *     Load a precompiled instruction table image, if one exists and
+ *     matches the .tab file.  Returns TRUE if the table was loaded.
+ *     In a batch the image is shared with the other assemblies.
+ */
+static int
+load_table_cache(
+char    *cache_filename,        /* name of the .tbc file          */
+struct stat *tab_stat)          /* status of the .tab file        */
+{
+    SHTABLE     *st;
+    TBCHEADER   *hdr;
+    char        *image;
+
+    if(Debug) return(FALSE);    /* always parse when debugging the table */
+
+    if(!Share_tables)
+    {
+        if((image = read_table_cache(cache_filename, tab_stat, FALSE)) == NULL)
+            return(FALSE);
+        install_table_cache(image);
+        return(TRUE);
+    }
+
+    pthread_mutex_lock(&Table_lock);
+    for(st = Shared_tables; st != NULL; st = st->next)
+    {
+        hdr = (TBCHEADER *)st->image;
+        if(   (strcmp(st->name, cache_filename) == SAME)
+           && (hdr->tab_mtime == (ulong)tab_stat->st_mtime)
+           && (hdr->tab_size  == (ulong)tab_stat->st_size)) break;
+    }
+
+    if((st == NULL) &&
+       ((image = read_table_cache(cache_filename, tab_stat, TRUE)) != NULL))
+    {
+        if((st = (SHTABLE *)malloc(sizeof(SHTABLE))) == NULL)
+        {
+            free(image);
+        }
+        else
+        {
+            st->image = image;
+            strcpy(st->name, cache_filename);
+            st->next  = Shared_tables;
+            Shared_tables = st;
+        }
+    }
+
+    if(st != NULL) install_table_cache(st->image);
+    pthread_mutex_unlock(&Table_lock);
+
+    return(st != NULL);
+}
+
+/* Function: read_table_cache()
+ * Description:
+ *     Read and relocate a precompiled instruction table image.  Returns
+ *     NULL if there isn't a good one for this .tab file.  A shared image
+ *     is malloc'd, otherwise it goes in the table arena.
+ */
+static char *
+read_table_cache(
+char    *cache_filename,        /* name of the .tbc file          */
+struct stat *tab_stat,          /* status of the .tab file        */
+int     shared)                 /* TRUE for an image to share     */
+{
+    FILE        *fp;
+    struct stat cache_stat;
+    TBCHEADER   *hdr;
+    OPTAB       *op;
+    REGTAB      *rp;
+    char        *strpool;
+    char        *image;
+    size_t      size;
+    int         i;
+
+    if(stat(cache_filename, &cache_stat) != 0) return(NULL);
+    size = (size_t)cache_stat.st_size;
+    if(size < sizeof(TBCHEADER)) return(NULL);
+
+    /* The table is empty (see read_table()), so if the image is no good
+     * the arena can just be reset.
+     */
+    if((fp = fopen(cache_filename, "rb")) == NULL) return(NULL);
+    if(shared) image = (char *)malloc(size);
+    else       image = (char *)arena_alloc(AR_TABLE, size);
+    if((image == NULL) || (fread(image, 1, size, fp) != size)){
+        fclose(fp);
+        return(tbc_discard(image, shared));
+    }
+    fclose(fp);
+
+    /* Make sure the image is one we wrote, and for this .tab file */
+    hdr = (TBCHEADER *)image;
+    if(   (memcmp(hdr->magic, TBC_MAGIC, sizeof(hdr->magic)) != SAME)
+       || (hdr->version     != TBC_VERSION)
+       || (hdr->tab_mtime   != (ulong)tab_stat->st_mtime)
+       || (hdr->tab_size    != (ulong)tab_stat->st_size)
+       || (hdr->optab_size  != sizeof(OPTAB))
+       || (hdr->regtab_size != sizeof(REGTAB))
+       || (hdr->num_instr   >  MAXINSTR)
+       || (hdr->num_reg     >  MAXREG)
+       || (size != sizeof(TBCHEADER) + hdr->num_instr*sizeof(OPTAB)
+                 + hdr->num_reg*sizeof(REGTAB) + hdr->strpool_size)
+       || (hdr->strpool_size == 0)
+       || (Tbc_hash = 2166136261UL,
+           tbc_hash(image + sizeof(TBCHEADER), size - sizeof(TBCHEADER)),
+           Tbc_hash != hdr->checksum)
+       || (image[size-1] != '\0')
+       || (hdr->banner >= hdr->strpool_size)){
+        return(tbc_discard(image, shared));
+    }
+
+    op      = (OPTAB  *)(image + sizeof(TBCHEADER));
+    rp      = (REGTAB *)(op + hdr->num_instr);
+    strpool = (char   *)(rp + hdr->num_reg);
+
+    /* Relocate the string offsets */
+    for(i = 0; i < hdr->num_instr; i++){
+        if(   ((ulong)(size_t)op[i].instruction >= hdr->strpool_size)
+           || ((ulong)(size_t)op[i].args        >= hdr->strpool_size)){
+            return(tbc_discard(image, shared));
+        }
+        op[i].instruction = strpool + (size_t)op[i].instruction;
+        op[i].args        = strpool + (size_t)op[i].args;
+    }
+    for(i = 0; i < hdr->num_reg; i++){
+        if((ulong)(size_t)rp[i].reg >= hdr->strpool_size){
+            return(tbc_discard(image, shared));
+        }
+        rp[i].reg = strpool + (size_t)rp[i].reg;
+    }
+
+    DEBUG2("read_table: loaded %d instructions from %s\n",
+           hdr->num_instr, cache_filename);
+    return(image);
+}
+
+/* Function: tbc_discard()
+ * Description:
+ *     Throw away a table image that turned out to be no good.  Returns
+ *     NULL.
+ */
+static char *
+tbc_discard(
+char    *image,
+int     shared)
+{
+    if(shared) free(image);
+    else       arena_reset(AR_TABLE);
+    return(NULL);
+}
+
+/* Function: install_table_cache()
+ * Description:
+ *     Make a (relocated) table image the current instruction table.
+ */
+static void
+install_table_cache(
+char    *image)
+{
+    extern ASMSTATE  char    Banner[];
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  ushort  Num_reg;
+    extern ASMSTATE  OPTAB   *Optab[];
+    extern ASMSTATE  REGTAB  *Regtab[];
+    extern ASMSTATE  int     Ols_first;
+    extern ASMSTATE  char    Wild_char;
+    extern ASMSTATE  int     Wordsize;
+    extern ASMSTATE  int     No_arg_shift;
+
+    TBCHEADER   *hdr;
+    OPTAB       *op;
+    REGTAB      *rp;
+    char        *strpool;
+    int         i;
+
+    hdr     = (TBCHEADER *)image;
+    op      = (OPTAB  *)(image + sizeof(TBCHEADER));
+    rp      = (REGTAB *)(op + hdr->num_instr);
+    strpool = (char   *)(rp + hdr->num_reg);
+
+    for(i = 0; i < hdr->num_instr; i++) Optab[i]  = &op[i];
+    for(i = 0; i < hdr->num_reg;   i++) Regtab[i] = &rp[i];
+
+    strcpy(Banner, strpool + hdr->banner);
+    Ols_first    = hdr->ols_first;
+    Wordsize     = hdr->wordsize;
+    No_arg_shift = hdr->no_arg_shift;
+    Wild_char    = hdr->wild_char;
+    Num_instr    = hdr->num_instr;
+    Num_reg      = hdr->num_reg;
+    if(Num_instr > 0) strcpy(Last_inst, Optab[Num_instr-1]->instruction);
+}
+
+/* Function: table_share()
+ * Description:
+ *     Turn sharing of instruction tables (for a batch) on or off.
+ *     Turning it off frees the shared tables, so it must only be done
+ *     once no assembly is using them.
+ */
+void
+table_share(
+int     enable)
+{
+    SHTABLE     *st;
+
+    pthread_mutex_lock(&Table_lock);
+    Share_tables = enable;
+    if(!enable)
+    {
+        while((st = Shared_tables) != NULL)
+        {
+            Shared_tables = st->next;
+            free(st->image);
+            free(st);
+        }
+    }
+    pthread_mutex_unlock(&Table_lock);
+}
+
+/* Function: tbc_string()
+ * Description:
+ *     Write one string, with its terminating null, to the table cache
+ *     string pool.  Returns FALSE if the write fails.
+ */
+static int
+tbc_string(char *s, FILE *fp)
+{
+    size_t  len = strlen(s) + 1;
+
+    tbc_hash(s, len);
+    return(fwrite(s, 1, len, fp) == len);
+}
+
+/* Function: save_table_cache()
+ * Description:
+ *     Write the instruction table just parsed out as a precompiled image.
+ *     This is purely an optimization, so any failure (e.g. a read only
+ *     table directory) is silently ignored.
+ */
+static void
+save_table_cache(
+char    *cache_filename,        /* name of the .tbc file          */
+struct stat *tab_stat)          /* status of the .tab file        */
+{
+    extern ASMSTATE  char    Banner[];
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  ushort  Num_reg;
+    extern ASMSTATE  OPTAB   *Optab[];
+    extern ASMSTATE  REGTAB  *Regtab[];
+    extern ASMSTATE  int     Ols_first;
+    extern ASMSTATE  char    Wild_char;
+    extern ASMSTATE  int     Wordsize;
+    extern ASMSTATE  int     No_arg_shift;
+
+    char        temp_filename[LINESIZE+16];
+    FILE        *fp;
+    TBCHEADER   hdr;
+    OPTAB       op;
+    REGTAB      rp;
+    ulong       offset;
+    int         i;
+    int         ok;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TBC_MAGIC, sizeof(hdr.magic));
+    hdr.version      = TBC_VERSION;
+    hdr.tab_mtime    = (ulong)tab_stat->st_mtime;
+    hdr.tab_size     = (ulong)tab_stat->st_size;
+    hdr.optab_size   = sizeof(OPTAB);
+    hdr.regtab_size  = sizeof(REGTAB);
+    hdr.num_instr    = Num_instr;
+    hdr.num_reg      = Num_reg;
+    hdr.ols_first    = Ols_first;
+    hdr.wordsize     = Wordsize;
+    hdr.no_arg_shift = No_arg_shift;
+    hdr.wild_char    = Wild_char;
+
+    /* The string pool is laid out in the order the strings are written
+     * below; compute its size (and the Banner's offset) first.
+     */
+    offset = 0;
+    for(i = 0; i < Num_instr; i++)
+        offset += strlen(Optab[i]->instruction) + strlen(Optab[i]->args) + 2;
+    for(i = 0; i < Num_reg; i++)
+        offset += strlen(Regtab[i]->reg) + 1;
+    hdr.banner       = offset;
+    hdr.strpool_size = offset + strlen(Banner) + 1;
+
+    /* Write to a temporary file and rename it so that a concurrent TASM
+     * never sees a partially written image.
+     */
+    sprintf(temp_filename, "%s.%ld", cache_filename, (long)getpid());
+    if((fp = fopen(temp_filename, "wb")) == NULL) return;
+    ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);   /* checksum comes later */
+    Tbc_hash = 2166136261UL;
+
+    offset = 0;
+    for(i = 0; ok && (i < Num_instr); i++){
+        op = *Optab[i];
+        op.instruction = (char *)(size_t)offset;
+        offset += strlen(Optab[i]->instruction) + 1;
+        op.args        = (char *)(size_t)offset;
+        offset += strlen(Optab[i]->args) + 1;
+        tbc_hash(&op, sizeof(op));
+        ok = (fwrite(&op, sizeof(op), 1, fp) == 1);
+    }
+    for(i = 0; ok && (i < Num_reg); i++){
+        rp = *Regtab[i];
+        rp.reg = (char *)(size_t)offset;
+        offset += strlen(Regtab[i]->reg) + 1;
+        tbc_hash(&rp, sizeof(rp));
+        ok = (fwrite(&rp, sizeof(rp), 1, fp) == 1);
+    }
+
+    for(i = 0; ok && (i < Num_instr); i++){
+        ok =    tbc_string(Optab[i]->instruction, fp)
+             && tbc_string(Optab[i]->args, fp);
+    }
+    for(i = 0; ok && (i < Num_reg); i++)
+        ok = tbc_string(Regtab[i]->reg, fp);
+    if(ok) ok = tbc_string(Banner, fp);
+
+    /* Now go back and fill in the checksum */
+    hdr.checksum = Tbc_hash;
+    if(ok) ok =    (fseek(fp, 0L, SEEK_SET) == 0)
+                && (fwrite(&hdr, sizeof(hdr), 1, fp) == 1);
+
+    if((fclose(fp) != 0) || !ok || (rename(temp_filename, cache_filename) != 0))
+        remove(temp_filename);
+}
+
+/* Function: free_table()
+ * Description:
+ *     Free the instruction set definition tables.
+ */
+void
+free_table(void)
+{
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  ushort  Num_reg;
+    extern ASMSTATE  OPTAB   *Optab[];
+    extern ASMSTATE  REGTAB  *Regtab[];
+
+    /* Everything in the tables (including a loaded cache image) lives
+     * in the table arena.
+     */
+    inst_index_free();
+    arena_reset(AR_TABLE);
+    Num_instr = 0;
+    Num_reg   = 0;
 }
 
 /* Function: add_instruction()
@@ -1104,14 +1695,12 @@ char    *pn)    /* part number */
 void
 add_instruction(char *s)
 {
-    extern  ushort  Num_instr;
-    extern  ushort  Ihash[];
-    extern  OPTAB   *Optab[];
+    extern ASMSTATE  ushort  Num_instr;
+    extern ASMSTATE  OPTAB   *Optab[];
 
     ushort  cfirst;
     ubyte   obytes;
     char    *ss;
-    int     i;
     char    buf[LINESIZE];
     OPTAB   *op;
 
@@ -1125,28 +1714,19 @@ add_instruction(char *s)
     if((*s < 'A') || (*s > 'Z'))return;
 
     if(*s != '\0'){
-        /* Update the hash table.  
-         * The hash table has an entry for each letter A-Z
-         *  indicating the point in the Optab to start 
-         *  looking for a match (a simple algorithm, but
-         *  it significantly speeds things up).   
+        /* The mnemonic index used by inst_lookup() is rebuilt the next
+         * time it is needed.
          */
-        i = HASHKEY(s);
-        Ihash[i] = min(Ihash[i],Num_instr);
+        inst_index_free();
 
-        /* Malloc memory for the Optab element */
-        op = (OPTAB *)malloc(sizeof(OPTAB));
-        if(op == NULL)
-        {
-            errprt("tasm: Cannot malloc for optab storage\n");
-            tasmexit(EXIT_MALLOC);
-        }
+        /* Allocate the Optab element */
+        op = (OPTAB *)arena_alloc(AR_TABLE, sizeof(OPTAB));
         Optab[Num_instr] = op;
 
         /* Process instruction string.
-         * Malloc memory for it and copy to that memory.
+         * Allocate memory for it and copy to that memory.
          */
-        op->instruction = save_string(s, STR_SPACEEND);
+        op->instruction = save_string(s, STR_SPACEEND, AR_TABLE);
 
         if(strcmp(op->instruction, Last_inst) == SAME)
             op->same_inst = TRUE;
@@ -1162,11 +1742,11 @@ add_instruction(char *s)
         while(isspace(*s))s++;
         /* if the args are just double quotes then no arg is needed */
         if(*s == '"'){
-            op->args = save_string("", STR_SPACEEND);
+            op->args = save_string("", STR_SPACEEND, AR_TABLE);
             s += 2;             /* skip past the double quotes */
         }
         else{
-            op->args = save_string(s, STR_SPACEEND);
+            op->args = save_string(s, STR_SPACEEND, AR_TABLE);
             while(!isspace(*s)) s++;
         }
 
@@ -1254,8 +1834,8 @@ add_instruction(char *s)
 static void
 add_reg(char *s)
 {
-    extern  ushort   Num_reg;
-    extern  REGTAB  *Regtab[];
+    extern ASMSTATE  ushort   Num_reg;
+    extern ASMSTATE  REGTAB  *Regtab[];
 
     char    buf[LINESIZE];
     REGTAB  *op;
@@ -1270,18 +1850,14 @@ add_reg(char *s)
 
     if(*s != '\0'){
 
-        /* Malloc memory for the Regtab element */
-        op = (REGTAB *)malloc(sizeof(REGTAB));
-        if(op == NULL){
-            errprt("tasm: Cannot malloc for regtab storage\n");
-            tasmexit(EXIT_MALLOC);
-        }
+        /* Allocate the Regtab element */
+        op = (REGTAB *)arena_alloc(AR_TABLE, sizeof(REGTAB));
         Regtab[Num_reg] = op;
 
         /* Process instruction string.
-         * Malloc memory for it and copy to that memory.
+         * Allocate memory for it and copy to that memory.
          */
-        op->reg = save_string(s, STR_SPACEEND);
+        op->reg = save_string(s, STR_SPACEEND, AR_TABLE);
 
         /* skip to end of instruction */
         while((*s != ' ') && (*s != '\t')) s++;
@@ -1311,13 +1887,14 @@ add_reg(char *s)
 
 /* Function: save_string()
  * Description:
- *     Save a string in the heap (malloc).
+ *     Save a string in one of the memory arenas.
  */
 
 static char *
 save_string(
 char    *s,                     /* string to save */
-strend_t strtype)               /* type of string (to determine length) */
+strend_t strtype,               /* type of string (to determine length) */
+arena_t region)                 /* where to save it */
 {
         int     i;
         char    buf[LINESIZE];
@@ -1339,13 +1916,9 @@ strend_t strtype)               /* type of string (to determine length) */
 
         }
         buf[i++] = '\0';
-        /* if we were asked to save an empty string, then avoid the malloc */
+        /* if we were asked to save an empty string, then avoid the copy */
         if(i == 1) return(Emptystring);
-        p = (char *)malloc(i);
-        if(p == NULL){
-            errprt("Cannot malloc for string storage.\n");
-            tasmexit(EXIT_MALLOC);
-        }
+        p = (char *)arena_alloc(region, i);
         strcpy(p,buf);
         return(p);
 }
@@ -0,0 +1,253 @@
+/****************************************************************************
+ *  File: memimage.c
+ *
+ *  Description:
+ *    Sparse memory image for TASM, the table driven assembler.
+ *
+ *    The object code is kept in MEMPAGE byte pages that are allocated
+ *    the first time something is written to them, so a program with a
+ *    few bytes at the bottom of a 32 bit address space and a few at the
+ *    top only costs a couple of pages.  The pages are found through a
+ *    two level page table, and each one has a bitmap of the bytes that
+ *    have actually been written so wrtobj() can skip over the gaps.
+ *    Bytes that were never written read as the fill byte (-f).
+ *
+ *    The pages and second level tables live in the AR_MODULE arena.
+ *
+ */
+
+/* INCLUDES */
+#include "tasm.h"
+
+#ifdef T_MEMCHECK
+#include <memcheck.h>
+#endif
+
+
+#define MEMPAGE_BITS    12                      /* 4K pages                */
+#define MEMPAGE         (1L << MEMPAGE_BITS)
+#define MEMTAB_BITS     8                       /* Pages per 2nd level tab */
+#define MEMTAB          (1 << MEMTAB_BITS)
+#define MEMDIR          (1L << (32 - MEMPAGE_BITS - MEMTAB_BITS))
+
+#define WBITS           (8 * sizeof(ulong))     /* Bits per bitmap word    */
+#define ALLONES         (~(ulong)0)
+
+/* A page of the image */
+typedef struct{
+        ulong   written[MEMPAGE / WBITS];       /* 1 bit per byte written  */
+        ubyte   data[MEMPAGE];
+}MEMPG;
+
+/* Static */
+static ASMSTATE MEMPG    **Memdir[MEMDIR];       /* Top level of the page table  */
+static ASMSTATE MEMPG    *Last_page  = NULL;     /* Last page put to, and ...    */
+static ASMSTATE pc_t     Last_base   = 0;        /* ... its address              */
+static ASMSTATE ubyte    Mem_fillbyte = 0;       /* Value of unwritten bytes     */
+
+
+/******************************************************************/
+/* Function: mem_page()
+ * Description:
+ *     Return the page that holds pc, or NULL if it hasn't been
+ *     allocated (and create is FALSE).
+ */
+static MEMPG *
+mem_page(
+pc_t    pc,
+int     create)
+{
+        MEMPG   **tab;
+        MEMPG   *pg;
+        int     i;
+
+        tab = Memdir[pc >> (MEMPAGE_BITS + MEMTAB_BITS)];
+        if(tab == NULL)
+        {
+            if(!create) return(NULL);
+            tab = (MEMPG **)arena_alloc(AR_MODULE, MEMTAB * sizeof(MEMPG *));
+            for(i = 0; i < MEMTAB; i++) tab[i] = NULL;
+            Memdir[pc >> (MEMPAGE_BITS + MEMTAB_BITS)] = tab;
+        }
+
+        pg = tab[(pc >> MEMPAGE_BITS) & (MEMTAB - 1)];
+        if((pg == NULL) && create)
+        {
+            pg = (MEMPG *)arena_alloc(AR_MODULE, sizeof(MEMPG));
+            memset(pg->written, 0, sizeof(pg->written));
+            memset(pg->data, Mem_fillbyte, sizeof(pg->data));
+            tab[(pc >> MEMPAGE_BITS) & (MEMTAB - 1)] = pg;
+        }
+        return(pg);
+}
+
+/******************************************************************/
+/* Function: mem_put()
+ * Description:
+ *     Write a byte to the memory image.
+ */
+void
+mem_put(
+pc_t    pc,
+ubyte   op)
+{
+        pc_t    base;
+        ulong   i;
+
+        pc  &= MAXMEM;
+        base = pc & ~(pc_t)(MEMPAGE - 1);
+        if((Last_page == NULL) || (base != Last_base))
+        {
+            Last_page = mem_page(pc, TRUE);
+            Last_base = base;
+        }
+
+        i = pc & (MEMPAGE - 1);
+        Last_page->data[i] = op;
+        Last_page->written[i / WBITS] |= (ulong)1 << (i % WBITS);
+}
+
+/******************************************************************/
+/* Function: mem_get()
+ * Description:
+ *     Fetch a byte from the memory image.
+ */
+ubyte
+mem_get(
+pc_t    pc)
+{
+        MEMPG   *pg;
+
+        pc &= MAXMEM;
+        if((pg = mem_page(pc, FALSE)) == NULL) return(Mem_fillbyte);
+        return(pg->data[pc & (MEMPAGE - 1)]);
+}
+
+/******************************************************************/
+/* Function: mem_read()
+ * Description:
+ *     Copy n bytes starting at pc from the memory image.
+ */
+void
+mem_read(
+pc_t    pc,
+ubyte   *buf,
+size_t  n)
+{
+        MEMPG   *pg;
+        size_t  chunk;
+        ulong   i;
+
+        while(n > 0)
+        {
+            pc   &= MAXMEM;
+            i     = pc & (MEMPAGE - 1);
+            chunk = MEMPAGE - i;
+            if(chunk > n) chunk = n;
+
+            if((pg = mem_page(pc, FALSE)) == NULL) memset(buf, Mem_fillbyte, chunk);
+            else                                   memcpy(buf, &pg->data[i], chunk);
+
+            buf += chunk;
+            pc  += chunk;
+            n   -= chunk;
+        }
+}
+
+/******************************************************************/
+/* Function: mem_fill()
+ * Description:
+ *     Set the value read back from bytes that were never written.
+ *     Must be called before anything is put in the image.
+ */
+void
+mem_fill(
+ubyte   fillbyte)
+{
+        Mem_fillbyte = fillbyte;
+}
+
+/******************************************************************/
+/* Function: mem_find()
+ * Description:
+ *     Return the first address from pc up to (but not including) limit
+ *     that has (or, if written is FALSE, hasn't) been written, or limit
+ *     if there isn't one.
+ */
+static pc_t
+mem_find(
+pc_t    pc,
+pc_t    limit,
+int     written)
+{
+        MEMPG   *pg;
+        ulong   i;
+        ulong   w;
+
+        while(pc < limit)
+        {
+            if((pg = mem_page(pc, FALSE)) == NULL)
+            {
+                /* A missing page is all unwritten */
+                if(!written) return(pc);
+                pc = (pc | (MEMPAGE - 1)) + 1;
+                continue;
+            }
+
+            for(i = pc & (MEMPAGE - 1); (i < MEMPAGE) && (pc < limit); i++, pc++)
+            {
+                /* Skip whole bitmap words where possible */
+                w = pg->written[i / WBITS];
+                if((i % WBITS == 0) && (w == (written ? 0 : ALLONES)))
+                {
+                    i  += WBITS - 1;
+                    pc += WBITS - 1;
+                    continue;
+                }
+                if(((w >> (i % WBITS)) & 1) == (written ? 1 : 0))
+                    return(pc);
+            }
+        }
+        return(limit);
+}
+
+/******************************************************************/
+/* Function: mem_run()
+ * Description:
+ *     Find the next run of written bytes in the image that starts at
+ *     or after *first and before limit.  *first and *last are set to
+ *     its first byte and one past its last.  Returns FALSE (and sets
+ *     neither) if there aren't any.
+ */
+int
+mem_run(
+pc_t    *first,
+pc_t    *last,
+pc_t    limit)
+{
+        pc_t    pc;
+
+        if((pc = mem_find(*first, limit, TRUE)) >= limit) return(FALSE);
+        *first = pc;
+        *last  = mem_find(pc, limit, FALSE);
+        return(TRUE);
+}
+
+/******************************************************************/
+/* Function: mem_free()
+ * Description:
+ *     Empty the image (the pages themselves go with the AR_MODULE
+ *     arena).
+ */
+void
+mem_free(void)
+{
+        long    i;
+
+        for(i = 0; i < MEMDIR; i++) Memdir[i] = NULL;
+        Last_page    = NULL;
+        Last_base    = 0;
+        Mem_fillbyte = 0;
+}
+
+/* That's all folks. */
@@ -26,12 +26,16 @@
 
 
 /* Externals */
-extern  ushort          Debug;
-extern  pc_t            Pc;
-extern  char            Local_char;
+extern ASMSTATE  ushort          Debug;
+extern ASMSTATE  pc_t            Pc;
+extern ASMSTATE  char            Local_char;
 
 /* Static */
 static ushort argvect( char *args, char *argv[], ushort  *argc);
+static void   parse_eval( ulong *op_code, ushort *obytes,
+                          ushort *abytes, ushort modop, ubyte shift,
+                          ulong bor, ushort argc, char **argv,
+                          ulong *argval);
 
 /**********************************************************************/
 
@@ -58,17 +62,17 @@ ushort  *obytes,        /* number of bytes of opcode                    */
 ushort  *abytes,        /* number of bytes of argument                  */
 ushort  *argc,          /* number of arguments found                    */
 char    **argv,         /* pointers to argument strings                 */
-ulong   *argval)        /* value of args (adjusted if necessary for this
+ulong   *argval,        /* value of args (adjusted if necessary for this
                            particular instruction)       */
+PARSED  *result)        /* if not NULL, the instruction table match for
+                           parse_cached() (nchar is 0 if there isn't one) */
 {
 
-    extern  error_t Errorno;        /* global error number */
-    extern  char    Errorbuf[LINESIZE];
-    extern  char    Comment_char1;  /* First column comment char */
-    extern  char    Comment_char2;  /* Embedded comment char     */
-    extern  line_t  Linetype;
-    extern  int     No_arg_shift;   /* Disable shift/or to args  */
-    extern  int     Use_argvalv;    
+    extern ASMSTATE  error_t Errorno;        /* global error number */
+    extern ASMSTATE  char    Errorbuf[LINESIZE];
+    extern ASMSTATE  char    Comment_char1;  /* First column comment char */
+    extern ASMSTATE  char    Comment_char2;  /* Embedded comment char     */
+    extern ASMSTATE  line_t  Linetype;
 
     int     i,j;
     ushort  modop;
@@ -78,7 +82,7 @@ ulong   *argval)        /* value of args (adjusted if necessary for this
     int     withinquotes1;      /* inside single quotes */
     int     withinquotes2;      /* inside double quotes */
 
-    static  char    args[LINESIZE];
+    static  ASMSTATE char    args[LINESIZE];
 
     /* initialize */
     *label          = '\0';
@@ -91,6 +95,7 @@ ulong   *argval)        /* value of args (adjusted if necessary for this
     Errorno         = ER_NOERR;
     args[0]         = '\0';
     Errorbuf[0]     = '\0';
+    if(result != NULL) result->nchar = 0;
 
     i     = 0;          /* buf character counter */
 
@@ -283,6 +288,102 @@ ulong   *argval)        /* value of args (adjusted if necessary for this
             Errorno = inst_lookup(inst,args,op_code,obytes,
                 abytes,&modop,&shift,&bor,argc,argv);
 
+            /* Hand back what was matched (before rules() modifies it) */
+            if((result != NULL) && (Errorno == ER_NOERR)){
+                result->nchar   = i;
+                result->op_code = *op_code;
+                result->obytes  = *obytes;
+                result->abytes  = *abytes;
+                result->modop   = modop;
+                result->shift   = shift;
+                result->bor     = bor;
+                result->argc    = *argc;
+                result->argv    = argv;
+                result->label   = label;
+            }
+
+            parse_eval(op_code, obytes, abytes, modop, shift, bor,
+                       *argc, argv, argval);
+        }
+    }
+    DEBUG3("%04lx %04lx %s",*op_code, *argval, buf);
+    return(i);
+
+}
+
+/* Function     : parse_cached
+ * Description  : Finish parsing an instruction statement that was
+ *                parsed before (on pass 1) and saved.  The label,
+ *                instruction table match and argument strings are
+ *                taken from the PARSED record, so only the argument
+ *                expressions are evaluated and the rule applied.
+ *                Returns the number of characters parse() consumed.
+ */
+
+int
+parse_cached(
+PARSED  *pp,            /* statement parsed earlier       */
+char    *buf,           /* the statement itself           */
+char    *label,         /* Outputs: as for parse()        */
+ulong   *op_code,
+ushort  *obytes,
+ushort  *abytes,
+ushort  *argc,
+char    **argv,
+ulong   *argval)
+{
+
+    extern ASMSTATE  error_t Errorno;
+    extern ASMSTATE  char    Errorbuf[LINESIZE];
+    extern ASMSTATE  line_t  Linetype;
+
+    static  char    noarg[] = "";
+    ushort  j;
+
+    Linetype    = INSTRUCT;
+    Errorno     = ER_NOERR;
+    Errorbuf[0] = '\0';
+
+    if(pp->label != NULL) strcpy(label, pp->label);
+    else                  *label = '\0';
+
+    *op_code = pp->op_code;
+    *obytes  = pp->obytes;
+    *abytes  = pp->abytes;
+    *argc    = pp->argc;
+    argv[0]  = noarg;
+    for(j = 0; j < pp->argc; j++) argv[j] = pp->argv[j];
+
+    parse_eval(op_code, obytes, abytes, pp->modop, pp->shift, pp->bor,
+               *argc, argv, argval);
+
+    DEBUG3("%04lx %04lx %s",*op_code, *argval, buf);
+    return(pp->nchar);
+}
+
+/* Function     : parse_eval
+ * Description  : Evaluate the arguments of an instruction that has
+ *                been matched in the instruction table, and apply
+ *                the rule for it.
+ */
+
+static void
+parse_eval(
+ulong   *op_code,
+ushort  *obytes,
+ushort  *abytes,
+ushort  modop,
+ubyte   shift,
+ulong   bor,
+ushort  argc,
+char    **argv,
+ulong   *argval)
+{
+
+    extern ASMSTATE  error_t Errorno;
+    extern ASMSTATE  int     No_arg_shift;   /* Disable shift/or to args  */
+    extern ASMSTATE  int     Use_argvalv;    
+
             /* Handle special cases here.
              *  For 8048 fix up JMP and CALL instructions.
              *  For 6502 handle zero page addressing
@@ -296,30 +397,26 @@ ulong   *argval)        /* value of args (adjusted if necessary for this
              *
              */
 
-            *argval = 0;
+    *argval = 0;
 
-            if((*abytes > 0) && (argv[0])){
-                *argval = val(argv[0]);
-            }
+    if((*abytes > 0) && (argv[0])){
+        *argval = val(argv[0]);
+    }
 
-            /* Make sure this is false for every instruction so it is 
-             * not left with the value from the previous instruction if
-             * if this is a NOTOUCH rule.
-             */
-            Use_argvalv = FALSE;
+    /* Make sure this is false for every instruction so it is 
+     * not left with the value from the previous instruction if
+     * if this is a NOTOUCH rule.
+     */
+    Use_argvalv = FALSE;
 
-            if((Errorno == ER_NOERR) && (modop != NOTOUCH)){
-                rules(modop, op_code, obytes, abytes, argval, Pc,
-                    *argc, argv, shift, bor);
-            }
+    if((Errorno == ER_NOERR) && (modop != NOTOUCH)){
+        rules(modop, op_code, obytes, abytes, argval, Pc,
+            argc, argv, shift, bor);
+    }
 
-            if((No_arg_shift == FALSE) && (*abytes > 0) && (shift || bor)){
-                *argval = (*argval << shift) | bor;
-            }
-        }
+    if((No_arg_shift == FALSE) && (*abytes > 0) && (shift || bor)){
+        *argval = (*argval << shift) | bor;
     }
-    DEBUG3("%04lx %04lx %s",*op_code, *argval, buf);
-    return(i);
 
 }
 
@@ -333,9 +430,9 @@ char    *args,     /* String buffer for the arguments                      */
 char    *argv[],   /* Array of string pointers to each individual argument */
 ushort  *argc)     /* Pointer to the argument count                        */
 {
-    static char argbuf[LINESIZE];
-    static char strbuf[LINESIZE];
-    static char txtbuf[LINESIZE][4];
+    static ASMSTATE char argbuf[LINESIZE];
+    static ASMSTATE char strbuf[LINESIZE];
+    static ASMSTATE char txtbuf[LINESIZE][4];
 
     char        *p;
     int         withinquotes;
@@ -102,8 +102,8 @@ static void      isargrangevalid (long argval, long argmin, long argmax,
 
 
 /* EXTERNALS */
-extern  ushort  Debug;
-extern  char    Errorbuf[LINESIZE];
+extern ASMSTATE  ushort  Debug;
+extern ASMSTATE  char    Errorbuf[LINESIZE];
 
 /************************************************************************/
 /* FUNCTIONS */
@@ -145,8 +145,8 @@ rules(
     ushort  bit;
     long    idx;
 
-    extern  int   Use_argvalv;
-    extern  ubyte Argvalv[];
+    extern ASMSTATE  int   Use_argvalv;
+    extern ASMSTATE  ubyte Argvalv[];
 
     strcpy(Errorbuf,"");
     Use_argvalv = FALSE;
@@ -1247,7 +1247,7 @@ arp_val(char *parg)
 {
     ushort          argt;
     ushort          arg;
-    extern  char Part_num[];
+    extern ASMSTATE  char Part_num[];
 
     argt = (ushort)val(parg);
 
@@ -0,0 +1,458 @@
+/****************************************************************************
+ *  File: srccache.c
+ *
+ *  Description:
+ *    Source line cache for TASM, the table driven assembler.
+ *
+ *    Pass 1 keeps every line it reads, the line after macro expansion
+ *    and, for each instruction statement, what parse() matched in the
+ *    instruction table.  Pass 2 then replays the source from memory
+ *    instead of reading it again, and reuses the expansion and parse
+ *    results from pass 1 wherever they are still valid.  They are valid
+ *    when the same macros are defined (Macro_state) and the comment and
+ *    local label characters are the same as they were on pass 1.  Since
+ *    a file's contents don't depend on where it's included they are
+ *    looked up by file name.
+ *
+ *    The cache uses at most MAXSRCCACHE bytes.  If a source is bigger
+ *    than that, pass 2 just reads all the files again.  Everything but
+ *    the (growing) line arrays is kept in the AR_SOURCE arena.
+ *
+ */
+
+/* INCLUDES */
+#include "tasm.h"
+
+#ifdef T_MEMCHECK
+#include <memcheck.h>
+#endif
+
+
+/* One line of a cached source file */
+typedef struct{
+        char    *text;          /* Line as read from the file            */
+        char    *expanded;      /* After macro expansion (== text if the
+                                 * expansion didn't change anything,
+                                 * NULL if not expanded yet)             */
+        ulong   context;        /* src_context() when it was expanded    */
+        PARSED  *parsed;        /* Instruction statements on the line    */
+}SRCLINE;
+
+/* A cached source file */
+typedef struct _SRCFILE{
+        struct _SRCFILE *next;  /* Next file in the cache                */
+        char    *name;          /* File name as given to src_open()      */
+        int     nlines;         /* Number of lines read so far           */
+        int     size;           /* Allocated size of lines[]             */
+        int     complete;       /* TRUE once it has been read to EOF     */
+        SRCLINE *lines;
+}SRCFILE;
+
+/* A source file open for reading */
+struct _SRCREAD{
+        FILE    *fp;            /* File being read (NULL when replaying) */
+        SRCFILE *sf;            /* Cache entry being filled or replayed  */
+        SRCLINE *line;          /* Cache entry for the current line      */
+        int     next;           /* Next line to replay                   */
+        int     valid;          /* TRUE if the current line's cached
+                                 * statements can be used                */
+        char    buf[LINESIZE];  /* Line buffer when reading the file     */
+};
+
+/* Static */
+static ASMSTATE SRCFILE  *Srcfiles       = NULL;    /* All cached files          */
+static ASMSTATE long     Srccache_bytes  = 0;       /* Memory allocated so far   */
+static ASMSTATE int      Srccache_full   = FALSE;   /* MAXSRCCACHE was reached   */
+
+
+// [RLA] Convert "\r\n" in source file to just "\n" ...
+static void FixCRLF (char *pszLine)
+{
+  size_t cb = strlen(pszLine);
+  if ((cb >= 2) && (pszLine[cb-2] == '\r') && (pszLine[cb-1] == '\n')) {
+    pszLine[cb-2] = '\n';  pszLine[cb-1] = 0;
+  }
+}
+
+/******************************************************************/
+/* Function: src_room()
+ * Description:
+ *     Account for size more bytes of cache memory.  Returns FALSE (and
+ *     stops any further caching) once MAXSRCCACHE would be exceeded.
+ */
+static int
+src_room(size_t size)
+{
+        if(Srccache_full) return(FALSE);
+
+        if(Srccache_bytes + (long)size > MAXSRCCACHE)
+        {
+            Srccache_full = TRUE;
+            return(FALSE);
+        }
+        Srccache_bytes += size;
+        return(TRUE);
+}
+
+/******************************************************************/
+/* Function: src_alloc()
+ * Description:
+ *     Allocate memory for the cache.  Returns NULL if there is no room.
+ */
+static void *
+src_alloc(size_t size)
+{
+        if(!src_room(size)) return(NULL);
+
+        return(arena_alloc(AR_SOURCE, size));
+}
+
+/******************************************************************/
+/* Function: src_strsave()
+ * Description:
+ *     Save a copy of a string in the cache.
+ */
+static char *
+src_strsave(char *s)
+{
+        char    *p;
+
+        if((p = (char *)src_alloc(strlen(s)+1)) != NULL) strcpy(p, s);
+        return(p);
+}
+
+/******************************************************************/
+/* Function: src_context()
+ * Description:
+ *     Return a value that identifies everything, other than the text
+ *     itself, that affects how a line is expanded and parsed.
+ */
+static ulong
+src_context(void)
+{
+        extern ASMSTATE  ulong   Macro_state;
+        extern ASMSTATE  char    Comment_char1;
+        extern ASMSTATE  char    Comment_char2;
+        extern ASMSTATE  char    Local_char;
+
+        return((((Macro_state * 31) + (ubyte)Comment_char1) * 31 +
+                 (ubyte)Comment_char2) * 31 + (ubyte)Local_char);
+}
+
+/******************************************************************/
+/* Function: src_add_line()
+ * Description:
+ *     Add a line to the end of a cached file.  Returns NULL if there
+ *     is no room.
+ */
+static SRCLINE *
+src_add_line(SRCFILE *sf, char *text)
+{
+        SRCLINE *lines;
+        SRCLINE *line;
+        int     size;
+
+        if(sf->nlines >= sf->size)
+        {
+            size = (sf->size == 0) ? 256 : sf->size*2;
+            if(!src_room((size - sf->size) * sizeof(SRCLINE))) return(NULL);
+
+            lines = (SRCLINE *)realloc(sf->lines, size * sizeof(SRCLINE));
+            if(lines == NULL)
+            {
+                Srccache_full = TRUE;
+                return(NULL);
+            }
+            sf->lines = lines;
+            sf->size  = size;
+        }
+
+        line = &sf->lines[sf->nlines];
+        if((line->text = src_strsave(text)) == NULL) return(NULL);
+        line->expanded = NULL;
+        line->context  = 0;
+        line->parsed   = NULL;
+        sf->nlines++;
+
+        return(line);
+}
+
+/******************************************************************/
+/* Function: src_open()
+ * Description:
+ *     Open a source file for pass1() or pass2().  On pass 1 the file
+ *     is added to the cache as it is read (unless it's been read
+ *     completely before, in which case it is replayed).  On pass 2 it
+ *     is replayed if it is in the cache.  Returns NULL if the file
+ *     can't be opened.
+ */
+SRCREAD *
+src_open(
+char    *source_file)   /* File name */
+{
+        extern ASMSTATE  pass_t  Pass;
+
+        SRCREAD *src;
+        SRCFILE *sf;
+
+        /* If the cache overflowed on pass 1 it is no use on pass 2 */
+        if(Srccache_full && (Pass == SECOND)) src_free();
+
+        src = (SRCREAD *)malloc(sizeof(SRCREAD));
+        if(src == NULL)
+        {
+            errprt("tasm: Cannot malloc for source file\n");
+            tasmexit(EXIT_MALLOC);
+        }
+        src->fp    = NULL;
+        src->sf    = NULL;
+        src->line  = NULL;
+        src->next  = 0;
+        src->valid = FALSE;
+
+        for(sf = Srcfiles; sf != NULL; sf = sf->next)
+        {
+            if(strcmp(sf->name, source_file) == SAME) break;
+        }
+
+        if((sf != NULL) && (sf->complete))
+        {
+            /* Replay it */
+            src->sf = sf;
+            return(src);
+        }
+
+        if((src->fp = fopen(source_file, "r")) == NULL)
+        {
+            free(src);
+            return(NULL);
+        }
+
+        /* Cache it if this is pass 1 and it isn't already being read
+         * (which can only happen if a file includes itself).
+         */
+        if((sf == NULL) && (Pass == FIRST) &&
+           ((sf = (SRCFILE *)src_alloc(sizeof(SRCFILE))) != NULL))
+        {
+            if((sf->name = src_strsave(source_file)) == NULL) return(src);
+            sf->nlines   = 0;
+            sf->size     = 0;
+            sf->complete = FALSE;
+            sf->lines    = NULL;
+            sf->next     = Srcfiles;
+            Srcfiles     = sf;
+            src->sf      = sf;
+        }
+
+        return(src);
+}
+
+/******************************************************************/
+/* Function: src_gets()
+ * Description:
+ *     Return the next line of a source file (CR LF converted to LF),
+ *     or NULL at end of file.  The line stays valid until the next
+ *     call to src_gets() for this file.
+ */
+char *
+src_gets(
+SRCREAD *src)
+{
+        src->line  = NULL;
+        src->valid = FALSE;
+
+        if(src->fp == NULL)
+        {
+            if(src->next >= src->sf->nlines) return(NULL);
+            src->line = &src->sf->lines[src->next++];
+            return(src->line->text);
+        }
+
+        if(fgets(src->buf, LINESIZE-1, src->fp) == NULL)
+        {
+            /* The file is only usable if every line made it in */
+            if((src->sf != NULL) && !Srccache_full) src->sf->complete = TRUE;
+            return(NULL);
+        }
+
+        FixCRLF(src->buf);
+
+        if((src->sf != NULL) && !Srccache_full)
+            src->line = src_add_line(src->sf, src->buf);
+
+        return(src->buf);
+}
+
+/******************************************************************/
+/* Function: src_expand()
+ * Description:
+ *     Return the current line after macro expansion.  The expansion
+ *     from the cache is used if it's still valid, otherwise the line is
+ *     expanded into buf (and, on pass 1, saved).
+ */
+char *
+src_expand(
+SRCREAD *src,
+char    *buf)           /* LINESIZE buffer for the expanded line */
+{
+        extern ASMSTATE  pass_t  Pass;
+        extern ASMSTATE  int     Num_macros;
+
+        SRCLINE *line;
+        ulong   context;
+        char    *text;
+        char    *expanded;
+
+        line    = src->line;
+        context = src_context();
+        text    = (line != NULL) ? line->text : src->buf;
+
+        if((line != NULL) && (line->expanded != NULL) &&
+           (line->context == context))
+        {
+            src->valid = TRUE;
+            return(line->expanded);
+        }
+
+        if(Num_macros > 0)
+        {
+            macro_expand(text, buf);
+            expanded = buf;
+        }
+        else
+        {
+            expanded = text;
+        }
+
+        /* Keep it for pass 2.  Anything saved for the line before was
+         * for a different context, so it's of no further use (it stays
+         * in the arena until the cache is freed).
+         */
+        if((line != NULL) && (Pass == FIRST))
+        {
+            line->parsed = NULL;
+            if(strcmp(expanded, text) == SAME) line->expanded = line->text;
+            else                               line->expanded = src_strsave(expanded);
+            line->context = context;
+
+            src->valid = (line->expanded != NULL);
+        }
+
+        return(expanded);
+}
+
+/******************************************************************/
+/* Function: src_parsed()
+ * Description:
+ *     Return the statement saved on pass 1 that starts at offset in
+ *     the current (expanded) line, or NULL if there isn't one that can
+ *     be used.
+ */
+PARSED *
+src_parsed(
+SRCREAD *src,
+int     offset)
+{
+        extern ASMSTATE  ushort  Num_instr;
+
+        PARSED  *pp;
+
+        if(!src->valid) return(NULL);
+
+        for(pp = src->line->parsed; pp != NULL; pp = pp->next)
+        {
+            if(pp->offset == offset)
+            {
+                /* ADDINSTR may have changed the table since */
+                if(pp->num_instr != Num_instr) return(NULL);
+                return(pp);
+            }
+        }
+        return(NULL);
+}
+
+/******************************************************************/
+/* Function: src_save_parsed()
+ * Description:
+ *     Save (on pass 1) the instruction statement that parse() just
+ *     matched, starting at offset in the current line.
+ */
+void
+src_save_parsed(
+SRCREAD *src,
+int     offset,
+PARSED  *pp)            /* as returned by parse()   */
+{
+        extern ASMSTATE  pass_t  Pass;
+        extern ASMSTATE  ushort  Num_instr;
+
+        PARSED  *p;
+        size_t  size;
+        ushort  j;
+        char    *q;
+
+        if((!src->valid) || (Pass != FIRST)) return;
+
+        /* Already have it if this file was included before */
+        for(p = src->line->parsed; p != NULL; p = p->next)
+        {
+            if(p->offset == offset) return;
+        }
+
+        /* Keep the whole thing in one block */
+        size = sizeof(PARSED) + pp->argc * sizeof(char *);
+        if(pp->label[0] != '\0') size += strlen(pp->label) + 1;
+        for(j = 0; j < pp->argc; j++) size += strlen(pp->argv[j]) + 1;
+
+        if((p = (PARSED *)src_alloc(size)) == NULL) return;
+
+        *p = *pp;
+        p->offset    = offset;
+        p->num_instr = Num_instr;
+        p->argv      = (char **)(p + 1);
+
+        q = (char *)(p->argv + pp->argc);
+        for(j = 0; j < pp->argc; j++)
+        {
+            p->argv[j] = strcpy(q, pp->argv[j]);
+            q += strlen(q) + 1;
+        }
+        if(pp->label[0] != '\0') p->label = strcpy(q, pp->label);
+        else                     p->label = NULL;
+
+        p->next = src->line->parsed;
+        src->line->parsed = p;
+}
+
+/******************************************************************/
+/* Function: src_close()
+ * Description:
+ *     Done reading a source file.
+ */
+void
+src_close(
+SRCREAD *src)
+{
+        if(src->fp != NULL) fclose(src->fp);
+        free(src);
+}
+
+/******************************************************************/
+/* Function: src_free()
+ * Description:
+ *     Free the whole cache.
+ */
+void
+src_free(void)
+{
+        SRCFILE *sf;
+
+        for(sf = Srcfiles; sf != NULL; sf = sf->next) free(sf->lines);
+        Srcfiles = NULL;
+        arena_reset(AR_SOURCE);
+
+        Srccache_bytes = 0;
+        Srccache_full  = FALSE;
+}
+
+/* That's all folks. */
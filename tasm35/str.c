@@ -27,7 +27,7 @@
 
 
 /* EXTERNALS */
-extern  ushort  Debug;
+extern ASMSTATE  ushort  Debug;
 
 /******************************************************************/
 /* Function: search()
@@ -44,7 +44,7 @@ char    *s)             /* sub string to search for in  p */
     int     n;
     char    *ss;
     char    *pp;
-    extern  char        Comment_char2;  /* embedded comment char */
+    extern ASMSTATE  char        Comment_char2;  /* embedded comment char */
 
     n = 0;
     while((*p != '\0') && (*p != Comment_char2)){
@@ -203,7 +203,7 @@ remquotes(char *s)
     int     starts_with_quote = FALSE;
     char    t[LINESIZE];
 
-    extern char Errorbuf[LINESIZE];
+    extern ASMSTATE char Errorbuf[LINESIZE];
 
     i = 0;
     j = 0;
@@ -297,7 +297,7 @@ char    *psource)
     int     lastc;
     char    *save_psource;
 
-    extern char Errorbuf[LINESIZE];
+    extern ASMSTATE char Errorbuf[LINESIZE];
 
 /* updated to terminate following an '=' so it will properly copy over
  *  the '*=' part of an expression like '*=*+10' without requiring
@@ -406,69 +406,52 @@ hex_val(char hex_digit)
 
 /*
  * Function:     sort_labels
- * Description:  Sort the label table to facilitate faster access to 
- *               the label values on the second pass.
+ * Description:  Sort the label table by the first character of each
+ *               label.  This is the order the label table listing and
+ *               the symbol and export files have always been written in.
+ *               A counting sort is used; it's stable, so labels that
+ *               start with the same character stay in definition order
+ *               (exactly as the old shaker sort left them), and it's
+ *               linear in the number of labels.  Lookups go through the
+ *               hash index, which is rebuilt once the table is in order.
  */
 void
 sort_labels(void)
 {
     int         i;
-    int         j;
-    int         k;
-    int         bot;
-    int         top;
-    LABTAB      *tmp_p;
+    int         c;
+    int         count[256+1];
+    LABTAB      **sorted;
 
-    extern  ushort  Lhash[];
-    extern  ushort  Nlab;                  /* number of labels */
-    extern  LABTAB  *Labtab[];             /* label pointer table */
+    extern ASMSTATE  int     Nlab;                  /* number of labels */
+    extern ASMSTATE  LABTAB  **Labtab;              /* label pointer table */
 
     DEBUG("sort: sorting %d labels\n",Nlab);
 
-    /* Bubble sort (shaker sort) */
-    top = 0;
-    bot = Nlab - 2;
-    k   = bot;
-
-    do{
-        /* shake to the top */
-        for(i = bot; i >= top; i--){
-            if(*(GETLABTAB(i)->lab) > *(GETLABTAB(i+1)->lab)){
-                /* Swap */
-                tmp_p         = GETLABTAB(i);
-                GETLABTAB(i)  = GETLABTAB(i+1);
-                GETLABTAB(i+1)= tmp_p;
-                k = i;
-            }
-        }
-        top = k + 1;
-
-        /* shake to the bottom */
-        for(i = top; i <= bot; i++){
-            if(*(GETLABTAB(i)->lab) > *(GETLABTAB(i+1)->lab)){
-                /* Swap */
-                tmp_p         = GETLABTAB(i);
-                GETLABTAB(i)  = GETLABTAB(i+1);
-                GETLABTAB(i+1)   = tmp_p;
-                k = i;
-            }
+    if(Nlab > 1){
+        sorted = (LABTAB **)malloc(Nlab * sizeof(LABTAB *));
+        if(sorted == NULL){
+            errprt("tasm: Cannot malloc for label sort\n");
+            tasmexit(EXIT_MALLOC);
         }
-        bot = k - 1;
-        DEBUG5("n=%d top=%d bot=%d Lab0=%s Labn=%s\n",Nlab,top,bot,
-            (GETLABTAB(0)->lab),(GETLABTAB(Nlab-1)->lab));
-    }while(top < bot);
-
-    /* Now build the label index table. 
-     * Go backwards through the sorted table so the last assignment to
-     * a given index element will be the first for that character in
-     * in the table.
-     */
-    for(i = Nlab-1 ; i >=0 ; i--){
-        j = *(GETLABTAB(i)->lab) - 'A';
-        if((j >=0 ) && (j < MAXLHASH)) Lhash[j] = i;
 
+        /* Count the labels that start with each character, then turn
+         * the counts into the starting index for each character.
+         */
+        memset(count, 0, sizeof(count));
+        for(i = 0; i < Nlab; i++) count[(ubyte)*(GETLABTAB(i)->lab) + 1]++;
+        for(c = 0; c < 256; c++) count[c+1] += count[c];
+
+        for(i = 0; i < Nlab; i++)
+            sorted[count[(ubyte)*(GETLABTAB(i)->lab)]++] = GETLABTAB(i);
+
+        memcpy(Labtab, sorted, Nlab * sizeof(LABTAB *));
+        free(sorted);
     }
 
+    /* Now rebuild the label hash index for the sorted table. */
+    hash_labels();
+
 }
 
 int
@@ -476,7 +459,7 @@ find_comment(char    s[])
 {
     int     i;
     char    quote;
-    extern  char        Comment_char2;  /* Embedded comment char */
+    extern ASMSTATE  char        Comment_char2;  /* Embedded comment char */
 
     /* Scan line for position of the start of a comment */
 
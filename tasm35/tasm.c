@@ -265,10 +265,60 @@
  *      11/29/24             Robert Armstorng <bob@jfcl.com>
  *                              change CLK_TCK to CLOCKS_PER_SEC
  *
+ *      10/14/26             AGT (agent@local)
+ *                              Hashed label table that grows as needed.
+ *                              Removes the MAXLAB limit and the linear
+ *                              label searches on both passes.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              Pass 2 replays the source from the pass 1
+ *                              line cache (srccache.c) and reuses the
+ *                              macro expansion and instruction lookup.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              Arena allocator (arena.c) for the labels,
+ *                              macros, instruction tables, TOC and the
+ *                              source cache.  Each is freed in one go.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              Sparse paged memory image (memimage.c)
+ *                              replaces the 64K Opbuffer.  Object records
+ *                              only for bytes written; Intel type 04 and
+ *                              Motorola S2/S3 records above 64K.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              Object records are hex encoded by table
+ *                              lookup into a big output buffer.  -o00
+ *                              gives the longest records allowed.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              Batch mode (tasm -batch).  The assembler's
+ *                              state is thread local (ASMSTATE) so jobs
+ *                              can run in parallel, sharing the tables.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              -stats shows the time taken by each phase
+ *                              and the label, instruction and macro
+ *                              lookup counts.  "make bench" uses it.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              -u (incremental build).  The include graph
+ *                              and file hashes are kept in a .tbs file
+ *                              next to the object, see build.c.
+ *
+ *      10/14/26             AGT (agent@local)
+ *                              -y and -stats time with the monotonic
+ *                              clock.  clock() is CPU time, and with
+ *                              -batch that's summed over every thread.
+ *
  *  Invoked as:
  *
  *  tasm [-flags] source_file [object_file [list_file [exp_file [sym_file]]]]
  *
+ *  or, to run many assemblies in one process (see tasmmain.c):
+ *
+ *  tasm -batch job_file [threads]
+ *
  *  Where 'flags' can be:
  *
  *  -<nn>   Specify version  -48 for 8048
@@ -299,13 +349,17 @@
  *  -p      Page the listing file
  *  -q      Quiet, disable the listing file
  *  -s      Symbol table
- *  -o<bb>  Set number of bytes per object record
+ *  -stats  Show time spent in each phase and lookup counts
+ *  -u      Update: skip the assembly if no source has changed
+ *  -o<bb>  Set number of bytes per object record (00 = as many as
+ *          the record format allows)
  *  -x      Enable extended instruction set (if any)
  *  -y      Enable timing.
  *  -z      Turn debugging on (enables DEBUG statements).
  *
  */
 
+#define         _POSIX_C_SOURCE 200809L     /* for clock_gettime() */
 #include        "tasm.h"
 #include        <stdarg.h>
 
@@ -372,103 +426,105 @@ char    *Dirtab[NDIR]   = {
         };
 
 /* Label tables */
-ushort   Nlab;                   /* number of labels in table    */
-LABTAB  *Labtab[MAXLAB];        /* Pointers to Label data       */
+ASMSTATE int      Nlab;                  /* number of labels in table    */
+ASMSTATE int      Labtab_size = 0;       /* allocated size of Labtab     */
+ASMSTATE LABTAB **Labtab      = NULL;    /* Pointers to Label data       */
 
-ushort  Lhash[MAXLHASH];        /* label hash table             */
+ASMSTATE int      Lhash_size  = 0;       /* number of hash buckets (power of 2) */
+ASMSTATE int     *Lhash       = NULL;    /* label hash table (bucket heads)     */
 
-OPTAB   *Optab[MAXINSTR];
-REGTAB  *Regtab[MAXREG];
+ASMSTATE OPTAB   *Optab[MAXINSTR];
+ASMSTATE REGTAB  *Regtab[MAXREG];
 
-ushort  Ihash[MAXIHASH];        /* instruction hash table */
-
-ushort  Num_instr = 0;
-ushort  Num_reg   = 0;
-int     Seg       = NULL_SEG;
+ASMSTATE ushort  Num_instr = 0;
+ASMSTATE ushort  Num_reg   = 0;
+ASMSTATE int     Seg       = NULL_SEG;
 
 /* last record to write into obj file.  Indexed by obj format */
 /* no such record if binary format selected */
-obj_t   Obj_format        = INTEL_OBJ;
-
-static  int     Avsim51           = FALSE;
-static  int     Blockobj          = FALSE;
-static  int     Conditional_level = 0;
-static  dir_t   Directive         = NOTDIR;
-static  char    *Filenames[MAX_NAMED_FILES];
-static  int     Include_level     = 0;
-static  int     Listflag          = TRUE;
-static  int     Long_label_list   = FALSE;
-static  int     Nocodes           = FALSE;
-static  int     No_end            = TRUE;
-static  ushort  Nobj_bytes_per_rec= 0x18;
-static  int     Nexport           = 0;
-static  int     Page_linenumber   = 0;
-static  int     Pagesize          = PAGESIZE;
-static  int     Page_num          = 0;
-static  int     Pageflag          = FALSE;
-static  int     Show_expanded     = FALSE;
-static  int     Total_lines       = 0;
-static  char    Title[LINESIZE]   = "Speech Technology Incorporated";
-static  char    SubTitle[LINESIZE]= "";
-static  int     Write_symtab;
-static  FILE    *Fp_list;
-static  int     Ls_first          = TRUE;       /* Arg LS first                     */
-static  TOCENTRY *TOCfirst        = NULL;     // first table of contents entry
-static  TOCENTRY *TOClast         = NULL;     // ... and the last
-
-int     AutoLabelID       = 7;
-int     Skip              = FALSE;
-int     Wordsize          = 1;          /* one byte per word default        */
-int     No_arg_shift      = FALSE;      /* Disable the shift/or on arg values */
-int     Ols_first         = TRUE;       /* Opcodes LS first                 */
-int     Err_check         = EC_UNUSED_ARGBYTES | EC_DUP_LABELS;
-char    Wild_char         = '*';        /* Wild character in opcode tables  */
-char    Local_char        = '_';        /* Default first char for local labels */
-char    Reg_char          = '!';        /* Wild for reg set entry in table  */
-char    Comment_char1     = ';';        /* First char for comments          */
-char    Comment_char2     = ';';        /* First char for embedded comments */
-int     Ignore_case       = FALSE;      /* Ignore case of labels            */
-int     Use_argvalv       = FALSE;      /* Use the Argvalv vector for args  */
-ushort  Debug             = 0;
-ushort  Class_mask        = 1;  /* Default instruction class mask.
+ASMSTATE obj_t   Obj_format        = INTEL_OBJ;
+
+static  ASMSTATE int     Avsim51           = FALSE;
+static  ASMSTATE int     Blockobj          = FALSE;
+static  ASMSTATE int     Conditional_level = 0;
+static  ASMSTATE dir_t   Directive         = NOTDIR;
+static  ASMSTATE char    *Filenames[MAX_NAMED_FILES];
+static  ASMSTATE int     Include_level     = 0;
+static  ASMSTATE int     Listflag          = TRUE;
+static  ASMSTATE int     Long_label_list   = FALSE;
+static  ASMSTATE int     Nocodes           = FALSE;
+static  ASMSTATE int     No_end            = TRUE;
+static  ASMSTATE ushort  Nobj_bytes_per_rec= 0x18;
+static  ASMSTATE int     Nexport           = 0;
+static  ASMSTATE int     Page_linenumber   = 0;
+static  ASMSTATE int     Pagesize          = PAGESIZE;
+static  ASMSTATE int     Page_num          = 0;
+static  ASMSTATE int     Pageflag          = FALSE;
+static  ASMSTATE int     Show_expanded     = FALSE;
+static  ASMSTATE int     Total_lines       = 0;
+static  ASMSTATE char    Title[LINESIZE]   = "Speech Technology Incorporated";
+static  ASMSTATE char    SubTitle[LINESIZE]= "";
+static  ASMSTATE int     Write_symtab;
+static  ASMSTATE FILE    *Fp_list;
+static  ASMSTATE int     Ls_first          = TRUE;       /* Arg LS first                     */
+static  ASMSTATE TOCENTRY *TOCfirst        = NULL;     // first table of contents entry
+static  ASMSTATE TOCENTRY *TOClast         = NULL;     // ... and the last
+
+ASMSTATE int     AutoLabelID       = 7;
+ASMSTATE int     Skip              = FALSE;
+ASMSTATE int     Wordsize          = 1;          /* one byte per word default        */
+ASMSTATE int     No_arg_shift      = FALSE;      /* Disable the shift/or on arg values */
+ASMSTATE int     Ols_first         = TRUE;       /* Opcodes LS first                 */
+ASMSTATE int     Err_check         = EC_UNUSED_ARGBYTES | EC_DUP_LABELS;
+ASMSTATE char    Wild_char         = '*';        /* Wild character in opcode tables  */
+ASMSTATE char    Local_char        = '_';        /* Default first char for local labels */
+ASMSTATE char    Reg_char          = '!';        /* Wild for reg set entry in table  */
+ASMSTATE char    Comment_char1     = ';';        /* First char for comments          */
+ASMSTATE char    Comment_char2     = ';';        /* First char for embedded comments */
+ASMSTATE int     Ignore_case       = FALSE;      /* Ignore case of labels            */
+ASMSTATE int     Use_argvalv       = FALSE;      /* Use the Argvalv vector for args  */
+ASMSTATE ushort  Debug             = 0;
+ASMSTATE STATS   Stats;                          /* -stats                           */
+ASMSTATE ushort  Class_mask        = 1;  /* Default instruction class mask.
                                  * Bit 0 on enables basic instruction set.
                                  * Other bits enable extended instructions,
                                  *  if any */
 
 
-char    Module_name[LABLEN]  = {DEFAULT_MODULE};
+ASMSTATE char    Module_name[LABLEN]  = {DEFAULT_MODULE};
 
 
 
-char    Banner[] = "TASM Assembler.                                                      ";
+ASMSTATE char    Banner[] = "TASM Assembler.                                                      ";
 
-char    Part_num[8];
+ASMSTATE char    Part_num[8];
 
-char    *Expr;
+ASMSTATE char    *Expr;
 
-ubyte   Argvalv[8];
+ASMSTATE ubyte   Argvalv[8];
 
-        pc_t    Pc;
-        pc_t    First_pc;
-static  pc_t    Last_pc;
-static  pc_t    Max_pc;
-static  pc_t    Min_pc;
-        pc_t    END_Pc;         /* Option addr provided with END directive */
+        ASMSTATE pc_t    Pc;
+        ASMSTATE pc_t    First_pc;
+static  ASMSTATE pc_t    Last_pc;
+static  ASMSTATE pc_t    Max_pc;
+static  ASMSTATE pc_t    Min_pc;
+        ASMSTATE pc_t    END_Pc;         /* Option addr provided with END directive */
 
-int     Line_number;
-line_t  Linetype;
-pass_t  Pass;
-error_t Errorno;
-int     Codegen;
+ASMSTATE int     Line_number;
+ASMSTATE line_t  Linetype;
+ASMSTATE pass_t  Pass;
+ASMSTATE error_t Errorno;
+ASMSTATE int     Codegen;
 
-char    Errorbuf[LINESIZE];
+ASMSTATE char    Errorbuf[LINESIZE];
 
 /* file descriptors */
-FILE           *Fp_object;
+ASMSTATE FILE           *Fp_object;
+ASMSTATE FILE           *Fp_console = NULL;   /* Messages (NULL for stdout) */
 
 /* File names */
 
-int     Errcnt;
+ASMSTATE int     Errcnt;
 static char    *Errmess[] =    {"",
                          "unrecognized directive.           ",
                          "unrecognized instruction.         ",
@@ -479,10 +535,6 @@ static char    *Errmess[] =    {"",
                          "no such label yet defined.        " };
 
 
-/* Declare pointer to the object code buffer  */
-static unsigned char HUGE  Opbuffer[MAXMEM+1L];
-static opbuf_t             Opbuf = (opbuf_t) Opbuffer;     /*lint !e643 */
-
 /* Static Functions */
 static  pc_t    baddr ( pc_t pc );
 static  void    close_files ( void );
@@ -490,9 +542,11 @@ static  ubyte   compute_checksum ( pc_t start_addr, pc_t end_addr );
 static  void    eject ( void );
 static  void    export ( void );
 static  void    list ( int linenumber , int showpc, pc_t pc , ushort nbytes , char *buf );
-static  int     open_files ( char *files [], int filecnt );
+static  int     name_files ( char *files [], int filecnt );
+static  int     open_files ( void );
 static  void    pass1 ( char *source_file );
 static  void    pass2 ( char *source_file );
+static  void    pr_stats ( ulong elapsed );
 static  void    pr_hextab ( pc_t pc_lo , pc_t pc_hi );
 static  void    pr_labels ( int show_no_locals );
 static  void    pr_toc();
@@ -514,21 +568,24 @@ tasm(int argc,char *margv[])
     char    option_buf[LINESIZE];
     char    *p;
     char    *s;
-    clock_t start_time;
     int     time_flag;
+    ulong   run_start;
+    ulong   start;
+    ulong   wrtobj_time;
     char    *argv[MAXARGS];
     int     objformat;
     int     printhextab;
     int     printlabels;
     int     printTOC;
     int     show_no_locals    = TRUE;       /* Don't list local labels */
+    int     update            = FALSE;      /* -u, skip if up to date  */
+    char    *outputs[4];
 
-    extern int Num_macros_predefined;
-    extern int Num_macros;
 
 
 
-    start_time = clock();
+    memset(&Stats, 0, sizeof(Stats));
+    run_start = stat_usecs();
 
     /* Initialize the file pointer array */
     filecnt = 0;
@@ -592,7 +649,10 @@ tasm(int argc,char *margv[])
 
             case 's':       /* write a symbol table */
             case 'S':
-                Write_symtab = TRUE;
+                if(strcmp(argv[arg]+1, "stats") == SAME)
+                    Stats.enabled = TRUE;
+                else
+                    Write_symtab = TRUE;
                 break;
 
             case 'l':       /* print a label table */
@@ -620,10 +680,9 @@ tasm(int argc,char *margv[])
 
             case 'f':       /* Set the memory fill byte */
             case 'F':
-                /* fill opcode array with specified byte */
+                /* fill unused memory with specified byte */
                 {
                     ubyte fillbyte;
-                    pc_t  pc;
 
                     /* Use the hex value, if provided */
                     if((*(argv[arg]+2)) != '\0')
@@ -631,7 +690,7 @@ tasm(int argc,char *margv[])
                     else
                         fillbyte = 0;
 
-                    for(pc = 0; pc <= MAXMEM; pc++) putop(pc,fillbyte);
+                    mem_fill(fillbyte);
                 }
                 break;
 
@@ -739,7 +798,9 @@ tasm(int argc,char *margv[])
             case '9':
                 /* read instruction set definition table */
                 strcpy(Part_num, argv[arg]+1);
+                start = stat_usecs();
                 read_table(argv[arg]+1);
+                Stats.t_table += stat_usecs() - start;
                 break;
 
             case 't':
@@ -751,7 +812,16 @@ tasm(int argc,char *margv[])
                  * then 'tasm -tf8'    could be used to invoke it.
                  */
                 strcpy(Part_num, argv[arg]+2);
+                start = stat_usecs();
                 read_table(argv[arg]+2);
+                Stats.t_table += stat_usecs() - start;
+                break;
+
+            case 'u':
+            case 'U':
+                /* Incremental: don't assemble if nothing has changed */
+                update = TRUE;
+                build_start();
                 break;
 
             case 'y':
@@ -790,8 +860,27 @@ tasm(int argc,char *margv[])
     errprt("  Version 3.5 February, 2024. [RLA]\n");
     errprt(" Copyright (C) 2001 Squak Valley Software\n");
 
+    if (name_files(files,filecnt) != SUCCESS)
+    {
+        free_all ();
+        tasmexit(EXIT_FILEACCESS);
+    }
+
+    /* With -u, there's nothing to do if the files it was last built
+     * from haven't changed (and neither have the outputs).
+     */
+    outputs[0] = OBJ_FN;
+    outputs[1] = LST_FN;
+    if (update && build_current(argc, argv, OBJ_FN, outputs, 2))
+    {
+        sprintf(errbuf, "tasm: %.128s is up to date.\n", OBJ_FN);
+        errprt(errbuf);
+        free_all();
+        return(EXIT_NORMAL);
+    }
+
     /* open files */
-    if (open_files(files,filecnt) != SUCCESS)
+    if (open_files() != SUCCESS)
     {
         free_all ();
         tasmexit(EXIT_FILEACCESS);
@@ -805,7 +894,7 @@ tasm(int argc,char *margv[])
     Nlab            = 0;
     Errcnt          = 0;
     No_end          = TRUE;
-    Num_macros_predefined = Num_macros;
+    macro_predefined();
 
     strcpy(Module_name, DEFAULT_MODULE);      /* set to default */
 
@@ -814,9 +903,13 @@ tasm(int argc,char *margv[])
 
     /* Do the first pass.  Build the symbol table.*/
     Pass = FIRST;
+    start = stat_usecs();
     pass1(SRC_FN);
+    Stats.t_pass1 = stat_usecs() - start;
 
+    start = stat_usecs();
     sort_labels();
+    Stats.t_sort = stat_usecs() - start;
 
     errprt("tasm: pass 1 complete.\n");
 
@@ -836,7 +929,10 @@ tasm(int argc,char *margv[])
     macro_free (FALSE);
 
     strcpy(Module_name, DEFAULT_MODULE);      /* Reset to default */
+    start       = stat_usecs();
+    wrtobj_time = Stats.t_wrtobj;
     pass2(SRC_FN);
+    Stats.t_pass2 = stat_usecs() - start - (Stats.t_wrtobj - wrtobj_time);
 
     /* assembly complete.  Now take care of any final things like
      *   generating symbol table, writing last of obj file, etc. 
@@ -858,10 +954,12 @@ tasm(int argc,char *margv[])
     /* if Blockobj flag was set then write the entire obj file now
      *   as one big block.
      */
-    if(Blockobj) wrtobj( Min_pc, Max_pc+1, Nobj_bytes_per_rec);
+    if(Blockobj) wrtobj( Min_pc, Max_pc+1, Nobj_bytes_per_rec, TRUE);
 
     /* write last object record */
+    start = stat_usecs();
     wrtlastobj(Obj_format);
+    Stats.t_wrtobj += stat_usecs() - start;
 
     /* generate label table if enabled*/
     if(printlabels) pr_labels(show_no_locals);
@@ -893,24 +991,34 @@ tasm(int argc,char *margv[])
 
     close_files();
 
+    /* Remember what this was built from for the next -u */
+    if(update)
+    {
+        outputs[0] = OBJ_FN;
+        outputs[1] = LST_FN;
+        outputs[2] = Nexport     ? EXP_FN : NULL;
+        outputs[3] = Write_symtab ? SYM_FN : NULL;
+        build_save(argc, argv, OBJ_FN, outputs, 4, (Errcnt == 0));
+    }
+
     if(time_flag)
     {
-        const clock_t ticksPerSec=(clock_t)CLOCKS_PER_SEC;  // [RLA]
-        clock_t et_ticks;
-        clock_t et_secs;
-        clock_t et_hunds;
+        ulong   et_usecs;
+        ulong   et_secs;
+        ulong   et_hunds;
 
         /* Compute Elapsed time in seconds and hundredths of seconds.
-         * Avoid using floating point so we don't bloat TASM.
+         * Avoid using floating point so we don't bloat TASM.  This is
+         * wall time, so it means the same thing under -batch.
          */
-        et_ticks = (clock() - start_time);
-        et_secs  =   et_ticks / ticksPerSec;
-        et_hunds = ((et_ticks % ticksPerSec) * 100)/ticksPerSec;
+        et_usecs = (stat_usecs() - run_start);
+        et_secs  =   et_usecs / 1000000UL;
+        et_hunds =  (et_usecs % 1000000UL) / 10000UL;
 
-        if ( et_ticks > 0 )
+        if ( et_usecs > 0 )
         {
-            sprintf(errbuf,"Elapsed time = %ld.%02ld secs  lines = %d   lines/sec = %ld\n",
-               et_secs, et_hunds, Total_lines,(Total_lines*ticksPerSec)/(et_ticks));
+            sprintf(errbuf,"Elapsed time = %lu.%02lu secs  lines = %d   lines/sec = %lu\n",
+               et_secs, et_hunds, Total_lines,(Total_lines*1000000UL)/(et_usecs));
         }
         else
         {
@@ -919,6 +1027,8 @@ tasm(int argc,char *margv[])
         errprt(errbuf);
     }
 
+    if(Stats.enabled) pr_stats(stat_usecs() - run_start);
+
     /* Free all the malloc'd memory */
     free_all();
 
@@ -945,63 +1055,45 @@ void
 free_all()
 {
     unsigned int i;
-    extern char Emptystring[];
 
     /* Free all the macros */
     macro_free (TRUE);
 
-    /* Free all the labels */
-    for(i=0; i< Nlab; i++)
-    {
-        free (GETLABTAB(i));
-    }
+    /* Free all the labels (the index arrays; the labels themselves are
+     * in the label arena).
+     */
+    free(Labtab);   Labtab = NULL;  Labtab_size = 0;  Nlab = 0;
+    free(Lhash);    Lhash  = NULL;  Lhash_size  = 0;
 
     /* Free the instruction set table */
-    for(i=0; i< Num_instr; i++)
-    {
-        free(Optab[i]->instruction);
-        if(Optab[i]->args != Emptystring) free(Optab[i]->args);
-        free(Optab[i]);
-    }
+    free_table();
 
-    for(i=0; i< Num_reg; i++)
-    {
-        if (Regtab[i] != NULL) free(Regtab[i]);
-    }
-
-    /* Free the file names */
-    for(i = 0; i < MAX_NAMED_FILES; i++)
-    {
-        if(Filenames[i] != NULL) free (Filenames[i]);
-    }
-}
+    /* Free the source line cache */
+    src_free();
 
-// [RLA] Convert "\r\n" in source file to just "\n" ...
-static void FixCRLF (char *pszLine)
-{
-  size_t cb = strlen(pszLine);
-  if ((cb >= 2) && (pszLine[cb-2] == '\r') && (pszLine[cb-1] == '\n')) {
-    pszLine[cb-2] = '\n';  pszLine[cb-1] = 0;
-  }
+    /* Forget the file names, table of contents and memory image (in
+     * the module arena)
+     */
+    for(i = 0; i < MAX_NAMED_FILES; i++) Filenames[i] = NULL;
+    TOCfirst = TOClast = NULL;
+    mem_free();
+    wrtobj_reset();
+    build_free();
+
+    /* Give all the arena blocks back to the heap */
+    for(i = 0; i < NARENA; i++) arena_free((arena_t)i);
 }
 
 // [RLA] Allocate a new table of contents entry ...
 static void NewTOCentry(char* entry)
 {
-  TOCENTRY* pTOC = malloc(sizeof(TOCENTRY));
-  char* pSTR = malloc(strlen(entry) + 1);
-  if ((pTOC == NULL) || (pSTR == NULL)) {
-    errprt("Cannot malloc for TOC storage.\n");
-    tasmexit(EXIT_MALLOC);
-  } else {
-    strcpy(pSTR, entry);
-    pTOC->pagenum = Page_num;
-    pTOC->subtitle = pSTR;
-    pTOC->next = NULL;
-    if (TOClast != NULL) TOClast->next = pTOC;
-    if (TOCfirst == NULL) TOCfirst = pTOC;
-    TOClast = pTOC;
-  }
+  TOCENTRY* pTOC = arena_alloc(AR_MODULE, sizeof(TOCENTRY));
+  pTOC->pagenum = Page_num;
+  pTOC->subtitle = arena_strsave(AR_MODULE, entry);
+  pTOC->next = NULL;
+  if (TOClast != NULL) TOClast->next = pTOC;
+  if (TOCfirst == NULL) TOCfirst = pTOC;
+  TOClast = pTOC;
 }
 
 
@@ -1031,23 +1123,23 @@ pass1(char *source_file)
     char    errbuf[LINESIZE];
 
     char    buf[LINESIZE];
-    char    sbuf[LINESIZE];
+    char    *pline;
     char    *pbuf;
+    int     nchar;
     int     local_line_number;
     int     i;
     dir_t   directive;
     char    include_filename[PATHSIZE];
     int     starting_conditional_level;
-    FILE    *fp_source;
-
-    extern  int     Num_macros;
+    SRCREAD *src;
+    PARSED  parsed;
 
     DEBUG ("pass1: open %s\n ",source_file);
 
     starting_conditional_level = Conditional_level;
 
-    fp_source = fopen( source_file, "r");
-    if(fp_source == NULL)
+    src = src_open( source_file );
+    if(src == NULL)
     {
         sprintf(errbuf,"tasm: source file open error on %s\n",source_file);
         errprt(errbuf);
@@ -1059,25 +1151,22 @@ pass1(char *source_file)
     Include_level++;
     Line_number = local_line_number = 0;
 
-    while(fgets( sbuf, LINESIZE-1, fp_source) != NULL)
+    while(src_gets(src) != NULL)
     {
-        FixCRLF(sbuf);
         Line_number = (++local_line_number);
         Total_lines++;
 
-        if(Num_macros > 0){
-            macro_expand(sbuf,buf);
-            pbuf = buf;
-        }
-        else{
-            pbuf = sbuf;
-        }
+        pline = pbuf = src_expand(src, buf);
 
         do{
             /* Parse each line to keep the PC up to date so the label
-                table can be built with proper values for each label */
-            pbuf += parse(pbuf,label,inst,&directive,&op_code,&obytes,
-                          &abytes,&argc,argv,&argval);
+                table can be built with proper values for each label.
+                Instructions are saved so pass 2 needn't look them up
+                again. */
+            nchar = parse(pbuf,label,inst,&directive,&op_code,&obytes,
+                          &abytes,&argc,argv,&argval,&parsed);
+            if(parsed.nchar > 0) src_save_parsed(src, pbuf - pline, &parsed);
+            pbuf += nchar;
             Directive = directive;     /* Save global for EQU detection */
             nbytes = obytes + abytes;
 
@@ -1164,48 +1253,42 @@ pass1(char *source_file)
                     /* if there is a label on this line then put
                      * it in the table along with its value */
                     if(label[0] != '\0'){
-                        if(Nlab < MAXLAB){
-                            switch(Linetype){
-                            case BLANK:
-                            case INSTRUCT:
-                                save_label(label, (expr_t)Pc);
-                                break;
+                        switch(Linetype){
+                        case BLANK:
+                        case INSTRUCT:
+                            save_label(label, (expr_t)Pc);
+                            break;
 
-                            case DIRECTIVE:
-                                switch(directive){
-                                case EQU:
-                                    /* if this is an EQU directive then
-                                     *  assign label value.
-                                     */
-                                    save_label(label, val(argv[0]));
-                                    break;
-
-                                case SET:
-                                    if((i = find_label(label)) != FAILURE)
-                                        GETLABTAB(i)->val = val(argv[0]);
-                                    else{
-                                        sprintf(errbuf,
-                                          "label must pre-exist for SET.  %s", 
-                                            label);
-                                        errlog(errbuf, ALWAYS);
-                                    }
-                                    break;
-
-                                default:
-                                    save_label(label, (expr_t)Pc);
-                                    break;
+                        case DIRECTIVE:
+                            switch(directive){
+                            case EQU:
+                                /* if this is an EQU directive then
+                                 *  assign label value.
+                                 */
+                                save_label(label, val(argv[0]));
+                                break;
 
+                            case SET:
+                                if((i = find_label(label)) != FAILURE)
+                                    GETLABTAB(i)->val = val(argv[0]);
+                                else{
+                                    sprintf(errbuf,
+                                      "label must pre-exist for SET.  %s", 
+                                        label);
+                                    errlog(errbuf, ALWAYS);
                                 }
                                 break;
 
                             default:
-                                /* OK */
+                                save_label(label, (expr_t)Pc);
                                 break;
+
                             }
-                        }
-                        else{
-                            sprintf(Errorbuf,"MaxLab=%d",MAXLAB);
-                            errlog(Errmess[(int)ER_TAB_OVERFLOW], ALWAYS);
+                            break;
+
+                        default:
+                            /* OK */
+                            break;
                         }
                     } /* end if(label) */
 
@@ -1228,7 +1311,7 @@ pass1(char *source_file)
         }while(*pbuf);
 
     }
-    fclose(fp_source);
+    src_close(src);
     fname_pop();
     Include_level--;
 
@@ -1270,7 +1353,8 @@ pass2(char *source_file)
     char    *argv[MAXARGS];
     char    errbuf[LINESIZE];
     char    buf[LINESIZE];
-    char    sbuf[LINESIZE];
+    char    *sline;
+    char    *pline;
     char    *pbuf;
     int     nchar;
     ubyte   fill_value; 
@@ -1279,17 +1363,17 @@ pass2(char *source_file)
     pc_t    iipc;
 	int     showpc;
     ushort  jj;
-    FILE    *fp_source;
+    SRCREAD *src;
+    PARSED  *pp;
     dir_t   directive;
     pc_t    start_addr;
     pc_t    end_addr;
     char    include_filename[PATHSIZE];
 
-    extern  int     Num_macros;
-    extern  int     Err_check;
+    extern ASMSTATE  int     Err_check;
 
-    fp_source = fopen(source_file,"r");
-    if(fp_source == NULL){
+    src = src_open(source_file);
+    if(src == NULL){
         sprintf(errbuf,"tasm: source file open error on %s\n",source_file);
         errprt(errbuf);
         tasmexit(EXIT_FILEACCESS);
@@ -1307,22 +1391,20 @@ pass2(char *source_file)
     Line_number = local_line_number = 0;
     memset(SubTitle, 0, sizeof(SubTitle));
 
-    while(fgets( sbuf, LINESIZE-1, fp_source) != NULL)
+    while((sline = src_gets(src)) != NULL)
     {
-        FixCRLF(sbuf);
         Line_number = (++local_line_number);  
 
-        if(Num_macros > 0){
-            macro_expand(sbuf,buf);
-            pbuf = buf;
-        }
-        else{
-            pbuf = sbuf;
-        }
+        pline = pbuf = src_expand(src, buf);
 
         do{
-            nchar = parse(pbuf,label,inst,&directive, &op_code,
+            /* Use the instruction table match from pass 1 if we can */
+            if((pp = src_parsed(src, pbuf - pline)) != NULL)
+                nchar = parse_cached(pp,pbuf,label,&op_code,
                           &obytes,&abytes,&argc,argv,&argval);
+            else
+                nchar = parse(pbuf,label,inst,&directive, &op_code,
+                          &obytes,&abytes,&argc,argv,&argval,NULL);
 
             Directive = directive;       /* Save global for EQU detection. */
             nbytes    = obytes + abytes;
@@ -1560,13 +1642,13 @@ pass2(char *source_file)
 				{
                     list(Line_number,TRUE,(pc_t)val(label),0,pbuf);
 				}
-				else if((pbuf == buf) || (pbuf == sbuf))
+				else if(pbuf == pline)
                 {
                     /* First line of this statement */
                     if(Show_expanded)
                         list(Line_number,showpc,Pc,nbytes,pbuf);
                     else
-                        list(Line_number,showpc,Pc,nbytes,sbuf);
+                        list(Line_number,showpc,Pc,nbytes,sline);
                 }
                 else 
                 {
@@ -1607,7 +1689,8 @@ pass2(char *source_file)
                   ((Last_pc  != (Pc - waddr((pc_t)nbytes))) ||
                   ((Linetype == DIRECTIVE) && (directive == END))))
                 {
-                    wrtobj( baddr(First_pc), baddr(Last_pc),Nobj_bytes_per_rec);
+                    wrtobj( baddr(First_pc), baddr(Last_pc),Nobj_bytes_per_rec,
+                            FALSE);
                     First_pc = Pc;
                 }
 
@@ -1626,12 +1709,12 @@ pass2(char *source_file)
             /* Send line to list file here if skip was TRUE, but
              * show no code assembled.
              */
-            if(Skip)list(Line_number,showpc,Pc,0,sbuf);
+            if(Skip)list(Line_number,showpc,Pc,0,sline);
 
         }while(*(pbuf +=nchar));/*keep parsing line until null is reached */
 
     }
-    fclose(fp_source);
+    src_close(src);
     fname_pop();
     Include_level--;
 
@@ -1660,8 +1743,8 @@ process_conditional(dir_t   directive, char    *arg0)
                           if(skip_state[i]==TRUE) skip=TRUE;}
 
     int         i;
-    static      int skip_state[MAX_CONDITIONAL_LEVELS];
-    static      int skip = FALSE;
+    static      ASMSTATE int skip_state[MAX_CONDITIONAL_LEVELS];
+    static      ASMSTATE int skip = FALSE;
 
     switch(directive){
     case ENDIF:
@@ -1721,22 +1804,20 @@ process_conditional(dir_t   directive, char    *arg0)
 
 /**********************************************************************/
 /*
- * Function: open_files()
+ * Function: name_files()
  *
  * Description:
- *     Open the object and list files.
  *     Build file names if they were not all provided on the command
  *     line.
  */
 /**********************************************************************/
 
 static int 
-open_files(
+name_files(
 char    *files[],       /* pointers to file names */
 int     filecnt)        /* Number of files given */
 {
 
-    char    errbuf[LINESIZE];
     char    basename[PATHSIZE];
     char    *p;
     char    *q;
@@ -1766,11 +1847,14 @@ int     filecnt)        /* Number of files given */
         errprt("  -i         Ignore case in labels\n");
         errprt("  -l[alt]    Produce a label table in the listing [l=long,a=all,t=TOC]\n");
         errprt("  -m         Produce object in MOS Technology format\n");
-        errprt("  -o<xx>     Define number of bytes per obj record = <xx>\n");
+        errprt("  -o<xx>     Define number of bytes per obj record = <xx> (00=max)\n");
         errprt("  -p<lines>  Page the listing file\n");
         errprt("  -q         Quiet, disable the listing file\n");
         errprt("  -s         Write a symbol table file\n");
+        errprt("  -stats     Show time per phase and lookup counts\n");
+        errprt("  -u         Skip the assembly if nothing changed since the last -u\n");
         errprt("  -x<xx>     Enable extended instruction set (if any)\n");
+        errprt("or: tasm -batch <job_file> [<threads>]  (one command line per job)\n");
 
         return(FAILURE);
     }
@@ -1785,12 +1869,11 @@ int     filecnt)        /* Number of files given */
     {
         if((files[i] != NULL) && (i < filecnt))
         {
-            Filenames[i] = (char *)malloc(strlen(files[i]) + 1);
-            strcpy(Filenames[i], files[i]);
+            Filenames[i] = arena_strsave(AR_MODULE, files[i]);
         }
         else
         {
-            Filenames[i] = (char *)malloc(strlen(basename) + 5);
+            Filenames[i] = (char *)arena_alloc(AR_MODULE, strlen(basename) + 5);
             strcpy(Filenames[i], basename);
             switch(i){
             case 1:  strcat(Filenames[i],".obj"); break;
@@ -1802,6 +1885,25 @@ int     filecnt)        /* Number of files given */
         }
 
     }
+
+    return (SUCCESS);
+}
+
+/**********************************************************************/
+/*
+ * Function: open_files()
+ *
+ * Description:
+ *     Open the object and list files (see name_files()).
+ */
+/**********************************************************************/
+
+static int 
+open_files(void)
+{
+
+    char    errbuf[LINESIZE];
+
     /* don't open the source file here since it is opened for each pass */
 
 #if 0
@@ -2047,7 +2149,7 @@ pr_labels(int show_no_locals)
 /* Send label table to list file */
 {
 
-    ushort  i;
+    int     i;
     char    labbuf[LINESIZE];
     char    linebuf[LINESIZE];
     char    ebuf[LINESIZE];
@@ -2159,30 +2261,30 @@ pc_t    pc_lo,         /* minimum address to output */
 pc_t    pc_hi)         /* maximum address to output (Program Counter)*/
 {
     ushort  i;
-    int     nlines;
     pc_t    addr;
+    pc_t    first;
+    pc_t    last;
     char    linebuf[LINESIZE];
     char    *p;
     ubyte   op;
 
-    /* decrement the max pc since it points to one location
-        beyond the last byte to output.  (see comments
-        in wrtobj). */
+    /* Note that the max pc points to one location beyond the last
+        byte to output.  (see comments in wrtobj). */
 
     /* First test a few error cases */
-    if((pc_hi == pc_lo) && (pc_lo > 0))return;
-    if((pc_hi == pc_lo) && (Codegen == FALSE))return;
-    if(pc_hi == 0) return;   /* No code generated */
-
-    pc_hi--;
-    nlines = ((pc_hi - pc_lo) / 16) + 1;
+    if(pc_hi == 0) return;          /* No code generated */
+    if(pc_hi <= pc_lo) return;      /* (or nothing written at all) */
 
     listprt("\n");
     listprt("ADDR  00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F\n");
     listprt("-----------------------------------------------------\n");
 
-    for(addr = pc_lo; nlines--; addr += 16)
+    for(addr = pc_lo; addr < pc_hi; addr += 16)
     {
+        /* Leave out lines where nothing was written */
+        first = addr;
+        if(!mem_run(&first, &last, addr + 16)) continue;
+
         sprintf(linebuf,"%04lx ",addr);
         p = linebuf;
         for(i = 0; i < 16; i++)
@@ -2201,20 +2303,15 @@ pc_t    pc_hi)         /* maximum address to output (Program Counter)*/
 
 /**********************************************************************/
 /* Function    : errprt()
- * Description :  send input buffer to stdout
+ * Description :  send input buffer to stdout (or, in a batch, to the
+ *                job's own console file)
  */
 /**********************************************************************/
 
 void
 errprt(char *err_mess)
 {
-    char c;
-
-    while(*err_mess)
-    {
-        c = *err_mess++;
-        putchar(c);
-    }
+    fputs(err_mess, (Fp_console != NULL) ? Fp_console : stdout);
 }
 
 /**********************************************************************/
@@ -2275,7 +2372,7 @@ export()
 {
 
     char        errbuf[LINESIZE];
-    ushort      i;
+    int         i;
     FILE        *fp;
 
     if((fp = fopen(EXP_FN,"w")) == NULL){
@@ -2310,7 +2407,7 @@ write_symbols(void)
 {
 
     char        errbuf[LINESIZE];
-    ushort      i;
+    int         i;
     FILE        *fp;
     char        prefix[4];
 
@@ -2438,7 +2535,8 @@ isequate( void )
 static void
 putop(pc_t pcb, ubyte op)
 {
-    Opbuf[pcb]=op;
+    pcb &= MAXMEM;
+    mem_put(pcb, op);
 
     /* Keep track of the address range written */
     /* Note that Min_pc and Max_pc are always byte addresses. */
@@ -2456,7 +2554,71 @@ putop(pc_t pcb, ubyte op)
 ubyte
 getop(pc_t pcb)
 {
-    return ( Opbuf[pcb] );
+    return ( mem_get(pcb) );
+}
+
+/**********************************************************************
+ * Function: stat_usecs
+ * Description:
+ *      Monotonic clock time in microseconds, for -y and -stats.  Only
+ *      differences mean anything (it wraps every hour or so with 32 bit
+ *      longs).
+ **********************************************************************
+ */
+
+ulong
+stat_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ( (ulong)ts.tv_sec * 1000000UL + (ulong)(ts.tv_nsec / 1000) );
+}
+
+/**********************************************************************
+ * Function: pr_stats
+ * Description:
+ *      Show the -stats report: the wall time spent in each phase of
+ *      the assembly and how much work the table lookups did.
+ **********************************************************************
+ */
+
+static void
+pr_stats(
+ulong   elapsed)        /* Wall time for the whole run (usecs) */
+{
+    char    buf[LINESIZE];
+
+    sprintf(buf, "tasm: stats: lines = %d  time = %lu.%06lu secs  lines/sec = %lu\n",
+        Total_lines, elapsed / 1000000, elapsed % 1000000,
+        (elapsed > 0) ? (ulong)(Total_lines * 1000000ULL / elapsed) : 0);
+    errprt(buf);
+
+    sprintf(buf, "tasm: stats: read_table  %3lu.%06lu secs\n",
+        Stats.t_table / 1000000, Stats.t_table % 1000000);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: pass1       %3lu.%06lu secs\n",
+        Stats.t_pass1 / 1000000, Stats.t_pass1 % 1000000);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: sort_labels %3lu.%06lu secs\n",
+        Stats.t_sort / 1000000, Stats.t_sort % 1000000);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: pass2       %3lu.%06lu secs\n",
+        Stats.t_pass2 / 1000000, Stats.t_pass2 % 1000000);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: wrtobj      %3lu.%06lu secs\n",
+        Stats.t_wrtobj / 1000000, Stats.t_wrtobj % 1000000);
+    errprt(buf);
+
+    sprintf(buf, "tasm: stats: find_label   %10lu calls %10lu probes\n",
+        Stats.label_finds, Stats.label_probes);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: inst_lookup  %10lu calls %10lu compares\n",
+        Stats.inst_lookups, Stats.inst_compares);
+    errprt(buf);
+    sprintf(buf, "tasm: stats: macro_expand %10lu scans  %10lu lookups\n",
+        Stats.macro_scans, Stats.macro_lookups);
+    errprt(buf);
 }
 
 /* That's all folks. */
@@ -43,21 +43,24 @@ typedef unsigned short          ushort;
 typedef unsigned long           ulong;
 #define HUGE
 
+/* Storage class for everything that belongs to one assembly.  The
+ * assemblies of a batch (-batch, see tasmmain.c) each run on their own
+ * thread, so that state is thread local: each thread is a complete
+ * assembler context, starting from the same initial values a new
+ * process would.
+ */
+#ifdef _MSC_VER
+#define ASMSTATE        __declspec(thread)
+#else
+#define ASMSTATE        _Thread_local
+#endif
+
 #ifdef  UNIX
 
 /* The MSDOS environments typically have io.h to handle the low level IO stuff.
- * The "extern C" is appropriate only if CC is being used to build in the 
- * UNIX environment.
+ * UNIX has unistd.h instead.
  */
-#ifdef __cplusplus
-extern "C" {
-#endif
-int	close(int fd);
-int	read(int fd, char *buf, int nbytes);
-/* int	open(char * file, int flags, ...); */
-#ifdef __cplusplus
-}
-#endif
+#include        <unistd.h>
 
 //#include        "sys/file.h"
 //#define O_BINARY   0
@@ -67,6 +70,7 @@ int	read(int fd, char *buf, int nbytes);
 /* MSDOS - Borland C */
 #include <io.h>
 #include <alloc.h>
+#include <process.h>
 
 #endif
 /*********************************************/
@@ -133,28 +137,26 @@ int	read(int fd, char *buf, int nbytes);
 #define LOTS_OF_LABELS  /* don't bother with a small version        */
 
 #ifdef LOTS_OF_LABELS
-#define MAXLAB  15000   /* maximum number of labels in symbol table */
 #define MAXINSTR 1200    /* maximum number of instructions           */
 #else
-#define MAXLAB  2000    /* maximum number of labels in symbol table */
 #define MAXINSTR 600    /* maximum number of instructions           */
 #endif
 
 #define MAXARGS 128     /* maximum number of args for inst or directive */
 #define LABLEN  32      /* maximum number of characters in label +1 */
 #define MAXREG  32      /* maximum number of register set entries   */ 
-#define MAXMEM  0xffff  /* maximum number of bytes in ROM (opbuf)   */
+#define MAXMEM  0xffffffffL /* highest address in the memory image   */
 #define PAGESIZE 63     /* lines per page on listing file           */
 #define MAX_CONDITIONAL_LEVELS  32
-#define MAXIHASH 1024   /* maximum size of instruction hash table.  
-                                Actually, just one element per letter
-                                of the alphabet is used.*/
-#define MAXLHASH 64     /* Maximum size of label hash table.
-                         * One element per letter (upper and lower case). 
+#define MAXSRCCACHE 0x4000000L /* Bytes of memory the source line cache
+                                * may use.  Sources bigger than this are
+                                * read from disk again on pass 2.
+                                */
+#define LABINIT  1024   /* Initial size of the label table.  Both the
+                         * table and its hash index double as needed,
+                         * so there is no fixed limit on labels.
                          */
 
-#define HASHKEY(p)  (((*p & 0x1f) << 5) | (*(p+1)&0x1f))
-
 /* The macros min and max (in stdlib.h) are not defined in the 
  * c++ case (because of the desire to minimize the side effects
  * associated with macros).  Here are the preferred definintions:
@@ -203,6 +205,7 @@ typedef struct{
 typedef struct{
         expr_t  val;            /* Label value */
         ushort  flags;          /* Label flags */
+        int     hnext;          /* Next label in this hash chain (or -1) */
         char    lab[2];         /* Label string (min size; 
                                    malloc may extend buffer area */
 }LABTAB;
@@ -215,6 +218,64 @@ struct _TOCENTRY {
 };
 typedef struct _TOCENTRY TOCENTRY;
 
+/* Structure for the result of parsing one instruction statement.  The
+ * source line cache keeps these from pass 1 so that pass 2 need only
+ * evaluate the arguments (see parse_cached()).
+ */
+typedef struct _PARSED{
+        struct _PARSED *next;   /* Next statement on the same line       */
+        ushort  offset;         /* Start of the statement in the line    */
+        ushort  nchar;          /* Characters consumed by parse()        */
+        ushort  num_instr;      /* Num_instr at the time (for ADDINSTR)  */
+        ushort  obytes;         /* Number of bytes of opcode             */
+        ushort  abytes;         /* Number of bytes of args               */
+        ushort  modop;          /* Modifier operation (rule)             */
+        ushort  argc;           /* Number of argument strings            */
+        ubyte   shift;          /* bits to shift first argval            */
+        ulong   op_code;        /* Opcode (before rules())               */
+        ulong   bor;            /* mask to OR first argval with          */
+        char    *label;         /* Label on the statement (or NULL)      */
+        char    **argv;         /* Argument strings                      */
+}PARSED;
+
+/* Memory regions for arena_alloc() (arena.c).  Everything allocated in
+ * a region is freed at once.
+ */
+typedef enum{
+        AR_TABLE,               /* Instruction set table (read_table())  */
+        AR_LABELS,              /* Label table entries                   */
+        AR_MACROS,              /* Macro labels and definitions          */
+        AR_MODULE,              /* Per assembly: file names, TOC         */
+        AR_SOURCE,              /* Source line cache (srccache.c)        */
+        NARENA}arena_t;
+
+/* A point in a region to go back to with arena_release() */
+typedef struct{
+        void    *block;
+        size_t  used;
+}ARMARK;
+
+/* Performance statistics (-stats).  Times are in microseconds of
+ * wall time.
+ */
+typedef struct{
+        int     enabled;        /* TRUE to print them at the end         */
+        ulong   t_table;        /* read_table()                          */
+        ulong   t_pass1;        /* pass1()                               */
+        ulong   t_sort;         /* sort_labels()                         */
+        ulong   t_pass2;        /* pass2(), not counting wrtobj()        */
+        ulong   t_wrtobj;       /* wrtobj() and wrtlastobj()             */
+        ulong   label_finds;    /* find_label() calls ...                */
+        ulong   label_probes;   /* ... and hash chain entries compared   */
+        ulong   inst_lookups;   /* inst_lookup() calls ...               */
+        ulong   inst_compares;  /* ... and table variants tried          */
+        ulong   macro_scans;    /* Lines scanned by macro_expand() ...   */
+        ulong   macro_lookups;  /* ... and identifiers looked up         */
+}STATS;
+
+/* Source file being read by pass1() or pass2() (private to srccache.c) */
+typedef struct _SRCREAD SRCREAD;
+
 #define FLUSHE  fflush(stderr)
 
 #define DEBUG(f,d)          {if(Debug){fprintf(stderr,f,d);        FLUSHE;}}
@@ -342,6 +403,7 @@ void    listprt      ( char *buf );
 int     isequate     ( void );
 void    free_all     ( void );
 ubyte   getop        ( pc_t pcx);
+ulong   stat_usecs   ( void );
 
 /* str.c */
 int     search       ( char *p , char *s );
@@ -367,6 +429,16 @@ int     parse ( char   *buf,
                 ushort *abytes, 
                 ushort *argc, 
                 char   **argv ,
+                ulong  *argval,
+                PARSED *result );
+int     parse_cached ( PARSED *pp,
+                char   *buf,
+                char   *label,
+                ulong  *op_code,
+                ushort *obytes,
+                ushort *abytes,
+                ushort *argc,
+                char   **argv,
                 ulong  *argval );
 
 /* macro.c */
@@ -375,9 +447,12 @@ int     macro_get_index ( char *macro_name);
 void    macro_save      ( char *macro_name );
 void    macro_append    ( char *s );
 void    macro_free      ( int freeAll );
+void    macro_predefined( void );
+void    table_share     ( int enable );
 
 expr_t  val             ( char *expr_buf );
 void    read_table      ( char *pn );
+void    free_table      ( void );
 void    add_instruction ( char *s );
 void    errlog          ( char *err_mess , errout_t output_mode );
 
@@ -408,10 +483,48 @@ error_t inst_lookup(char    *inst,
                     char    **argv);
 void    save_label ( char *label , expr_t val );
 int     find_label ( char *label );
+void    hash_labels( void );
+void    inst_index_free ( void );
 
 /* wrtobj.c */
-void    wrtobj     ( pc_t  firstpc, pc_t  lastpc, ushort bytes_per_rec);
+void    wrtobj     ( pc_t  firstpc, pc_t  lastpc, ushort bytes_per_rec,
+                     int contiguous );
 void    wrtlastobj ( obj_t obj_type );
+void    wrtobj_reset ( void );
+
+/* memimage.c */
+void     mem_put        ( pc_t pc, ubyte op );
+ubyte    mem_get        ( pc_t pc );
+void     mem_read       ( pc_t pc, ubyte *buf, size_t n );
+void     mem_fill       ( ubyte fillbyte );
+int      mem_run        ( pc_t *first, pc_t *last, pc_t limit );
+void     mem_free       ( void );
+
+/* arena.c */
+void    *arena_alloc    ( arena_t region, size_t size );
+char    *arena_strsave  ( arena_t region, char *s );
+ARMARK   arena_mark     ( arena_t region );
+void     arena_release  ( arena_t region, ARMARK mark );
+void     arena_reset    ( arena_t region );
+void     arena_free     ( arena_t region );
+
+/* srccache.c */
+SRCREAD *src_open       ( char *source_file );
+char    *src_gets       ( SRCREAD *src );
+char    *src_expand     ( SRCREAD *src, char *buf );
+PARSED  *src_parsed     ( SRCREAD *src, int offset );
+void     src_save_parsed( SRCREAD *src, int offset, PARSED *pp );
+void     src_close      ( SRCREAD *src );
+void     src_free       ( void );
+
+/* build.c */
+void    build_start   ( void );
+void    build_dep     ( char *name, char *parent );
+int     build_current ( int argc, char **argv, char *obj_file,
+                        char **required, int nrequired );
+void    build_save    ( int argc, char **argv, char *obj_file,
+                        char **outputs, int noutputs, int success );
+void    build_free    ( void );
 
 /* fname.c */
 void    fname_push  ( char * fname );
@@ -22,8 +22,29 @@
 
 #include "tasm.h"
 #include <setjmp.h>
+#include <pthread.h>
 
-static jmp_buf Jump_buffer;    /* State information from return point */
+#define BATCH_THREADS   4       /* Default number of jobs run at once   */
+#define MAXJOBARGS      64      /* Most arguments on one job line       */
+
+/* One assembly of a batch */
+typedef struct{
+        int     argc;
+        char    *argv[MAXJOBARGS+1];
+        char    *line;          /* The job line (argv points into it)   */
+        FILE    *console;       /* Its messages, until they're shown    */
+        int     exit_code;
+        int     done;           /* TRUE once it has finished            */
+        pthread_t thread;
+}JOB;
+
+static ASMSTATE jmp_buf Jump_buffer;    /* State information from return point */
+
+static pthread_mutex_t  Batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   Batch_done = PTHREAD_COND_INITIALIZER;
+static int              Batch_running;  /* Jobs running now             */
+
+static int  batch ( char *job_file, int nthreads );
 
 
 /*
@@ -38,6 +59,12 @@ main(int argc, char *argv[])
 {
     int	exit_code;
 
+    /* tasm -batch job_file [threads] */
+    if ((argc >= 3) && (strcmp(argv[1], "-batch") == SAME))
+    {
+        exit(batch(argv[2], (argc > 3) ? atoi(argv[3]) : BATCH_THREADS));
+    }
+
     /* Setup the jump buffer for fatal exits */
 
     exit_code = setjmp ( Jump_buffer );
@@ -63,3 +90,213 @@ tasmexit ( int exit_code )
     longjmp ( Jump_buffer, exit_code );
 
 }
+
+/*
+ * Function: batch_job()
+ *
+ * Description:
+ *     Thread to run one job of a batch.  The thread is new, so all of
+ *     the assembler's (thread local) state starts out just as it does
+ *     in a new process.
+ */
+
+static void *
+batch_job(void *arg)
+{
+    extern ASMSTATE FILE *Fp_console;
+
+    JOB     *job = (JOB *)arg;
+    int     exit_code;
+
+    Fp_console = job->console;
+
+    exit_code = setjmp ( Jump_buffer );
+    if ( exit_code == 0 ) exit_code = tasm (job->argc, job->argv);
+
+    pthread_mutex_lock(&Batch_lock);
+    job->exit_code = exit_code;
+    job->done      = TRUE;
+    Batch_running--;
+    pthread_cond_signal(&Batch_done);
+    pthread_mutex_unlock(&Batch_lock);
+
+    return(NULL);
+}
+
+/*
+ * Function: batch_parse()
+ *
+ * Description:
+ *     Split a job line into arguments, as the shell would for a tasm
+ *     command line (double quotes group words).  Returns the number of
+ *     arguments, not counting argv[0].
+ */
+
+static int
+batch_parse(char *s, char *argv[])
+{
+    int     argc;
+    char    *p;
+
+    argc = 0;
+    argv[argc++] = "tasm";
+
+    while (argc < MAXJOBARGS)
+    {
+        while (isspace(*s)) s++;
+        if (*s == '\0') break;
+
+        argv[argc++] = p = s;
+        while ((*s != '\0') && !isspace(*s))
+        {
+            if (*s == '"')
+            {
+                s++;
+                while ((*s != '\0') && (*s != '"')) *p++ = *s++;
+                if (*s == '"') s++;
+            }
+            else
+            {
+                *p++ = *s++;
+            }
+        }
+        if (*s != '\0') s++;
+        *p = '\0';
+    }
+    argv[argc] = NULL;
+
+    return (argc - 1);
+}
+
+/*
+ * Function: batch()
+ *
+ * Description:
+ *     Run every job in a job file, up to nthreads at a time.  Each line
+ *     of the file is the arguments of one tasm command (blank lines and
+ *     lines starting with '#' are ignored).  The instruction tables are
+ *     loaded once and shared by all the jobs.
+ *
+ *     The jobs' messages are shown in the order of the job file, each
+ *     followed by its exit code (the code tasm would have exited with
+ *     for that command).  Returns the highest exit code of any job.
+ */
+
+static int
+batch(char *job_file, int nthreads)
+{
+    FILE    *fp;
+    JOB     *jobs = NULL;
+    JOB     *job;
+    int     njobs = 0;
+    int     maxjobs = 0;
+    int     next;
+    int     shown;
+    int     worst = EXIT_NORMAL;
+    int     c;
+    int     i;
+    char    buf[LINESIZE];
+
+    if ((fp = fopen(job_file, "r")) == NULL)
+    {
+        sprintf(buf, "tasm: Cannot open job file %.128s\n", job_file);
+        errprt(buf);
+        return (EXIT_FILEACCESS);
+    }
+
+    while (fgets(buf, LINESIZE-1, fp) != NULL)
+    {
+        if (njobs >= maxjobs)
+        {
+            maxjobs = (maxjobs == 0) ? 64 : maxjobs*2;
+            jobs = (JOB *)realloc(jobs, maxjobs * sizeof(JOB));
+            if (jobs == NULL)
+            {
+                errprt("tasm: Cannot malloc for batch jobs\n");
+                return (EXIT_MALLOC);
+            }
+        }
+
+        job = &jobs[njobs];
+        if ((job->line = (char *)malloc(strlen(buf) + 1)) == NULL)
+        {
+            errprt("tasm: Cannot malloc for batch jobs\n");
+            return (EXIT_MALLOC);
+        }
+        job->argc = batch_parse(strcpy(job->line, buf), job->argv) + 1;
+        if ((job->argc == 1) || (*job->argv[1] == '#'))
+        {
+            free(job->line);
+            continue;
+        }
+        job->done = FALSE;
+        job->exit_code = EXIT_NORMAL;
+        njobs++;
+    }
+    fclose(fp);
+
+    if (nthreads < 1) nthreads = 1;
+
+    table_share(TRUE);
+
+    next  = 0;
+    shown = 0;
+    pthread_mutex_lock(&Batch_lock);
+    while (shown < njobs)
+    {
+        /* Start as many as we're allowed */
+        while ((next < njobs) && (Batch_running < nthreads))
+        {
+            job = &jobs[next];
+            if ((job->console = tmpfile()) == NULL) job->console = stdout;
+            if (pthread_create(&job->thread, NULL, batch_job, job) != 0)
+            {
+                /* Try again when one finishes */
+                if (job->console != stdout) fclose(job->console);
+                break;
+            }
+            Batch_running++;
+            next++;
+        }
+        if (shown == next)
+        {
+            /* Nothing running, and we couldn't start anything */
+            errprt("tasm: Cannot start batch job\n");
+            break;
+        }
+
+        /* Show the ones that are done, in order */
+        while ((shown < next) && jobs[shown].done)
+        {
+            job = &jobs[shown++];
+            pthread_mutex_unlock(&Batch_lock);
+
+            pthread_join(job->thread, NULL);
+            if (job->console != stdout)
+            {
+                rewind(job->console);
+                while ((c = getc(job->console)) != EOF) putchar(c);
+                fclose(job->console);
+            }
+            for (i = 1; (i < job->argc-1) && (*job->argv[i] == '-'); i++) ;
+            printf("tasm: job %d (%s) exit code %d\n",
+                   shown, job->argv[i], job->exit_code);
+            fflush(stdout);
+            worst = max(worst, job->exit_code);
+
+            pthread_mutex_lock(&Batch_lock);
+        }
+
+        if ((shown < next) && !jobs[shown].done)
+            pthread_cond_wait(&Batch_done, &Batch_lock);
+    }
+    pthread_mutex_unlock(&Batch_lock);
+
+    table_share(FALSE);
+
+    for (job = jobs; job < &jobs[njobs]; job++) free(job->line);
+    free(jobs);
+
+    if (shown < njobs) return (EXIT_FATALERROR);
+    return (worst);
+}
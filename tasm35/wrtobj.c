@@ -28,7 +28,118 @@
 #endif
 
 /* EXTERNALS */
-extern  ushort  Debug;
+extern ASMSTATE  ushort  Debug;
+
+#define OBJBUFSIZE      0x10000 /* Size of the object output buffer     */
+#define MAXRECBYTES     255     /* Most bytes a record's count can cover */
+
+/* STATIC */
+static  ASMSTATE pc_t    Obj_upper   = 0;    /* Upper address bits of the last Intel
+                                     * extended linear address record     */
+static  ASMSTATE int     Obj_srec    = 1;    /* Widest S record written (1,2 or 3) */
+
+static  ASMSTATE char    Objbuf[OBJBUFSIZE]; /* Output waiting to be written       */
+static  ASMSTATE size_t  Objlen      = 0;    /* Bytes in Objbuf                    */
+static  ASMSTATE ushort  Objsum;             /* Sum of the bytes in this record    */
+static  const char Hexdigit[] = "0123456789ABCDEF";
+
+static  void    wrtrecs ( pc_t  firstpc, pc_t  lastpc, ushort bytes_per_rec);
+
+/*
+ * Function: obj_flush()
+ *
+ * Description:
+ *     Write out whatever is in the object output buffer.
+ */
+
+static void
+obj_flush(void)
+{
+    extern ASMSTATE  FILE        *Fp_object;
+
+    if(Objlen > 0) fwrite(Objbuf, 1, Objlen, Fp_object);
+    Objlen = 0;
+}
+
+/*
+ * Function: obj_room()
+ *
+ * Description:
+ *     Make sure there are n bytes free in the object output buffer and
+ *     return a pointer to them.
+ */
+
+static char *
+obj_room(size_t n)
+{
+    if(Objlen + n > OBJBUFSIZE) obj_flush();
+    return(&Objbuf[Objlen]);
+}
+
+/*
+ * Function: obj_puts()
+ *
+ * Description:
+ *     Add a string to the object output.  This also starts a new
+ *     record checksum.
+ */
+
+static void
+obj_puts(char *s)
+{
+    size_t n = strlen(s);
+
+    memcpy(obj_room(n), s, n);
+    Objlen += n;
+    Objsum  = 0;
+}
+
+/*
+ * Function: obj_hex()
+ *
+ * Description:
+ *     Add n bytes to the object output in hex, adding them to the
+ *     record checksum.
+ */
+
+static void
+obj_hex(ubyte *bytes, ushort n)
+{
+    char    *p;
+    ushort  sum;
+    ushort  i;
+    ubyte   b;
+
+    p   = obj_room(2 * (size_t)n);
+    sum = Objsum;
+    for(i = 0; i < n; i++)
+    {
+        b    = bytes[i];
+        sum += b;
+        *p++ = Hexdigit[b >> 4];
+        *p++ = Hexdigit[b & 0xf];
+    }
+    Objsum  = sum;
+    Objlen += 2 * (size_t)n;
+}
+
+/*
+ * Function: obj_value()
+ *
+ * Description:
+ *     Add the low n bytes of a value (most significant first) to the
+ *     object output in hex, adding them to the record checksum.
+ */
+
+static void
+obj_value(ulong val, ushort n)
+{
+    ubyte   bytes[4];
+    ushort  i;
+
+    for(i = n; i-- > 0; val >>= 8) bytes[i] = (ubyte)(val & 0xff);
+    obj_hex(bytes, n);
+}
 
 /*
  * Function: wrtobj()
@@ -38,27 +149,28 @@ extern  ushort  Debug;
  *     Write in the object format selected on the command line (Intel
  *     hex as default).
  *
+ *     Unless a contiguous block is asked for (or the output is binary)
+ *     only the bytes that were actually written are output, so gaps
+ *     in the range don't cost anything.
+ *
  */
 
 void
 wrtobj(
 pc_t    firstpc,        /* Byte address of the first object byte      */
 pc_t    lastpc,         /* Byte address of the last object byte + 1   */
-ushort  bytes_per_rec)  /* Number of bytes per hex record             */
+ushort  bytes_per_rec,  /* Number of bytes per hex record             */
+int     contiguous)     /* TRUE to output the gaps too (as fill)      */
 {
-    ushort   i;
-    ushort   checksum;
-    ushort   rec_type;
-    ushort   nbytes;
-    char    buf[LINESIZE];
-    char    *p;
-    ubyte   op;
+    size_t  n;
     pc_t    pc;
+    pc_t    endpc;
+    ulong   start;
 
-    extern  obj_t       Obj_format;
-    extern  FILE        *Fp_object;
-    extern  pc_t        First_pc;
-    extern  int         Codegen;
+    extern ASMSTATE  obj_t       Obj_format;
+    extern ASMSTATE  pc_t        First_pc;
+    extern ASMSTATE  int         Codegen;
+    extern ASMSTATE  STATS       Stats;
 
     DEBUG2("wrtobj: %lx %lx\n",firstpc, lastpc);
 
@@ -66,104 +178,178 @@ ushort  bytes_per_rec)  /* Number of bytes per hex record             */
     if((lastpc == firstpc) && (First_pc > 0))return;
     if((lastpc == firstpc) && (Codegen == FALSE))return;
 
+    start = (Stats.enabled) ? stat_usecs() : 0;
     pc = firstpc;
  
     if(Obj_format == BINARY_OBJ)
     {
+        /* Straight from the memory image, a buffer full at a time */
         while(pc < lastpc)
         {
-            op = getop(pc++);
-            fwrite((char *)&op,1,1,Fp_object);
+            n = OBJBUFSIZE - Objlen;
+            if(n > lastpc - pc) n = lastpc - pc;
+            mem_read(pc, (ubyte *)&Objbuf[Objlen], n);
+            Objlen += n;
+            pc     += n;
+            if(Objlen == OBJBUFSIZE) obj_flush();
         }
 
     } 
+    else if(contiguous)
+    {
+        wrtrecs(firstpc, lastpc, bytes_per_rec);
+    }
     else
     {
-
-        while(pc < lastpc)
+        /* One set of records for each run of bytes written */
+        while(mem_run(&pc, &endpc, lastpc))
         {
-            nbytes = (ushort)(lastpc - pc); 
-            if(nbytes > bytes_per_rec)nbytes = bytes_per_rec;
-            if(nbytes == 0)return;
+            wrtrecs(pc, endpc, bytes_per_rec);
+            pc = endpc;
+        }
+    }
 
-            rec_type = 0;
-            checksum = nbytes + rec_type + (ushort)(pc & 0xff) + 
-                                           (ushort)((pc >> 8) & 0xff);
-            p = buf;
+    obj_flush();
+    if(Stats.enabled) Stats.t_wrtobj += stat_usecs() - start;
+}
 
-            switch (Obj_format){
-            case MOSTECH_OBJ:
-                sprintf(buf,";%02X%04lX",nbytes,pc);
-                break;
+/*
+ * Function: wrtrecs()
+ *
+ * Description:
+ *     Write the hex records for a range of the memory image.
+ *     Addresses above 16 bits get Intel type 04 (extended linear
+ *     address) records or Motorola S2/S3 records.  Records never
+ *     cross a 64K boundary in the Intel formats.
+ *
+ *     bytes_per_rec is limited to what the record count can hold;
+ *     zero means as many as that allows.
+ *
+ */
+
+static void
+wrtrecs(
+pc_t    firstpc,        /* Byte address of the first object byte      */
+pc_t    lastpc,         /* Byte address of the last object byte + 1   */
+ushort  bytes_per_rec)  /* Number of bytes per hex record             */
+{
+    ushort   checksum;
+    ushort   nbytes;
+    ushort   maxbytes;
+    ushort   srec;
+    ubyte    data[MAXRECBYTES];
+    pc_t    pc;
+    pc_t    addr;
+    pc_t    limit;
 
-            case INTEL_OBJ:
-                sprintf(buf,":%02X%04lX%02X",nbytes,pc,rec_type);
-                break;
+    extern ASMSTATE  obj_t       Obj_format;
+    extern ASMSTATE  char        Errorbuf[];
 
-            case INTELWORD_OBJ:
-                /* Same as INTEL_OBJ, but convert PC to a word address */
-                sprintf(buf,":%02X%04lX%02X",nbytes,(pc>>1),rec_type);
-                break;
+    pc = firstpc;
+    srec = 1;
 
-            case MOTOROLA_OBJ:
-                sprintf(buf,"S1%02X%04lX",(nbytes+3),pc);
-                break;
+    /* Motorola counts the address and checksum too (allow for S3) */
+    maxbytes = (Obj_format == MOTOROLA_OBJ) ? (MAXRECBYTES - 5) : MAXRECBYTES;
+    if((bytes_per_rec == 0) || (bytes_per_rec > maxbytes)) bytes_per_rec = maxbytes;
 
-				/* Should not get here (handled above).  Put here for lint */
-            case BINARY_OBJ:
-                break;
+    while(pc < lastpc)
+    {
+        limit = lastpc - pc;
+        if(limit > bytes_per_rec)limit = bytes_per_rec;
+        nbytes = (ushort)limit;
 
-            default:
-                errlog("Invalid Object file type.", PASS2_ONLY);
-                break;
+        /* The address that goes in the record */
+        addr = (Obj_format == INTELWORD_OBJ) ? (pc >> 1) : pc;
 
-            }
+        switch (Obj_format){
+        case INTEL_OBJ:
+        case INTELWORD_OBJ:
+            /* Stop at the next 64K boundary (of the record address) */
+            limit = (Obj_format == INTELWORD_OBJ) ? 
+                        ((pc | 0x1ffffL) + 1) : ((pc | 0xffffL) + 1);
+            if(pc + nbytes > limit) nbytes = (ushort)(limit - pc);
 
-            for(i = 0; i < nbytes; i++)
+            /* Set the upper 16 bits first if they have changed */
+            if((addr >> 16) != Obj_upper)
             {
-                op = getop(pc++);
-                checksum += op;
-                while(*(++p)) /* void */;
-                sprintf(p,"%02X",op);
+                Obj_upper = addr >> 16;
+                obj_puts(":");
+                obj_value(0x020000L, 3);
+                obj_value(0x04, 1);
+                obj_value(Obj_upper, 2);
+                obj_value(((~Objsum)+1) & 0xff, 1);
+                obj_puts("\n");
             }
 
-            while(*(++p)) /* void */ ;
-
-            switch (Obj_format){
-            case MOSTECH_OBJ:
-                sprintf(p,"%04X\n",checksum);
-                break;
-
-            case INTELWORD_OBJ:
-            case INTEL_OBJ:
-                /* For Intel we need to negate the checksum and mask.
-                 * Invert and add one (instead of negate) since we are
-                 * using unsigned types.
-                 */
-                checksum = ((~checksum)+1) & 0xff;
-                sprintf(p,"%02X\n",checksum);
-                break;
-
-            case MOTOROLA_OBJ:
-                checksum = (~((ushort)checksum+3)) & 0xff;
-                sprintf(p,"%02X\n",checksum);
-                break;
-
-            /* Just for completness */
-            case BINARY_OBJ:
-                break;
-
-            default:
-                errlog("Invalid Object file type.", PASS2_ONLY);
-                break;
+            obj_puts(":");
+            obj_value(nbytes, 1);
+            obj_value(addr & 0xffff, 2);
+            obj_value(0, 1);                    /* record type */
+            break;
+
+        case MOTOROLA_OBJ:
+            if     ((pc + nbytes - 1) <= 0xffffL)   srec = 1;
+            else if((pc + nbytes - 1) <= 0xffffffL) srec = 2;
+            else                                    srec = 3;
+            if(srec > Obj_srec) Obj_srec = srec;
+
+            /* The count includes the address and checksum bytes */
+            obj_puts((srec == 1) ? "S1" : (srec == 2) ? "S2" : "S3");
+            obj_value(nbytes + srec + 2, 1);
+            obj_value(addr, srec + 1);
+            break;
+
+        case MOSTECH_OBJ:
+            if((pc + nbytes - 1) > 0xffffL)
+            {
+                sprintf(Errorbuf,"%lX",pc);
+                errlog("Address too big for MOS Tech object:", PASS2_ONLY);
+                return;
             }
-                                /* Advance the pointer to the end       */
-                                /* just so we can compute the size of   */
-                                /* the buffer.                          */
-            while(*(++p)) /* void */ ;
+            obj_puts(";");
+            obj_value(nbytes, 1);
+            obj_value(addr, 2);
+            break;
 
-            fwrite(buf,1,(p-buf),Fp_object);
+			/* Should not get here (handled in wrtobj).  Put here for lint */
+        case BINARY_OBJ:
+            break;
+
+        default:
+            errlog("Invalid Object file type.", PASS2_ONLY);
+            return;
+        }
+
+        mem_read(pc, data, nbytes);
+        obj_hex(data, nbytes);
+        pc += nbytes;
+
+        switch (Obj_format){
+        case MOSTECH_OBJ:
+            obj_value(Objsum, 2);
+            break;
+
+        case INTELWORD_OBJ:
+        case INTEL_OBJ:
+            /* For Intel we need to negate the checksum and mask.
+             * Invert and add one (instead of negate) since we are
+             * using unsigned types.
+             */
+            checksum = ((~Objsum)+1) & 0xff;
+            obj_value(checksum, 1);
+            break;
+
+        case MOTOROLA_OBJ:
+            checksum = (~Objsum) & 0xff;
+            obj_value(checksum, 1);
+            break;
+
+        /* Just for completness */
+        case BINARY_OBJ:
+        default:
+            break;
         }
+        obj_puts("\n");
     }
 }
 
@@ -180,9 +366,7 @@ ushort  bytes_per_rec)  /* Number of bytes per hex record             */
 
 void wrtlastobj(obj_t obj_format)
 {
-    ushort checksum;
     ushort nbytes = 3;    /* Motorola S9 record has only 3 data bytes */
-    char  buf[LINESIZE];
 
     /* last record to write into obj file.  Indexed by obj format */
     /* no such record if binary format selected */
@@ -193,32 +377,53 @@ void wrtlastobj(obj_t obj_format)
                                "",                  /* Binary (not used)  */
                                ":00000001FF\n"};    /* INTEL-WORD format  */
     
-    extern   FILE  *Fp_object;
-    extern   pc_t  END_Pc;
+    extern ASMSTATE   pc_t  END_Pc;
 
     switch (obj_format){
                                 /* These are a fixed format for now */
         case MOSTECH_OBJ:
         case INTEL_OBJ:
         case INTELWORD_OBJ:
-            fwrite(last_obj_rec[(int)obj_format],1,
-                strlen(last_obj_rec[(int)obj_format]), Fp_object);
+            obj_puts(last_obj_rec[(int)obj_format]);
             break;
 
         case MOTOROLA_OBJ:
                                 /* If an address was specified with the END */
-                                /* directive then apply it now              */
-
-            checksum = nbytes  + (ushort)(END_Pc >> 8) + (ushort)(END_Pc & 0xff);
-            checksum = (0xffff - checksum) & 0xff;
-            sprintf(buf,"S9%02X%04X%02X\n",nbytes,(int)END_Pc,checksum);
-            fwrite(buf, 1, strlen(buf), Fp_object);
+                                /* directive then apply it now.  Use the    */
+                                /* S8 or S7 record to match any S2 or S3    */
+                                /* records (or a big END address).          */
+
+            if(END_Pc > 0xffffffL)      Obj_srec = 3;
+            else if(END_Pc > 0xffffL)   Obj_srec = max(Obj_srec, 2);
+            nbytes += Obj_srec - 1;
+
+            obj_puts((Obj_srec == 1) ? "S9" : (Obj_srec == 2) ? "S8" : "S7");
+            obj_value(nbytes, 1);
+            obj_value(END_Pc, Obj_srec + 1);
+            obj_value((~Objsum) & 0xff, 1);
+            obj_puts("\n");
             break;
 
         case BINARY_OBJ:
         default:
             break;
         }
+
+    obj_flush();
+}
+
+/* 
+ * Function: wrtobj_reset()
+ *
+ * Description:
+ *      Forget the extended address state of the last object file.
+ */
+
+void wrtobj_reset(void)
+{
+    Obj_upper = 0;
+    Obj_srec  = 1;
+    Objlen    = 0;
 }
 
 /* that's all folks */